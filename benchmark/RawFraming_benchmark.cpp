@@ -0,0 +1,136 @@
+/** @file
+ *
+ * @brief Compares the raw framing transports with the WebSocket ones they replace, i.e. RAWTLS with TLS and RAWTCP with PLAIN.
+ *
+ * For each transport a Server and Client are connected over the loopback interface. Prints the round trip
+ * time of one small request at a time, the throughput of small requests when many are in flight at once,
+ * and the throughput of 64 KiB requests. The TLS transports need the test certificates, so run it from the
+ * top of the source tree or give the directory they're in as the only argument.
+ *
+ * UNIXSOCKET and SHAREDMEMORY are measured as well for comparison, the latter both going to sleep straight
+ * away and busy polling for a while first. Busy polling only helps if both ends have a core to themselves.
+ */
+#include <communique/Server.h>
+#include <communique/Client.h>
+#include <vector>
+#include <future>
+#include <thread>
+#include <chrono>
+#include <string>
+#include <iostream>
+#include <iomanip>
+#include <stdexcept>
+
+//
+// Unnamed namespace for things only used in this file
+//
+namespace
+{
+	struct Result
+	{
+		double roundTripMicroseconds;
+		double smallRequestsPerSecond;
+		double largeMegabytesPerSecond;
+	};
+
+	/** @brief Sends the requests in batches, waiting for each batch to be answered before sending the next. Returns the time taken in seconds. */
+	double timeRequests( communique::Client& client, const std::string& message, size_t numberOfRequests, size_t batchSize )
+	{
+		std::vector< std::future<std::string> > responses;
+		responses.reserve( batchSize );
+		auto startTime=std::chrono::steady_clock::now();
+		for( size_t sent=0; sent<numberOfRequests; sent+=batchSize )
+		{
+			for( size_t index=0; index<batchSize; ++index ) responses.push_back( client.sendRequest( message ) );
+			for( auto& response : responses )
+			{
+				if( response.get().size()!=message.size() ) throw std::runtime_error( "Benchmark got the wrong response" );
+			}
+			responses.clear();
+		}
+		return std::chrono::duration<double>( std::chrono::steady_clock::now()-startTime ).count();
+	}
+
+	struct Configuration
+	{
+		const char* name;
+		communique::Transport transport;
+		const char* scheme;
+		std::chrono::microseconds busyPollTime; ///< Only used by SHAREDMEMORY
+		bool usesSocketPath; ///< True for the transports that listen on a filesystem path rather than a port
+	};
+
+	Result measure( const Configuration& configuration, size_t port, const std::string& certificateDirectory )
+	{
+		communique::Server server( configuration.transport );
+		server.setCertificateChainFile( certificateDirectory+"server_cert.pem" );
+		server.setPrivateKeyFile( certificateDirectory+"server_key.pem" );
+		server.setBusyPollTime( configuration.busyPollTime );
+		server.setDefaultRequestHandler( [](const std::string& message){ return message; } );
+
+		communique::Client client( configuration.transport );
+		client.setVerifyFile( certificateDirectory+"certificateAuthority_cert.pem" );
+		client.setBusyPollTime( configuration.busyPollTime );
+		if( configuration.usesSocketPath )
+		{
+			const std::string socketPath="/tmp/communiqueBenchmark"+std::to_string(port)+".sock";
+			server.listen( socketPath );
+			client.connect( configuration.scheme+std::string("://")+socketPath );
+		}
+		else
+		{
+			server.listen( port );
+			client.connect( configuration.scheme+std::string("://localhost:")+std::to_string(port) );
+		}
+		if( !client.isConnected() ) throw std::runtime_error( std::string("Benchmark couldn't connect using ")+configuration.scheme );
+
+		// Warm up, so that nothing is being allocated for the first time during the measurements
+		timeRequests( client, "warm up", 1000, 100 );
+
+		Result result;
+		const size_t numberOfRoundTrips=10000;
+		result.roundTripMicroseconds=timeRequests( client, "x", numberOfRoundTrips, 1 )/numberOfRoundTrips*1e6;
+		const size_t numberOfSmallRequests=100000;
+		result.smallRequestsPerSecond=numberOfSmallRequests/timeRequests( client, std::string(32,'x'), numberOfSmallRequests, 256 );
+		const size_t numberOfLargeRequests=2000;
+		const std::string largeMessage( 64*1024, 'x' );
+		result.largeMegabytesPerSecond=numberOfLargeRequests*largeMessage.size()/timeRequests( client, largeMessage, numberOfLargeRequests, 16 )/1e6;
+
+		client.disconnect();
+		server.stop();
+		return result;
+	}
+} // end of the unnamed namespace
+
+int main( int argc, char* argv[] )
+{
+	const std::string certificateDirectory=( argc>1 ? std::string(argv[1])+"/" : std::string("test/testData/") );
+	const Configuration configurations[]={
+		{ "TLS", communique::Transport::TLS, "ws", std::chrono::microseconds(0), false },
+		{ "RAWTLS", communique::Transport::RAWTLS, "tls", std::chrono::microseconds(0), false },
+		{ "PLAIN", communique::Transport::PLAIN, "ws", std::chrono::microseconds(0), false },
+		{ "RAWTCP", communique::Transport::RAWTCP, "tcp", std::chrono::microseconds(0), false },
+		{ "UNIXSOCKET", communique::Transport::UNIXSOCKET, "unix", std::chrono::microseconds(0), true },
+#ifndef COMMUNIQUE_NO_SHAREDMEMORY
+		{ "SHM", communique::Transport::SHAREDMEMORY, "shm", std::chrono::microseconds(0), true },
+		{ "SHM+POLL", communique::Transport::SHAREDMEMORY, "shm", std::chrono::microseconds(50), true }
+#endif
+	};
+
+	size_t port=29170;
+	std::cout << std::setw(12) << "transport" << std::setw(20) << "round trip (us)" << std::setw(24) << "small requests (k/s)" << std::setw(24) << "64 KiB requests (MB/s)" << std::endl;
+	for( const auto& configuration : configurations )
+	{
+		try
+		{
+			Result result=measure( configuration, ++port, certificateDirectory );
+			std::cout << std::setw(12) << configuration.name << std::setw(20) << result.roundTripMicroseconds
+				<< std::setw(24) << result.smallRequestsPerSecond/1e3 << std::setw(24) << result.largeMegabytesPerSecond << std::endl;
+		}
+		catch( const std::exception& error )
+		{
+			std::cout << std::setw(12) << configuration.name << "  failed: " << error.what() << std::endl;
+		}
+	}
+	return 0;
+}
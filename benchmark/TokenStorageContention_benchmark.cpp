@@ -0,0 +1,70 @@
+/** @file
+ *
+ * @brief Measures how UniqueTokenStorage and ShardedUniqueTokenStorage scale with the number of threads using them.
+ *
+ * Each thread behaves like an application thread sending requests on a shared connection: it keeps a
+ * window of requests outstanding, and each iteration completes (pops) the oldest and sends (pushes) a
+ * new one. Prints the total throughput for each number of threads.
+ */
+#include <communique/impl/UniqueTokenStorage.h>
+#include <communique/impl/ShardedUniqueTokenStorage.h>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <iomanip>
+#include <stdexcept>
+
+//
+// Unnamed namespace for things only used in this file
+//
+namespace
+{
+	typedef std::function<void(const std::string&)> handler_type;
+
+	/** @brief Returns the total number of pop/push pairs per second across all threads. */
+	template<class T_Storage>
+	double operationsPerSecond( size_t numberOfThreads, size_t iterationsPerThread )
+	{
+		const size_t window=64; // Number of requests each thread keeps in flight
+		T_Storage storage;
+		handler_type handler=[](const std::string&){};
+
+		auto threadFunction=[&]()
+		{
+			std::deque<uint32_t> tokens;
+			for( size_t index=0; index<window; ++index ) tokens.push_back( storage.push(handler) );
+			for( size_t iteration=0; iteration<iterationsPerThread; ++iteration )
+			{
+				handler_type retrievedHandler;
+				if( !storage.pop( tokens.front(), retrievedHandler ) ) throw std::runtime_error( "Benchmark couldn't find a token that was stored" );
+				tokens.pop_front();
+				tokens.push_back( storage.push(handler) );
+			}
+			for( const auto& token : tokens ) storage.pop(token);
+		};
+
+		auto startTime=std::chrono::steady_clock::now();
+		std::vector<std::thread> threads;
+		for( size_t index=0; index<numberOfThreads; ++index ) threads.emplace_back( threadFunction );
+		for( auto& thread : threads ) thread.join();
+		auto endTime=std::chrono::steady_clock::now();
+
+		return numberOfThreads*iterationsPerThread/std::chrono::duration<double>(endTime-startTime).count();
+	}
+} // end of the unnamed namespace
+
+int main( int argc, char* argv[] )
+{
+	const size_t iterationsPerThread=500000;
+	std::cout << std::setw(8) << "threads" << std::setw(24) << "single lock (Mops/s)" << std::setw(24) << "sharded (Mops/s)" << std::endl;
+	for( size_t numberOfThreads : { 1, 2, 4, 8, 16 } )
+	{
+		double singleLock=operationsPerSecond< communique::impl::UniqueTokenStorage<handler_type,uint32_t> >( numberOfThreads, iterationsPerThread );
+		double sharded=operationsPerSecond< communique::impl::ShardedUniqueTokenStorage<handler_type,uint32_t> >( numberOfThreads, iterationsPerThread );
+		std::cout << std::setw(8) << numberOfThreads << std::setw(24) << singleLock/1e6 << std::setw(24) << sharded/1e6 << std::endl;
+	}
+	return 0;
+}
@@ -0,0 +1,112 @@
+/** @file
+ *
+ * @brief Compares the slot map implementation of UniqueTokenStorage against the original std::list version.
+ *
+ * For several numbers of outstanding entries, fills the container and then repeatedly pops a random
+ * outstanding token and pushes a replacement, which is what a connection with that many requests in
+ * flight does. Prints the average time for each pop/push pair.
+ */
+#include <communique/impl/UniqueTokenStorage.h>
+#include <list>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <mutex>
+
+//
+// Unnamed namespace for things only used in this file
+//
+namespace
+{
+	/** @brief The original std::list based implementation, kept here for comparison. */
+	template<class T_Element,class T_Token=uint32_t>
+	class ListTokenStorage
+	{
+	public:
+		T_Token push( const T_Element& newElement )
+		{
+			std::lock_guard<std::mutex> guard(lockMutex_);
+			auto tokenIteratorPair=getFreeToken();
+			container_.emplace( tokenIteratorPair.second, tokenIteratorPair.first, newElement );
+			return tokenIteratorPair.first;
+		}
+		bool pop( const T_Token& token, T_Element& returnValue ) noexcept
+		{
+			std::lock_guard<std::mutex> guard(lockMutex_);
+			auto iEntry=container_.begin();
+			for( ; iEntry!=container_.end(); ++iEntry )
+			{
+				if( token==iEntry->first ) break;
+			}
+			if( iEntry==container_.end() ) return false;
+			returnValue=std::move( iEntry->second );
+			container_.erase( iEntry );
+			return true;
+		}
+	private:
+		std::pair<T_Token,typename std::list< std::pair<T_Token,T_Element> >::iterator> getFreeToken()
+		{
+			T_Token token;
+			if( container_.empty() ) return std::make_pair( std::numeric_limits<T_Token>::min(), container_.begin() );
+			token=container_.back().first;
+			if( token!=std::numeric_limits<T_Token>::max() ) return std::make_pair( ++token, container_.end() );
+			token=container_.front().first;
+			if( token!=std::numeric_limits<T_Token>::min() ) return std::make_pair( --token, container_.begin() );
+			auto iEntry=container_.begin();
+			for( ; iEntry!=container_.end(); ++iEntry, ++token )
+			{
+				if( token!=iEntry->first ) break;
+			}
+			if( iEntry==container_.end() ) throw std::runtime_error( "ListTokenStorage::push couldn't find free space" );
+			return std::make_pair( token, iEntry );
+		}
+		std::list< std::pair<T_Token,T_Element> > container_;
+		std::mutex lockMutex_;
+	};
+
+	typedef std::function<void(const std::string&)> handler_type;
+
+	/** @brief Returns the average time in nanoseconds for a pop and push with "outstanding" entries stored. */
+	template<class T_Storage>
+	double timePopPush( size_t outstanding, size_t iterations )
+	{
+		T_Storage storage;
+		std::vector<uint32_t> tokens;
+		handler_type handler=[](const std::string&){};
+		for( size_t index=0; index<outstanding; ++index ) tokens.push_back( storage.push(handler) );
+
+		std::mt19937 generator(42);
+		std::uniform_int_distribution<size_t> distribution( 0, outstanding-1 );
+
+		auto startTime=std::chrono::steady_clock::now();
+		for( size_t iteration=0; iteration<iterations; ++iteration )
+		{
+			// Responses don't come back in order, so pick a random request to complete
+			size_t position=distribution(generator);
+			handler_type retrievedHandler;
+			if( !storage.pop( tokens[position], retrievedHandler ) ) throw std::runtime_error( "Benchmark couldn't find a token that was stored" );
+			tokens[position]=storage.push(handler);
+		}
+		auto endTime=std::chrono::steady_clock::now();
+
+		return std::chrono::duration<double,std::nano>(endTime-startTime).count()/iterations;
+	}
+} // end of the unnamed namespace
+
+int main( int argc, char* argv[] )
+{
+	std::cout << std::setw(12) << "outstanding" << std::setw(20) << "std::list (ns/op)" << std::setw(20) << "slot map (ns/op)" << std::endl;
+	for( size_t outstanding : { 1, 1000, 100000 } )
+	{
+		// The list version is O(n), so use fewer iterations for large n to keep the run time sensible
+		size_t listIterations=std::max<size_t>( 1000, 100000000/outstanding/100 );
+		double listTime=timePopPush< ListTokenStorage<handler_type,uint32_t> >( outstanding, listIterations );
+		double slotMapTime=timePopPush< communique::impl::UniqueTokenStorage<handler_type,uint32_t> >( outstanding, 1000000 );
+		std::cout << std::setw(12) << outstanding << std::setw(20) << listTime << std::setw(20) << slotMapTime << std::endl;
+	}
+	return 0;
+}
@@ -2,7 +2,20 @@
 #define communique_Client_h
 
 #include <memory>
+#include <future>
 #include <communique/IConnection.h>
+#include <communique/IExecutor.h>
+#include <communique/TLSVersion.h>
+#include <communique/Transport.h>
+#include <communique/ReconnectPolicy.h>
+
+//
+// Forward declarations
+//
+namespace communique
+{
+	class EventLoop;
+}
 
 namespace communique
 {
@@ -16,14 +29,31 @@ namespace communique
 	{
 	public:
 		Client();
+		/** @brief Use the given EventLoop to do the network IO, rather than starting a thread of its own. */
+		explicit Client( std::shared_ptr<communique::EventLoop> pEventLoop );
+		/** @brief Connect over the given transport rather than TLS, optionally using an EventLoop for the IO.
+		 *
+		 * For Transport::UNIXSOCKET the URIs passed to connect are "unix://" followed by the path to the socket,
+		 * for Transport::SHAREDMEMORY "shm://" followed by the path to the socket, for Transport::INPROCESS
+		 * "inproc://" followed by the name the Server is listening under, and for Transport::RAWTLS and
+		 * Transport::RAWTCP "tls://" or "tcp://" followed by the host and port, e.g. "tls://localhost:9000".
+		 */
+		explicit Client( communique::Transport transport, std::shared_ptr<communique::EventLoop> pEventLoop=nullptr );
 		Client( Client&& otherClient ) noexcept;
 		~Client();
 
 		/** @brief Attempts to connect to the URI provided. Returns before the connection is established. */
 		void connect( const std::string& URI );
+		/** @brief As connect, but returns a future that becomes ready as soon as the connection is established.
+		 *
+		 * If the connection fails the future holds an exception describing why.
+		 */
+		std::future<void> connectAsync( const std::string& URI );
 
 		/** @brief Returns true if the connection is established. If the handshake is still ongoing, blocks until that is finished. */
 		bool isConnected();
+		/** @brief As isConnected, but gives up and returns false if the handshake hasn't finished within the timeout. */
+		bool waitConnected( std::chrono::milliseconds timeout );
 		/** @brief Returns true if the connection is closed. If in the process of disconnecting, blocks until that is finished.
 		 *
 		 * Note that this is subtly different from "!isConnected()". Since the blocking conditions are different the two
@@ -32,16 +62,90 @@ namespace communique
 		 */
 		bool isDisconnected();
 		void disconnect();
+		/** @brief The number of requests sent on the current connection that are still waiting for a response. */
+		size_t requestsOutstanding() const;
 		void setCertificateChainFile( const std::string& filename );
 		void setPrivateKeyFile( const std::string& filename );
 		void setVerifyFile( const std::string& filename );
 
+		/** @brief The range of TLS versions that can be negotiated. The default is TLS 1.2 to TLS 1.3. */
+		void setProtocolVersions( communique::TLSVersion minimum, communique::TLSVersion maximum );
+		/** @brief OpenSSL format cipher list used for TLS 1.2 and below. Defaults to forward secret AEAD ciphers only. */
+		void setCipherList( const std::string& cipherList );
+		/** @brief OpenSSL format list of cipher suites used for TLS 1.3. Empty (the default) means the OpenSSL defaults. */
+		void setCipherSuites( const std::string& cipherSuites );
+		/** @brief Colon separated list of curves for ECDHE key exchange in order of preference, e.g. "X25519:P-256". */
+		void setCurves( const std::string& curves );
+
+		/** @brief Try to resume the previous TLS session when connecting to a URI that has been connected to before.
+		 *
+		 * Off by default. The server also has to have session resumption enabled.
+		 */
+		void setSessionResumption( bool enabled );
+		/** @brief Returns true if the current connection resumed a previous TLS session rather than doing a full handshake. */
+		bool sessionWasResumed();
+		/** @brief The total number of TLS handshakes completed since the client was created. */
+		size_t completedHandshakes() const;
+		/** @brief How many of completedHandshakes() resumed a previous session. */
+		size_t resumedHandshakes() const;
+
+		/** @brief Sets where the request handlers are run, so that slow handlers don't hold up the IO thread.
+		 *
+		 * If this is never called a communique::ThreadPool with default settings is used, one shared by
+		 * every Client and Server in the process that doesn't have an executor of its own. If using an
+		 * EventLoop the one executor it has for everything using it is used instead. The executor can be
+		 * shared with other Servers and Clients.
+		 */
+		void setExecutor( std::shared_ptr<communique::IExecutor> pExecutor );
+
+		/** @brief Sets where response handlers given to sendRequest are run.
+		 *
+		 * If null (the default) they're run on the IO thread as soon as the response arrives, which is the
+		 * fastest option but means a slow handler holds up everything else on the connection. Futures
+		 * returned by sendRequest are always completed on the IO thread.
+		 */
+		void setResponseExecutor( std::shared_ptr<communique::IExecutor> pExecutor );
+
+		/** @brief Re-establish the connection automatically if it drops, until disconnect is called.
+		 *
+		 * Off by default. Attempts are made on the same event loop, with delays set by the policy. Messages
+		 * sent while reconnecting are only held for later if policy.maximumBufferedMessages is non zero.
+		 */
+		void setAutoReconnect( bool enabled, const communique::ReconnectPolicy& policy=communique::ReconnectPolicy() );
+
+		/** @brief The timeout for requests sent without one specified. Zero (the default) means wait forever.
+		 *
+		 * Handlers given to the version of sendRequest without a status are simply dropped if the request times out.
+		 */
+		void setDefaultRequestTimeout( std::chrono::milliseconds timeout );
+		/** @brief How long to keep checking for new messages before going to sleep. Only used by Transport::SHAREDMEMORY.
+		 *
+		 * Zero (the default) sleeps straight away. Anything else makes messages arrive faster, at the cost of
+		 * keeping the IO thread busy for up to this long after every message. Takes effect on the next connect.
+		 */
+		void setBusyPollTime( std::chrono::microseconds busyPollTime );
+
 		virtual void sendRequest( const std::string& message, std::function<void(const std::string&)> responseHandler ) override;
+		virtual void sendRequest( const std::string& message, std::function<void(const std::string&,communique::ResponseStatus)> responseHandler, std::chrono::milliseconds timeout ) override;
+		virtual void sendRequest( const std::string& message, std::function<void(const communique::MessageView&,communique::ResponseStatus)> responseHandler, std::chrono::milliseconds timeout ) override;
+		virtual std::future<std::string> sendRequest( const std::string& message, std::chrono::milliseconds timeout=std::chrono::milliseconds(0) ) override;
+		virtual void sendRequest( std::string&& message, std::function<void(const std::string&)> responseHandler ) override;
+		virtual void sendRequest( std::string&& message, std::function<void(const std::string&,communique::ResponseStatus)> responseHandler, std::chrono::milliseconds timeout ) override;
+		virtual void sendRequest( std::string&& message, std::function<void(const communique::MessageView&,communique::ResponseStatus)> responseHandler, std::chrono::milliseconds timeout ) override;
+		virtual std::future<std::string> sendRequest( std::string&& message, std::chrono::milliseconds timeout=std::chrono::milliseconds(0) ) override;
+		virtual void sendRequest( communique::MessageBuffer&& message, std::function<void(const communique::MessageView&,communique::ResponseStatus)> responseHandler, std::chrono::milliseconds timeout ) override;
+		virtual std::future<std::string> sendRequest( communique::MessageBuffer&& message, std::chrono::milliseconds timeout=std::chrono::milliseconds(0) ) override;
 		virtual void sendInfo( const std::string& message ) override;
+		virtual void sendInfo( std::string&& message ) override;
+		virtual void sendInfo( communique::MessageBuffer&& message ) override;
 		virtual void setInfoHandler( std::function<void(const std::string&)> infoHandler ) override;
 		virtual void setInfoHandler( std::function<void(const std::string&,std::weak_ptr<communique::IConnection>)> infoHandler ) override;
+		virtual void setInfoHandler( std::function<void(const communique::MessageView&,std::weak_ptr<communique::IConnection>)> infoHandler ) override;
 		virtual void setRequestHandler( std::function<std::string(const std::string&)> requestHandler ) override;
 		virtual void setRequestHandler( std::function<std::string(const std::string&,std::weak_ptr<communique::IConnection>)> requestHandler ) override;
+		virtual void setRequestHandler( std::function<std::string(const communique::MessageView&,std::weak_ptr<communique::IConnection>)> requestHandler ) override;
+		/** @brief The counts are for every connection since the Client was created, including ones replaced by reconnecting. */
+		virtual communique::Stats stats() const override;
 
 		/** @brief Set where error messages are sent */
 		void setErrorLogLocation( std::ostream& outputStream );
@@ -52,8 +156,10 @@ namespace communique
 		/** @brief Set the verbosity of the access log. Implementation specific, but zero is none 0xffffffff is everything. */
 		void setAccessLogLevel( uint32_t level );
 	private:
-		/// Pimple idiom to hide the transport details
-		std::unique_ptr<class ClientPrivateMembers> pImple_;
+		/// Null if running its own event loop. Declared before pImple_ so that it outlives it.
+		std::shared_ptr<communique::EventLoop> pEventLoop_;
+		/// Pimple idiom to hide the transport details. Shared so that the transport callbacks can hold weak references to it.
+		std::shared_ptr<class ClientPrivateMembers> pImple_;
 	};
 
 } // end of namespace communique
@@ -0,0 +1,97 @@
+#ifndef communique_ClientPool_h
+#define communique_ClientPool_h
+
+#include <memory>
+#include <functional>
+#include <chrono>
+#include <communique/IConnection.h>
+
+//
+// Forward declarations
+//
+namespace communique
+{
+	class Client;
+	class EventLoop;
+}
+
+namespace communique
+{
+
+	/** @brief Several connections to the same server, with requests and info messages spread over them.
+	 *
+	 * A single Client does all of its TLS work on one connection, so is limited to what one core can
+	 * encrypt. A ClientPool keeps a fixed number of Clients connected to the same URI and sends each
+	 * message on one of them, so the work can be spread over as many threads as the EventLoop has.
+	 * Members whose connection drops are replaced in the background.
+	 *
+	 * Messages sent through the pool can go out on different connections, so there's no guarantee they
+	 * arrive in the order they were sent.
+	 *
+	 * @date 17/Oct/2026
+	 */
+	class ClientPool : public communique::IConnection
+	{
+	public:
+		/** @brief How the connection for each message is chosen. */
+		enum class Balancing { ROUNDROBIN, LEASTOUTSTANDING };
+	public:
+		/** @brief Constructor
+		 * @parameter numberOfConnections  How many connections to keep open.
+		 * @parameter configureClient      Called on every new Client before it connects, to set certificates,
+		 *                                 executors and so on. Handlers set on the pool are applied afterwards.
+		 * @parameter pEventLoop           Where the network IO is done. If null a new EventLoop is created with
+		 *                                 one thread per connection.
+		 */
+		ClientPool( size_t numberOfConnections, std::function<void(communique::Client&)> configureClient=nullptr, std::shared_ptr<communique::EventLoop> pEventLoop=nullptr );
+		~ClientPool();
+
+		/** @brief Starts every connection to the URI provided. Returns before the connections are established. */
+		void connect( const std::string& URI );
+		/** @brief Blocks until every connection has finished its handshake or the timeout runs out. Returns true if all are connected. */
+		bool waitConnected( std::chrono::milliseconds timeout );
+		/** @brief Closes every connection and stops replacing them. */
+		void disconnect();
+		/** @brief The number of connections the pool tries to keep open. */
+		size_t size() const;
+		/** @brief The number of connections that are currently open. */
+		size_t numberConnected() const;
+
+		/** @brief Sets how the connection for each message is chosen. The default is Balancing::ROUNDROBIN.
+		 *
+		 * Balancing::LEASTOUTSTANDING sends each request on the connection with the fewest requests still
+		 * waiting for a response, which is better if the response times vary a lot.
+		 */
+		void setBalancing( Balancing balancing );
+		/** @brief How often the connections are checked, and any that have closed replaced. The default is one second. */
+		void setReconnectInterval( std::chrono::milliseconds interval );
+
+		virtual void sendRequest( const std::string& message, std::function<void(const std::string&)> responseHandler ) override;
+		virtual void sendRequest( const std::string& message, std::function<void(const std::string&,communique::ResponseStatus)> responseHandler, std::chrono::milliseconds timeout ) override;
+		virtual void sendRequest( const std::string& message, std::function<void(const communique::MessageView&,communique::ResponseStatus)> responseHandler, std::chrono::milliseconds timeout ) override;
+		virtual std::future<std::string> sendRequest( const std::string& message, std::chrono::milliseconds timeout=std::chrono::milliseconds(0) ) override;
+		virtual void sendRequest( std::string&& message, std::function<void(const std::string&)> responseHandler ) override;
+		virtual void sendRequest( std::string&& message, std::function<void(const std::string&,communique::ResponseStatus)> responseHandler, std::chrono::milliseconds timeout ) override;
+		virtual void sendRequest( std::string&& message, std::function<void(const communique::MessageView&,communique::ResponseStatus)> responseHandler, std::chrono::milliseconds timeout ) override;
+		virtual std::future<std::string> sendRequest( std::string&& message, std::chrono::milliseconds timeout=std::chrono::milliseconds(0) ) override;
+		virtual void sendRequest( communique::MessageBuffer&& message, std::function<void(const communique::MessageView&,communique::ResponseStatus)> responseHandler, std::chrono::milliseconds timeout ) override;
+		virtual std::future<std::string> sendRequest( communique::MessageBuffer&& message, std::chrono::milliseconds timeout=std::chrono::milliseconds(0) ) override;
+		virtual void sendInfo( const std::string& message ) override;
+		virtual void sendInfo( std::string&& message ) override;
+		virtual void sendInfo( communique::MessageBuffer&& message ) override;
+		virtual void setInfoHandler( std::function<void(const std::string&)> infoHandler ) override;
+		virtual void setInfoHandler( std::function<void(const std::string&,std::weak_ptr<communique::IConnection>)> infoHandler ) override;
+		virtual void setInfoHandler( std::function<void(const communique::MessageView&,std::weak_ptr<communique::IConnection>)> infoHandler ) override;
+		virtual void setRequestHandler( std::function<std::string(const std::string&)> requestHandler ) override;
+		virtual void setRequestHandler( std::function<std::string(const std::string&,std::weak_ptr<communique::IConnection>)> requestHandler ) override;
+		virtual void setRequestHandler( std::function<std::string(const communique::MessageView&,std::weak_ptr<communique::IConnection>)> requestHandler ) override;
+		/** @brief The sum over every member, including the ones that have been replaced. */
+		virtual communique::Stats stats() const override;
+	private:
+		/// Pimple idiom to hide the implementation details
+		std::unique_ptr<class ClientPoolPrivateMembers> pImple_;
+	};
+
+} // end of namespace communique
+
+#endif // end of ifndef communique_ClientPool_h
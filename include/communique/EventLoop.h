@@ -0,0 +1,46 @@
+#ifndef communique_EventLoop_h
+#define communique_EventLoop_h
+
+#include <memory>
+#include <cstddef>
+
+namespace communique
+{
+
+	/** @brief A set of threads doing the network IO, that can be shared between any number of Clients and Servers.
+	 *
+	 * By default every Client and Server runs its own event loop on its own threads. Passing the same EventLoop
+	 * to their constructors instead means all of them are serviced by this one set of threads, so a process
+	 * talking to hundreds of servers doesn't need hundreds of IO threads. The threads start when the EventLoop
+	 * is constructed and are joined when it's destroyed. Every Client and Server using it keeps a shared_ptr
+	 * to it, so it can't be destroyed while still in use. It's safe for that last shared_ptr to be released in
+	 * a handler running on the loop, in which case that thread finishes on its own once the handler returns.
+	 *
+	 * Messages for any one connection are still processed in the order they arrive, however many threads
+	 * there are.
+	 *
+	 * Everything using the loop also shares one executor for request handlers, unless given its own with
+	 * setExecutor, and one timer thread for request timeouts.
+	 *
+	 * @date 17/Oct/2026
+	 */
+	class EventLoop
+	{
+	public:
+		/** @brief Constructor
+		 * @parameter numberOfThreads  The number of threads running the loop. Zero means use std::thread::hardware_concurrency().
+		 */
+		explicit EventLoop( size_t numberOfThreads=1 );
+		~EventLoop();
+
+		size_t numberOfThreads() const;
+	private:
+		friend class Client;
+		friend class Server;
+		/// Pimple idiom to hide the implementation details. Shared with the loop threads, see ~EventLoop.
+		std::shared_ptr<class EventLoopPrivateMembers> pImple_;
+	};
+
+} // end of namespace communique
+
+#endif // end of ifndef communique_EventLoop_h
@@ -2,6 +2,8 @@
 #define communique_Exceptions_h
 
 #include <exception>
+#include <string>
+#include <communique/ResponseStatus.h>
 
 namespace communique
 {
@@ -17,6 +19,20 @@ namespace communique
 		virtual ~Exception() {}
 	};
 
+	/** @brief Exception stored in the future returned by IConnection::sendRequest when the request fails. */
+	class RequestFailed : public communique::Exception
+	{
+	public:
+		RequestFailed( communique::ResponseStatus status, const std::string& what );
+		virtual ~RequestFailed();
+		virtual const char* what() const noexcept override;
+		/** @brief Why the request failed. Never ResponseStatus::OK. */
+		communique::ResponseStatus status() const;
+	private:
+		communique::ResponseStatus status_;
+		std::string what_;
+	};
+
 } // end of namespace communique
 
 #endif // end of ifndef communique_Exceptions_h
@@ -3,10 +3,15 @@
 
 #include <functional>
 #include <memory>
+#include <chrono>
+#include <future>
+#include <communique/ResponseStatus.h>
+#include <communique/MessageView.h>
+#include <communique/MessageBuffer.h>
+#include <communique/Stats.h>
 
 namespace communique
 {
-
 	/** @brief Abstract interface to connections between a client and a server.
 	 *
 	 * @author Mark Grimes (kknb1056@gmail.com)
@@ -25,20 +30,68 @@ namespace communique
 		 */
 		virtual void sendRequest( const std::string& message, std::function<void(const std::string&)> responseHandler ) = 0;
 
+		/** @brief Send a request that requires a response, and be told if it fails
+		 * @parameter message          The information to send.
+		 * @parameter responseHandler  Called exactly once, with the response and ResponseStatus::OK if it
+		 *                             arrives, or with the reason it failed otherwise.
+		 * @parameter timeout          How long to wait for the response before calling the handler with
+		 *                             ResponseStatus::TIMEDOUT. Zero means wait forever.
+		 */
+		virtual void sendRequest( const std::string& message, std::function<void(const std::string&,communique::ResponseStatus)> responseHandler, std::chrono::milliseconds timeout ) = 0;
+		/** @brief As above, but the handler sees the response in place rather than a copy. Use for large responses. */
+		virtual void sendRequest( const std::string& message, std::function<void(const communique::MessageView&,communique::ResponseStatus)> responseHandler, std::chrono::milliseconds timeout ) = 0;
+
+		/** @brief Send a request and get the response through a future
+		 *
+		 * The future is completed directly by the thread that receives the response. If the request fails
+		 * the future holds a communique::RequestFailed exception saying why.
+		 * @parameter message          The information to send.
+		 * @parameter timeout          How long to wait for the response before failing with ResponseStatus::TIMEDOUT.
+		 *                             Zero (the default) means wait forever.
+		 */
+		virtual std::future<std::string> sendRequest( const std::string& message, std::chrono::milliseconds timeout=std::chrono::milliseconds(0) ) = 0;
+
+		/** @brief Versions of the sendRequest methods above that take over the message buffer rather than copying it.
+		 *
+		 * The message is moved into the outgoing frame, and the 5 byte Communique header is written in front of
+		 * it. If the string was created with at least 5 bytes of spare capacity no new buffer is allocated, but
+		 * the body still has to be shifted along to make room. Use the MessageBuffer versions to avoid that.
+		 */
+		virtual void sendRequest( std::string&& message, std::function<void(const std::string&)> responseHandler ) = 0;
+		virtual void sendRequest( std::string&& message, std::function<void(const std::string&,communique::ResponseStatus)> responseHandler, std::chrono::milliseconds timeout ) = 0;
+		virtual void sendRequest( std::string&& message, std::function<void(const communique::MessageView&,communique::ResponseStatus)> responseHandler, std::chrono::milliseconds timeout ) = 0;
+		virtual std::future<std::string> sendRequest( std::string&& message, std::chrono::milliseconds timeout=std::chrono::milliseconds(0) ) = 0;
+
+		/** @brief Versions of the sendRequest methods above that write the header into the headroom the MessageBuffer
+		 * left for it, so the body is never copied or moved. */
+		virtual void sendRequest( communique::MessageBuffer&& message, std::function<void(const communique::MessageView&,communique::ResponseStatus)> responseHandler, std::chrono::milliseconds timeout ) = 0;
+		virtual std::future<std::string> sendRequest( communique::MessageBuffer&& message, std::chrono::milliseconds timeout=std::chrono::milliseconds(0) ) = 0;
+
 		/** @brief Send information that does not require a response
 		 * @parameter message          The information to send. This needn't be ASCII, std::string is just
 		 *                             used as a convenient container.
 		 * @parameter length           The size of the information.
 		 */
 		virtual void sendInfo( const std::string& message ) = 0;
+		/** @brief Version of sendInfo that takes over the message buffer rather than copying it. See the sendRequest versions. */
+		virtual void sendInfo( std::string&& message ) = 0;
+		/** @brief Version of sendInfo that never copies or moves the body. See the sendRequest versions. */
+		virtual void sendInfo( communique::MessageBuffer&& message ) = 0;
 
 		/** @brief Sets the function that will be notified when information comes in (no response required) */
 		virtual void setInfoHandler( std::function<void(const std::string&)> infoHandler ) = 0;
 		virtual void setInfoHandler( std::function<void(const std::string&,std::weak_ptr<communique::IConnection>)> infoHandler ) = 0;
+		/** @brief As above, but the handler sees the message in place rather than a copy. Use for large messages. */
+		virtual void setInfoHandler( std::function<void(const communique::MessageView&,std::weak_ptr<communique::IConnection>)> infoHandler ) = 0;
 
 		/** @brief Sets the function that will be notified when requests come in (response required) */
 		virtual void setRequestHandler( std::function<std::string(const std::string&)> requestHandler ) = 0;
 		virtual void setRequestHandler( std::function<std::string(const std::string&,std::weak_ptr<communique::IConnection>)> requestHandler ) = 0;
+		/** @brief As above, but the handler sees the request in place rather than a copy. Use for large requests. */
+		virtual void setRequestHandler( std::function<std::string(const communique::MessageView&,std::weak_ptr<communique::IConnection>)> requestHandler ) = 0;
+
+		/** @brief A snapshot of how many messages have gone each way, how long they took to handle, etc. Cheap enough to poll. */
+		virtual communique::Stats stats() const = 0;
 	};
 
 } // end of namespace communique
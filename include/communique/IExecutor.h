@@ -0,0 +1,31 @@
+#ifndef communique_IExecutor_h
+#define communique_IExecutor_h
+
+#include <functional>
+
+namespace communique
+{
+
+	/** @brief Abstract interface to something that runs tasks, e.g. a pool of threads.
+	 *
+	 * Server and Client hand incoming requests to one of these so that the thread doing the
+	 * network IO can go straight back to reading the socket, rather than waiting for the
+	 * user's handler to finish.
+	 *
+	 * @date 17/Oct/2026
+	 */
+	class IExecutor
+	{
+	public:
+		virtual ~IExecutor() {}
+
+		/** @brief Queue a task to be run at some point in the future, possibly on a different thread.
+		 *
+		 * Implementations are allowed to block the caller if they can't accept any more work.
+		 */
+		virtual void execute( std::function<void()> task ) = 0;
+	};
+
+} // end of namespace communique
+
+#endif // end of ifndef communique_IExecutor_h
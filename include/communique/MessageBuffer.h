@@ -0,0 +1,50 @@
+#ifndef communique_MessageBuffer_h
+#define communique_MessageBuffer_h
+
+#include <string>
+
+namespace communique
+{
+
+	/** @brief A message body with room left in front of it for the Communique header.
+	 *
+	 * Sending a std::string&& still has to shift the body along to fit the 5 byte header in front of it.
+	 * Build large messages in one of these instead and the header is written into the reserved space, so
+	 * the body is never copied or moved between here and the transport. Everything except release() only
+	 * sees the body.
+	 *
+	 * @date 17/Oct/2026
+	 */
+	class MessageBuffer
+	{
+	public:
+		static const size_t HEADROOM=5; ///< The size of the Communique header
+	public:
+		/** @brief An empty body, with space reserved for expectedSize bytes of it. */
+		explicit MessageBuffer( size_t expectedSize=0 ) : buffer_( HEADROOM, '\0' ) { buffer_.reserve( HEADROOM+expectedSize ); }
+		/** @brief A copy of body. Only saves anything if more is going to be appended afterwards. */
+		explicit MessageBuffer( const std::string& body ) : buffer_( HEADROOM, '\0' ) { buffer_.reserve( HEADROOM+body.size() ); buffer_.append( body ); }
+		/// Moved from buffers are left empty but still with their headroom, so they can be used again
+		MessageBuffer( MessageBuffer&& other ) : buffer_( other.release() ) {}
+		MessageBuffer( const MessageBuffer& other )=default;
+		MessageBuffer& operator=( MessageBuffer&& other ) { buffer_=other.release(); return *this; }
+		MessageBuffer& operator=( const MessageBuffer& other )=default;
+
+		char* data() { return &buffer_[HEADROOM]; }
+		const char* data() const { return buffer_.data()+HEADROOM; }
+		size_t size() const { return buffer_.size()-HEADROOM; }
+		bool empty() const { return size()==0; }
+		void resize( size_t size ) { buffer_.resize( HEADROOM+size ); }
+		void reserve( size_t size ) { buffer_.reserve( HEADROOM+size ); }
+		MessageBuffer& append( const char* pData, size_t size ) { buffer_.append( pData, size ); return *this; }
+		MessageBuffer& append( const std::string& data ) { buffer_.append( data ); return *this; }
+
+		/** @brief Hands over the whole buffer, headroom included, and leaves this empty. Used by the library when sending. */
+		std::string release() { std::string result( HEADROOM, '\0' ); result.swap( buffer_ ); return result; }
+	private:
+		std::string buffer_;
+	};
+
+} // end of namespace communique
+
+#endif // end of ifndef communique_MessageBuffer_h
@@ -0,0 +1,46 @@
+#ifndef communique_MessageView_h
+#define communique_MessageView_h
+
+#include <memory>
+#include <string>
+#include <cstring>
+
+namespace communique
+{
+
+	/** @brief Read only access to the body of a received message without copying it.
+	 *
+	 * Holds a reference to the underlying message, so the data stays valid for as long as any copy
+	 * of the view exists. Copying a MessageView is cheap, it just copies a shared_ptr. Use str() if
+	 * you really need a std::string.
+	 *
+	 * @date 17/Oct/2026
+	 */
+	class MessageView
+	{
+	public:
+		MessageView() : pData_(nullptr), size_(0) {}
+		/** @brief View size bytes starting at pData, which pOwner has to keep alive. */
+		MessageView( std::shared_ptr<const void> pOwner, const char* pData, size_t size ) : pOwner_(std::move(pOwner)), pData_(pData), size_(size) {}
+
+		const char* data() const { return pData_; }
+		size_t size() const { return size_; }
+		bool empty() const { return size_==0; }
+		const char* begin() const { return pData_; }
+		const char* end() const { return pData_+size_; }
+		char operator[]( size_t index ) const { return pData_[index]; }
+
+		/** @brief Copies the data into a new std::string. */
+		std::string str() const { return std::string( pData_, size_ ); }
+
+		bool operator==( const std::string& other ) const { return size_==other.size() && (size_==0 || std::memcmp( pData_, other.data(), size_ )==0); }
+		bool operator!=( const std::string& other ) const { return !(*this==other); }
+	private:
+		std::shared_ptr<const void> pOwner_;
+		const char* pData_;
+		size_t size_;
+	};
+
+} // end of namespace communique
+
+#endif // end of ifndef communique_MessageView_h
@@ -0,0 +1,45 @@
+#ifndef communique_ReconnectPolicy_h
+#define communique_ReconnectPolicy_h
+
+#include <chrono>
+#include <cstddef>
+
+namespace communique
+{
+
+	/** @brief Settings for how a Client re-establishes a connection that has dropped.
+	 *
+	 * The delay before each attempt is initialDelay*multiplier^attempt, capped at maximumDelay, and then
+	 * reduced by a random fraction of up to jitter so that lots of clients don't all reconnect at once.
+	 * The attempt count goes back to zero as soon as a connection opens.
+	 *
+	 * @date 17/Oct/2026
+	 */
+	struct ReconnectPolicy
+	{
+		ReconnectPolicy() : initialDelay(50), maximumDelay(30000), multiplier(2.0), jitter(0.2), maximumAttempts(0), maximumBufferedMessages(0) {}
+
+		std::chrono::milliseconds initialDelay;
+		std::chrono::milliseconds maximumDelay;
+		double multiplier;
+		/// Fraction of the delay that can randomly be taken off, between 0 and 1.
+		double jitter;
+		/// Give up after this many attempts in a row. Zero means keep trying forever.
+		size_t maximumAttempts;
+		/** @brief How many messages sent while reconnecting are held and sent once the connection is back.
+		 *
+		 * Zero (the default) means don't hold any, so sending while disconnected fails as usual. Only messages
+		 * sent during the outage are held. Requests that were already sent when the connection dropped still
+		 * fail with ResponseStatus::CONNECTIONCLOSED because the server might have acted on them, so only
+		 * resend those if they're safe to repeat. If the client gives up or is disconnected the held requests
+		 * fail with ResponseStatus::CONNECTIONCLOSED. The timeout of a held request starts when it's sent rather
+		 * than when the connection is back, and it fails with ResponseStatus::TIMEDOUT if that comes first.
+		 * Requests whose handler doesn't take a ResponseStatus are never held, since there would be no way
+		 * to tell the handler if they fail.
+		 */
+		size_t maximumBufferedMessages;
+	};
+
+} // end of namespace communique
+
+#endif // end of ifndef communique_ReconnectPolicy_h
@@ -0,0 +1,18 @@
+#ifndef communique_ResponseStatus_h
+#define communique_ResponseStatus_h
+
+namespace communique
+{
+
+	/** @brief The outcome of a request, passed to response handlers that take a status. */
+	enum class ResponseStatus
+	{
+		OK,               ///< The response arrived, and is the message passed to the handler.
+		REQUESTERROR,     ///< The request handler at the other end failed. The message is the error description.
+		TIMEDOUT,         ///< No response arrived before the timeout. The message is empty.
+		CONNECTIONCLOSED  ///< The connection closed before the response arrived. The message is empty.
+	};
+
+} // end of namespace communique
+
+#endif // end of ifndef communique_ResponseStatus_h
@@ -4,6 +4,11 @@
 #include <memory>
 #include <functional>
 #include <vector>
+#include <chrono>
+#include <communique/TLSVersion.h>
+#include <communique/Transport.h>
+#include <communique/MessageView.h>
+#include <communique/Stats.h>
 
 //
 // Forward declarations
@@ -11,6 +16,8 @@
 namespace communique
 {
 	class IConnection;
+	class IExecutor;
+	class EventLoop;
 }
 
 namespace communique
@@ -28,21 +35,124 @@ namespace communique
 	{
 	public:
 		Server();
+		/** @brief Use the given EventLoop to do the network IO, rather than starting threads of its own. */
+		explicit Server( std::shared_ptr<communique::EventLoop> pEventLoop );
+		/** @brief Accept connections over the given transport rather than TLS, optionally using an EventLoop for the IO. */
+		explicit Server( communique::Transport transport, std::shared_ptr<communique::EventLoop> pEventLoop=nullptr );
 		~Server();
 
-		bool listen( size_t port );
-		void stop();
+		/** @brief Start listening for connections on the given port. Throws for Transport::UNIXSOCKET, Transport::SHAREDMEMORY and Transport::INPROCESS.
+		 *
+		 * @parameter port          The port to listen on.
+		 * @parameter ioThreadCount The number of threads used to run the event loop, i.e. to do the TLS
+		 *                          work, framing and dispatch for every connection. Messages for any one
+		 *                          connection are still processed in the order they arrive. Ignored if
+		 *                          the Server was constructed with an EventLoop.
+		 */
+		bool listen( size_t port, size_t ioThreadCount=1 );
+		/** @brief Start listening for connections on a Unix domain socket. Only for Transport::UNIXSOCKET and Transport::SHAREDMEMORY.
+		 *
+		 * The socket file is created at socketPath, replacing any socket already there, and removed again
+		 * when the server stops. ioThreadCount is the same as for listening on a port.
+		 *
+		 * For Transport::INPROCESS socketPath is instead the name to listen under, which no other Server in
+		 * the process can be listening under at the same time.
+		 */
+		bool listen( const std::string& socketPath, size_t ioThreadCount=1 );
+		/** @brief Stop listening and close all connections, giving them up to drainTimeout to finish cleanly.
+		 *
+		 * New connections are refused straight away, and new requests on existing connections get a
+		 * REQUESTERROR. Requests already being handled are allowed to finish and send their response. Then
+		 * all connections are sent a close frame at once. Anything still open when the timeout runs out
+		 * is dropped without finishing the close handshake. Total time is never much more than drainTimeout,
+		 * however many connections there are.
+		 */
+		void stop( std::chrono::milliseconds drainTimeout=std::chrono::seconds(5) );
 		void setCertificateChainFile( const std::string& filename );
 		void setPrivateKeyFile( const std::string& filename );
 		void setVerifyFile( const std::string& filename );
 		void setDiffieHellmanParamsFile( const std::string& filename );
 
+		/** @brief The range of TLS versions that can be negotiated. The default is TLS 1.2 to TLS 1.3. */
+		void setProtocolVersions( communique::TLSVersion minimum, communique::TLSVersion maximum );
+		/** @brief OpenSSL format cipher list used for TLS 1.2 and below. Defaults to forward secret AEAD ciphers only. */
+		void setCipherList( const std::string& cipherList );
+		/** @brief OpenSSL format list of cipher suites used for TLS 1.3. Empty (the default) means the OpenSSL defaults. */
+		void setCipherSuites( const std::string& cipherSuites );
+		/** @brief Colon separated list of curves for ECDHE key exchange in order of preference, e.g. "X25519:P-256". */
+		void setCurves( const std::string& curves );
+		/** @brief Choose the cipher by the server's order of preference rather than the client's. Off by default. */
+		void setServerCipherPreference( bool serverPreference );
+
+		/** @brief Allow clients to resume previous TLS sessions, which saves most of the cost of the handshake.
+		 *
+		 * Off by default. Enables both the server side session cache and session tickets.
+		 */
+		void setSessionResumption( bool enabled );
+		/** @brief The maximum number of sessions kept in the session cache. */
+		void setSessionCacheSize( size_t numberOfSessions );
+		/** @brief How long after a full handshake a client can resume the session. */
+		void setSessionTimeout( std::chrono::seconds timeout );
+		/** @brief Replace the key used to encrypt session tickets. Tickets from the previous key are still accepted once. */
+		void rotateSessionTicketKeys();
+		/** @brief The total number of TLS handshakes completed since the server was created. */
+		size_t completedHandshakes() const;
+		/** @brief How many of completedHandshakes() resumed a previous session rather than doing a full handshake. */
+		size_t resumedHandshakes() const;
+		/** @brief The sum over every connection since the Server was created, open or closed. Cheap enough to poll for monitoring. */
+		communique::Stats stats() const;
+
 		void setDefaultInfoHandler( std::function<void(const std::string&)> infoHandler );
 		void setDefaultInfoHandler( std::function<void(const std::string&,std::weak_ptr<communique::IConnection>)> infoHandler );
+		/** @brief Info handler that sees the message in place rather than a copy. Use for large messages. */
+		void setDefaultInfoHandler( std::function<void(const communique::MessageView&,std::weak_ptr<communique::IConnection>)> infoHandler );
 		void setDefaultRequestHandler( std::function<std::string(const std::string&)> requestHandler );
 		void setDefaultRequestHandler( std::function<std::string(const std::string&,std::weak_ptr<communique::IConnection>)> requestHandler );
+		/** @brief Request handler that sees the request in place rather than a copy. Use for large requests. */
+		void setDefaultRequestHandler( std::function<std::string(const communique::MessageView&,std::weak_ptr<communique::IConnection>)> requestHandler );
 
+		/** @brief All of the open connections, oldest first. */
 		std::vector<std::weak_ptr<communique::IConnection> > currentConnections();
+		/** @brief A number identifying the connection, unique among every connection the Server has had and increasing
+		 * in the order they were opened. Zero if it isn't one of the current connections, e.g. because it has closed. */
+		uint64_t connectionId( const std::weak_ptr<communique::IConnection>& pConnection ) const;
+		/** @brief The current connection with the given connectionId(). Expired if it has closed. */
+		std::weak_ptr<communique::IConnection> connection( uint64_t connectionId ) const;
+
+		/** @brief Send the same info message to every connected client, or every one that the filter returns true for.
+		 *
+		 * Much cheaper than calling sendInfo on each of currentConnections(), because the message is encoded and
+		 * framed once and the same buffer is queued on every connection. The filter is called without any locks
+		 * held. Returns the number of connections the message was queued on.
+		 */
+		size_t broadcastInfo( const std::string& message, std::function<bool(std::weak_ptr<communique::IConnection>)> filter=nullptr );
+
+		/** @brief Sets where the request handlers are run, so that slow handlers don't hold up the IO thread.
+		 *
+		 * If this is never called a communique::ThreadPool with default settings is used, one shared by
+		 * every Client and Server in the process that doesn't have an executor of its own. If using an
+		 * EventLoop the one executor it has for everything using it is used instead. The executor can be
+		 * shared with other Servers and Clients.
+		 */
+		void setExecutor( std::shared_ptr<communique::IExecutor> pExecutor );
+
+		/** @brief Sets where response handlers for requests sent to clients are run.
+		 *
+		 * If null (the default) they're run on the IO thread as soon as the response arrives, which is the
+		 * fastest option but means a slow handler holds up everything else on the connection. Futures
+		 * returned by sendRequest are always completed on the IO thread.
+		 */
+		void setResponseExecutor( std::shared_ptr<communique::IExecutor> pExecutor );
+
+		/** @brief The timeout for requests sent to clients without one specified. Zero (the default) means wait forever. */
+		void setDefaultRequestTimeout( std::chrono::milliseconds timeout );
+		/** @brief How long to keep checking for new messages before going to sleep. Only used by Transport::SHAREDMEMORY.
+		 *
+		 * Zero (the default) sleeps straight away. Anything else makes messages arrive faster, at the cost of
+		 * keeping an IO thread busy for up to this long after every message. Only affects connections made
+		 * after it's called.
+		 */
+		void setBusyPollTime( std::chrono::microseconds busyPollTime );
 
 		/** @brief Set where error messages are sent */
 		void setErrorLogLocation( std::ostream& outputStream );
@@ -53,8 +163,10 @@ namespace communique
 		/** @brief Set the verbosity of the access log. Implementation specific, but zero is none 0xffffffff is everything. */
 		void setAccessLogLevel( uint32_t level );
 	private:
-		/// Pimple idiom to hide the transport details
-		std::unique_ptr<class ServerPrivateMembers> pImple_;
+		/// Null if running its own event loop. Declared before pImple_ so that it outlives it.
+		std::shared_ptr<communique::EventLoop> pEventLoop_;
+		/// Pimple idiom to hide the transport details. Shared so that the transport callbacks can hold weak references to it.
+		std::shared_ptr<class ServerPrivateMembers> pImple_;
 	};
 
 } // end of namespace communique
@@ -0,0 +1,90 @@
+#ifndef communique_Stats_h
+#define communique_Stats_h
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+
+namespace communique
+{
+	/** @brief How many of something took how long, counted in fixed buckets.
+	 *
+	 * Bucket 0 counts everything under 1 microsecond, and bucket i everything from 2^(i-1) up to 2^i
+	 * microseconds. The last bucket counts everything longer than that, i.e. from about 4 seconds.
+	 *
+	 * @date 17/Oct/2026
+	 */
+	struct LatencyHistogram
+	{
+		static const size_t NUMBER_OF_BUCKETS=24;
+
+		std::array<uint64_t,NUMBER_OF_BUCKETS> buckets;
+		uint64_t count; ///< The sum of all the buckets
+		uint64_t totalMicroseconds; ///< So that the mean can be worked out
+
+		LatencyHistogram();
+		/// @brief The top of the bucket, i.e. everything counted in it was shorter. The last bucket gives std::chrono::microseconds::max().
+		static std::chrono::microseconds bucketUpperBound( size_t bucket );
+		/// @brief The top of the bucket that the given fraction (e.g. 0.99) of everything falls in. Zero if nothing has been counted.
+		std::chrono::microseconds quantile( double fraction ) const;
+		std::chrono::microseconds mean() const;
+		LatencyHistogram& operator+=( const LatencyHistogram& other );
+	};
+
+	/** @brief A count for each type of Communique message. */
+	struct MessageCounts
+	{
+		uint64_t requests;
+		uint64_t responses;
+		uint64_t infos;
+		uint64_t requestErrors; ///< Sent instead of a response when a request fails, e.g. because its handler threw
+
+		MessageCounts();
+		uint64_t total() const;
+		MessageCounts& operator+=( const MessageCounts& other );
+	};
+
+	/** @brief A snapshot of what a connection, or everything a Client or Server has done, for monitoring.
+	 *
+	 * The counts are kept with relaxed atomics so that collecting them costs next to nothing, which means a
+	 * snapshot taken while messages are flowing can be very slightly out of step with itself. Counts only
+	 * ever go up, apart from requestsOutstanding, requestsInProgress, sendQueueBytes and connections which
+	 * say how things are at the moment.
+	 *
+	 * Reading the clock costs more than all the counting put together, so the histograms only time one in
+	 * every 16 requests and info messages on each thread. Their counts are therefore lower than the message
+	 * counts, but the quantiles are still representative once there's been some traffic.
+	 *
+	 * The counts and histograms can be compiled out by turning off the COLLECT_STATS cmake option, in which
+	 * case they're always zero, see enabled(). requestsOutstanding, requestsInProgress, sendQueueBytes and
+	 * connections are always there.
+	 *
+	 * @date 17/Oct/2026
+	 */
+	struct Stats
+	{
+		MessageCounts messagesSent;
+		MessageCounts messagesReceived;
+		/// Every message including the 5 byte Communique header, but not the framing added by the transport
+		uint64_t bytesSent;
+		uint64_t bytesReceived;
+
+		uint64_t requestsOutstanding; ///< Sent but still waiting for a response
+		uint64_t requestsInProgress; ///< Received and still being handled
+		uint64_t sendQueueBytes; ///< Queued by the transport but not yet written. Always zero for transports that send straight away.
+		uint64_t connections; ///< How many of the connections the numbers are from are currently open
+
+		LatencyHistogram requestHandlerTime; ///< How long the request handlers took, not counting time waiting for an executor
+		LatencyHistogram infoHandlerTime; ///< How long the info handlers took
+		LatencyHistogram responseTime; ///< From sending a request until its response arrived, for the requests that got one
+
+		Stats();
+		/// @brief Whether the library was built to collect stats. If not, the counts and histograms are always zero.
+		static bool enabled();
+		Stats& operator+=( const Stats& other );
+	};
+
+} // end of namespace communique
+
+#endif // end of ifndef communique_Stats_h
@@ -0,0 +1,17 @@
+#ifndef communique_TLSVersion_h
+#define communique_TLSVersion_h
+
+namespace communique
+{
+
+	/** @brief The TLS protocol versions that can be used to restrict what a Client or Server negotiates.
+	 *
+	 * Versions that the OpenSSL library being used doesn't support are ignored.
+	 *
+	 * @date 17/Oct/2026
+	 */
+	enum class TLSVersion { TLSv1_0, TLSv1_1, TLSv1_2, TLSv1_3 };
+
+} // end of namespace communique
+
+#endif // end of ifndef communique_TLSVersion_h
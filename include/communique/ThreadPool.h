@@ -0,0 +1,42 @@
+#ifndef communique_ThreadPool_h
+#define communique_ThreadPool_h
+
+#include <memory>
+#include <communique/IExecutor.h>
+
+namespace communique
+{
+
+	/** @brief Executor that runs tasks on a fixed number of threads, fed from a bounded queue.
+	 *
+	 * If the queue is full execute() blocks until one of the threads takes a task off it, which
+	 * provides back pressure to whoever is submitting the work. On destruction all tasks already
+	 * queued are run before the threads are joined.
+	 *
+	 * @date 17/Oct/2026
+	 */
+	class ThreadPool : public communique::IExecutor
+	{
+	public:
+		/** @brief Constructor
+		 * @parameter numberOfThreads  The number of worker threads. Zero means use std::thread::hardware_concurrency().
+		 * @parameter maximumQueueSize The number of tasks that can be waiting before execute() blocks.
+		 */
+		ThreadPool( size_t numberOfThreads=0, size_t maximumQueueSize=1024 );
+		ThreadPool( ThreadPool&& otherThreadPool ) noexcept;
+		~ThreadPool();
+
+		virtual void execute( std::function<void()> task ) override;
+
+		size_t numberOfThreads() const;
+		size_t maximumQueueSize() const;
+		/** @brief The number of tasks waiting to be picked up by a thread. */
+		size_t queueSize() const;
+	private:
+		/// Pimple idiom to hide the implementation details
+		std::unique_ptr<class ThreadPoolPrivateMembers> pImple_;
+	};
+
+} // end of namespace communique
+
+#endif // end of ifndef communique_ThreadPool_h
@@ -0,0 +1,36 @@
+#ifndef communique_Transport_h
+#define communique_Transport_h
+
+namespace communique
+{
+
+	/** @brief What a Client and Server use to carry their messages. Both ends have to use the same one.
+	 *
+	 * TLS     - WebSocket over TLS over TCP. The default.
+	 * PLAIN   - WebSocket over TCP with no encryption. Only for networks where every host is trusted.
+	 * UNIXSOCKET - WebSocket over a Unix domain socket, for processes on the same host. Servers listen on
+	 *           a path rather than a port, and Clients connect to "unix://" followed by that path, e.g.
+	 *           "unix:///tmp/myService.sock". Access is controlled by the permissions on the socket file.
+	 * SHAREDMEMORY - Messages go through rings in memory shared by the two processes, so there are no
+	 *           system calls while both ends are busy. Servers listen on a socket file the same as for
+	 *           UNIXSOCKET, and Clients connect to "shm://" followed by that path. Linux only, creating a
+	 *           Client or Server with it anywhere else throws.
+	 * INPROCESS - For a Client and Server in the same process. Messages are handed straight to the other
+	 *           end without being copied, and there are no sockets involved. Servers listen under a name
+	 *           rather than on a port, and Clients connect to "inproc://" followed by the name.
+	 * RAWTLS  - The same as TLS but without WebSocket. Each message goes straight over TLS as a 4 byte
+	 *           length then the message, which saves the WebSocket framing and masking on every message.
+	 *           Clients connect to "tls://" followed by the host and port, e.g. "tls://localhost:9000".
+	 *           A Client using this fails to connect to a WebSocket Server, and the other way round.
+	 * RAWTCP  - The same as RAWTLS without the encryption, i.e. raw framing over plain TCP. Clients
+	 *           connect to "tcp://" followed by the host and port. Only for trusted networks, like PLAIN.
+	 *
+	 * The certificate and other TLS settings are ignored by everything except TLS and RAWTLS.
+	 *
+	 * @date 17/Oct/2026
+	 */
+	enum class Transport { TLS, PLAIN, UNIXSOCKET, SHAREDMEMORY, INPROCESS, RAWTLS, RAWTCP };
+
+} // end of namespace communique
+
+#endif // end of ifndef communique_Transport_h
@@ -0,0 +1,78 @@
+#ifndef communique_impl_ClientTransport_h
+#define communique_impl_ClientTransport_h
+
+#include <memory>
+#include <functional>
+#include <string>
+#include <ostream>
+#include <cstdint>
+#include <chrono>
+
+#define _WEBSOCKETPP_CPP11_STL_ // Make sure websocketpp uses c++11 features in preference to boost ones
+#include <websocketpp/common/asio.hpp>
+#include <websocketpp/config/asio.hpp>
+
+//
+// Forward declarations
+//
+namespace communique
+{
+	namespace impl
+	{
+		class Connection;
+		class TLSHandler;
+	}
+}
+
+namespace communique
+{
+
+	namespace impl
+	{
+		/** @brief The part of a Client that makes the connection, so that the Client works the same whatever it goes over.
+		 *
+		 * The callbacks are set by the Client before connecting, and are called from the IO thread for the
+		 * connection most recently passed to connect. onFail is given a description of why the connection
+		 * couldn't be made.
+		 *
+		 * Always owned by a shared_ptr. Everything the transport queues on the io_service, and every connection
+		 * it creates, holds a shared_ptr back to it, so it isn't deleted until nothing can call into it.
+		 *
+		 * @date 17/Oct/2026
+		 */
+		class ClientTransport : public std::enable_shared_from_this<ClientTransport>
+		{
+		public:
+			std::function<void()> onOpen;
+			std::function<void()> onClose;
+			std::function<void()> onInterrupt;
+			std::function<void(const std::string&)> onFail;
+		public:
+			virtual ~ClientTransport() {}
+
+			/// @brief A new Connection to the URI, ready to have its handlers set. Throws std::runtime_error if the URI isn't suitable.
+			virtual std::shared_ptr<communique::impl::Connection> createConnection( const std::string& URI )=0;
+			/// @brief Starts connecting. The Connection has to have come from createConnection on this transport.
+			virtual void connect( communique::impl::Connection& connection )=0;
+			/// @brief Does the IO on the calling thread until there's nothing left to do.
+			virtual void run()=0;
+			/// @brief Has to be called after the event loop has stopped, before run can be called again.
+			virtual void reset()=0;
+			/// @brief The io_service the IO is done on, for anything else that needs to happen on the IO thread.
+			virtual websocketpp::lib::asio::io_service& ioService()=0;
+
+			/// @brief For transports that use TLS, which keep hold of the handler. Ignored by everything else.
+			virtual void setTLSHandler( std::shared_ptr<communique::impl::TLSHandler> pTLSHandler ) {}
+			/// @brief For transports that can poll for new messages rather than sleeping. Ignored by everything else.
+			virtual void setBusyPollTime( std::chrono::microseconds busyPollTime ) {}
+			virtual websocketpp::config::asio::alog_type& accessLog()=0;
+			virtual void setErrorLogLocation( std::ostream& outputStream )=0;
+			virtual void setErrorLogLevel( uint32_t level )=0;
+			virtual void setAccessLogLocation( std::ostream& outputStream )=0;
+			virtual void setAccessLogLevel( uint32_t level )=0;
+		};
+
+	} // end of namespace impl
+} // end of namespace communique
+
+#endif // end of ifndef communique_impl_ClientTransport_h
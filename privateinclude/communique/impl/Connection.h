@@ -2,15 +2,20 @@
 #define communique_impl_Connection_h
 
 #include <communique/IConnection.h>
+#include <communique/IExecutor.h>
 #include <functional>
 #include <list>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
 
 #define _WEBSOCKETPP_CPP11_STL_ // Make sure websocketpp uses c++11 features in preference to boost ones
 #include <websocketpp/connection.hpp>
-#include <websocketpp/config/asio.hpp>
 
 #include "communique/impl/Message.h"
-#include "communique/impl/UniqueTokenStorage.h"
+#include "communique/impl/ShardedUniqueTokenStorage.h"
+#include "communique/impl/TimingWheel.h"
+#include "communique/impl/StatsCounters.h"
 
 namespace communique
 {
@@ -23,31 +28,56 @@ namespace communique
 		 * connected to a different client. A connection between a server and a particular client will only have
 		 * one Connection instance for each.
 		 *
+		 * Everything to do with the Communique protocol is done here. Subclasses provide the transport the
+		 * messages go over, by implementing the protected methods and calling receiveMessage for everything
+		 * that arrives.
+		 *
 		 * @author Mark Grimes (kknb1056@gmail.com)
 		 * @date 30/Sep/2014
 		 */
 		class Connection : public communique::IConnection, public std::enable_shared_from_this<Connection>
 		{
 		public:
-			typedef websocketpp::connection<websocketpp::config::asio_tls>::ptr connection_ptr;
-			typedef websocketpp::connection<websocketpp::config::asio_tls>::message_ptr message_ptr;
-			//typedef websocketpp::client<connection_type>::connection_ptr connection_ptr;
+			typedef communique::impl::Message::message_ptr message_ptr;
 		public:
-			Connection( connection_ptr pConnection );
-			Connection( connection_ptr pConnection, std::function<void(const std::string&)>& infoHandler, std::function<std::string(const std::string&)>& requestHandler );
-			Connection( connection_ptr pConnection, std::function<void(const std::string&,std::weak_ptr<communique::IConnection>)>& infoHandler, std::function<std::string(const std::string&,std::weak_ptr<communique::IConnection>)>& requestHandler );
+			Connection();
 			virtual ~Connection();
 
 			virtual void sendRequest( const std::string& message, std::function<void(const std::string&)> responseHandler ) override;
+			virtual void sendRequest( const std::string& message, std::function<void(const std::string&,communique::ResponseStatus)> responseHandler, std::chrono::milliseconds timeout ) override;
+			virtual void sendRequest( const std::string& message, std::function<void(const communique::MessageView&,communique::ResponseStatus)> responseHandler, std::chrono::milliseconds timeout ) override;
+			virtual std::future<std::string> sendRequest( const std::string& message, std::chrono::milliseconds timeout=std::chrono::milliseconds(0) ) override;
+			virtual void sendRequest( std::string&& message, std::function<void(const std::string&)> responseHandler ) override;
+			virtual void sendRequest( std::string&& message, std::function<void(const std::string&,communique::ResponseStatus)> responseHandler, std::chrono::milliseconds timeout ) override;
+			virtual void sendRequest( std::string&& message, std::function<void(const communique::MessageView&,communique::ResponseStatus)> responseHandler, std::chrono::milliseconds timeout ) override;
+			virtual std::future<std::string> sendRequest( std::string&& message, std::chrono::milliseconds timeout=std::chrono::milliseconds(0) ) override;
+			virtual void sendRequest( communique::MessageBuffer&& message, std::function<void(const communique::MessageView&,communique::ResponseStatus)> responseHandler, std::chrono::milliseconds timeout ) override;
+			virtual std::future<std::string> sendRequest( communique::MessageBuffer&& message, std::chrono::milliseconds timeout=std::chrono::milliseconds(0) ) override;
 			virtual void sendInfo( const std::string& message ) override;
+			virtual void sendInfo( std::string&& message ) override;
+			virtual void sendInfo( communique::MessageBuffer&& message ) override;
 			virtual void setInfoHandler( std::function<void(const std::string&)> infoHandler ) override;
 			virtual void setInfoHandler( std::function<void(const std::string&,std::weak_ptr<communique::IConnection>)> infoHandler ) override;
+			virtual void setInfoHandler( std::function<void(const communique::MessageView&,std::weak_ptr<communique::IConnection>)> infoHandler ) override;
 			virtual void setRequestHandler( std::function<std::string(const std::string&)> requestHandler ) override;
 			virtual void setRequestHandler( std::function<std::string(const std::string&,std::weak_ptr<communique::IConnection>)> requestHandler ) override;
+			virtual void setRequestHandler( std::function<std::string(const communique::MessageView&,std::weak_ptr<communique::IConnection>)> requestHandler ) override;
+			virtual communique::Stats stats() const override;
+
+			/** @brief Sets where incoming requests are run. If null (the default) they are run on the IO thread. */
+			void setExecutor( std::shared_ptr<communique::IExecutor> pExecutor );
+			/** @brief Sets where response handlers are run. If null (the default) they are run on the IO thread. */
+			void setResponseExecutor( std::shared_ptr<communique::IExecutor> pExecutor );
+			/** @brief Sets the timer used for request timeouts, which can be shared between connections. If null
+			 * (the default) requests never time out. */
+			void setTimingWheel( std::shared_ptr<communique::impl::TimingWheel> pTimingWheel );
+			/** @brief The timeout for requests sent without one specified. Zero (the default) means wait forever. */
+			void setDefaultRequestTimeout( std::chrono::milliseconds timeout );
 
-			connection_ptr& underlyingPointer();
 			/// @brief Returns true if the connection is established. If status is "connecting" blocks until the status changes.
 			bool isConnected();
+			/// @brief As isConnected, but gives up and returns false if still connecting after the timeout.
+			bool waitConnected( std::chrono::milliseconds timeout );
 			/** @brief Returns true if the connection is closed. If status is "closing" blocks until the status changes.
 			 *
 			 * Note that this isn't quite the same as "!isConnected()", unless you're only concerned with the returned
@@ -55,10 +85,71 @@ namespace communique
 			 */
 			bool isDisconnected();
 			void close();
+			/** @brief Calls the handler for every request still waiting for a response with ResponseStatus::CONNECTIONCLOSED.
+			 * Called when the underlying connection closes, since no responses can arrive after that. */
+			void failPendingRequests();
+			/** @brief Wakes anything blocked in isConnected, waitConnected or isDisconnected so that they check the state again.
+			 * Has to be called by whatever gets the transport's open, close and fail callbacks, after the state changes. */
+			void notifyStateChange();
+			/** @brief From now on reply to any incoming request with an error rather than passing it to the request handler.
+			 * Used when shutting down, so that the requests already in progress can be waited for.
+			 * @parameter drainedHandler  Called on whichever thread finishes a request that takes requestsInProgress to zero. Not
+			 *                            called if it's already zero, so check that afterwards. Can be null.
+			 */
+			void stopAcceptingRequests( std::function<void()> drainedHandler=nullptr );
+			/// @brief The number of incoming requests that have been received but not yet had a response sent.
+			size_t requestsInProgress() const;
+			/// @brief The number of outgoing requests that have been sent but not yet had a response or timed out.
+			size_t requestsOutstanding() const;
+			/// @brief Returns true if the TLS handshake resumed a previous session. Only valid once the connection is open. False for transports without TLS.
+			virtual bool sessionResumed();
+			/// @brief How long to wait for the other end to finish closing before dropping the connection. Ignored by transports without a close handshake timer.
+			virtual void setCloseTimeout( std::chrono::milliseconds timeout );
+			/** @brief Sends a message that is going to many connections. pServerFrame is message.serverFrame(), which
+			 * transports that use WebSocket framing can send unchanged. Returns false if the message couldn't be queued. */
+			bool sendBroadcast( communique::impl::Message& message, const message_ptr& pServerFrame );
+			/// @brief Unique to the underlying connection, so that the owner can find this Connection again from the transport's callbacks.
+			virtual const void* key() const=0;
+			/// @brief A response handler that completes the promise, with a communique::RequestFailed exception if the request failed.
+			static std::function<void(const communique::MessageView&,communique::ResponseStatus)> promiseHandler( std::shared_ptr< std::promise<std::string> > pPromise );
+		protected:
+			/// @brief The state of the underlying connection. Transports that aren't WebSocket map their own states onto these.
+			virtual websocketpp::session::state::value state() const=0;
+			/// @brief Queues the message to be sent. Has to be safe to call from any thread. Returns false if it couldn't be queued.
+			virtual bool transmit( const message_ptr& pMessage )=0;
+			/// @brief Starts closing the underlying connection. Only called when the connection is open.
+			virtual void closeTransport()=0;
+			/// @brief Does the work for sendBroadcast. By default transmits the message as normal.
+			virtual bool transmitBroadcast( communique::impl::Message& message, const message_ptr& pServerFrame );
+			/// @brief How much has been queued but not yet written, for stats(). Zero by default.
+			virtual size_t sendQueueBytes() const;
+			/// @brief Subclasses call this for every message that arrives, in the order they arrive.
+			void receiveMessage( const message_ptr& pMessage );
 		private:
-			connection_ptr pConnection_;
-			std::function<void(const std::string&,std::weak_ptr<communique::IConnection>)> infoHandler_;
-			std::function<std::string(const std::string&,std::weak_ptr<communique::IConnection>)> requestHandler_;
+			std::function<void(const communique::MessageView&,std::weak_ptr<communique::IConnection>)> infoHandler_;
+			std::function<std::string(const communique::MessageView&,std::weak_ptr<communique::IConnection>)> requestHandler_;
+			/// The setters can be called from any thread while messages are flowing, so these three are only
+			/// accessed with std::atomic_load and std::atomic_store
+			std::shared_ptr<communique::IExecutor> pExecutor_;
+			std::shared_ptr<communique::IExecutor> pResponseExecutor_;
+			std::shared_ptr<communique::impl::TimingWheel> pTimingWheel_;
+			std::atomic<std::chrono::milliseconds> defaultRequestTimeout_;
+			std::atomic<bool> acceptingRequests_;
+			std::atomic<size_t> requestsInProgress_;
+			/// Set from another thread by stopAcceptingRequests, so only accessed with std::atomic_load and std::atomic_store
+			std::shared_ptr< std::function<void()> > pDrainedHandler_;
+			/// Kept alongside responseHandlers_ so that requestsOutstanding doesn't have to lock every shard to count them
+			std::atomic<size_t> requestsOutstanding_;
+			std::mutex stateMutex_;
+			std::condition_variable stateChanged_;
+			/// Everything needed to deal with the response to a request
+			struct PendingRequest
+			{
+				std::function<void(const communique::MessageView&,communique::ResponseStatus)> handler;
+				communique::impl::TimingWheel::TimerId timerId; ///< Zero if the request has no timeout
+				bool runInline; ///< True if the handler is cheap enough to call from the IO thread
+				communique::impl::StatsCounters::clock_type::time_point sent; ///< Set by registerRequest, for the response time stats. Default if not a timing sample.
+			};
 			/// This keeps track of the user references and associated handler for all requests
 			/// sent but without a response received.
 //			std::list< std::pair<communique::impl::Message::UserReference,std::function<void(const std::string&)> > > responseHandlers_;
@@ -66,15 +157,23 @@ namespace communique
 			/// to overflowing then responseHandlers_ is checked for free numbers. If ever
 			/// there are no responses pending it gets reset to zero.
 //			std::atomic<communique::impl::Message::UserReference> availableUserReference_;
-			communique::impl::UniqueTokenStorage<std::function<void(const std::string&)>,communique::impl::Message::UserReference> responseHandlers_;
+			/// Sharded so that several threads sending requests on this connection don't all contend for one lock.
+			communique::impl::ShardedUniqueTokenStorage<PendingRequest,communique::impl::Message::UserReference> responseHandlers_;
+			communique::impl::StatsCounters statsCounters_;
+
+			/// Transmits the message and counts it if it was queued. Everything is sent through here, apart from broadcasts.
+			bool sendMessage( const message_ptr& pMessage );
+			/// Decrements requestsInProgress_, and calls the drained handler if that was the last one.
+			void finishRequest();
 
-			//
-			// All the event handlers
-			//
-			void on_message( websocketpp::connection_hdl hdl, message_ptr msg );
-//			void on_open( websocketpp::connection_hdl hdl );
-//			void on_close( websocketpp::connection_hdl hdl );
-//			void on_interrupt( websocketpp::connection_hdl hdl );
+			/// Stores the request so that the response can be matched up to it, and starts the timeout. timerId is set to the timeout's ID, or zero if there isn't one.
+			communique::impl::Message::UserReference registerRequest( PendingRequest&& pendingRequest, std::chrono::milliseconds timeout, communique::impl::TimingWheel::TimerId& timerId );
+			/// Common part of the sendRequest overloads. T_String is either "const std::string&" or "std::string".
+			template<class T_String> void sendRequestMessage( T_String&& message, PendingRequest&& pendingRequest, std::chrono::milliseconds timeout );
+			/// Calls the handler, either directly or on the response executor if there is one
+			void dispatchResponse( PendingRequest& pendingRequest, const communique::MessageView& message, communique::ResponseStatus status );
+			/// Called by the timing wheel when a request times out
+			void expireRequest( communique::impl::Message::UserReference userReference, communique::impl::TimingWheel::TimerId timerId );
 		};
 
 	} // end of namespace impl
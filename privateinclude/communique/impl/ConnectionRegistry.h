@@ -0,0 +1,179 @@
+#ifndef communique_impl_ConnectionRegistry_h
+#define communique_impl_ConnectionRegistry_h
+
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <cstdint>
+
+namespace communique
+{
+
+	namespace impl
+	{
+		/** @brief Keeps track of the current connections, with constant time insert, lookup and removal.
+		 *
+		 * Connections are looked up by a key, which for the Server is the address of the underlying websocketpp
+		 * connection. Each connection is also given a unique ID when added, which increases in the order the
+		 * connections were added.
+		 *
+		 * Readers that want to go through every connection take a snapshot, which is an immutable vector shared
+		 * between all readers until the next add or remove. Adding and removing only throws the old snapshot away,
+		 * so is still constant time. The next reader builds a new one, holding the lock only long enough to copy
+		 * the pointers out. The sorting is done after it's released, so that adds and removes never wait for it.
+		 * That means lots of connections coming and going at once don't cost anything extra, and readers don't
+		 * need to hold the lock while they use the snapshot.
+		 *
+		 * @date 17/Oct/2026
+		 */
+		template<class T_Element,class T_Key=const void*>
+		class ConnectionRegistry
+		{
+		public:
+			typedef uint64_t ConnectionId;
+			/// Oldest connection first
+			typedef std::vector< std::shared_ptr<T_Element> > Snapshot;
+		public:
+			ConnectionRegistry();
+			/** @brief Add the element under the given key and return its new ID. If the key is already in use the
+			 * old element is replaced. */
+			ConnectionId add( const T_Key& key, std::shared_ptr<T_Element> pElement );
+			/** @brief Remove and return the element for the key. Returns null if the key isn't there. */
+			std::shared_ptr<T_Element> remove( const T_Key& key );
+			/** @brief Return the element for the key without removing it. Returns null if the key isn't there. */
+			std::shared_ptr<T_Element> find( const T_Key& key ) const;
+			/** @brief The ID given to the element when it was added, or zero if the key isn't there. IDs start at 1. */
+			ConnectionId id( const T_Key& key ) const;
+			/** @brief Return the element given the ID when it was added. Returns null if it has since been removed. */
+			std::shared_ptr<T_Element> findById( ConnectionId id ) const;
+			/** @brief All of the current elements, oldest first. Doesn't change if elements are added or removed later. */
+			std::shared_ptr<const Snapshot> snapshot() const;
+			size_t size() const;
+			bool empty() const;
+		private:
+			struct Entry
+			{
+				std::shared_ptr<T_Element> pElement;
+				ConnectionId id;
+			};
+			mutable std::mutex mutex_;
+			std::unordered_map<T_Key,Entry> entries_;
+			std::unordered_map<ConnectionId,T_Key> keys_; ///< The key of each entry, by its ID
+			ConnectionId nextId_;
+			uint64_t changes_; ///< Increased by every add and remove, so that a snapshot can tell if it's out of date
+			/// Null if something has changed since it was last built
+			mutable std::shared_ptr<const Snapshot> pSnapshot_;
+		};
+
+	} // end of namespace impl
+} // end of namespace communique
+
+template<class T_Element,class T_Key>
+communique::impl::ConnectionRegistry<T_Element,T_Key>::ConnectionRegistry()
+	: nextId_(1), changes_(0), pSnapshot_( std::make_shared<const Snapshot>() )
+{
+	// No operation besides the initialiser list
+}
+
+template<class T_Element,class T_Key>
+typename communique::impl::ConnectionRegistry<T_Element,T_Key>::ConnectionId communique::impl::ConnectionRegistry<T_Element,T_Key>::add( const T_Key& key, std::shared_ptr<T_Element> pElement )
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	Entry& entry=entries_[key];
+	if( entry.pElement ) keys_.erase( entry.id ); // Replacing an element that was already there
+	entry.pElement=std::move(pElement);
+	entry.id=nextId_++;
+	keys_[entry.id]=key;
+	++changes_;
+	pSnapshot_.reset();
+	return entry.id;
+}
+
+template<class T_Element,class T_Key>
+std::shared_ptr<T_Element> communique::impl::ConnectionRegistry<T_Element,T_Key>::remove( const T_Key& key )
+{
+	std::shared_ptr<T_Element> pReturnValue;
+	std::lock_guard<std::mutex> lock(mutex_);
+	auto iFindResult=entries_.find(key);
+	if( iFindResult==entries_.end() ) return pReturnValue;
+
+	pReturnValue=std::move(iFindResult->second.pElement);
+	keys_.erase( iFindResult->second.id );
+	entries_.erase(iFindResult);
+	++changes_;
+	pSnapshot_.reset();
+	return pReturnValue;
+}
+
+template<class T_Element,class T_Key>
+std::shared_ptr<T_Element> communique::impl::ConnectionRegistry<T_Element,T_Key>::find( const T_Key& key ) const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	auto iFindResult=entries_.find(key);
+	if( iFindResult==entries_.end() ) return std::shared_ptr<T_Element>();
+	else return iFindResult->second.pElement;
+}
+
+template<class T_Element,class T_Key>
+typename communique::impl::ConnectionRegistry<T_Element,T_Key>::ConnectionId communique::impl::ConnectionRegistry<T_Element,T_Key>::id( const T_Key& key ) const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	auto iFindResult=entries_.find(key);
+	if( iFindResult==entries_.end() ) return 0;
+	else return iFindResult->second.id;
+}
+
+template<class T_Element,class T_Key>
+std::shared_ptr<T_Element> communique::impl::ConnectionRegistry<T_Element,T_Key>::findById( ConnectionId id ) const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	auto iKey=keys_.find(id);
+	if( iKey==keys_.end() ) return std::shared_ptr<T_Element>();
+	else return entries_.find(iKey->second)->second.pElement;
+}
+
+template<class T_Element,class T_Key>
+std::shared_ptr<const typename communique::impl::ConnectionRegistry<T_Element,T_Key>::Snapshot> communique::impl::ConnectionRegistry<T_Element,T_Key>::snapshot() const
+{
+	// Something has changed since the last snapshot, so need to rebuild it. Only copy the entries
+	// while holding the lock, so that adds and removes don't have to wait for the sort.
+	std::vector<Entry> sortedEntries;
+	uint64_t changesWhenCopied;
+	{ // Block to limit lifetime of the lock_guard
+		std::lock_guard<std::mutex> lock(mutex_);
+		if( pSnapshot_ ) return pSnapshot_;
+		sortedEntries.reserve( entries_.size() );
+		for( const auto& keyEntryPair : entries_ ) sortedEntries.push_back( keyEntryPair.second );
+		changesWhenCopied=changes_;
+	}
+
+	// Sort by ID so that the order is the same as the order the elements were added
+	std::sort( sortedEntries.begin(), sortedEntries.end(), [](const Entry& first,const Entry& second){ return first.id<second.id; } );
+	std::shared_ptr<Snapshot> pNewSnapshot=std::make_shared<Snapshot>();
+	pNewSnapshot->reserve( sortedEntries.size() );
+	for( Entry& entry : sortedEntries ) pNewSnapshot->push_back( std::move(entry.pElement) );
+
+	// Keep it for the next reader, unless something has changed while it was being built. It's still
+	// a consistent view of the moment it was copied, so this reader can have it either way.
+	std::lock_guard<std::mutex> lock(mutex_);
+	if( changes_==changesWhenCopied ) pSnapshot_=pNewSnapshot;
+	return pNewSnapshot;
+}
+
+template<class T_Element,class T_Key>
+size_t communique::impl::ConnectionRegistry<T_Element,T_Key>::size() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return entries_.size();
+}
+
+template<class T_Element,class T_Key>
+bool communique::impl::ConnectionRegistry<T_Element,T_Key>::empty() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return entries_.empty();
+}
+
+#endif // end of ifndef communique_impl_ConnectionRegistry_h
@@ -0,0 +1,47 @@
+#ifndef communique_impl_EventLoopPrivateMembers_h
+#define communique_impl_EventLoopPrivateMembers_h
+
+#include <memory>
+#include <vector>
+#include <thread>
+#include <mutex>
+#define _WEBSOCKETPP_CPP11_STL_ // Make sure websocketpp uses c++11 features in preference to boost ones
+#include <websocketpp/common/asio.hpp>
+
+namespace communique
+{
+	class IExecutor;
+	namespace impl
+	{
+		class TimingWheel;
+	}
+
+	/** @brief The pimple for communique::EventLoop.
+	 *
+	 * Unlike the other pimples this is in a header, because Client and Server need to get at the io_service.
+	 *
+	 * @date 17/Oct/2026
+	 */
+	class EventLoopPrivateMembers
+	{
+	public:
+		EventLoopPrivateMembers() : pWork_( new websocketpp::lib::asio::io_service::work(ioService_) ) { /*No operation besides initialiser list*/ }
+
+		/** @brief Where request handlers are run for every Client and Server using the loop, unless they're given an
+		 * executor of their own. Created the first time it's needed, so that a loop nothing uses it on has no extra threads. */
+		std::shared_ptr<communique::IExecutor> defaultExecutor();
+		/** @brief The timer for request timeouts, shared by every Client and Server using the loop. Created the first time it's needed. */
+		std::shared_ptr<communique::impl::TimingWheel> timingWheel();
+
+		websocketpp::lib::asio::io_service ioService_; // Declared first so that it outlives everything using it
+		/// Stops the threads returning from run() when there is nothing to do
+		std::unique_ptr<websocketpp::lib::asio::io_service::work> pWork_;
+		std::vector<std::thread> threads_;
+
+		std::mutex sharedMutex_; ///< Guards pDefaultExecutor_ and pTimingWheel_
+		std::shared_ptr<communique::IExecutor> pDefaultExecutor_;
+		std::shared_ptr<communique::impl::TimingWheel> pTimingWheel_;
+	};
+}
+
+#endif // end of ifndef communique_impl_EventLoopPrivateMembers_h
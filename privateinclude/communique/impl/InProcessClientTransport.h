@@ -0,0 +1,54 @@
+#ifndef communique_impl_InProcessClientTransport_h
+#define communique_impl_InProcessClientTransport_h
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include "communique/impl/ClientTransport.h"
+
+#define _WEBSOCKETPP_CPP11_STL_ // Make sure websocketpp uses c++11 features in preference to boost ones
+#include <websocketpp/common/asio.hpp>
+#include <websocketpp/config/asio.hpp>
+
+namespace communique
+{
+
+	namespace impl
+	{
+		/** @brief A ClientTransport for InProcessConnections.
+		 *
+		 * URIs are "inproc://" followed by the name the server is listening under, e.g. "inproc://myService".
+		 *
+		 * @date 17/Oct/2026
+		 */
+		class InProcessClientTransport : public communique::impl::ClientTransport
+		{
+		public:
+			/** @brief Constructor
+			 * @parameter pIoService  The io_service to use, or null to create one. */
+			InProcessClientTransport( websocketpp::lib::asio::io_service* pIoService );
+
+			virtual std::shared_ptr<communique::impl::Connection> createConnection( const std::string& URI ) override;
+			virtual void connect( communique::impl::Connection& connection ) override;
+			virtual void run() override;
+			virtual void reset() override;
+			virtual websocketpp::lib::asio::io_service& ioService() override;
+
+			virtual websocketpp::config::asio::alog_type& accessLog() override;
+			virtual void setErrorLogLocation( std::ostream& outputStream ) override;
+			virtual void setErrorLogLevel( uint32_t level ) override;
+			virtual void setAccessLogLocation( std::ostream& outputStream ) override;
+			virtual void setAccessLogLevel( uint32_t level ) override;
+		private:
+			std::unique_ptr<websocketpp::lib::asio::io_service> pOwnIoService_; ///< Null if using an io_service from elsewhere
+			websocketpp::lib::asio::io_service& ioService_;
+			websocketpp::config::asio::alog_type accessLog_;
+			websocketpp::config::asio::elog_type errorLog_;
+			std::mutex nameMutex_;
+			std::string name_; ///< The server name for the most recently created connection
+		};
+
+	} // end of namespace impl
+} // end of namespace communique
+
+#endif // end of ifndef communique_impl_InProcessClientTransport_h
@@ -0,0 +1,66 @@
+#ifndef communique_impl_InProcessConnection_h
+#define communique_impl_InProcessConnection_h
+
+#include <memory>
+#include <atomic>
+#include <functional>
+#include <string>
+#include "communique/impl/Connection.h"
+
+#define _WEBSOCKETPP_CPP11_STL_ // Make sure websocketpp uses c++11 features in preference to boost ones
+#include <websocketpp/common/asio.hpp>
+
+namespace communique
+{
+
+	namespace impl
+	{
+		/** @brief A Connection to a Client or Server in the same process.
+		 *
+		 * Connections come in pairs, one for each end. Sending a message just hands the buffer to the other end's
+		 * IO thread, so nothing is copied or encoded and there are no sockets involved. A message broadcast to
+		 * several connections is the same buffer for all of them.
+		 *
+		 * @date 17/Oct/2026
+		 */
+		class InProcessConnection : public communique::impl::Connection
+		{
+		public:
+			/// Called on the IO thread once the connection is ready to use
+			std::function<void()> onOpen;
+			/// Called on the IO thread once the connection has closed, if it was opened
+			std::function<void()> onClose;
+			/// Called on the IO thread if the connection couldn't be made, with a description of why
+			std::function<void(const std::string&)> onFail;
+		public:
+			InProcessConnection( websocketpp::lib::asio::io_service& ioService );
+			~InProcessConnection();
+
+			/** @brief Joins the two ends together and starts opening them.
+			 * The server end opens first, so that it's ready for anything the client sends as soon as it opens. */
+			static void connect( const std::shared_ptr<InProcessConnection>& pClientEnd, const std::shared_ptr<InProcessConnection>& pServerEnd );
+			/// @brief For when there's nothing to connect to. The failure is reported on the IO thread.
+			void fail( const std::string& reason );
+
+			virtual const void* key() const override;
+		protected:
+			virtual websocketpp::session::state::value state() const override;
+			virtual bool transmit( const message_ptr& pMessage ) override;
+			virtual void closeTransport() override;
+		private:
+			std::atomic<websocketpp::session::state::value> state_;
+			websocketpp::lib::asio::io_service::strand strand_;
+			std::weak_ptr<InProcessConnection> pOtherEnd_; ///< Set before the connection opens, and never changed after
+			std::string failReason_;
+
+			std::shared_ptr<InProcessConnection> self();
+			/// Sets the state to open and calls onOpen, then does the same for pNext if there is one
+			void open( std::shared_ptr<InProcessConnection> pNext );
+			/// Sets the state to closed and queues the onClose or onFail callback. Can be called from any thread.
+			void finish();
+		};
+
+	} // end of namespace impl
+} // end of namespace communique
+
+#endif // end of ifndef communique_impl_InProcessConnection_h
@@ -0,0 +1,78 @@
+#ifndef communique_impl_InProcessServerTransport_h
+#define communique_impl_InProcessServerTransport_h
+
+#include <memory>
+#include <string>
+#include "communique/impl/ServerTransport.h"
+
+#define _WEBSOCKETPP_CPP11_STL_ // Make sure websocketpp uses c++11 features in preference to boost ones
+#include <websocketpp/common/asio.hpp>
+#include <websocketpp/config/asio.hpp>
+
+//
+// Forward declarations
+//
+namespace communique
+{
+	namespace impl
+	{
+		class InProcessConnection;
+	}
+}
+
+namespace communique
+{
+
+	namespace impl
+	{
+		/** @brief A ServerTransport for InProcessConnections.
+		 *
+		 * Servers listen under a name rather than on a port or socket file. The names are shared by everything in the
+		 * process, so only one server at a time can listen under each one.
+		 *
+		 * @date 17/Oct/2026
+		 */
+		class InProcessServerTransport : public communique::impl::ServerTransport
+		{
+		public:
+			/** @brief Constructor
+			 * @parameter pIoService  The io_service to use, or null to create one. */
+			InProcessServerTransport( websocketpp::lib::asio::io_service* pIoService );
+			~InProcessServerTransport();
+
+			/** @brief Connects the client end to the server listening under the name.
+			 * @return false if there is no server listening under that name. */
+			static bool connect( const std::string& name, const std::shared_ptr<communique::impl::InProcessConnection>& pClientEnd );
+
+			using communique::impl::ServerTransport::listen;
+			/// @brief Starts listening under the name given. Throws std::runtime_error if another server already is.
+			virtual void listen( const std::string& name ) override;
+			virtual bool isListening() const override;
+			virtual void stopListening() override;
+			virtual void run() override;
+			virtual void stop() override;
+			virtual void reset() override;
+
+			virtual websocketpp::config::asio::alog_type& accessLog() override;
+			virtual void setErrorLogLocation( std::ostream& outputStream ) override;
+			virtual void setErrorLogLevel( uint32_t level ) override;
+			virtual void setAccessLogLocation( std::ostream& outputStream ) override;
+			virtual void setAccessLogLevel( uint32_t level ) override;
+		private:
+			std::unique_ptr<websocketpp::lib::asio::io_service> pOwnIoService_; ///< Null if using an io_service from elsewhere
+			websocketpp::lib::asio::io_service& ioService_;
+			/// Keeps the io_service running while listening, since there's no acceptor to do that. Each connection
+			/// has its own as well, for the same reason.
+			std::unique_ptr<websocketpp::lib::asio::io_service::work> pWork_;
+			std::string name_; ///< Empty if not listening. Only changed with the registry locked.
+			websocketpp::config::asio::alog_type accessLog_;
+			websocketpp::config::asio::elog_type errorLog_;
+
+			/// Creates the server end for a client that has just connected. Called with the registry locked.
+			void accept( const std::shared_ptr<communique::impl::InProcessConnection>& pClientEnd );
+		};
+
+	} // end of namespace impl
+} // end of namespace communique
+
+#endif // end of ifndef communique_impl_InProcessServerTransport_h
@@ -2,6 +2,8 @@
 #define communique_impl_Message_h
 
 #include <functional>
+#include <communique/MessageView.h>
+#include <communique/MessageBuffer.h>
 
 #define _WEBSOCKETPP_CPP11_STL_ // Make sure websocketpp uses c++11 features in preference to boost ones
 #include <websocketpp/connection.hpp>
@@ -25,20 +27,36 @@ namespace communique
 		class Message
 		{
 		public:
-			typedef websocketpp::connection<websocketpp::config::asio_tls>::ptr connection_ptr;
+			/// All of the websocketpp configs use the same message type, so this is the same whatever the transport
 			typedef websocketpp::connection<websocketpp::config::asio_tls>::message_ptr message_ptr;
 			typedef uint32_t UserReference;
 			enum MessageType { REQUEST, RESPONSE, INFO, REQUESTERROR }; ///< Note that this is currently packed into a char, so don't extend more than 16 types
 		public:
 			Message( message_ptr pMessage );
-			Message( connection_ptr pConnection, const std::string& messageBody, MessageType type, UserReference userReference );
+			Message( const std::string& messageBody, MessageType type, UserReference userReference );
+			/// @brief Takes over the buffer of messageBody and writes the header in front of it, without allocating if there's spare capacity.
+			Message( std::string&& messageBody, MessageType type, UserReference userReference );
+			/// @brief Takes over the buffer of messageBody and writes the header into its headroom, so the body isn't moved at all.
+			Message( communique::MessageBuffer&& messageBody, MessageType type, UserReference userReference );
 			virtual ~Message();
 
 			MessageType type() const;
 			UserReference userReference() const;
+			/// @brief Returns a copy of the body. Prefer messageBodyView() which doesn't copy.
 			std::string messageBody() const;
+			/// @brief The body in place. Keeps the underlying message alive for as long as the view exists.
+			communique::MessageView messageBodyView() const;
 			const std::string& fullMessage() const;
 			message_ptr websocketppMessage();
+			/** @brief Returns the message with the WebSocket framing already applied, as a server would send it.
+			 *
+			 * Servers don't mask their frames, so the result can be sent unchanged to any number of RFC6455
+			 * connections. This lets a message going to many clients be framed once rather than once per client.
+			 * Returns null if the framing fails, in which case send websocketppMessage() as normal.
+			 */
+			message_ptr serverFrame() const;
+			/// @brief An empty buffer from the same place as every other message, for transports that put together incoming messages themselves.
+			static message_ptr newBuffer();
 		private:
 			message_ptr pFullMessage_;
 		};
@@ -0,0 +1,62 @@
+#ifndef communique_impl_RawClientTransport_h
+#define communique_impl_RawClientTransport_h
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include "communique/impl/ClientTransport.h"
+
+#define _WEBSOCKETPP_CPP11_STL_ // Make sure websocketpp uses c++11 features in preference to boost ones
+#include <websocketpp/common/asio.hpp>
+#include <websocketpp/config/asio.hpp>
+
+namespace communique
+{
+
+	namespace impl
+	{
+		/** @brief A ClientTransport for RawConnections, i.e. Communique messages straight over TCP or TLS without WebSocket.
+		 *
+		 * URIs are "tls://" (or "tcp://" without TLS) followed by the host and port, e.g. "tls://localhost:9000".
+		 * There's no default port. IPv6 addresses go in square brackets, e.g. "tcp://[::1]:9000".
+		 *
+		 * @date 17/Oct/2026
+		 */
+		class RawClientTransport : public communique::impl::ClientTransport
+		{
+		public:
+			/** @brief Constructor
+			 * @parameter pIoService  The io_service to use, or null to create one.
+			 * @parameter useTLS      Whether connections use TLS, with the settings from the TLSHandler. */
+			RawClientTransport( websocketpp::lib::asio::io_service* pIoService, bool useTLS );
+
+			virtual std::shared_ptr<communique::impl::Connection> createConnection( const std::string& URI ) override;
+			virtual void connect( communique::impl::Connection& connection ) override;
+			virtual void run() override;
+			virtual void reset() override;
+			virtual websocketpp::lib::asio::io_service& ioService() override;
+
+			virtual void setTLSHandler( std::shared_ptr<communique::impl::TLSHandler> pTLSHandler ) override;
+			virtual websocketpp::config::asio::alog_type& accessLog() override;
+			virtual void setErrorLogLocation( std::ostream& outputStream ) override;
+			virtual void setErrorLogLevel( uint32_t level ) override;
+			virtual void setAccessLogLocation( std::ostream& outputStream ) override;
+			virtual void setAccessLogLevel( uint32_t level ) override;
+		private:
+			std::unique_ptr<websocketpp::lib::asio::io_service> pOwnIoService_; ///< Null if using an io_service from elsewhere
+			websocketpp::lib::asio::io_service& ioService_;
+			const bool useTLS_;
+			websocketpp::config::asio::alog_type accessLog_;
+			websocketpp::config::asio::elog_type errorLog_;
+			std::shared_ptr<communique::impl::TLSHandler> pTLSHandler_; ///< Declared after accessLog_ so that it goes first, since it logs to it
+			std::mutex targetMutex_;
+			// Where the most recently created connection goes to
+			std::string host_;
+			std::string port_;
+			std::string URI_;
+		};
+
+	} // end of namespace impl
+} // end of namespace communique
+
+#endif // end of ifndef communique_impl_RawClientTransport_h
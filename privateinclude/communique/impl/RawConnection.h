@@ -0,0 +1,152 @@
+#ifndef communique_impl_RawConnection_h
+#define communique_impl_RawConnection_h
+
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <string>
+#include <deque>
+#include <vector>
+#include <array>
+#include "communique/impl/Connection.h"
+
+#define _WEBSOCKETPP_CPP11_STL_ // Make sure websocketpp uses c++11 features in preference to boost ones
+#include <websocketpp/common/asio.hpp>
+#include <websocketpp/config/asio.hpp>
+
+//
+// Forward declarations
+//
+namespace communique
+{
+	namespace impl
+	{
+		class TLSHandler;
+	}
+}
+
+namespace communique
+{
+
+	namespace impl
+	{
+		/** @brief A Connection that sends Communique messages straight over TCP, or TLS over TCP, without WebSocket.
+		 *
+		 * Each message is a 4 byte length in network byte order followed by the Communique message exactly as it
+		 * would be for WebSocket, i.e. the 5 byte header and then the body. There is no masking and no per frame
+		 * header to parse, and several queued messages go out in one write.
+		 *
+		 * Straight after connecting (and the TLS handshake if there is one) the client sends a short preamble and
+		 * the server echoes it back. An endpoint that doesn't understand the framing, like a WebSocket server,
+		 * answers with something else, so the connection fails cleanly rather than misreading what comes back.
+		 *
+		 * Closing is done by shutting down the sending side of the socket once everything queued has been written.
+		 * The other end closes in reply.
+		 *
+		 * @date 17/Oct/2026
+		 */
+		class RawConnection : public communique::impl::Connection
+		{
+		public:
+			typedef websocketpp::lib::asio::ip::tcp::socket socket_type;
+			typedef websocketpp::lib::asio::ssl::stream<socket_type> tls_stream_type;
+			/// Longer messages are treated as the other end misbehaving. The same as the websocketpp default.
+			static const uint32_t MAXIMUM_MESSAGE_SIZE=32000000;
+
+			/// Called on the IO thread once the connection is ready to use
+			std::function<void()> onOpen;
+			/// Called on the IO thread once the connection has closed, if it was opened
+			std::function<void()> onClose;
+			/// Called on the IO thread if the connection couldn't be made, with a description of why
+			std::function<void(const std::string&)> onFail;
+		public:
+			/** @brief Constructor
+			 * @parameter ioService    Where the IO is done.
+			 * @parameter pTLSContext  The TLS settings, or null for plain TCP.
+			 * @parameter pTLSHandler  Told about each TLS handshake so that it can keep count and resume sessions. Can be null. */
+			RawConnection( websocketpp::lib::asio::io_service& ioService, std::shared_ptr<websocketpp::lib::asio::ssl::context> pTLSContext, communique::impl::TLSHandler* pTLSHandler );
+
+			/// @brief The TCP socket, for a server to accept on.
+			socket_type& socket();
+			/** @brief Client side. Looks up the host, connects and does the handshakes.
+			 * @parameter sessionKey  What previous TLS sessions are filed under, so that only ones from the same server are offered. */
+			void connect( const std::string& host, const std::string& port, const std::string& sessionKey );
+			/// @brief Server side, once the socket has been accepted. Does the handshakes.
+			void accept();
+
+			virtual bool sessionResumed() override;
+			virtual void setCloseTimeout( std::chrono::milliseconds timeout ) override;
+			virtual const void* key() const override;
+		protected:
+			virtual websocketpp::session::state::value state() const override;
+			virtual bool transmit( const message_ptr& pMessage ) override;
+			virtual void closeTransport() override;
+			virtual size_t sendQueueBytes() const override;
+		private:
+			std::atomic<websocketpp::session::state::value> state_;
+			std::shared_ptr<websocketpp::lib::asio::ssl::context> pTLSContext_; ///< Kept so that the context outlives the stream
+			communique::impl::TLSHandler* pTLSHandler_;
+			std::unique_ptr<socket_type> pSocket_; ///< Null if using TLS
+			std::unique_ptr<tls_stream_type> pTLSStream_; ///< Null if not using TLS
+			websocketpp::lib::asio::io_service::strand strand_;
+			websocketpp::lib::asio::ip::tcp::resolver resolver_;
+			std::atomic<long long> closeTimeoutMilliseconds_;
+			websocketpp::lib::asio::steady_timer closeTimer_;
+
+			std::mutex sendMutex_; ///< Protects sendQueue_ and writing_
+			std::deque<message_ptr> sendQueue_;
+			bool writing_; ///< True from when a write is queued until the send queue is found empty
+			std::atomic<size_t> queuedBytes_; ///< Everything in sendQueue_ and messagesBeingWritten_
+			bool closeRequested_; ///< Only used on the strand
+			// Kept alive for as long as the write that uses them
+			std::vector<message_ptr> messagesBeingWritten_;
+			std::vector<uint32_t> lengthsBeingWritten_;
+			std::vector<websocketpp::lib::asio::const_buffer> writeBuffers_;
+			std::string coalescedWrite_; ///< With TLS everything is copied into one buffer, so that it's encrypted in as few records as possible
+
+			std::array<char,12> preamble_; ///< The preamble as received from the other end
+			std::array<char,16384> readBuffer_;
+			std::array<char,4> lengthBuffer_;
+			size_t lengthBytes_; ///< How much of the length of the next message has been read
+			message_ptr pIncoming_; ///< The message being read, or null if waiting for the length
+			size_t incomingRemaining_;
+			std::string failReason_;
+
+			std::shared_ptr<RawConnection> self();
+			/// Reads from whichever stream is in use. The handler has to be wrapped in the strand.
+			template<class T_Buffers, class T_Handler> void asyncRead( const T_Buffers& buffers, T_Handler handler );
+			template<class T_Buffers, class T_Handler> void asyncReadSome( const T_Buffers& buffers, T_Handler handler );
+			template<class T_Buffers, class T_Handler> void asyncWrite( const T_Buffers& buffers, T_Handler handler );
+			/// Does the TLS handshake if there is one, then calls on_handshake
+			void startHandshake( bool isClient );
+			/// Writes everything in the send queue, or shuts down the socket if it's empty and a close was asked for
+			void writeQueued();
+			/// Tells the other end that nothing more is coming
+			void shutdownSend();
+			/// Reads into the buffer, or straight into the message being read if there's a lot of it left
+			void startRead();
+			/// Splits the bytes read into messages and passes them to receiveMessage. Throws if they're not valid.
+			void consume( const char* pData, size_t size );
+			void startCloseTimer();
+			/// Called on the strand when the connection fails or finishes closing
+			void finish();
+
+			void on_resolve( const websocketpp::lib::asio::error_code& errorCode, websocketpp::lib::asio::ip::tcp::resolver::iterator endpoints );
+			void on_connect( const websocketpp::lib::asio::error_code& errorCode );
+			void on_handshake( bool isClient, const websocketpp::lib::asio::error_code& errorCode );
+			void on_preambleSent( bool isClient, const websocketpp::lib::asio::error_code& errorCode );
+			void on_preambleReceived( bool isClient, const websocketpp::lib::asio::error_code& errorCode );
+			void on_write( const websocketpp::lib::asio::error_code& errorCode );
+			void on_read( const websocketpp::lib::asio::error_code& errorCode, size_t bytesRead );
+			void on_readBody( const websocketpp::lib::asio::error_code& errorCode );
+			void on_closeTimeout( const websocketpp::lib::asio::error_code& errorCode );
+			/// Called once the handshakes are done on either end
+			void open();
+		};
+
+	} // end of namespace impl
+} // end of namespace communique
+
+#endif // end of ifndef communique_impl_RawConnection_h
@@ -0,0 +1,70 @@
+#ifndef communique_impl_RawServerTransport_h
+#define communique_impl_RawServerTransport_h
+
+#include <memory>
+#include "communique/impl/ServerTransport.h"
+
+#define _WEBSOCKETPP_CPP11_STL_ // Make sure websocketpp uses c++11 features in preference to boost ones
+#include <websocketpp/common/asio.hpp>
+#include <websocketpp/config/asio.hpp>
+
+//
+// Forward declarations
+//
+namespace communique
+{
+	namespace impl
+	{
+		class RawConnection;
+	}
+}
+
+namespace communique
+{
+
+	namespace impl
+	{
+		/** @brief A ServerTransport for RawConnections, i.e. Communique messages straight over TCP or TLS without WebSocket.
+		 *
+		 * @date 17/Oct/2026
+		 */
+		class RawServerTransport : public communique::impl::ServerTransport
+		{
+		public:
+			/** @brief Constructor
+			 * @parameter pIoService  The io_service to use, or null to create one.
+			 * @parameter useTLS      Whether connections use TLS, with the settings from the TLSHandler. */
+			RawServerTransport( websocketpp::lib::asio::io_service* pIoService, bool useTLS );
+			~RawServerTransport();
+
+			using communique::impl::ServerTransport::listen;
+			virtual void listen( size_t port ) override;
+			virtual bool isListening() const override;
+			virtual void stopListening() override;
+			virtual void run() override;
+			virtual void stop() override;
+			virtual void reset() override;
+
+			virtual void setTLSHandler( std::shared_ptr<communique::impl::TLSHandler> pTLSHandler ) override;
+			virtual websocketpp::config::asio::alog_type& accessLog() override;
+			virtual void setErrorLogLocation( std::ostream& outputStream ) override;
+			virtual void setErrorLogLevel( uint32_t level ) override;
+			virtual void setAccessLogLocation( std::ostream& outputStream ) override;
+			virtual void setAccessLogLevel( uint32_t level ) override;
+		private:
+			std::unique_ptr<websocketpp::lib::asio::io_service> pOwnIoService_; ///< Null if using an io_service from elsewhere
+			websocketpp::lib::asio::io_service& ioService_;
+			websocketpp::lib::asio::ip::tcp::acceptor acceptor_;
+			const bool useTLS_;
+			websocketpp::config::asio::alog_type accessLog_;
+			websocketpp::config::asio::elog_type errorLog_;
+			std::shared_ptr<communique::impl::TLSHandler> pTLSHandler_; ///< Declared after accessLog_ so that it goes first, since it logs to it
+
+			void startAccept();
+			void on_accept( std::shared_ptr<communique::impl::RawConnection> pConnection, const websocketpp::lib::asio::error_code& errorCode );
+		};
+
+	} // end of namespace impl
+} // end of namespace communique
+
+#endif // end of ifndef communique_impl_RawServerTransport_h
@@ -0,0 +1,78 @@
+#ifndef communique_impl_ServerTransport_h
+#define communique_impl_ServerTransport_h
+
+#include <memory>
+#include <functional>
+#include <string>
+#include <ostream>
+#include <stdexcept>
+#include <cstdint>
+#include <chrono>
+
+#define _WEBSOCKETPP_CPP11_STL_ // Make sure websocketpp uses c++11 features in preference to boost ones
+#include <websocketpp/config/asio.hpp>
+
+//
+// Forward declarations
+//
+namespace communique
+{
+	namespace impl
+	{
+		class Connection;
+		class TLSHandler;
+	}
+}
+
+namespace communique
+{
+
+	namespace impl
+	{
+		/** @brief The part of a Server that accepts connections, so that the Server works the same whatever they go over.
+		 *
+		 * The callbacks are set by the Server before listen is called, and are called from the IO threads. onOpen
+		 * is given the new Connection once it's ready to use. onClose is given the Connection::key() of one that
+		 * has closed.
+		 *
+		 * Always owned by a shared_ptr. Everything the transport queues on the io_service, and every connection
+		 * it accepts, holds a shared_ptr back to it, so it isn't deleted until nothing can call into it.
+		 *
+		 * @date 17/Oct/2026
+		 */
+		class ServerTransport : public std::enable_shared_from_this<ServerTransport>
+		{
+		public:
+			std::function<void(std::shared_ptr<communique::impl::Connection>)> onOpen;
+			std::function<void(const void*)> onClose;
+			std::function<void(const void*)> onInterrupt;
+		public:
+			virtual ~ServerTransport() {}
+
+			/// @brief Start accepting connections on a TCP port. Throws std::runtime_error if that fails or the transport doesn't use ports.
+			virtual void listen( size_t port ) { throw std::runtime_error( "Communique server listen error: this transport doesn't listen on a port" ); }
+			/// @brief Start accepting connections on a socket file. Throws std::runtime_error if that fails or the transport doesn't use socket files.
+			virtual void listen( const std::string& socketPath ) { throw std::runtime_error( "Communique server listen error: this transport doesn't listen on a socket file" ); }
+			virtual bool isListening() const=0;
+			virtual void stopListening()=0;
+			/// @brief Does the IO on the calling thread until stop is called or there's nothing left to do. Can be called from several threads at once.
+			virtual void run()=0;
+			virtual void stop()=0;
+			/// @brief Has to be called after the event loop has stopped, before run can be called again.
+			virtual void reset()=0;
+
+			/// @brief For transports that use TLS, which keep hold of the handler. Ignored by everything else.
+			virtual void setTLSHandler( std::shared_ptr<communique::impl::TLSHandler> pTLSHandler ) {}
+			/// @brief For transports that can poll for new messages rather than sleeping. Ignored by everything else.
+			virtual void setBusyPollTime( std::chrono::microseconds busyPollTime ) {}
+			virtual websocketpp::config::asio::alog_type& accessLog()=0;
+			virtual void setErrorLogLocation( std::ostream& outputStream )=0;
+			virtual void setErrorLogLevel( uint32_t level )=0;
+			virtual void setAccessLogLocation( std::ostream& outputStream )=0;
+			virtual void setAccessLogLevel( uint32_t level )=0;
+		};
+
+	} // end of namespace impl
+} // end of namespace communique
+
+#endif // end of ifndef communique_impl_ServerTransport_h
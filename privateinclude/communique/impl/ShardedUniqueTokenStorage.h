@@ -0,0 +1,168 @@
+#ifndef communique_impl_ShardedUniqueTokenStorage_h
+#define communique_impl_ShardedUniqueTokenStorage_h
+
+#include <memory>
+#include <atomic>
+#include "communique/impl/UniqueTokenStorage.h"
+
+namespace communique
+{
+
+	namespace impl
+	{
+		/** @brief A UniqueTokenStorage split into several independently locked shards, to reduce lock contention.
+		 *
+		 * Has exactly the same contract as UniqueTokenStorage. Each thread that pushes is assigned one of
+		 * the shards (round robin, the first time it pushes), so different threads sending requests
+		 * on the same connection mostly take different locks. The shard number is stored in the lowest
+		 * T_ShardBits of the token, so pop and at go straight to the correct shard.
+		 *
+		 * The maximum number of elements that can be stored in any one shard is reduced by a factor of
+		 * 2^T_ShardBits compared to UniqueTokenStorage, so this isn't suitable for small token types.
+		 *
+		 * @date 17/Oct/2026
+		 */
+		template<class T_Element,class T_Token=uint32_t,unsigned T_ShardBits=4>
+		class ShardedUniqueTokenStorage
+		{
+		public:
+			ShardedUniqueTokenStorage();
+			T_Token push( const T_Element& newElement );
+			T_Token push( T_Element&& newElement );
+			/** @brief Remove and return the object associated to the token.
+			 * Throws an exception if the token does not exist.*/
+			T_Element pop( const T_Token& token );
+			/** @brief Remove and move into the supplied object the object associated to the token.
+			 * Returns false if the token doesn't exist.*/
+			bool pop( const T_Token& token, T_Element& returnValue ) noexcept;
+			/** @brief As pop, but only removes the object if the predicate returns true when given the object.*/
+			template<class T_Predicate>
+			bool popIf( const T_Token& token, T_Element& returnValue, T_Predicate predicate );
+			/** @brief Remove every object and return them. Each shard is emptied in turn, so this is not atomic
+			 * with respect to pushes on other threads.*/
+			std::vector<T_Element> popAll();
+			/** @brief Return the object associated to the token without removing it.
+			 * Throws an exception if the token does not exist.*/
+			T_Element& at( const T_Token& token );
+			const T_Element& at( const T_Token& token ) const;
+			/** @brief Fills the supplied pointer with the address of the object.
+			 * If the token doesn't exist returns false*/
+			bool at( const T_Token& token, T_Element*& pReturnValue ) noexcept;
+			bool at( const T_Token& token, const T_Element*& pReturnValue ) const noexcept;
+			/** @brief The number of objects stored in all the shards. Each shard is counted in turn, so this is only
+			 * approximate while other threads are pushing or popping.*/
+			size_t size() const;
+		private:
+			static constexpr size_t numberOfShards_=( static_cast<size_t>(1)<<T_ShardBits );
+			static_assert( T_ShardBits<sizeof(T_Token)*8-8, "ShardedUniqueTokenStorage - too many shard bits for the token type" );
+			/// The shard used by the calling thread when pushing
+			static size_t shardForThisThread();
+			/// The shard a token was issued from
+			static size_t shardForToken( const T_Token& token );
+			/// Each shard is allocated separately so that the locks aren't on the same cache line
+			std::unique_ptr< communique::impl::UniqueTokenStorage<T_Element,T_Token> > shards_[numberOfShards_];
+		};
+
+	} // end of namespace impl
+} // end of namespace communique
+
+template<class T_Element,class T_Token,unsigned T_ShardBits>
+communique::impl::ShardedUniqueTokenStorage<T_Element,T_Token,T_ShardBits>::ShardedUniqueTokenStorage()
+{
+	for( auto& pShard : shards_ ) pShard.reset( new communique::impl::UniqueTokenStorage<T_Element,T_Token>(T_ShardBits) );
+}
+
+template<class T_Element,class T_Token,unsigned T_ShardBits>
+T_Token communique::impl::ShardedUniqueTokenStorage<T_Element,T_Token,T_ShardBits>::push( const T_Element& newElement )
+{
+	const size_t shard=shardForThisThread();
+	return shards_[shard]->push( newElement ) | static_cast<T_Token>(shard);
+}
+
+template<class T_Element,class T_Token,unsigned T_ShardBits>
+T_Token communique::impl::ShardedUniqueTokenStorage<T_Element,T_Token,T_ShardBits>::push( T_Element&& newElement )
+{
+	const size_t shard=shardForThisThread();
+	return shards_[shard]->push( std::move(newElement) ) | static_cast<T_Token>(shard);
+}
+
+template<class T_Element,class T_Token,unsigned T_ShardBits>
+T_Element communique::impl::ShardedUniqueTokenStorage<T_Element,T_Token,T_ShardBits>::pop( const T_Token& token )
+{
+	return shards_[shardForToken(token)]->pop( token & ~static_cast<T_Token>(numberOfShards_-1) );
+}
+
+template<class T_Element,class T_Token,unsigned T_ShardBits>
+bool communique::impl::ShardedUniqueTokenStorage<T_Element,T_Token,T_ShardBits>::pop( const T_Token& token, T_Element& returnValue ) noexcept
+{
+	return shards_[shardForToken(token)]->pop( token & ~static_cast<T_Token>(numberOfShards_-1), returnValue );
+}
+
+template<class T_Element,class T_Token,unsigned T_ShardBits>
+template<class T_Predicate>
+bool communique::impl::ShardedUniqueTokenStorage<T_Element,T_Token,T_ShardBits>::popIf( const T_Token& token, T_Element& returnValue, T_Predicate predicate )
+{
+	return shards_[shardForToken(token)]->popIf( token & ~static_cast<T_Token>(numberOfShards_-1), returnValue, predicate );
+}
+
+template<class T_Element,class T_Token,unsigned T_ShardBits>
+std::vector<T_Element> communique::impl::ShardedUniqueTokenStorage<T_Element,T_Token,T_ShardBits>::popAll()
+{
+	std::vector<T_Element> returnValue;
+	for( auto& pShard : shards_ )
+	{
+		std::vector<T_Element> shardElements=pShard->popAll();
+		for( auto& element : shardElements ) returnValue.push_back( std::move(element) );
+	}
+	return returnValue;
+}
+
+template<class T_Element,class T_Token,unsigned T_ShardBits>
+T_Element& communique::impl::ShardedUniqueTokenStorage<T_Element,T_Token,T_ShardBits>::at( const T_Token& token )
+{
+	return shards_[shardForToken(token)]->at( token & ~static_cast<T_Token>(numberOfShards_-1) );
+}
+
+template<class T_Element,class T_Token,unsigned T_ShardBits>
+const T_Element& communique::impl::ShardedUniqueTokenStorage<T_Element,T_Token,T_ShardBits>::at( const T_Token& token ) const
+{
+	return static_cast<const communique::impl::UniqueTokenStorage<T_Element,T_Token>&>(*shards_[shardForToken(token)]).at( token & ~static_cast<T_Token>(numberOfShards_-1) );
+}
+
+template<class T_Element,class T_Token,unsigned T_ShardBits>
+bool communique::impl::ShardedUniqueTokenStorage<T_Element,T_Token,T_ShardBits>::at( const T_Token& token, T_Element*& pReturnValue ) noexcept
+{
+	return shards_[shardForToken(token)]->at( token & ~static_cast<T_Token>(numberOfShards_-1), pReturnValue );
+}
+
+template<class T_Element,class T_Token,unsigned T_ShardBits>
+bool communique::impl::ShardedUniqueTokenStorage<T_Element,T_Token,T_ShardBits>::at( const T_Token& token, const T_Element*& pReturnValue ) const noexcept
+{
+	return static_cast<const communique::impl::UniqueTokenStorage<T_Element,T_Token>&>(*shards_[shardForToken(token)]).at( token & ~static_cast<T_Token>(numberOfShards_-1), pReturnValue );
+}
+
+template<class T_Element,class T_Token,unsigned T_ShardBits>
+size_t communique::impl::ShardedUniqueTokenStorage<T_Element,T_Token,T_ShardBits>::size() const
+{
+	size_t returnValue=0;
+	for( const auto& pShard : shards_ ) returnValue+=pShard->size();
+	return returnValue;
+}
+
+template<class T_Element,class T_Token,unsigned T_ShardBits>
+size_t communique::impl::ShardedUniqueTokenStorage<T_Element,T_Token,T_ShardBits>::shardForThisThread()
+{
+	// Shared between all instances, so a thread uses the same shard number in every connection. That's fine
+	// because what matters is that different threads use different shards.
+	static std::atomic<size_t> nextShard(0);
+	static thread_local size_t threadShard=( nextShard++ % numberOfShards_ );
+	return threadShard;
+}
+
+template<class T_Element,class T_Token,unsigned T_ShardBits>
+size_t communique::impl::ShardedUniqueTokenStorage<T_Element,T_Token,T_ShardBits>::shardForToken( const T_Token& token )
+{
+	return static_cast<size_t>( token & static_cast<T_Token>(numberOfShards_-1) );
+}
+
+#endif // end of ifndef communique_impl_ShardedUniqueTokenStorage_h
@@ -0,0 +1,57 @@
+#ifndef communique_impl_SharedMemoryClientTransport_h
+#define communique_impl_SharedMemoryClientTransport_h
+
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include "communique/impl/ClientTransport.h"
+
+#define _WEBSOCKETPP_CPP11_STL_ // Make sure websocketpp uses c++11 features in preference to boost ones
+#include <websocketpp/common/asio.hpp>
+#include <websocketpp/config/asio.hpp>
+
+namespace communique
+{
+
+	namespace impl
+	{
+		/** @brief A ClientTransport for SharedMemoryConnections.
+		 *
+		 * URIs are "shm://" followed by the path to the server's socket file, e.g. "shm:///tmp/myService.sock".
+		 *
+		 * @date 17/Oct/2026
+		 */
+		class SharedMemoryClientTransport : public communique::impl::ClientTransport
+		{
+		public:
+			/** @brief Constructor
+			 * @parameter pIoService  The io_service to use, or null to create one. */
+			SharedMemoryClientTransport( websocketpp::lib::asio::io_service* pIoService );
+
+			virtual std::shared_ptr<communique::impl::Connection> createConnection( const std::string& URI ) override;
+			virtual void connect( communique::impl::Connection& connection ) override;
+			virtual void run() override;
+			virtual void reset() override;
+			virtual websocketpp::lib::asio::io_service& ioService() override;
+
+			virtual void setBusyPollTime( std::chrono::microseconds busyPollTime ) override;
+			virtual websocketpp::config::asio::alog_type& accessLog() override;
+			virtual void setErrorLogLocation( std::ostream& outputStream ) override;
+			virtual void setErrorLogLevel( uint32_t level ) override;
+			virtual void setAccessLogLocation( std::ostream& outputStream ) override;
+			virtual void setAccessLogLevel( uint32_t level ) override;
+		private:
+			std::unique_ptr<websocketpp::lib::asio::io_service> pOwnIoService_; ///< Null if using an io_service from elsewhere
+			websocketpp::lib::asio::io_service& ioService_;
+			std::atomic<long long> busyPollMicroseconds_;
+			websocketpp::config::asio::alog_type accessLog_;
+			websocketpp::config::asio::elog_type errorLog_;
+			std::mutex endpointMutex_;
+			websocketpp::lib::asio::local::stream_protocol::endpoint endpoint_; ///< Where the most recently created connection goes to
+		};
+
+	} // end of namespace impl
+} // end of namespace communique
+
+#endif // end of ifndef communique_impl_SharedMemoryClientTransport_h
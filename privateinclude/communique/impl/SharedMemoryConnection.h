@@ -0,0 +1,140 @@
+#ifndef communique_impl_SharedMemoryConnection_h
+#define communique_impl_SharedMemoryConnection_h
+
+#include <memory>
+#include <mutex>
+#include <deque>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <string>
+#include "communique/impl/Connection.h"
+#include "communique/impl/SharedMemoryRing.h"
+
+#define _WEBSOCKETPP_CPP11_STL_ // Make sure websocketpp uses c++11 features in preference to boost ones
+#include <websocketpp/common/asio.hpp>
+
+namespace communique
+{
+
+	namespace impl
+	{
+		/** @brief A Connection to another process on the same host, with the messages going through shared memory.
+		 *
+		 * Each direction has a SharedMemoryRing, so sending a message is one copy into the ring and receiving it
+		 * is one copy out, with no system calls unless the other end is asleep. A reader that has run out of
+		 * messages sleeps on an eventfd, which the writer only signals if the reader said it was going to sleep.
+		 *
+		 * The two ends find each other through a Unix domain socket. The client creates the shared memory and
+		 * the eventfds, and passes their file descriptors to the server over the socket. The memory is sealed so
+		 * that it can't be resized, and the server refuses it otherwise. After that the socket is only used to
+		 * detect the other end closing, or dying.
+		 *
+		 * A full ring never makes the sender wait. Whatever doesn't fit is queued, and written from the IO thread
+		 * as the other end makes room, the same as the other transports' send queues. How much is queued shows
+		 * up in sendQueueBytes().
+		 *
+		 * Linux only, since it uses memfd_create and eventfd.
+		 *
+		 * @date 17/Oct/2026
+		 */
+		class SharedMemoryConnection : public communique::impl::Connection
+		{
+		public:
+			typedef websocketpp::lib::asio::local::stream_protocol::socket socket_type;
+			typedef websocketpp::lib::asio::local::stream_protocol::endpoint endpoint_type;
+			/// The capacity of the ring in each direction
+			static const size_t RING_CAPACITY=1<<20;
+
+			/// Called on the IO thread once the connection is ready to use
+			std::function<void()> onOpen;
+			/// Called on the IO thread once the connection has closed, if it was opened
+			std::function<void()> onClose;
+			/// Called on the IO thread if the connection couldn't be made, with a description of why
+			std::function<void(const std::string&)> onFail;
+		public:
+			/** @brief Constructor
+			 * @parameter ioService     Where the IO is done.
+			 * @parameter busyPollTime  How long to keep checking for new messages before going to sleep. */
+			SharedMemoryConnection( websocketpp::lib::asio::io_service& ioService, std::chrono::microseconds busyPollTime );
+			~SharedMemoryConnection();
+
+			/// @brief The socket used to find the other end, for a server to accept on.
+			socket_type& socket();
+			/// @brief Client side. Connects to the server listening on the endpoint and sets up the shared memory.
+			void connect( const endpoint_type& endpoint );
+			/// @brief Server side, once the socket has been accepted. Waits for the client to send the shared memory.
+			void accept();
+
+			virtual void setCloseTimeout( std::chrono::milliseconds timeout ) override;
+			virtual const void* key() const override;
+		protected:
+			virtual websocketpp::session::state::value state() const override;
+			virtual bool transmit( const message_ptr& pMessage ) override;
+			virtual size_t sendQueueBytes() const override;
+			virtual void closeTransport() override;
+		private:
+			std::atomic<websocketpp::session::state::value> state_;
+			socket_type socket_;
+			websocketpp::lib::asio::io_service::strand strand_;
+			const std::chrono::microseconds busyPollTime_;
+			std::atomic<long long> closeTimeoutMilliseconds_;
+			websocketpp::lib::asio::steady_timer closeTimer_;
+			websocketpp::lib::asio::steady_timer overflowTimer_; ///< For checking whether the other end has made room yet
+			std::chrono::microseconds overflowBackoff_; ///< How long to wait before checking again. Only used on the strand.
+
+			void* pSharedMemory_; ///< Null until the connection is set up
+			size_t sharedMemorySize_;
+			std::unique_ptr<communique::impl::SharedMemoryRing> pIncoming_;
+			std::unique_ptr<communique::impl::SharedMemoryRing> pOutgoing_;
+			websocketpp::lib::asio::posix::stream_descriptor incomingSignal_; ///< The eventfd this end sleeps on
+			int outgoingSignal_; ///< The eventfd the other end sleeps on
+
+			std::mutex sendMutex_; ///< Only one thread at a time can write to the ring. Also protects overflow_, overflowPosition_ and draining_.
+			/// Messages that didn't fit in the ring yet, in the order they were sent. The first can have been partly written.
+			std::deque<message_ptr> overflow_;
+			size_t overflowPosition_; ///< How much of the first message in overflow_ has been written
+			bool draining_; ///< True from when overflow_ gets something until it's found empty
+			std::atomic<size_t> overflowBytes_; ///< What's left to write of everything in overflow_
+			bool closeRequested_; ///< Only used on the strand
+			message_ptr pPartialMessage_; ///< The fragments received so far of a message that was too long for one record
+			uint64_t signalBuffer_;
+			char socketBuffer_;
+			std::string failReason_;
+
+			std::shared_ptr<SharedMemoryConnection> self();
+			/// Maps the shared memory and sets up the rings, so that this end reads from the incomingRing'th
+			void mapSharedMemory( int memoryFileDescriptor, size_t ringCapacity, bool initialise, int incomingRing );
+			/** @brief Writes as many records of the message to the outgoing ring as there's room for, starting from position.
+			 * Call holding sendMutex_. Updates position, and returns true if the whole message has been written. */
+			bool writeRecords( const std::string& payload, size_t& position );
+			/// Writes as much of overflow_ as fits, and if that isn't everything checks again after overflowBackoff_
+			void drainOverflow();
+			/// Tells the other end this end has finished sending
+			void shutdownSend();
+			/// Passes the complete messages in the incoming ring to receiveMessage, up to a limit. Returns true if anything was read.
+			bool readAvailable();
+			/// Reads everything there is, busy polling for a while, and then goes to sleep until woken
+			void receive();
+			void waitForSignal();
+			/// Waits for the socket to close, which is how the other end says it has finished
+			void waitForSocketClose();
+			void startCloseTimer();
+			/// Called when the connection fails or finishes closing. Releases everything but the shared memory.
+			void finish();
+
+			void on_connect( const websocketpp::lib::asio::error_code& errorCode );
+			void on_hello( const websocketpp::lib::asio::error_code& errorCode );
+			void on_acknowledge( const websocketpp::lib::asio::error_code& errorCode );
+			void on_signal( const websocketpp::lib::asio::error_code& errorCode );
+			void on_socketClosed( const websocketpp::lib::asio::error_code& errorCode );
+			void on_closeTimeout( const websocketpp::lib::asio::error_code& errorCode );
+			void on_overflowTimer( const websocketpp::lib::asio::error_code& errorCode );
+			/// Called once the handshake is done on either end
+			void open();
+		};
+
+	} // end of namespace impl
+} // end of namespace communique
+
+#endif // end of ifndef communique_impl_SharedMemoryConnection_h
@@ -0,0 +1,92 @@
+#ifndef communique_impl_SharedMemoryRing_h
+#define communique_impl_SharedMemoryRing_h
+
+#include <atomic>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+namespace communique
+{
+
+	namespace impl
+	{
+		/** @brief A single producer, single consumer queue of byte records in memory that two processes can share.
+		 *
+		 * The ring doesn't own its memory, it's just a view of it. One process calls the constructor with
+		 * initialise set to true to set up the control block, after which each end can construct its own view
+		 * of the same memory. Exactly one thread at a time may write, and exactly one at a time may read.
+		 *
+		 * Records are copied in and out whole, with an 8 byte header that holds the length and whether there
+		 * are more fragments to follow. Anything longer than maximumRecordSize has to be split by the caller.
+		 *
+		 * Blocking is left to the caller. The consumer calls prepareToWait before going to sleep, and the
+		 * producer calls consumerNeedsWaking after every write to find out whether to wake it.
+		 *
+		 * @date 17/Oct/2026
+		 */
+		class SharedMemoryRing
+		{
+		public:
+			/** @brief Constructor
+			 * @parameter pMemory     The start of the memory, which has to be aligned to at least 64 bytes.
+			 * @parameter capacity    The number of bytes available for records. Has to be a power of two, and at
+			 *                        least 64. The memory has to be at least regionSize(capacity) long.
+			 * @parameter initialise  If true the control block is reset, which has to be done once before either end
+			 *                        uses the ring.
+			 * @throws std::runtime_error if the capacity isn't valid.
+			 */
+			SharedMemoryRing( void* pMemory, size_t capacity, bool initialise );
+
+			/// @brief The number of bytes of memory needed for a ring of the given capacity.
+			static size_t regionSize( size_t capacity );
+			/// @brief The largest record that can be written, which is a quarter of the capacity so that several can be in flight.
+			size_t maximumRecordSize() const;
+
+			/** @brief Copies a record into the ring. Producer only.
+			 * @return false, without writing anything, if there isn't room at the moment. */
+			bool tryWrite( const char* pData, size_t length, bool moreFragments );
+			/** @brief Returns true if the consumer has said it is going to sleep, so needs waking. Producer only.
+			 * Only returns true once per prepareToWait, so that only one of several writes wakes the consumer. */
+			bool consumerNeedsWaking();
+
+			/** @brief Appends the next record to destination. Consumer only.
+			 * @return false if the ring is empty.
+			 * @throws std::runtime_error if the record is corrupt, in which case the ring can't be used any more. */
+			bool tryRead( std::string& destination, bool& moreFragments );
+			/** @brief Says that the consumer is about to sleep until woken. Consumer only.
+			 * @return false if something was written in the meantime, so it shouldn't sleep after all. */
+			bool prepareToWait();
+			bool empty() const;
+		private:
+			/// Lives at the start of the shared memory. Each member has a cache line to itself so that the ends don't contend.
+			struct ControlBlock
+			{
+				alignas(64) std::atomic<uint64_t> writePosition; ///< The total number of bytes ever written. Only changed by the producer.
+				alignas(64) std::atomic<uint64_t> readPosition; ///< The total number of bytes ever read. Only changed by the consumer.
+				alignas(64) std::atomic<uint32_t> consumerWaiting;
+			};
+			/// Goes in front of every record
+			struct RecordHeader
+			{
+				uint32_t length;
+				uint32_t flags;
+			};
+			static const uint32_t MORE_FRAGMENTS=1;
+
+			ControlBlock* pControl_;
+			char* pData_;
+			size_t capacity_;
+
+			/// Copies into the ring at the given position, wrapping round the end if necessary
+			void copyIn( uint64_t position, const char* pSource, size_t length );
+			/// Copies out of the ring from the given position, wrapping round the end if necessary
+			void copyOut( uint64_t position, char* pDestination, size_t length ) const;
+			/// The space a record takes up, including the header and padding so that the next header is aligned
+			static size_t recordSize( size_t length );
+		};
+
+	} // end of namespace impl
+} // end of namespace communique
+
+#endif // end of ifndef communique_impl_SharedMemoryRing_h
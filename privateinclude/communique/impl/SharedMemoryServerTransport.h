@@ -0,0 +1,75 @@
+#ifndef communique_impl_SharedMemoryServerTransport_h
+#define communique_impl_SharedMemoryServerTransport_h
+
+#include <memory>
+#include <string>
+#include <atomic>
+#include <chrono>
+#include "communique/impl/ServerTransport.h"
+
+#define _WEBSOCKETPP_CPP11_STL_ // Make sure websocketpp uses c++11 features in preference to boost ones
+#include <websocketpp/common/asio.hpp>
+#include <websocketpp/config/asio.hpp>
+
+//
+// Forward declarations
+//
+namespace communique
+{
+	namespace impl
+	{
+		class SharedMemoryConnection;
+	}
+}
+
+namespace communique
+{
+
+	namespace impl
+	{
+		/** @brief A ServerTransport for SharedMemoryConnections.
+		 *
+		 * Clients find the server through a Unix domain socket, which is created by listen and removed again by
+		 * stopListening. Everything after the connection is set up goes through shared memory.
+		 *
+		 * @date 17/Oct/2026
+		 */
+		class SharedMemoryServerTransport : public communique::impl::ServerTransport
+		{
+		public:
+			/** @brief Constructor
+			 * @parameter pIoService  The io_service to use, or null to create one. */
+			SharedMemoryServerTransport( websocketpp::lib::asio::io_service* pIoService );
+			~SharedMemoryServerTransport();
+
+			using communique::impl::ServerTransport::listen;
+			virtual void listen( const std::string& socketPath ) override;
+			virtual bool isListening() const override;
+			virtual void stopListening() override;
+			virtual void run() override;
+			virtual void stop() override;
+			virtual void reset() override;
+
+			virtual void setBusyPollTime( std::chrono::microseconds busyPollTime ) override;
+			virtual websocketpp::config::asio::alog_type& accessLog() override;
+			virtual void setErrorLogLocation( std::ostream& outputStream ) override;
+			virtual void setErrorLogLevel( uint32_t level ) override;
+			virtual void setAccessLogLocation( std::ostream& outputStream ) override;
+			virtual void setAccessLogLevel( uint32_t level ) override;
+		private:
+			std::unique_ptr<websocketpp::lib::asio::io_service> pOwnIoService_; ///< Null if using an io_service from elsewhere
+			websocketpp::lib::asio::io_service& ioService_;
+			websocketpp::lib::asio::local::stream_protocol::acceptor acceptor_;
+			std::string socketPath_; ///< Empty if not listening
+			std::atomic<long long> busyPollMicroseconds_;
+			websocketpp::config::asio::alog_type accessLog_;
+			websocketpp::config::asio::elog_type errorLog_;
+
+			void startAccept();
+			void on_accept( std::shared_ptr<communique::impl::SharedMemoryConnection> pConnection, const websocketpp::lib::asio::error_code& errorCode );
+		};
+
+	} // end of namespace impl
+} // end of namespace communique
+
+#endif // end of ifndef communique_impl_SharedMemoryServerTransport_h
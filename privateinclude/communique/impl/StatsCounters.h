@@ -0,0 +1,262 @@
+#ifndef communique_impl_StatsCounters_h
+#define communique_impl_StatsCounters_h
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include "communique/Stats.h"
+#include "communique/impl/Message.h"
+
+namespace communique
+{
+
+	namespace impl
+	{
+		/** @brief The counters behind communique::Stats, cheap enough to update for every message.
+		 *
+		 * Every counter is a relaxed atomic, so updating one never waits for another thread, and nothing is
+		 * worked out until a snapshot is asked for. Messages can be sent from any thread, so the sent counts
+		 * are kept separately for each of the first NUMBER_OF_WRITERS threads in the process to send anything.
+		 * Each of those only ever has one writer, so it can be updated with a plain load and store rather than
+		 * an atomic increment. Threads after that share one set updated with atomic increments. Reading the
+		 * clock costs more than everything else put together, so only one in every TIMING_SAMPLE_INTERVAL
+		 * timings on each thread is actually taken.
+		 * If the library is built with COMMUNIQUE_NO_STATS defined there are no counters, every method is
+		 * empty, and the clock is never read.
+		 *
+		 * @date 17/Oct/2026
+		 */
+		class StatsCounters
+		{
+		public:
+			typedef std::chrono::steady_clock clock_type;
+			static const unsigned int TIMING_SAMPLE_INTERVAL=16;
+			static const size_t NUMBER_OF_WRITERS=16;
+		public:
+			StatsCounters();
+
+			/** @brief The current time if this timing is one of the samples, otherwise a default time_point without reading
+			 * the clock. Pass the result to requestHandled etc. when whatever is being timed has finished. */
+			static clock_type::time_point startTimer();
+			/// @brief payload is the message as sent, i.e. starting with the Communique header
+			void messageSent( const std::string& payload );
+			/// @brief Only ever called by one thread at a time, since messages are received in order
+			void messageReceived( communique::impl::Message::MessageType type, size_t bytes );
+			/// @brief Records how long a request handler took, given the result of startTimer when it started
+			void requestHandled( clock_type::time_point start );
+			void infoHandled( clock_type::time_point start );
+			/// @brief Records how long a response took, given when its request was sent
+			void responseReceived( clock_type::time_point requestSent );
+			/// @brief Adds the counts to the snapshot. The numbers that aren't counts, e.g. requestsOutstanding, are left alone.
+			void addTo( communique::Stats& stats ) const;
+			/** @brief Zeroes everything that says how things are at the moment, e.g. requestsOutstanding, leaving only the counts.
+			 * For keeping the totals of connections that have since been replaced or closed. */
+			static communique::Stats countsOnly( communique::Stats stats );
+		private:
+#ifndef COMMUNIQUE_NO_STATS
+			/// Matches communique::LatencyHistogram, but with counters that can be updated from any thread
+			class Histogram
+			{
+			public:
+				Histogram();
+				void record( clock_type::duration duration );
+				void addTo( communique::LatencyHistogram& histogram ) const;
+			private:
+				std::array<std::atomic<uint64_t>,communique::LatencyHistogram::NUMBER_OF_BUCKETS> buckets_;
+				std::atomic<uint64_t> totalMicroseconds_;
+			};
+
+			/// Claims one of the NUMBER_OF_WRITERS indices for a thread, and gives it back when the thread exits
+			class WriterSlot
+			{
+			public:
+				WriterSlot();
+				~WriterSlot();
+				const size_t index; ///< NUMBER_OF_WRITERS if they were all taken
+			};
+
+			/// What one writer has sent. Padded so that different writers don't share a cache line.
+			struct SendCounters
+			{
+				std::array<std::atomic<uint64_t>,4> messages; ///< One for each communique::impl::Message::MessageType
+				std::atomic<uint64_t> bytes;
+				char padding[64-5*sizeof(std::atomic<uint64_t>)];
+			};
+
+			/// One for each writer index, and a last one shared by any threads that didn't get an index
+			std::array<SendCounters,NUMBER_OF_WRITERS+1> sent_;
+			/// One for each communique::impl::Message::MessageType
+			std::array<std::atomic<uint64_t>,4> messagesReceived_;
+			std::atomic<uint64_t> bytesReceived_;
+			Histogram requestHandlerTime_;
+			Histogram infoHandlerTime_;
+			Histogram responseTime_;
+
+			static void addCounts( communique::MessageCounts& counts, const std::array<std::atomic<uint64_t>,4>& counters );
+			/// The index into sent_ for this thread
+			static size_t writerIndex();
+#endif
+		};
+
+	} // end of namespace impl
+} // end of namespace communique
+
+inline communique::Stats communique::impl::StatsCounters::countsOnly( communique::Stats stats )
+{
+	stats.requestsOutstanding=0;
+	stats.requestsInProgress=0;
+	stats.sendQueueBytes=0;
+	stats.connections=0;
+	return stats;
+}
+
+#ifndef COMMUNIQUE_NO_STATS
+//
+// Definitions are here rather than in a source file so that they can be inlined into the message handling
+//
+inline communique::impl::StatsCounters::Histogram::Histogram()
+	: totalMicroseconds_(0)
+{
+	for( auto& bucket : buckets_ ) bucket=0;
+}
+
+inline void communique::impl::StatsCounters::Histogram::record( clock_type::duration duration )
+{
+	const auto microseconds=std::chrono::duration_cast<std::chrono::microseconds>( duration ).count();
+	uint64_t remaining=( microseconds>0 ? static_cast<uint64_t>(microseconds) : 0 );
+	totalMicroseconds_.fetch_add( remaining, std::memory_order_relaxed );
+
+	// Bucket i holds everything under 2^i microseconds, so the bucket is the number of significant bits
+	size_t bucket=0;
+	while( remaining!=0 && bucket<buckets_.size()-1 )
+	{
+		remaining>>=1;
+		++bucket;
+	}
+	buckets_[bucket].fetch_add( 1, std::memory_order_relaxed );
+}
+
+inline void communique::impl::StatsCounters::Histogram::addTo( communique::LatencyHistogram& histogram ) const
+{
+	for( size_t bucket=0; bucket<buckets_.size(); ++bucket )
+	{
+		const uint64_t count=buckets_[bucket].load( std::memory_order_relaxed );
+		histogram.buckets[bucket]+=count;
+		histogram.count+=count;
+	}
+	histogram.totalMicroseconds+=totalMicroseconds_.load( std::memory_order_relaxed );
+}
+
+inline communique::impl::StatsCounters::StatsCounters()
+	: bytesReceived_(0)
+{
+	for( auto& writer : sent_ )
+	{
+		for( auto& counter : writer.messages ) counter=0;
+		writer.bytes=0;
+	}
+	for( auto& counter : messagesReceived_ ) counter=0;
+}
+
+inline size_t communique::impl::StatsCounters::writerIndex()
+{
+	static thread_local WriterSlot slot;
+	return slot.index;
+}
+
+inline communique::impl::StatsCounters::clock_type::time_point communique::impl::StatsCounters::startTimer()
+{
+	static thread_local unsigned int timingsUntilSample=0;
+	if( timingsUntilSample!=0 )
+	{
+		--timingsUntilSample;
+		return clock_type::time_point();
+	}
+	timingsUntilSample=TIMING_SAMPLE_INTERVAL-1;
+	return clock_type::now();
+}
+
+inline void communique::impl::StatsCounters::messageSent( const std::string& payload )
+{
+	// Everything sent was made by communique::impl::Message, so there's always a header
+	const size_t type=static_cast<unsigned char>( payload[0] );
+	const size_t writer=writerIndex();
+	SendCounters& counters=sent_[writer];
+	if( writer<NUMBER_OF_WRITERS )
+	{
+		// Nothing else ever writes these, so a load and store is enough, and a lot cheaper than an atomic increment
+		if( type<counters.messages.size() ) counters.messages[type].store( counters.messages[type].load( std::memory_order_relaxed )+1, std::memory_order_relaxed );
+		counters.bytes.store( counters.bytes.load( std::memory_order_relaxed )+payload.size(), std::memory_order_relaxed );
+	}
+	else
+	{
+		if( type<counters.messages.size() ) counters.messages[type].fetch_add( 1, std::memory_order_relaxed );
+		counters.bytes.fetch_add( payload.size(), std::memory_order_relaxed );
+	}
+}
+
+inline void communique::impl::StatsCounters::messageReceived( communique::impl::Message::MessageType type, size_t bytes )
+{
+	// There's only ever one thread receiving, so these don't need to be atomic increments. A load and
+	// store is a lot cheaper, and snapshots still never see a torn value.
+	// The type came from the other end, so it can't be trusted to be one of the four
+	const size_t index=static_cast<size_t>( type );
+	if( index<messagesReceived_.size() ) messagesReceived_[index].store( messagesReceived_[index].load( std::memory_order_relaxed )+1, std::memory_order_relaxed );
+	bytesReceived_.store( bytesReceived_.load( std::memory_order_relaxed )+bytes, std::memory_order_relaxed );
+}
+
+inline void communique::impl::StatsCounters::requestHandled( clock_type::time_point start )
+{
+	if( start==clock_type::time_point() ) return; // Not one of the samples
+	requestHandlerTime_.record( clock_type::now()-start );
+}
+
+inline void communique::impl::StatsCounters::infoHandled( clock_type::time_point start )
+{
+	if( start==clock_type::time_point() ) return; // Not one of the samples
+	infoHandlerTime_.record( clock_type::now()-start );
+}
+
+inline void communique::impl::StatsCounters::responseReceived( clock_type::time_point requestSent )
+{
+	if( requestSent==clock_type::time_point() ) return; // Not one of the samples
+	responseTime_.record( clock_type::now()-requestSent );
+}
+
+inline void communique::impl::StatsCounters::addTo( communique::Stats& stats ) const
+{
+	for( const auto& writer : sent_ )
+	{
+		addCounts( stats.messagesSent, writer.messages );
+		stats.bytesSent+=writer.bytes.load( std::memory_order_relaxed );
+	}
+	addCounts( stats.messagesReceived, messagesReceived_ );
+	stats.bytesReceived+=bytesReceived_.load( std::memory_order_relaxed );
+	requestHandlerTime_.addTo( stats.requestHandlerTime );
+	infoHandlerTime_.addTo( stats.infoHandlerTime );
+	responseTime_.addTo( stats.responseTime );
+}
+
+inline void communique::impl::StatsCounters::addCounts( communique::MessageCounts& counts, const std::array<std::atomic<uint64_t>,4>& counters )
+{
+	counts.requests+=counters[communique::impl::Message::REQUEST].load( std::memory_order_relaxed );
+	counts.responses+=counters[communique::impl::Message::RESPONSE].load( std::memory_order_relaxed );
+	counts.infos+=counters[communique::impl::Message::INFO].load( std::memory_order_relaxed );
+	counts.requestErrors+=counters[communique::impl::Message::REQUESTERROR].load( std::memory_order_relaxed );
+}
+
+#else // COMMUNIQUE_NO_STATS is defined, so everything compiles to nothing
+
+inline communique::impl::StatsCounters::StatsCounters() {}
+inline communique::impl::StatsCounters::clock_type::time_point communique::impl::StatsCounters::startTimer() { return clock_type::time_point(); }
+inline void communique::impl::StatsCounters::messageSent( const std::string& payload ) {}
+inline void communique::impl::StatsCounters::messageReceived( communique::impl::Message::MessageType type, size_t bytes ) {}
+inline void communique::impl::StatsCounters::requestHandled( clock_type::time_point start ) {}
+inline void communique::impl::StatsCounters::infoHandled( clock_type::time_point start ) {}
+inline void communique::impl::StatsCounters::responseReceived( clock_type::time_point requestSent ) {}
+inline void communique::impl::StatsCounters::addTo( communique::Stats& stats ) const {}
+
+#endif // end of ifndef COMMUNIQUE_NO_STATS
+
+#endif // end of ifndef communique_impl_StatsCounters_h
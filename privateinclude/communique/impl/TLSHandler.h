@@ -3,7 +3,14 @@
 
 #include <functional>
 #include <string>
+#include <mutex>
+#include <map>
+#include <deque>
+#include <atomic>
+#include <chrono>
+#include <openssl/ssl.h>
 #include <websocketpp/config/asio.hpp>
+#include "communique/TLSVersion.h"
 
 namespace communique
 {
@@ -11,6 +18,9 @@ namespace communique
 	namespace impl
 	{
 		/** @brief Methods common to Client and Server that deal with the TLS handshake.
+		 *
+		 * The TLS context is built once, the first time it's needed, and shared between all connections.
+		 * Calling any of the setters causes it to be rebuilt for connections made after that point.
 		 *
 		 * @author Mark Grimes
 		 * @date 26/Jul/2015
@@ -18,13 +28,77 @@ namespace communique
 		class TLSHandler
 		{
 		public:
+			/// The keys used to encrypt and authenticate session tickets
+			struct SessionTicketKey
+			{
+				unsigned char name[16];
+				unsigned char aesKey[32];
+				unsigned char hmacKey[32];
+			};
+
 			TLSHandler( websocketpp::config::asio::alog_type& logger );
+			~TLSHandler();
 
 			void setCertificateChainFile( const std::string& filename );
 			void setPrivateKeyFile( const std::string& filename );
 			void setVerifyFile( const std::string& filename );
 			void setDiffieHellmanParamsFile( const std::string& filename );
 
+			/** @brief Restricts the protocol versions that can be negotiated. Defaults to TLS 1.2 up to TLS 1.3, so
+			 * two Communique peers will use TLS 1.3 if the OpenSSL library supports it. */
+			void setProtocolVersions( communique::TLSVersion minimum, communique::TLSVersion maximum );
+			/** @brief The OpenSSL cipher list used for TLS 1.2 and below. Defaults to ECDHE/DHE with AES-GCM or ChaCha20-Poly1305.
+			 * An empty string means use the OpenSSL defaults. */
+			void setCipherList( const std::string& cipherList );
+			/// @brief The OpenSSL list of TLS 1.3 cipher suites. An empty string (the default) means use the OpenSSL defaults.
+			void setCipherSuites( const std::string& cipherSuites );
+			/// @brief Colon separated list of the curves used for ECDHE, e.g. "X25519:P-256". Empty (the default) means use the OpenSSL defaults.
+			void setCurves( const std::string& curves );
+			/// @brief If true, when acting as a server choose the cipher by this end's order of preference rather than the client's.
+			void setServerCipherPreference( bool serverPreference );
+
+			/** @brief Turns on TLS session resumption, which is off by default.
+			 *
+			 * When acting as a server this enables the session cache and session tickets. When acting as a
+			 * client the session from each handshake is stored against the key given to prepareClientSession,
+			 * and offered to the server the next time that key is used.
+			 */
+			void setSessionResumption( bool enabled );
+			/// @brief The maximum number of sessions held in the server side session cache.
+			void setSessionCacheSize( size_t numberOfSessions );
+			/// @brief How long a session can be resumed for after it was created.
+			void setSessionTimeout( std::chrono::seconds timeout );
+			/** @brief Creates a new key for encrypting session tickets.
+			 *
+			 * The previous key is kept for decryption only, so tickets issued with it can still be used once
+			 * (and will be replaced by one encrypted with the new key). Tickets from before that are rejected.
+			 */
+			void rotateSessionTicketKeys();
+
+			/** @brief Called before a client handshake to offer the server any session stored under sessionKey,
+			 * and to make sure any new session is stored under that key. */
+			void prepareClientSession( SSL* pSSL, const std::string& sessionKey ) const;
+			/// @brief Called once the handshake has finished to keep count of how many sessions were resumed.
+			void recordHandshake( SSL* pSSL );
+			size_t completedHandshakes() const;
+			size_t resumedHandshakes() const;
+
+			/** @brief Copies the key for session tickets into the supplied object. Used by the OpenSSL callback.
+			 *
+			 * @parameter pName      The name of the key required. If null the current key is returned.
+			 * @parameter key        Filled with the key if it's found.
+			 * @parameter isCurrent  Set to true if the key found is the one currently used for encryption.
+			 * @return    False if there is no key with the requested name.
+			 */
+			bool sessionTicketKey( const unsigned char* pName, SessionTicketKey& key, bool& isCurrent ) const;
+			/** @brief Stores a session received from a server. Used by the OpenSSL callback.
+			 * Returns true if ownership of the session was taken. */
+			bool storeClientSession( SSL* pSSL, SSL_SESSION* pSession ) const;
+
+			/** @brief Returns the shared TLS context, building it first if any settings have changed.
+			 * Throws if any of the files can't be loaded, so can be called early to check the settings are valid. */
+			std::shared_ptr<websocketpp::lib::asio::ssl::context> context() const;
+
 			std::shared_ptr<websocketpp::lib::asio::ssl::context> on_tls_init( websocketpp::connection_hdl hdl ) const;
 			bool verify_certificate( bool preverified, websocketpp::lib::asio::ssl::verify_context& context ) const;
 		protected:
@@ -32,7 +106,31 @@ namespace communique
 			std::string privateKeyFileName_;
 			std::string verifyFileName_;
 			std::string diffieHellmanParamsFileName_;
+			communique::TLSVersion minimumVersion_;
+			communique::TLSVersion maximumVersion_;
+			std::string cipherList_;
+			std::string cipherSuites_;
+			std::string curves_;
+			bool serverCipherPreference_;
 			websocketpp::config::asio::alog_type& logger_;
+			/// The context given to every connection. Null if it needs to be (re)built.
+			mutable std::shared_ptr<websocketpp::lib::asio::ssl::context> pContext_;
+			mutable std::mutex contextMutex_;
+
+			std::atomic<bool> sessionResumption_; ///< Atomic because prepareClientSession reads it without contextMutex_
+			size_t sessionCacheSize_;
+			std::chrono::seconds sessionTimeout_;
+			/// Keys for session tickets, the first is the current one. Others are only used for decryption.
+			std::deque<SessionTicketKey> sessionTicketKeys_;
+			mutable std::mutex sessionTicketKeysMutex_;
+			/// Sessions received from servers when acting as a client, keyed by whatever was passed to prepareClientSession
+			mutable std::map<std::string,SSL_SESSION*> clientSessions_;
+			mutable std::mutex clientSessionsMutex_;
+			std::atomic<size_t> completedHandshakes_;
+			std::atomic<size_t> resumedHandshakes_;
+
+			/// Creates a new context from the current settings and loads all the files from disk.
+			std::shared_ptr<websocketpp::lib::asio::ssl::context> buildContext() const;
 		};
 
 	} // end of namespace impl
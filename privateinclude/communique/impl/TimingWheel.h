@@ -0,0 +1,76 @@
+#ifndef communique_impl_TimingWheel_h
+#define communique_impl_TimingWheel_h
+
+#include <functional>
+#include <chrono>
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+namespace communique
+{
+
+	namespace impl
+	{
+		/** @brief A hashed timing wheel, for running callbacks after a timeout.
+		 *
+		 * Time is split into ticks, and timers are hashed into a fixed ring of slots by the tick they
+		 * expire on. Adding and cancelling a timer are constant time, and each tick only looks at the
+		 * timers in one slot, so having a very large number of pending timers (e.g. one for every
+		 * request in flight) costs almost nothing. The price is that timers only have a resolution of
+		 * one tick.
+		 *
+		 * Callbacks are run on a thread owned by the wheel, which is only started when the first timer
+		 * is added. Callbacks should be quick since they hold up any other timers that expire at the same
+		 * time.
+		 *
+		 * @date 17/Oct/2026
+		 */
+		class TimingWheel
+		{
+		public:
+			typedef uint64_t TimerId;
+		public:
+			TimingWheel( std::chrono::milliseconds tickDuration=std::chrono::milliseconds(10), size_t numberOfSlots=512 );
+			~TimingWheel();
+
+			/** @brief Returns an ID that has never been used before, so that it can be recorded before calling add. */
+			TimerId newId();
+			/** @brief Runs the callback after the timeout. Returns an ID that can be used to cancel the timer. */
+			TimerId add( std::chrono::milliseconds timeout, std::function<void()> callback );
+			/** @brief As the other version of add, but using an ID previously obtained from newId(). */
+			void add( TimerId id, std::chrono::milliseconds timeout, std::function<void()> callback );
+			/** @brief Stops the timer from firing. Returns false if it has already fired or been cancelled. */
+			bool cancel( TimerId id );
+			/** @brief The number of timers waiting to fire. */
+			size_t size() const;
+		private:
+			struct Timer
+			{
+				TimerId id;
+				size_t rounds; ///< The number of times the wheel has to go round before this timer fires
+				std::function<void()> callback;
+			};
+			const std::chrono::milliseconds tickDuration_;
+			std::vector< std::list<Timer> > slots_;
+			/// Where to find each timer so that it can be cancelled in constant time
+			std::unordered_map< TimerId, std::pair<size_t,std::list<Timer>::iterator> > timerLocations_;
+			size_t currentSlot_;
+			TimerId nextId_;
+			bool stopping_;
+			std::thread tickThread_;
+			/// Points at a local in tickLoop, so that it can tell when a callback has destroyed the wheel. Only used on the tick thread.
+			bool* pDestroyedByCallback_;
+			mutable std::mutex mutex_;
+			std::condition_variable wakeUp_;
+
+			void tickLoop();
+		};
+
+	} // end of namespace impl
+} // end of namespace communique
+
+#endif // end of ifndef communique_impl_TimingWheel_h
@@ -1,9 +1,12 @@
 #ifndef communique_impl_UniqueTokenStorage_h
 #define communique_impl_UniqueTokenStorage_h
 
-#include <list>
+#include <deque>
+#include <vector>
 #include <mutex>
-#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <cstdint>
 
 // Windows has some ridiculous macros defined that interfere with e.g. std::numeric_limits<int>::min().
 // See for example http://stackoverflow.com/questions/5004858/stdmin-gives-error. Presumably non-windows
@@ -32,6 +35,18 @@ namespace communique
 		 * This is similar in concept to std::map, except that for a map you need to know the key
 		 * before you can add an item. In this case you don't care what the key is when you insert.
 		 *
+		 * Implemented as a "slot map", so that push, pop and at are all constant time. The token is
+		 * the index of the slot the element is stored in. For tokens of 32 bits or more the top 8
+		 * bits are a generation counter for the slot, which is incremented every time the slot is
+		 * reused. This means a stale token (e.g. a late response to a request that has already been
+		 * dealt with) is very unlikely to retrieve the element stored later in the same slot. Smaller
+		 * token types use all the bits for the index, so that the full range of the type can be stored.
+		 *
+		 * The constructor can be asked to leave the lowest bits of every token as zero, so that the
+		 * caller can use them for its own purposes (see ShardedUniqueTokenStorage).
+		 *
+		 * References returned by at() stay valid until that element is popped.
+		 *
 		 * Thread safe through the use of locking.
 		 *
 		 * @author Mark Grimes (kknb1056@gmail.com)
@@ -41,15 +56,26 @@ namespace communique
 		class UniqueTokenStorage
 		{
 		public:
-			UniqueTokenStorage();
+			/** @brief Constructor
+			 * @parameter reservedBits  The number of low bits of each token that are always zero. Reduces
+			 *                          the maximum number of elements by a factor of 2^reservedBits.
+			 */
+			UniqueTokenStorage( unsigned reservedBits=0 );
 			T_Token push( const T_Element& newElement );
-			T_Token push( const T_Element&& newElement );
+			T_Token push( T_Element&& newElement );
 			/** @brief Remove and return the object associated to the token.
 			 * Throws an exception if the token does not exist.*/
 			T_Element pop( const T_Token& token );
 			/** @brief Remove and move into the supplied object the object associated to the token.
 			 * Returns false if the token doesn't exist.*/
 			bool pop( const T_Token& token, T_Element& returnValue ) noexcept;
+			/** @brief As pop, but only removes the object if the predicate returns true when given the object.
+			 * The check and removal happen under the same lock. Returns false if the token doesn't exist
+			 * or the predicate returned false.*/
+			template<class T_Predicate>
+			bool popIf( const T_Token& token, T_Element& returnValue, T_Predicate predicate );
+			/** @brief Remove every object and return them, e.g. to notify all pending handlers that they won't be called.*/
+			std::vector<T_Element> popAll();
 			/** @brief Return the object associated to the token without removing it.
 			 * Throws an exception if the token does not exist.*/
 			T_Element& at( const T_Token& token );
@@ -58,18 +84,43 @@ namespace communique
 			 * If the token doesn't exist returns false*/
 			bool at( const T_Token& token, T_Element*& pReturnValue ) noexcept;
 			bool at( const T_Token& token, const T_Element*& pReturnValue ) const noexcept;
+			/** @brief The number of objects currently stored.*/
+			size_t size() const;
 		private:
-			/// gets a token for both versions of store. N.B. assumes collection is already locked.
-			std::pair<T_Token,typename std::list< std::pair<T_Token,T_Element> >::iterator> getFreeToken();
-			std::list< std::pair<T_Token,T_Element> > container_;
-			std::mutex lockMutex_;
+			/// The number of bits of the token used for the slot index. The rest are the generation.
+			static constexpr unsigned indexBits_=( sizeof(T_Token)>=4 ? sizeof(T_Token)*8-8 : sizeof(T_Token)*8 );
+			/// The amount the generation counter is increased by each time a slot is reused, i.e. one in the first generation bit.
+			static constexpr uint64_t generationIncrement_=( static_cast<uint64_t>(1)<<indexBits_ );
+			/// The low bits of the token which are always left as zero
+			const unsigned reservedBits_;
+			/// The maximum number of slots, i.e. the maximum number of elements that can be stored at once.
+			const uint64_t maximumSlots_;
+			/// Returns the slot index encoded in the token
+			size_t indexFromToken( const T_Token& token ) const;
+			struct Slot
+			{
+				T_Element element;
+				T_Token generation;
+				bool occupied;
+			};
+			/// Finds the slot for the token, or returns nullptr if it isn't in use. N.B. assumes collection is already locked.
+			Slot* findSlot( const T_Token& token ) const;
+			/// gets a slot for both versions of push and returns its token. N.B. assumes collection is already locked.
+			T_Token getFreeSlot( Slot*& pSlot );
+			/// A deque rather than a vector so that references to elements survive the container growing
+			mutable std::deque<Slot> slots_;
+			/// Indices of slots that have been used and then freed, so can be reused
+			std::vector<size_t> freeSlots_;
+			mutable std::mutex lockMutex_;
 		};
 
 	} // end of namespace impl
 } // end of namespace communique
 
 template<class T_Element,class T_Token>
-communique::impl::UniqueTokenStorage<T_Element,T_Token>::UniqueTokenStorage()
+communique::impl::UniqueTokenStorage<T_Element,T_Token>::UniqueTokenStorage( unsigned reservedBits )
+	: reservedBits_(reservedBits),
+	  maximumSlots_( reservedBits<indexBits_ ? (generationIncrement_>>reservedBits) : 1 )
 {
 
 }
@@ -79,31 +130,26 @@ T_Token communique::impl::UniqueTokenStorage<T_Element,T_Token>::push( const T_E
 {
 	std::lock_guard<std::mutex> guard(lockMutex_);
 
-	// Get a free token and iterator telling me where to insert the new element
-	auto tokenIteratorPair=getFreeToken();
-	// Then insert the new element at the correct place in the collection...
-	container_.emplace( tokenIteratorPair.second, tokenIteratorPair.first, newElement );
-	// ...and return the token to the user.
-	return tokenIteratorPair.first;
+	Slot* pSlot;
+	T_Token token=getFreeSlot( pSlot );
+	pSlot->element=newElement;
+	return token;
 }
 
 template<class T_Element,class T_Token>
-T_Token communique::impl::UniqueTokenStorage<T_Element,T_Token>::push( const T_Element&& newElement )
+T_Token communique::impl::UniqueTokenStorage<T_Element,T_Token>::push( T_Element&& newElement )
 {
 	std::lock_guard<std::mutex> guard(lockMutex_);
 
-	// Get a free token and iterator telling me where to insert the new element
-	auto tokenIteratorPair=getFreeToken();
-	// Then insert the new element at the correct place in the collection...
-	container_.emplace( tokenIteratorPair.second, tokenIteratorPair.first, std::forward(newElement) );
-	// ...and return the token to the user.
-	return tokenIteratorPair.first;
+	Slot* pSlot;
+	T_Token token=getFreeSlot( pSlot );
+	pSlot->element=std::move(newElement);
+	return token;
 }
 
 template<class T_Element,class T_Token>
 T_Element communique::impl::UniqueTokenStorage<T_Element,T_Token>::pop( const T_Token& token )
 {
-	//std::lock_guard<std::mutex> guard(lockMutex_);
 	T_Element returnValue;
 	if( !pop( token, returnValue ) ) throw std::runtime_error( "communique::impl::UniqueTokenStorage::pop couldn't find token" );
 	return returnValue;
@@ -114,24 +160,58 @@ bool communique::impl::UniqueTokenStorage<T_Element,T_Token>::pop( const T_Token
 {
 	std::lock_guard<std::mutex> guard(lockMutex_);
 
-	auto iEntry=container_.begin();
-	for( ; iEntry!=container_.end(); ++iEntry )
-	{
-		if( token==iEntry->first ) break;
-	}
+	Slot* pSlot=findSlot( token );
+	if( pSlot==nullptr ) return false; // Token not found
+
+	returnValue=std::move( pSlot->element );
+	pSlot->element=T_Element(); // Make sure anything held by the element (e.g. captured by a std::function) is released now
+	pSlot->occupied=false;
+	freeSlots_.push_back( indexFromToken(token) );
+
+	return true;
+}
+
+template<class T_Element,class T_Token>
+template<class T_Predicate>
+bool communique::impl::UniqueTokenStorage<T_Element,T_Token>::popIf( const T_Token& token, T_Element& returnValue, T_Predicate predicate )
+{
+	std::lock_guard<std::mutex> guard(lockMutex_);
 
-	if( iEntry==container_.end() ) return false; // Token not found
+	Slot* pSlot=findSlot( token );
+	if( pSlot==nullptr ) return false; // Token not found
+	if( !predicate( static_cast<const T_Element&>(pSlot->element) ) ) return false;
 
-	returnValue=std::move( iEntry->second );
-	container_.erase( iEntry );
+	returnValue=std::move( pSlot->element );
+	pSlot->element=T_Element();
+	pSlot->occupied=false;
+	freeSlots_.push_back( indexFromToken(token) );
 
 	return true;
 }
 
+template<class T_Element,class T_Token>
+std::vector<T_Element> communique::impl::UniqueTokenStorage<T_Element,T_Token>::popAll()
+{
+	std::lock_guard<std::mutex> guard(lockMutex_);
+
+	std::vector<T_Element> returnValue;
+	for( size_t index=0; index<slots_.size(); ++index )
+	{
+		Slot& slot=slots_[index];
+		if( !slot.occupied ) continue;
+		returnValue.push_back( std::move(slot.element) );
+		slot.element=T_Element();
+		slot.occupied=false;
+		freeSlots_.push_back( index );
+	}
+
+	return returnValue;
+}
+
 template<class T_Element,class T_Token>
 T_Element& communique::impl::UniqueTokenStorage<T_Element,T_Token>::at( const T_Token& token )
 {
-	T_Element pReturnValue;
+	T_Element* pReturnValue;
 	if( !at( token, pReturnValue ) ) throw std::runtime_error( "communique::impl::UniqueTokenStorage::at couldn't find token" );
 	return *pReturnValue;
 }
@@ -139,7 +219,7 @@ T_Element& communique::impl::UniqueTokenStorage<T_Element,T_Token>::at( const T_
 template<class T_Element,class T_Token>
 const T_Element& communique::impl::UniqueTokenStorage<T_Element,T_Token>::at( const T_Token& token ) const
 {
-	T_Element pReturnValue;
+	const T_Element* pReturnValue;
 	if( !at( token, pReturnValue ) ) throw std::runtime_error( "communique::impl::UniqueTokenStorage::at couldn't find token" );
 	return *pReturnValue;
 }
@@ -149,15 +229,10 @@ bool communique::impl::UniqueTokenStorage<T_Element,T_Token>::at( const T_Token&
 {
 	std::lock_guard<std::mutex> guard(lockMutex_);
 
-	auto iEntry=container_.begin();
-	for( ; iEntry!=container_.end(); ++iEntry )
-	{
-		if( token==iEntry->first ) break;
-	}
+	Slot* pSlot=findSlot( token );
+	if( pSlot==nullptr ) return false; // Token not found
 
-	if( iEntry==container_.end() ) return false; // Token not found
-
-	pReturnValue=&iEntry->second;
+	pReturnValue=&pSlot->element;
 
 	return true;
 }
@@ -167,54 +242,66 @@ bool communique::impl::UniqueTokenStorage<T_Element,T_Token>::at( const T_Token&
 {
 	std::lock_guard<std::mutex> guard(lockMutex_);
 
-	auto iEntry=container_.begin();
-	for( ; iEntry!=container_.end(); ++iEntry )
-	{
-		if( token==iEntry->first ) break;
-	}
-
-	if( iEntry==container_.end() ) return false; // Token not found
+	Slot* pSlot=findSlot( token );
+	if( pSlot==nullptr ) return false; // Token not found
 
-	pReturnValue=&iEntry->second;
+	pReturnValue=&pSlot->element;
 
 	return true;
 }
 
 template<class T_Element,class T_Token>
-std::pair<T_Token,typename std::list< std::pair<T_Token,T_Element> >::iterator> communique::impl::UniqueTokenStorage<T_Element,T_Token>::getFreeToken()
+size_t communique::impl::UniqueTokenStorage<T_Element,T_Token>::size() const
+{
+	std::lock_guard<std::mutex> guard(lockMutex_);
+	return slots_.size()-freeSlots_.size();
+}
+
+template<class T_Element,class T_Token>
+typename communique::impl::UniqueTokenStorage<T_Element,T_Token>::Slot* communique::impl::UniqueTokenStorage<T_Element,T_Token>::findSlot( const T_Token& token ) const
 {
 	// Don't lock - assume this has already been done by the callee.
+	const size_t index=indexFromToken( token );
+	if( index>=slots_.size() ) return nullptr;
+
+	Slot& slot=slots_[index];
+	if( !slot.occupied || static_cast<T_Token>(slot.generation+(static_cast<T_Token>(index)<<reservedBits_))!=token ) return nullptr;
+	return &slot;
+}
 
-	// I need to find a token not already stored in the container_ list. Simplest case
-	// is when the list is empty and I can use zero.
-	T_Token token;
-	if( container_.empty() ) return std::make_pair( std::numeric_limits<T_Token>::min(), container_.begin() );
+template<class T_Element,class T_Token>
+size_t communique::impl::UniqueTokenStorage<T_Element,T_Token>::indexFromToken( const T_Token& token ) const
+{
+	return static_cast<size_t>( (static_cast<uint64_t>(token) & (generationIncrement_-1)) >> reservedBits_ );
+}
+
+template<class T_Element,class T_Token>
+T_Token communique::impl::UniqueTokenStorage<T_Element,T_Token>::getFreeSlot( Slot*& pSlot )
+{
+	// Don't lock - assume this has already been done by the callee.
+
+	size_t index;
+	if( !freeSlots_.empty() )
+	{
+		// Reuse a slot that's been freed. Bump the generation so that old tokens for this slot no longer match.
+		index=freeSlots_.back();
+		freeSlots_.pop_back();
+		pSlot=&slots_[index];
+		if( indexBits_<sizeof(T_Token)*8 ) pSlot->generation=static_cast<T_Token>( pSlot->generation+static_cast<T_Token>(generationIncrement_) );
+	}
 	else
 	{
-		// Next simplest case is increasing the token in the last entry by one, assuming
-		// it is not at its limit.
-		token=container_.back().first;
-		if( token!=std::numeric_limits<T_Token>::max() ) return std::make_pair( ++token, container_.end() );
-		else
-		{
-			// The last entry can't be increased, so see if the first entry can't be decreased.
-			token=container_.front().first;
-			if( token!=std::numeric_limits<T_Token>::min() ) return std::make_pair( --token, container_.begin() );
-			else
-			{
-				// Can't find any free space at the front or the back, so I need to run through
-				// and find a free space somewhere in the middle.
-				auto iEntry=container_.begin();
-				for( ; iEntry!=container_.end(); ++iEntry, ++token )
-				{
-					if( token!=iEntry->first ) break;
-				}
-				// Make sure I was able to find free space
-				if( iEntry==container_.end() ) throw std::runtime_error( "communique::impl::UniqueTokenStorage::push couldn't find free space" );
-				return std::make_pair( token, iEntry );
-			} // end of "else" for "if can't decrease the first token"
-		} // end of "else" for "if can't increase the last token"
-	} // end of "else" for "if empty"
+		// Otherwise create a new slot at the end, if there's space.
+		index=slots_.size();
+		if( index>=maximumSlots_ ) throw std::runtime_error( "communique::impl::UniqueTokenStorage::push couldn't find free space" );
+		slots_.emplace_back();
+		pSlot=&slots_.back();
+		pSlot->generation=0;
+	}
+	pSlot->occupied=true;
+
+	// The generation is stored pre-shifted into the high bits, so the token is just the sum of the two.
+	return static_cast<T_Token>( pSlot->generation+(static_cast<T_Token>(index)<<reservedBits_) );
 }
 
 // If this is windows, check if the macros undefined at the start need to be reset
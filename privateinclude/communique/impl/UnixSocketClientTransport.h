@@ -0,0 +1,60 @@
+#ifndef communique_impl_UnixSocketClientTransport_h
+#define communique_impl_UnixSocketClientTransport_h
+
+#include <memory>
+#include <mutex>
+#include "communique/impl/ClientTransport.h"
+
+#define _WEBSOCKETPP_CPP11_STL_ // Make sure websocketpp uses c++11 features in preference to boost ones
+#include <websocketpp/common/asio.hpp>
+#include <websocketpp/client.hpp>
+#include <websocketpp/config/core.hpp>
+
+namespace communique
+{
+
+	namespace impl
+	{
+		/** @brief A ClientTransport that makes WebSocket connections over a Unix domain socket.
+		 *
+		 * URIs are "unix://" followed by the path to the socket file, e.g. "unix:///tmp/myService.sock".
+		 *
+		 * @date 17/Oct/2026
+		 */
+		class UnixSocketClientTransport : public communique::impl::ClientTransport
+		{
+		public:
+			typedef websocketpp::client<websocketpp::config::core> client_type;
+		public:
+			/** @brief Constructor
+			 * @parameter pIoService  The io_service to use, or null to create one. */
+			UnixSocketClientTransport( websocketpp::lib::asio::io_service* pIoService );
+
+			virtual std::shared_ptr<communique::impl::Connection> createConnection( const std::string& URI ) override;
+			virtual void connect( communique::impl::Connection& connection ) override;
+			virtual void run() override;
+			virtual void reset() override;
+			virtual websocketpp::lib::asio::io_service& ioService() override;
+
+			virtual websocketpp::config::asio::alog_type& accessLog() override;
+			virtual void setErrorLogLocation( std::ostream& outputStream ) override;
+			virtual void setErrorLogLevel( uint32_t level ) override;
+			virtual void setAccessLogLocation( std::ostream& outputStream ) override;
+			virtual void setAccessLogLevel( uint32_t level ) override;
+		private:
+			std::unique_ptr<websocketpp::lib::asio::io_service> pOwnIoService_; ///< Null if using an io_service from elsewhere
+			websocketpp::lib::asio::io_service& ioService_;
+			client_type client_;
+			std::mutex endpointMutex_;
+			websocketpp::lib::asio::local::stream_protocol::endpoint endpoint_; ///< Where the most recently created connection goes to
+
+			void on_open( websocketpp::connection_hdl hdl );
+			void on_close( websocketpp::connection_hdl hdl );
+			void on_fail( websocketpp::connection_hdl hdl );
+			void on_interrupt( websocketpp::connection_hdl hdl );
+		};
+
+	} // end of namespace impl
+} // end of namespace communique
+
+#endif // end of ifndef communique_impl_UnixSocketClientTransport_h
@@ -0,0 +1,76 @@
+#ifndef communique_impl_UnixSocketServerTransport_h
+#define communique_impl_UnixSocketServerTransport_h
+
+#include <memory>
+#include <string>
+#include "communique/impl/ServerTransport.h"
+
+#define _WEBSOCKETPP_CPP11_STL_ // Make sure websocketpp uses c++11 features in preference to boost ones
+#include <websocketpp/common/asio.hpp>
+#include <websocketpp/server.hpp>
+#include <websocketpp/config/core.hpp>
+
+//
+// Forward declarations
+//
+namespace communique
+{
+	namespace impl
+	{
+		class UnixSocketSession;
+	}
+}
+
+namespace communique
+{
+
+	namespace impl
+	{
+		/** @brief A ServerTransport that accepts WebSocket connections on a Unix domain socket.
+		 *
+		 * There's no TLS, and no TCP, so it's a lot cheaper than the other transports for processes on the same
+		 * host. The socket file is created by listen and removed again by stopListening.
+		 *
+		 * @date 17/Oct/2026
+		 */
+		class UnixSocketServerTransport : public communique::impl::ServerTransport
+		{
+		public:
+			typedef websocketpp::server<websocketpp::config::core> server_type;
+		public:
+			/** @brief Constructor
+			 * @parameter pIoService  The io_service to use, or null to create one. */
+			UnixSocketServerTransport( websocketpp::lib::asio::io_service* pIoService );
+			~UnixSocketServerTransport();
+
+			using communique::impl::ServerTransport::listen;
+			virtual void listen( const std::string& socketPath ) override;
+			virtual bool isListening() const override;
+			virtual void stopListening() override;
+			virtual void run() override;
+			virtual void stop() override;
+			virtual void reset() override;
+
+			virtual websocketpp::config::asio::alog_type& accessLog() override;
+			virtual void setErrorLogLocation( std::ostream& outputStream ) override;
+			virtual void setErrorLogLevel( uint32_t level ) override;
+			virtual void setAccessLogLocation( std::ostream& outputStream ) override;
+			virtual void setAccessLogLevel( uint32_t level ) override;
+		private:
+			std::unique_ptr<websocketpp::lib::asio::io_service> pOwnIoService_; ///< Null if using an io_service from elsewhere
+			websocketpp::lib::asio::io_service& ioService_;
+			websocketpp::lib::asio::local::stream_protocol::acceptor acceptor_;
+			server_type server_;
+			std::string socketPath_; ///< Empty if not listening
+
+			void startAccept();
+			void on_accept( std::shared_ptr<communique::impl::UnixSocketSession> pSession, const websocketpp::lib::asio::error_code& errorCode );
+			void on_open( websocketpp::connection_hdl hdl );
+			void on_close( websocketpp::connection_hdl hdl );
+			void on_interrupt( websocketpp::connection_hdl hdl );
+		};
+
+	} // end of namespace impl
+} // end of namespace communique
+
+#endif // end of ifndef communique_impl_UnixSocketServerTransport_h
@@ -0,0 +1,70 @@
+#ifndef communique_impl_UnixSocketSession_h
+#define communique_impl_UnixSocketSession_h
+
+#include <memory>
+#include <mutex>
+#include <array>
+#include <string>
+
+#define _WEBSOCKETPP_CPP11_STL_ // Make sure websocketpp uses c++11 features in preference to boost ones
+#include <websocketpp/common/asio.hpp>
+#include <websocketpp/connection.hpp>
+#include <websocketpp/config/core.hpp>
+
+namespace communique
+{
+
+	namespace impl
+	{
+		/** @brief Joins a websocketpp connection that uses the iostream transport to a Unix domain socket.
+		 *
+		 * websocketpp's asio transport only does TCP, so for Unix domain sockets the connection uses the
+		 * iostream transport and this does the IO for it. Everything websocketpp writes is queued and sent
+		 * with async_write, and everything read from the socket is handed to websocketpp. All of the socket
+		 * IO is done on a strand, so that a connection never handles two messages at once however many
+		 * threads are running the io_service, and a sender never blocks on a full socket.
+		 *
+		 * Keeps itself alive for as long as the socket is open.
+		 *
+		 * @date 17/Oct/2026
+		 */
+		class UnixSocketSession : public std::enable_shared_from_this<UnixSocketSession>
+		{
+		public:
+			typedef websocketpp::lib::asio::local::stream_protocol::socket socket_type;
+			typedef websocketpp::connection<websocketpp::config::core>::ptr connection_ptr;
+		public:
+			UnixSocketSession( websocketpp::lib::asio::io_service& ioService );
+
+			socket_type& socket();
+			/// @brief Sends the connection's output to the socket. Has to be called before the connection is started.
+			void attach( connection_ptr pConnection );
+			/// @brief Starts handing everything that arrives on the socket to the connection. Call once the connection has been started.
+			void startReading();
+			/// @brief Makes every write fail with this error, so that a connection whose socket couldn't connect fails its handshake.
+			void failWrites( const websocketpp::lib::asio::error_code& errorCode );
+		private:
+			socket_type socket_;
+			websocketpp::lib::asio::io_service::strand strand_;
+			connection_ptr pConnection_;
+			std::mutex writeMutex_; ///< Sends can come from any thread. Protects pendingWrite_, writing_ and writeError_.
+			std::string pendingWrite_; ///< Everything sent since the last write started
+			bool writing_; ///< True from when a write is queued until pendingWrite_ is found empty
+			websocketpp::lib::error_code writeError_;
+			std::string bytesBeingWritten_; ///< Only used on the strand. Kept alive for as long as the write that uses it.
+			bool closeRequested_; ///< Only used on the strand
+			std::array<char,16384> readBuffer_;
+
+			/// Called by websocketpp. The data is only valid for the duration of the call, so it's copied into pendingWrite_.
+			websocketpp::lib::error_code write( const char* data, size_t length );
+			/// Writes everything pending, or closes the socket if there's nothing and a close was asked for
+			void writeQueued();
+			void closeSocket();
+			void on_write( const websocketpp::lib::asio::error_code& errorCode );
+			void on_read( const websocketpp::lib::asio::error_code& errorCode, size_t bytesRead );
+		};
+
+	} // end of namespace impl
+} // end of namespace communique
+
+#endif // end of ifndef communique_impl_UnixSocketSession_h
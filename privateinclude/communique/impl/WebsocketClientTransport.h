@@ -0,0 +1,180 @@
+#ifndef communique_impl_WebsocketClientTransport_h
+#define communique_impl_WebsocketClientTransport_h
+
+#include <stdexcept>
+#include "communique/impl/ClientTransport.h"
+
+#define _WEBSOCKETPP_CPP11_STL_ // Make sure websocketpp uses c++11 features in preference to boost ones
+#include <websocketpp/client.hpp>
+#include <websocketpp/config/asio.hpp>
+#include "communique/impl/WebsocketConnection.h"
+#include "communique/impl/WebsocketTLS.h"
+
+namespace communique
+{
+
+	namespace impl
+	{
+		/** @brief A ClientTransport that makes WebSocket connections over TCP.
+		 *
+		 * The template parameter is the websocketpp config, websocketpp::config::asio_tls for TLS or
+		 * websocketpp::config::asio for plain TCP.
+		 *
+		 * @date 17/Oct/2026
+		 */
+		template<class T_Config>
+		class WebsocketClientTransport : public communique::impl::ClientTransport
+		{
+		public:
+			typedef websocketpp::client<T_Config> client_type;
+		public:
+			/** @brief Constructor
+			 * @parameter pIoService  The io_service to use, or null to create one. */
+			WebsocketClientTransport( websocketpp::lib::asio::io_service* pIoService );
+
+			virtual std::shared_ptr<communique::impl::Connection> createConnection( const std::string& URI ) override;
+			virtual void connect( communique::impl::Connection& connection ) override;
+			virtual void run() override;
+			virtual void reset() override;
+			virtual websocketpp::lib::asio::io_service& ioService() override;
+
+			virtual void setTLSHandler( std::shared_ptr<communique::impl::TLSHandler> pTLSHandler ) override;
+			virtual websocketpp::config::asio::alog_type& accessLog() override;
+			virtual void setErrorLogLocation( std::ostream& outputStream ) override;
+			virtual void setErrorLogLevel( uint32_t level ) override;
+			virtual void setAccessLogLocation( std::ostream& outputStream ) override;
+			virtual void setAccessLogLevel( uint32_t level ) override;
+		private:
+			client_type client_;
+			std::shared_ptr<communique::impl::TLSHandler> pTLSHandler_; ///< Declared after client_ so that it goes first, since it logs to the endpoint
+
+			void on_open( websocketpp::connection_hdl hdl );
+			void on_close( websocketpp::connection_hdl hdl );
+			void on_fail( websocketpp::connection_hdl hdl );
+			void on_interrupt( websocketpp::connection_hdl hdl );
+		};
+
+	} // end of namespace impl
+} // end of namespace communique
+
+template<class T_Config>
+communique::impl::WebsocketClientTransport<T_Config>::WebsocketClientTransport( websocketpp::lib::asio::io_service* pIoService )
+	: pTLSHandler_(nullptr)
+{
+	client_.set_access_channels(websocketpp::log::alevel::none);
+	//client_.set_error_channels(websocketpp::log::elevel::all ^ websocketpp::log::elevel::info);
+	client_.set_error_channels(websocketpp::log::elevel::none);
+	if( pIoService ) client_.init_asio( pIoService );
+	else client_.init_asio();
+	// The handlers are set on each connection in createConnection rather than on the endpoint
+}
+
+template<class T_Config>
+std::shared_ptr<communique::impl::Connection> communique::impl::WebsocketClientTransport<T_Config>::createConnection( const std::string& URI )
+{
+	websocketpp::lib::error_code errorCode;
+	auto pWebPPConnection=client_.get_connection( URI, errorCode );
+	if( errorCode.value()!=0 ) throw std::runtime_error( "Unable to get the websocketpp connection - "+errorCode.message() );
+
+	// websocketpp binds its own handlers for resolving and connecting to a raw pointer to the endpoint, but they
+	// all hold the connection as well. So giving the connection a shared_ptr to this keeps the endpoint alive
+	// for as long as any of them are queued. The endpoint doesn't keep its connections, so there's no cycle.
+	auto pThis=std::static_pointer_cast<WebsocketClientTransport>( shared_from_this() );
+	pWebPPConnection->set_open_handler( [pThis]( websocketpp::connection_hdl hdl ){ pThis->on_open( hdl ); } );
+	pWebPPConnection->set_close_handler( [pThis]( websocketpp::connection_hdl hdl ){ pThis->on_close( hdl ); } );
+	pWebPPConnection->set_interrupt_handler( [pThis]( websocketpp::connection_hdl hdl ){ pThis->on_interrupt( hdl ); } );
+	pWebPPConnection->set_fail_handler( [pThis]( websocketpp::connection_hdl hdl ){ pThis->on_fail( hdl ); } );
+
+	return communique::impl::WebsocketConnection<T_Config>::create( pWebPPConnection );
+}
+
+template<class T_Config>
+void communique::impl::WebsocketClientTransport<T_Config>::connect( communique::impl::Connection& connection )
+{
+	client_.connect( static_cast< communique::impl::WebsocketConnection<T_Config>& >(connection).underlyingPointer() );
+}
+
+template<class T_Config>
+void communique::impl::WebsocketClientTransport<T_Config>::run()
+{
+	client_.run();
+}
+
+template<class T_Config>
+void communique::impl::WebsocketClientTransport<T_Config>::reset()
+{
+	client_.reset();
+}
+
+template<class T_Config>
+websocketpp::lib::asio::io_service& communique::impl::WebsocketClientTransport<T_Config>::ioService()
+{
+	return client_.get_io_service();
+}
+
+template<class T_Config>
+void communique::impl::WebsocketClientTransport<T_Config>::setTLSHandler( std::shared_ptr<communique::impl::TLSHandler> pTLSHandler )
+{
+	pTLSHandler_=pTLSHandler;
+	communique::impl::configureTLS( client_, std::move(pTLSHandler) );
+}
+
+template<class T_Config>
+websocketpp::config::asio::alog_type& communique::impl::WebsocketClientTransport<T_Config>::accessLog()
+{
+	return client_.get_alog();
+}
+
+template<class T_Config>
+void communique::impl::WebsocketClientTransport<T_Config>::setErrorLogLocation( std::ostream& outputStream )
+{
+	client_.get_elog().set_ostream( &outputStream );
+}
+
+template<class T_Config>
+void communique::impl::WebsocketClientTransport<T_Config>::setErrorLogLevel( uint32_t level )
+{
+	client_.set_error_channels(level);
+}
+
+template<class T_Config>
+void communique::impl::WebsocketClientTransport<T_Config>::setAccessLogLocation( std::ostream& outputStream )
+{
+	client_.get_alog().set_ostream( &outputStream );
+}
+
+template<class T_Config>
+void communique::impl::WebsocketClientTransport<T_Config>::setAccessLogLevel( uint32_t level )
+{
+	client_.set_access_channels(level);
+}
+
+template<class T_Config>
+void communique::impl::WebsocketClientTransport<T_Config>::on_open( websocketpp::connection_hdl hdl )
+{
+	communique::impl::recordHandshake( pTLSHandler_.get(), client_.get_con_from_hdl(hdl) );
+	if( onOpen ) onOpen();
+}
+
+template<class T_Config>
+void communique::impl::WebsocketClientTransport<T_Config>::on_close( websocketpp::connection_hdl hdl )
+{
+	if( onClose ) onClose();
+}
+
+template<class T_Config>
+void communique::impl::WebsocketClientTransport<T_Config>::on_fail( websocketpp::connection_hdl hdl )
+{
+	websocketpp::lib::error_code errorCode;
+	auto pRawConnection=client_.get_con_from_hdl( hdl, errorCode );
+	std::string reason=( pRawConnection ? pRawConnection->get_ec().message() : errorCode.message() );
+	if( onFail ) onFail( reason );
+}
+
+template<class T_Config>
+void communique::impl::WebsocketClientTransport<T_Config>::on_interrupt( websocketpp::connection_hdl hdl )
+{
+	if( onInterrupt ) onInterrupt();
+}
+
+#endif // end of ifndef communique_impl_WebsocketClientTransport_h
@@ -0,0 +1,151 @@
+#ifndef communique_impl_WebsocketConnection_h
+#define communique_impl_WebsocketConnection_h
+
+#include <type_traits>
+#include <iostream>
+#include "communique/impl/Connection.h"
+
+#define _WEBSOCKETPP_CPP11_STL_ // Make sure websocketpp uses c++11 features in preference to boost ones
+#include <websocketpp/connection.hpp>
+#include <websocketpp/config/asio.hpp>
+
+namespace communique
+{
+
+	namespace impl
+	{
+		/** @brief A Connection that sends its messages over a websocketpp connection.
+		 *
+		 * The template parameter is the websocketpp config, which decides what the WebSocket goes over. E.g.
+		 * websocketpp::config::asio_tls for TLS, websocketpp::config::asio for plain TCP.
+		 *
+		 * @date 17/Oct/2026
+		 */
+		template<class T_Config>
+		class WebsocketConnection : public communique::impl::Connection
+		{
+		public:
+			typedef typename websocketpp::connection<T_Config>::ptr connection_ptr;
+			static_assert( std::is_same<typename websocketpp::connection<T_Config>::message_ptr,communique::impl::Message::message_ptr>::value, "The websocketpp config has to use the same message type as communique::impl::Message" );
+		public:
+			/** @brief Use create rather than constructing directly, otherwise nothing receives the messages. */
+			WebsocketConnection( connection_ptr pConnection );
+			/** @brief Wraps the websocketpp connection. It can outlive this (e.g. while its close handshake finishes), so
+			 * it only gets a weak reference back for the message handler. */
+			static std::shared_ptr<WebsocketConnection> create( connection_ptr pConnection );
+
+			connection_ptr& underlyingPointer();
+
+			virtual bool sessionResumed() override;
+			virtual void setCloseTimeout( std::chrono::milliseconds timeout ) override;
+			virtual const void* key() const override;
+		protected:
+			virtual websocketpp::session::state::value state() const override;
+			virtual bool transmit( const message_ptr& pMessage ) override;
+			virtual void closeTransport() override;
+			virtual bool transmitBroadcast( communique::impl::Message& message, const message_ptr& pServerFrame ) override;
+			virtual size_t sendQueueBytes() const override;
+		private:
+			connection_ptr pConnection_;
+
+			void on_message( websocketpp::connection_hdl hdl, message_ptr pMessage );
+		};
+
+	} // end of namespace impl
+} // end of namespace communique
+
+template<class T_Config>
+communique::impl::WebsocketConnection<T_Config>::WebsocketConnection( connection_ptr pConnection )
+	: pConnection_(pConnection)
+{
+	// No operation besides the initialiser list
+}
+
+template<class T_Config>
+std::shared_ptr< communique::impl::WebsocketConnection<T_Config> > communique::impl::WebsocketConnection<T_Config>::create( connection_ptr pConnection )
+{
+	auto pNewConnection=std::make_shared<WebsocketConnection>( pConnection );
+	std::weak_ptr<WebsocketConnection> pWeakConnection=pNewConnection;
+	pConnection->set_message_handler( [pWeakConnection]( websocketpp::connection_hdl hdl, message_ptr pMessage )
+		{
+			auto pConnection=pWeakConnection.lock();
+			if( pConnection ) pConnection->on_message( hdl, pMessage );
+		} );
+	return pNewConnection;
+}
+
+template<class T_Config>
+typename communique::impl::WebsocketConnection<T_Config>::connection_ptr& communique::impl::WebsocketConnection<T_Config>::underlyingPointer()
+{
+	return pConnection_;
+}
+
+template<class T_Config>
+bool communique::impl::WebsocketConnection<T_Config>::sessionResumed()
+{
+	return false;
+}
+
+template<>
+inline bool communique::impl::WebsocketConnection<websocketpp::config::asio_tls>::sessionResumed()
+{
+	return SSL_session_reused( pConnection_->get_socket().native_handle() )!=0;
+}
+
+template<class T_Config>
+void communique::impl::WebsocketConnection<T_Config>::setCloseTimeout( std::chrono::milliseconds timeout )
+{
+	pConnection_->set_close_handshake_timeout( static_cast<long>( timeout.count() ) );
+}
+
+template<class T_Config>
+bool communique::impl::WebsocketConnection<T_Config>::transmitBroadcast( communique::impl::Message& message, const message_ptr& pServerFrame )
+{
+	// Frames already prepared are queued as is. Anything older than RFC6455 (version 13, or the
+	// drafts 7 and 8 which frame the same way) needs the unframed message so it can frame it itself.
+	if( pServerFrame && pConnection_->get_websocket_version()>=7 ) return !pConnection_->send( pServerFrame );
+	else return !pConnection_->send( message.websocketppMessage() );
+}
+
+template<class T_Config>
+size_t communique::impl::WebsocketConnection<T_Config>::sendQueueBytes() const
+{
+	// Includes the WebSocket framing, unlike the byte counts
+	return pConnection_->get_buffered_amount();
+}
+
+template<class T_Config>
+const void* communique::impl::WebsocketConnection<T_Config>::key() const
+{
+	return pConnection_.get();
+}
+
+template<class T_Config>
+websocketpp::session::state::value communique::impl::WebsocketConnection<T_Config>::state() const
+{
+	return pConnection_->get_state();
+}
+
+template<class T_Config>
+bool communique::impl::WebsocketConnection<T_Config>::transmit( const message_ptr& pMessage )
+{
+	return !pConnection_->send( pMessage );
+}
+
+template<class T_Config>
+void communique::impl::WebsocketConnection<T_Config>::closeTransport()
+{
+	websocketpp::lib::error_code errorCode;
+
+	pConnection_->close( websocketpp::close::status::normal, "Had enough. Bye.", errorCode );
+
+	if( errorCode ) std::cerr << "communique::impl::Connection::close() - " << errorCode.message() << std::endl;
+}
+
+template<class T_Config>
+void communique::impl::WebsocketConnection<T_Config>::on_message( websocketpp::connection_hdl hdl, message_ptr pMessage )
+{
+	receiveMessage( pMessage );
+}
+
+#endif // end of ifndef communique_impl_WebsocketConnection_h
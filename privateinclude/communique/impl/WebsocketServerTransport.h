@@ -0,0 +1,245 @@
+#ifndef communique_impl_WebsocketServerTransport_h
+#define communique_impl_WebsocketServerTransport_h
+
+#include "communique/impl/ServerTransport.h"
+
+#define _WEBSOCKETPP_CPP11_STL_ // Make sure websocketpp uses c++11 features in preference to boost ones
+#include <websocketpp/server.hpp>
+#include <websocketpp/config/asio.hpp>
+#include "communique/impl/WebsocketConnection.h"
+#include "communique/impl/WebsocketTLS.h"
+
+namespace communique
+{
+
+	namespace impl
+	{
+		/** @brief A ServerTransport that accepts WebSocket connections over TCP.
+		 *
+		 * The template parameter is the websocketpp config, websocketpp::config::asio_tls for TLS or
+		 * websocketpp::config::asio for plain TCP.
+		 *
+		 * @date 17/Oct/2026
+		 */
+		template<class T_Config>
+		class WebsocketServerTransport : public communique::impl::ServerTransport
+		{
+		public:
+			typedef websocketpp::server<T_Config> server_type;
+		public:
+			/** @brief Constructor
+			 * @parameter pIoService  The io_service to use, or null to create one. */
+			WebsocketServerTransport( websocketpp::lib::asio::io_service* pIoService );
+
+			using communique::impl::ServerTransport::listen;
+			virtual void listen( size_t port ) override;
+			virtual bool isListening() const override;
+			virtual void stopListening() override;
+			virtual void run() override;
+			virtual void stop() override;
+			virtual void reset() override;
+
+			virtual void setTLSHandler( std::shared_ptr<communique::impl::TLSHandler> pTLSHandler ) override;
+			virtual websocketpp::config::asio::alog_type& accessLog() override;
+			virtual void setErrorLogLocation( std::ostream& outputStream ) override;
+			virtual void setErrorLogLevel( uint32_t level ) override;
+			virtual void setAccessLogLocation( std::ostream& outputStream ) override;
+			virtual void setAccessLogLevel( uint32_t level ) override;
+		private:
+			server_type server_;
+			std::shared_ptr<communique::impl::TLSHandler> pTLSHandler_; ///< Declared after server_ so that it goes first, since it logs to the endpoint
+
+			/** @brief The same as websocketpp's start_accept, except that the handlers hold a shared_ptr to this rather
+			 * than a raw pointer to the endpoint. Throws std::runtime_error if the accept can't be started. */
+			void startAccept();
+			void on_accept( typename server_type::connection_ptr pRawConnection, const websocketpp::lib::error_code& errorCode );
+			void on_http( websocketpp::connection_hdl hdl );
+			void on_open( websocketpp::connection_hdl hdl );
+			void on_close( websocketpp::connection_hdl hdl );
+			void on_interrupt( websocketpp::connection_hdl hdl );
+		};
+
+	} // end of namespace impl
+} // end of namespace communique
+
+template<class T_Config>
+communique::impl::WebsocketServerTransport<T_Config>::WebsocketServerTransport( websocketpp::lib::asio::io_service* pIoService )
+	: pTLSHandler_(nullptr)
+{
+	server_.set_access_channels(websocketpp::log::alevel::none);
+	//server_.set_error_channels(websocketpp::log::elevel::all ^ websocketpp::log::elevel::info);
+	server_.set_error_channels(websocketpp::log::elevel::none);
+	if( pIoService ) server_.init_asio( pIoService );
+	else server_.init_asio();
+	// Connections the server closed sit in TIME_WAIT for a while, and without this they stop the
+	// server listening on the same port again. Clients reconnecting expect to find it there.
+	server_.set_reuse_addr(true);
+	// The handlers are set on each connection in startAccept rather than on the endpoint
+}
+
+template<class T_Config>
+void communique::impl::WebsocketServerTransport<T_Config>::listen( size_t port )
+{
+	websocketpp::lib::error_code errorCode;
+	websocketpp::lib::asio::error_code underlyingErrorCode;
+	server_.listen(port,errorCode,&underlyingErrorCode);
+	if( errorCode )
+	{
+		std::string errorMessage="Communique server listen error: "+errorCode.message();
+		if( underlyingErrorCode ) errorMessage+=" ("+underlyingErrorCode.message()+")";
+		throw std::runtime_error( errorMessage );
+	}
+
+	try
+	{
+		startAccept();
+	}
+	catch(...)
+	{
+		server_.stop_listening( errorCode );
+		throw;
+	}
+}
+
+template<class T_Config>
+bool communique::impl::WebsocketServerTransport<T_Config>::isListening() const
+{
+	return server_.is_listening();
+}
+
+template<class T_Config>
+void communique::impl::WebsocketServerTransport<T_Config>::stopListening()
+{
+	server_.stop_listening();
+}
+
+template<class T_Config>
+void communique::impl::WebsocketServerTransport<T_Config>::run()
+{
+	server_.run();
+}
+
+template<class T_Config>
+void communique::impl::WebsocketServerTransport<T_Config>::stop()
+{
+	server_.stop();
+}
+
+template<class T_Config>
+void communique::impl::WebsocketServerTransport<T_Config>::reset()
+{
+	server_.reset();
+}
+
+template<class T_Config>
+void communique::impl::WebsocketServerTransport<T_Config>::setTLSHandler( std::shared_ptr<communique::impl::TLSHandler> pTLSHandler )
+{
+	pTLSHandler_=pTLSHandler;
+	communique::impl::configureTLS( server_, std::move(pTLSHandler) );
+}
+
+template<class T_Config>
+websocketpp::config::asio::alog_type& communique::impl::WebsocketServerTransport<T_Config>::accessLog()
+{
+	return server_.get_alog();
+}
+
+template<class T_Config>
+void communique::impl::WebsocketServerTransport<T_Config>::setErrorLogLocation( std::ostream& outputStream )
+{
+	server_.get_elog().set_ostream( &outputStream );
+}
+
+template<class T_Config>
+void communique::impl::WebsocketServerTransport<T_Config>::setErrorLogLevel( uint32_t level )
+{
+	server_.set_error_channels(level);
+}
+
+template<class T_Config>
+void communique::impl::WebsocketServerTransport<T_Config>::setAccessLogLocation( std::ostream& outputStream )
+{
+	server_.get_alog().set_ostream( &outputStream );
+}
+
+template<class T_Config>
+void communique::impl::WebsocketServerTransport<T_Config>::setAccessLogLevel( uint32_t level )
+{
+	server_.set_access_channels(level);
+}
+
+template<class T_Config>
+void communique::impl::WebsocketServerTransport<T_Config>::startAccept()
+{
+	auto pRawConnection=server_.get_connection();
+	if( !pRawConnection ) throw std::runtime_error( "Communique server listen error: unable to create a websocketpp connection" );
+
+	// The connection's handlers hold a shared_ptr to this, which keeps the endpoint alive for as long as anything
+	// websocketpp queues for the connection. The endpoint doesn't keep its connections, so there's no cycle.
+	auto pThis=std::static_pointer_cast<WebsocketServerTransport>( shared_from_this() );
+	pRawConnection->set_http_handler( [pThis]( websocketpp::connection_hdl hdl ){ pThis->on_http( hdl ); } );
+	pRawConnection->set_open_handler( [pThis]( websocketpp::connection_hdl hdl ){ pThis->on_open( hdl ); } );
+	pRawConnection->set_close_handler( [pThis]( websocketpp::connection_hdl hdl ){ pThis->on_close( hdl ); } );
+	pRawConnection->set_interrupt_handler( [pThis]( websocketpp::connection_hdl hdl ){ pThis->on_interrupt( hdl ); } );
+
+	websocketpp::lib::error_code errorCode;
+	server_.async_accept( pRawConnection, [pThis,pRawConnection]( const websocketpp::lib::error_code& acceptError ){ pThis->on_accept( pRawConnection, acceptError ); }, errorCode );
+	if( errorCode )
+	{
+		pRawConnection->terminate( websocketpp::lib::error_code() );
+		throw std::runtime_error( "Communique server listen error: "+errorCode.message() );
+	}
+}
+
+template<class T_Config>
+void communique::impl::WebsocketServerTransport<T_Config>::on_accept( typename server_type::connection_ptr pRawConnection, const websocketpp::lib::error_code& errorCode )
+{
+	if( errorCode )
+	{
+		pRawConnection->terminate( errorCode );
+		if( errorCode==websocketpp::error::operation_canceled ) return; // stopListening has been called
+		server_.get_elog().write( websocketpp::log::elevel::rerror, "WebSocket accept failed: "+errorCode.message() );
+	}
+	else pRawConnection->start();
+
+	if( !server_.is_listening() ) return;
+	try
+	{
+		startAccept();
+	}
+	catch( const std::exception& error )
+	{
+		server_.get_elog().write( websocketpp::log::elevel::rerror, error.what() );
+	}
+}
+
+template<class T_Config>
+void communique::impl::WebsocketServerTransport<T_Config>::on_http( websocketpp::connection_hdl hdl )
+{
+	typename server_type::connection_ptr con = server_.get_con_from_hdl(hdl);
+	//con->set_body("Hello World!\n");
+	con->set_status(websocketpp::http::status_code::ok);
+}
+
+template<class T_Config>
+void communique::impl::WebsocketServerTransport<T_Config>::on_open( websocketpp::connection_hdl hdl )
+{
+	auto pRawConnection=server_.get_con_from_hdl(hdl);
+	communique::impl::recordHandshake( pTLSHandler_.get(), pRawConnection );
+
+	if( onOpen ) onOpen( communique::impl::WebsocketConnection<T_Config>::create( pRawConnection ) );
+}
+
+template<class T_Config>
+void communique::impl::WebsocketServerTransport<T_Config>::on_close( websocketpp::connection_hdl hdl )
+{
+	if( onClose ) onClose( server_.get_con_from_hdl(hdl).get() );
+}
+
+template<class T_Config>
+void communique::impl::WebsocketServerTransport<T_Config>::on_interrupt( websocketpp::connection_hdl hdl )
+{
+	if( onInterrupt ) onInterrupt( server_.get_con_from_hdl(hdl).get() );
+}
+
+#endif // end of ifndef communique_impl_WebsocketServerTransport_h
@@ -0,0 +1,53 @@
+#ifndef communique_impl_WebsocketTLS_h
+#define communique_impl_WebsocketTLS_h
+
+#define _WEBSOCKETPP_CPP11_STL_ // Make sure websocketpp uses c++11 features in preference to boost ones
+#include <websocketpp/server.hpp>
+#include <websocketpp/client.hpp>
+#include <websocketpp/config/asio.hpp>
+#include "communique/impl/TLSHandler.h"
+
+namespace communique
+{
+
+	namespace impl
+	{
+		//
+		// Overloads for the parts of setting up websocketpp that only apply to TLS. The templated versions
+		// are picked for every other config and do nothing, so the websocket transports can call these
+		// whatever config they use.
+		//
+
+		/// @brief Hooks the TLSHandler into the endpoint so that it sets up the TLS for every connection
+		template<class T_Endpoint>
+		void configureTLS( T_Endpoint& endpoint, std::shared_ptr<communique::impl::TLSHandler> pTLSHandler ) {}
+
+		inline void configureTLS( websocketpp::server<websocketpp::config::asio_tls>& server, std::shared_ptr<communique::impl::TLSHandler> pTLSHandler )
+		{
+			server.set_tls_init_handler( std::bind( &communique::impl::TLSHandler::on_tls_init, pTLSHandler, std::placeholders::_1 ) );
+		}
+
+		inline void configureTLS( websocketpp::client<websocketpp::config::asio_tls>& client, std::shared_ptr<communique::impl::TLSHandler> pTLSHandler )
+		{
+			client.set_tls_init_handler( std::bind( &communique::impl::TLSHandler::on_tls_init, pTLSHandler, std::placeholders::_1 ) );
+			// Previous sessions are looked up by URI, so that a session is only ever offered to the server it came from.
+			// Only called for a connection, which keeps the transport and so the endpoint alive.
+			client.set_socket_init_handler( [&client,pTLSHandler]( websocketpp::connection_hdl hdl, websocketpp::lib::asio::ssl::stream<websocketpp::lib::asio::ip::tcp::socket>& socket )
+				{
+					pTLSHandler->prepareClientSession( socket.native_handle(), client.get_con_from_hdl(hdl)->get_uri()->str() );
+				} );
+		}
+
+		/// @brief Tells the TLSHandler about the handshake that has just finished, so that it can keep count
+		template<class T_ConnectionPtr>
+		void recordHandshake( communique::impl::TLSHandler* pTLSHandler, const T_ConnectionPtr& pConnection ) {}
+
+		inline void recordHandshake( communique::impl::TLSHandler* pTLSHandler, const websocketpp::connection<websocketpp::config::asio_tls>::ptr& pConnection )
+		{
+			if( pTLSHandler ) pTLSHandler->recordHandshake( pConnection->get_socket().native_handle() );
+		}
+
+	} // end of namespace impl
+} // end of namespace communique
+
+#endif // end of ifndef communique_impl_WebsocketTLS_h
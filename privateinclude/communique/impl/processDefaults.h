@@ -0,0 +1,35 @@
+/** @file
+ *
+ * @brief The executor and TimingWheel used by every Client and Server that isn't on an EventLoop and hasn't
+ * been given its own.
+ */
+#ifndef communique_impl_processDefaults_h
+#define communique_impl_processDefaults_h
+
+#include <memory>
+
+namespace communique
+{
+	class IExecutor;
+
+	namespace impl
+	{
+		class TimingWheel;
+
+		/** @brief A communique::ThreadPool with default settings, shared by the whole process.
+		 *
+		 * Created the first time it's asked for and kept until the process exits, so however many Clients and
+		 * Servers there are there's only ever one set of handler threads unless they're given executors of their own.
+		 *
+		 * @date 17/Oct/2026
+		 */
+		std::shared_ptr<communique::IExecutor> processDefaultExecutor();
+
+		/** @brief The timer for request timeouts, shared by the whole process in the same way as processDefaultExecutor.
+		 * Its thread isn't started until the first timeout is added. */
+		std::shared_ptr<communique::impl::TimingWheel> processTimingWheel();
+
+	} // end of namespace impl
+} // end of namespace communique
+
+#endif // end of ifndef communique_impl_processDefaults_h
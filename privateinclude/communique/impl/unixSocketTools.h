@@ -0,0 +1,32 @@
+/** @file
+ *
+ * @brief Free standing functions shared by the transports that go over Unix domain sockets.
+ */
+#ifndef communique_impl_unixSocketTools_h
+#define communique_impl_unixSocketTools_h
+
+#include <string>
+
+#define _WEBSOCKETPP_CPP11_STL_ // Make sure websocketpp uses c++11 features in preference to boost ones
+#include <websocketpp/common/asio.hpp>
+
+namespace communique
+{
+
+	namespace impl
+	{
+		/** @brief Opens the acceptor on a socket file and starts it listening.
+		 *
+		 * A socket file already at socketPath is removed first, since one left behind by a server that didn't
+		 * shut down cleanly would stop the bind. Anything at socketPath that isn't a socket is left alone.
+		 *
+		 * @throws std::runtime_error if any step fails, in which case the acceptor is left closed.
+		 *
+		 * @date 17/Oct/2026
+		 */
+		void listenOnUnixSocket( websocketpp::lib::asio::local::stream_protocol::acceptor& acceptor, const std::string& socketPath );
+
+	} // end of namespace impl
+} // end of namespace communique
+
+#endif // end of ifndef communique_impl_unixSocketTools_h
@@ -2,54 +2,174 @@
 
 #include <mutex>
 #include <future>
+#include <atomic>
+#include <deque>
+#include <random>
+#include <cmath>
+#include "communique/EventLoop.h"
 #include "communique/impl/Exceptions.h"
 
 #define _WEBSOCKETPP_CPP11_STL_ // Make sure websocketpp uses c++11 features in preference to boost ones
-#include <websocketpp/client.hpp>
+#include <websocketpp/common/asio.hpp>
 #include <websocketpp/config/asio.hpp>
 #include "communique/impl/Connection.h"
+#include "communique/impl/EventLoopPrivateMembers.h"
 #include "communique/impl/TLSHandler.h"
+#include "communique/impl/TimingWheel.h"
+#include "communique/impl/processDefaults.h"
+#include "communique/impl/StatsCounters.h"
+#include "communique/impl/WebsocketClientTransport.h"
+#include "communique/impl/UnixSocketClientTransport.h"
+#ifndef COMMUNIQUE_NO_SHAREDMEMORY
+#include "communique/impl/SharedMemoryClientTransport.h"
+#endif
+#include "communique/impl/InProcessClientTransport.h"
+#include "communique/impl/RawClientTransport.h"
 
 //
 // Declaration of the pimple
 //
 namespace communique
 {
-	class ClientPrivateMembers
+	class ClientPrivateMembers : public std::enable_shared_from_this<ClientPrivateMembers>
 	{
 	public:
-		typedef websocketpp::client<websocketpp::config::asio_tls> client_type;
+		typedef std::shared_ptr<websocketpp::lib::asio::steady_timer> timer_ptr;
 
-		ClientPrivateMembers() : tlsHandler_(client_.get_alog()) { /*No operation besides initialiser list*/ }
-		client_type client_;
+		ClientPrivateMembers( communique::Transport transport, communique::EventLoopPrivateMembers* pEventLoop );
+		communique::Transport transport_;
+		communique::EventLoopPrivateMembers* pEventLoop_; ///< Null unless using a shared EventLoop, which the Client keeps alive
+		/// Null if using a shared EventLoop. Owned here rather than by the transport, because anything still queued holds a
+		/// shared_ptr to the transport, and declared first so that destroying it is what finally releases those.
+		std::unique_ptr<websocketpp::lib::asio::io_service> pOwnIoService_;
+		std::shared_ptr<communique::impl::ClientTransport> pTransport_; ///< Can outlive this, while anything it queued is still to run
 		std::thread ioThread_;
-		std::shared_ptr<communique::impl::Connection> pConnection_; // Needs to be shared rather than unique because it's passed to handlers
-		communique::impl::TLSHandler tlsHandler_;
+		std::shared_ptr<communique::IExecutor> pExecutor_; // Declared after pTransport_ so that queued tasks finish before the transport is destroyed
+		std::shared_ptr<communique::IExecutor> pResponseExecutor_; // Null means run response handlers on the IO thread
+		std::shared_ptr<communique::impl::TimingWheel> pTimingWheel_; // Used for request timeouts
+		std::chrono::milliseconds defaultRequestTimeout_;
+		std::shared_ptr<communique::impl::Connection> pConnection_; // Needs to be shared rather than unique because it's passed to handlers. Only access with connection() and setConnection().
+		std::shared_ptr<communique::impl::TLSHandler> pTLSHandler_;
 
-		std::function<void(const std::string&,std::weak_ptr<communique::IConnection>)> infoHandler_;
-		std::function<std::string(const std::string&,std::weak_ptr<communique::IConnection>)> requestHandler_;
+		std::string URI_; ///< The URI of the current connection, used when reconnecting
+		std::shared_ptr< std::promise<void> > pConnectPromise_; ///< Completed when the current connection attempt finishes
+		std::mutex connectPromiseMutex_;
 
-		void on_open( websocketpp::connection_hdl hdl );
-		void on_close( websocketpp::connection_hdl hdl );
-		void on_interrupt( websocketpp::connection_hdl hdl );
+		std::function<void(const communique::MessageView&,std::weak_ptr<communique::IConnection>)> infoHandler_;
+		std::function<std::string(const communique::MessageView&,std::weak_ptr<communique::IConnection>)> requestHandler_;
+
+		std::mutex reconnectMutex_; ///< Guards everything to do with reconnecting except the buffered messages
+		bool reconnectEnabled_;
+		communique::ReconnectPolicy reconnectPolicy_;
+		bool userDisconnected_; ///< True if disconnect has been called since the last connect, so don't reconnect
+		size_t reconnectAttempts_; ///< Number of attempts since the connection was last open
+		timer_ptr pReconnectTimer_;
+		std::mt19937 randomEngine_; ///< For the jitter on the reconnect delay
+		/// A message sent while reconnecting. Called with the new connection once it's open, or null if it never will be.
+		typedef std::function<void(communique::impl::Connection*)> BufferedMessage;
+		std::atomic<bool> reconnecting_; ///< Checked without the lock so that sends don't pay for it when connected
+		std::mutex bufferMutex_;
+		size_t maximumBufferedMessages_;
+		std::deque<BufferedMessage> bufferedMessages_;
+
+		mutable std::mutex statsMutex_; ///< Held while the connection is replaced, so that stats() never counts a connection twice or not at all
+		communique::Stats previousConnections_; ///< The counts from every connection before the current one
+
+		/// The connection may be replaced by the IO thread when reconnecting, so always take a copy through here
+		std::shared_ptr<communique::impl::Connection> connection() const { return std::atomic_load( &pConnection_ ); }
+		/// Replaces the connection, keeping the counts from the old one
+		void setConnection( std::shared_ptr<communique::impl::Connection> pConnection );
+		/// Creates a new Connection with the current handlers and settings. Doesn't start connecting.
+		std::shared_ptr<communique::impl::Connection> createConnection( const std::string& URI );
+		/** @brief Start the timer for the next reconnect attempt. Has to be called with reconnectMutex_ locked.
+		 * Returns false if the policy says to give up, in which case failBufferedMessages needs to be called. */
+		bool scheduleReconnect();
+		void on_reconnectTimer( const websocketpp::lib::asio::error_code& errorCode );
+		/// If reconnecting and buffering is enabled, holds on to the message and returns true. Otherwise returns false.
+		bool bufferIfReconnecting( BufferedMessage message );
+		/** @brief As bufferIfReconnecting, but for requests. The timeout starts now rather than when the request is
+		 * eventually sent, and if it expires first fail is called with ResponseStatus::TIMEDOUT. send is given the new
+		 * connection and whatever is left of the timeout. fail is also called if the request is never sent. */
+		bool bufferRequestIfReconnecting( std::function<void(communique::impl::Connection&,std::chrono::milliseconds)> send, std::function<void(communique::ResponseStatus)> fail, std::chrono::milliseconds timeout );
+		/// Sends all the buffered messages on the new connection
+		void sendBufferedMessages( communique::impl::Connection& connection );
+		/// Tells everything waiting in the buffer that it isn't going to be sent
+		void failBufferedMessages();
+		/// Stops any reconnect that's pending. Returns the timer so that it can be cancelled once the lock is released.
+		timer_ptr stopReconnecting();
+
+		void on_open();
+		void on_close();
+		void on_fail( const std::string& reason );
+		void on_interrupt();
 	};
 }
 
+namespace
+{
+	std::shared_ptr<communique::impl::ClientTransport> createTransport( communique::Transport transport, websocketpp::lib::asio::io_service* pIoService )
+	{
+		switch( transport )
+		{
+			case communique::Transport::TLS:
+				return std::make_shared< communique::impl::WebsocketClientTransport<websocketpp::config::asio_tls> >( pIoService );
+			case communique::Transport::PLAIN:
+				return std::make_shared< communique::impl::WebsocketClientTransport<websocketpp::config::asio> >( pIoService );
+			case communique::Transport::UNIXSOCKET:
+				return std::make_shared<communique::impl::UnixSocketClientTransport>( pIoService );
+			case communique::Transport::SHAREDMEMORY:
+#ifndef COMMUNIQUE_NO_SHAREDMEMORY
+				return std::make_shared<communique::impl::SharedMemoryClientTransport>( pIoService );
+#else
+				throw std::runtime_error( "communique::Transport::SHAREDMEMORY is only available on Linux" );
+#endif
+			case communique::Transport::INPROCESS:
+				return std::make_shared<communique::impl::InProcessClientTransport>( pIoService );
+			case communique::Transport::RAWTLS:
+				return std::make_shared<communique::impl::RawClientTransport>( pIoService, true );
+			case communique::Transport::RAWTCP:
+				return std::make_shared<communique::impl::RawClientTransport>( pIoService, false );
+		}
+		throw std::runtime_error( "Unknown communique::Transport" );
+	}
+}
+
+communique::ClientPrivateMembers::ClientPrivateMembers( communique::Transport transport, communique::EventLoopPrivateMembers* pEventLoop )
+	: transport_(transport), pEventLoop_(pEventLoop), pOwnIoService_( pEventLoop ? nullptr : new websocketpp::lib::asio::io_service ),
+	  pTransport_( createTransport( transport, pEventLoop ? &pEventLoop->ioService_ : pOwnIoService_.get() ) ),
+	  pTimingWheel_( pEventLoop ? pEventLoop->timingWheel() : communique::impl::processTimingWheel() ), defaultRequestTimeout_(0),
+	  pTLSHandler_( std::make_shared<communique::impl::TLSHandler>( pTransport_->accessLog() ) ), reconnectEnabled_(false), userDisconnected_(true), reconnectAttempts_(0), randomEngine_(std::random_device()()),
+	  reconnecting_(false), maximumBufferedMessages_(0)
+{
+	// No operation besides initialiser list
+}
+
 communique::Client::Client()
-	: pImple_( new ClientPrivateMembers )
+	: Client( communique::Transport::TLS, nullptr )
+{
+	// No operation, everything done in the delegated constructor
+}
+
+communique::Client::Client( std::shared_ptr<communique::EventLoop> pEventLoop )
+	: Client( communique::Transport::TLS, std::move(pEventLoop) )
 {
-	pImple_->client_.set_access_channels(websocketpp::log::alevel::none);
-	//pImple_->client_.set_error_channels(websocketpp::log::elevel::all ^ websocketpp::log::elevel::info);
-	pImple_->client_.set_error_channels(websocketpp::log::elevel::none);
-	pImple_->client_.set_tls_init_handler( std::bind( &communique::impl::TLSHandler::on_tls_init, &pImple_->tlsHandler_, std::placeholders::_1 ) );
-	pImple_->client_.init_asio();
-	pImple_->client_.set_open_handler( std::bind( &ClientPrivateMembers::on_open, pImple_.get(), std::placeholders::_1 ) );
-	pImple_->client_.set_close_handler( std::bind( &ClientPrivateMembers::on_close, pImple_.get(), std::placeholders::_1 ) );
-	pImple_->client_.set_interrupt_handler( std::bind( &ClientPrivateMembers::on_interrupt, pImple_.get(), std::placeholders::_1 ) );
+	// No operation, everything done in the delegated constructor
+}
+
+communique::Client::Client( communique::Transport transport, std::shared_ptr<communique::EventLoop> pEventLoop )
+	: pEventLoop_( std::move(pEventLoop) ), pImple_( std::make_shared<ClientPrivateMembers>( transport, pEventLoop_ ? pEventLoop_->pImple_.get() : nullptr ) )
+{
+	pImple_->pTransport_->setTLSHandler( pImple_->pTLSHandler_ );
+	// The transport can outlive pImple_ while anything it queued is still to run, so it only gets weak references
+	std::weak_ptr<ClientPrivateMembers> pWeakImple( pImple_ );
+	pImple_->pTransport_->onOpen=[pWeakImple](){ auto pImple=pWeakImple.lock(); if( pImple ) pImple->on_open(); };
+	pImple_->pTransport_->onClose=[pWeakImple](){ auto pImple=pWeakImple.lock(); if( pImple ) pImple->on_close(); };
+	pImple_->pTransport_->onInterrupt=[pWeakImple](){ auto pImple=pWeakImple.lock(); if( pImple ) pImple->on_interrupt(); };
+	pImple_->pTransport_->onFail=[pWeakImple]( const std::string& reason ){ auto pImple=pWeakImple.lock(); if( pImple ) pImple->on_fail( reason ); };
 }
 
 communique::Client::Client( Client&& otherClient ) noexcept
-	: pImple_( std::move(otherClient.pImple_) )
+	: pEventLoop_( std::move(otherClient.pEventLoop_) ), pImple_( std::move(otherClient.pImple_) )
 {
 	// No operation, everything done in initialiser list
 }
@@ -61,139 +181,673 @@ communique::Client::~Client()
 		// If std::move is used then pImple_ can be null, in which
 		// case I don't want to do any cleanup.
 		if( pImple_ ) disconnect();
+		// Anything still queued for the transport holds a shared_ptr to it, so it goes once that has run
 	}
 	catch(...) { /* Make sure no exceptions propagate out */ }
 }
 
 void communique::Client::connect( const std::string& URI )
 {
-	websocketpp::lib::error_code errorCode;
-	auto pWebPPConnection=pImple_->client_.get_connection( URI, errorCode );
-	if( errorCode.value()!=0 ) throw std::runtime_error( "Unable to get the websocketpp connection - "+errorCode.message() );
-	pImple_->pConnection_=std::make_shared<communique::impl::Connection>( pWebPPConnection, pImple_->infoHandler_, pImple_->requestHandler_ );
+	connectAsync( URI );
+}
 
-	if( errorCode )
-	{
-		pImple_->client_.get_alog().write(websocketpp::log::alevel::app,errorCode.message());
-		throw communique::impl::Exception( errorCode.message() );
+std::future<void> communique::Client::connectAsync( const std::string& URI )
+{
+	// Clear up anything left from the last connection, including the IO thread
+	if( pImple_->connection() || pImple_->ioThread_.joinable() ) disconnect();
+
+	// Build the TLS context now, so that any problems with the certificate files are reported
+	// here rather than on the handshake.
+	if( pImple_->transport_==communique::Transport::TLS || pImple_->transport_==communique::Transport::RAWTLS ) pImple_->pTLSHandler_->context();
+
+	std::future<void> result;
+	{ // Block to limit lifetime of the lock_guard
+		std::lock_guard<std::mutex> lock( pImple_->reconnectMutex_ );
+		pImple_->URI_=URI;
+		pImple_->setConnection( pImple_->createConnection( URI ) );
+		pImple_->userDisconnected_=false;
+		pImple_->reconnectAttempts_=0;
+
+		std::lock_guard<std::mutex> myMutex( pImple_->connectPromiseMutex_ );
+		pImple_->pConnectPromise_=std::make_shared< std::promise<void> >();
+		result=pImple_->pConnectPromise_->get_future();
 	}
 
-	pImple_->client_.connect( pImple_->pConnection_->underlyingPointer() );
-	pImple_->ioThread_=std::thread( &ClientPrivateMembers::client_type::run, &pImple_->client_ );
+	pImple_->pTransport_->connect( *pImple_->connection() );
+	// If using a shared EventLoop its threads are already running. Otherwise the event loop
+	// needs resetting if it has been run before.
+	if( !pEventLoop_ )
+	{
+		pImple_->pTransport_->reset();
+		pImple_->ioThread_=std::thread( &communique::impl::ClientTransport::run, pImple_->pTransport_.get() );
+	}
+	return result;
 }
 
 bool communique::Client::isConnected()
 {
-	if( !pImple_->pConnection_ ) return false;
-	return pImple_->pConnection_->isConnected();
+	auto pConnection=pImple_->connection();
+	if( !pConnection ) return false;
+	return pConnection->isConnected();
+}
+
+bool communique::Client::waitConnected( std::chrono::milliseconds timeout )
+{
+	auto pConnection=pImple_->connection();
+	if( !pConnection ) return false;
+	return pConnection->waitConnected( timeout );
 }
 
 bool communique::Client::isDisconnected()
 {
-	if( !pImple_->pConnection_ ) return true;
-	return pImple_->pConnection_->isDisconnected();
+	auto pConnection=pImple_->connection();
+	if( !pConnection ) return true;
+	return pConnection->isDisconnected();
 }
 
 void communique::Client::disconnect()
 {
-	if( pImple_->pConnection_ ) pImple_->pConnection_->close();
+	auto pReconnectTimer=pImple_->stopReconnecting();
+	// Cancelling a timer isn't thread safe, so has to be done by the event loop
+	if( pReconnectTimer ) pImple_->pTransport_->ioService().post( [pReconnectTimer](){ pReconnectTimer->cancel(); } );
+	pImple_->failBufferedMessages();
+
+	auto pConnection=pImple_->connection();
+	if( pConnection ) pConnection->close();
 	if( pImple_->ioThread_.joinable() ) pImple_->ioThread_.join();
+	// Can't join the threads of a shared loop, so wait for the close handshake to finish instead
+	else if( pConnection ) pConnection->isDisconnected();
+}
+
+size_t communique::Client::requestsOutstanding() const
+{
+	auto pConnection=pImple_->connection();
+	if( !pConnection ) return 0;
+	return pConnection->requestsOutstanding();
+}
+
+communique::Stats communique::Client::stats() const
+{
+	std::lock_guard<std::mutex> lock( pImple_->statsMutex_ );
+	communique::Stats result=pImple_->previousConnections_;
+	auto pConnection=pImple_->connection();
+	if( pConnection ) result+=pConnection->stats();
+	return result;
 }
 
 void communique::Client::setCertificateChainFile( const std::string& filename )
 {
-	pImple_->tlsHandler_.setCertificateChainFile(filename);
+	pImple_->pTLSHandler_->setCertificateChainFile(filename);
 }
 
 void communique::Client::setPrivateKeyFile( const std::string& filename )
 {
-	pImple_->tlsHandler_.setPrivateKeyFile(filename);
+	pImple_->pTLSHandler_->setPrivateKeyFile(filename);
 }
 
 void communique::Client::setVerifyFile( const std::string& filename )
 {
-	pImple_->tlsHandler_.setVerifyFile(filename);
+	pImple_->pTLSHandler_->setVerifyFile(filename);
+}
+
+void communique::Client::setProtocolVersions( communique::TLSVersion minimum, communique::TLSVersion maximum )
+{
+	pImple_->pTLSHandler_->setProtocolVersions(minimum,maximum);
+}
+
+void communique::Client::setCipherList( const std::string& cipherList )
+{
+	pImple_->pTLSHandler_->setCipherList(cipherList);
+}
+
+void communique::Client::setCipherSuites( const std::string& cipherSuites )
+{
+	pImple_->pTLSHandler_->setCipherSuites(cipherSuites);
+}
+
+void communique::Client::setCurves( const std::string& curves )
+{
+	pImple_->pTLSHandler_->setCurves(curves);
+}
+
+void communique::Client::setSessionResumption( bool enabled )
+{
+	pImple_->pTLSHandler_->setSessionResumption(enabled);
+}
+
+bool communique::Client::sessionWasResumed()
+{
+	auto pConnection=pImple_->connection();
+	if( !isConnected() ) return false;
+	return pConnection->sessionResumed();
+}
+
+size_t communique::Client::completedHandshakes() const
+{
+	return pImple_->pTLSHandler_->completedHandshakes();
+}
+
+size_t communique::Client::resumedHandshakes() const
+{
+	return pImple_->pTLSHandler_->resumedHandshakes();
+}
+
+void communique::Client::setExecutor( std::shared_ptr<communique::IExecutor> pExecutor )
+{
+	auto pConnection=pImple_->connection();
+	pImple_->pExecutor_=pExecutor;
+	if( pConnection ) pConnection->setExecutor( pImple_->pExecutor_ );
+}
+
+void communique::Client::setResponseExecutor( std::shared_ptr<communique::IExecutor> pExecutor )
+{
+	auto pConnection=pImple_->connection();
+	pImple_->pResponseExecutor_=pExecutor;
+	if( pConnection ) pConnection->setResponseExecutor( pImple_->pResponseExecutor_ );
+}
+
+void communique::Client::setAutoReconnect( bool enabled, const communique::ReconnectPolicy& policy )
+{
+	ClientPrivateMembers::timer_ptr pReconnectTimer;
+	{ // Block to limit lifetime of the lock_guard
+		std::lock_guard<std::mutex> lock( pImple_->reconnectMutex_ );
+		pImple_->reconnectEnabled_=enabled;
+		pImple_->reconnectPolicy_=policy;
+		if( !enabled )
+		{
+			pImple_->reconnecting_=false;
+			pReconnectTimer.swap( pImple_->pReconnectTimer_ );
+		}
+	}
+	{ // Block to limit lifetime of the lock_guard
+		std::lock_guard<std::mutex> lock( pImple_->bufferMutex_ );
+		pImple_->maximumBufferedMessages_=( enabled ? policy.maximumBufferedMessages : 0 );
+	}
+	if( !enabled )
+	{
+		// Cancelling a timer isn't thread safe, so has to be done by the event loop
+		if( pReconnectTimer ) pImple_->pTransport_->ioService().post( [pReconnectTimer](){ pReconnectTimer->cancel(); } );
+		pImple_->failBufferedMessages();
+	}
+}
+
+void communique::Client::setDefaultRequestTimeout( std::chrono::milliseconds timeout )
+{
+	auto pConnection=pImple_->connection();
+	pImple_->defaultRequestTimeout_=timeout;
+	if( pConnection ) pConnection->setDefaultRequestTimeout( timeout );
+}
+
+void communique::Client::setBusyPollTime( std::chrono::microseconds busyPollTime )
+{
+	pImple_->pTransport_->setBusyPollTime( busyPollTime );
 }
 
 void communique::Client::sendRequest( const std::string& message, std::function<void(const std::string&)> responseHandler )
 {
-	if( !pImple_->pConnection_ ) throw communique::impl::Exception( "No connection" );
-	pImple_->pConnection_->sendRequest( message, responseHandler );
+	// Never buffered while reconnecting, since there'd be no way to tell the handler if the request is never sent
+	auto pConnection=pImple_->connection();
+	if( !pConnection ) throw communique::impl::Exception( "No connection" );
+	pConnection->sendRequest( message, responseHandler );
+}
+
+void communique::Client::sendRequest( const std::string& message, std::function<void(const std::string&,communique::ResponseStatus)> responseHandler, std::chrono::milliseconds timeout )
+{
+	if( pImple_->reconnecting_ && pImple_->bufferRequestIfReconnecting( [message,responseHandler](communique::impl::Connection& connection,std::chrono::milliseconds remaining) mutable { connection.sendRequest( std::move(message), responseHandler, remaining ); }, [responseHandler](communique::ResponseStatus status){ responseHandler( std::string(), status ); }, timeout ) ) return;
+	auto pConnection=pImple_->connection();
+	if( !pConnection ) throw communique::impl::Exception( "No connection" );
+	pConnection->sendRequest( message, responseHandler, timeout );
+}
+
+void communique::Client::sendRequest( const std::string& message, std::function<void(const communique::MessageView&,communique::ResponseStatus)> responseHandler, std::chrono::milliseconds timeout )
+{
+	if( pImple_->reconnecting_ && pImple_->bufferRequestIfReconnecting( [message,responseHandler](communique::impl::Connection& connection,std::chrono::milliseconds remaining) mutable { connection.sendRequest( std::move(message), responseHandler, remaining ); }, [responseHandler](communique::ResponseStatus status){ responseHandler( communique::MessageView(), status ); }, timeout ) ) return;
+	auto pConnection=pImple_->connection();
+	if( !pConnection ) throw communique::impl::Exception( "No connection" );
+	pConnection->sendRequest( message, responseHandler, timeout );
+}
+
+std::future<std::string> communique::Client::sendRequest( const std::string& message, std::chrono::milliseconds timeout )
+{
+	if( pImple_->reconnecting_ )
+	{
+		auto pPromise=std::make_shared< std::promise<std::string> >();
+		auto responseHandler=communique::impl::Connection::promiseHandler( pPromise );
+		if( pImple_->bufferRequestIfReconnecting( [message,responseHandler](communique::impl::Connection& connection,std::chrono::milliseconds remaining) mutable { connection.sendRequest( std::move(message), responseHandler, remaining ); }, [responseHandler](communique::ResponseStatus status){ responseHandler( communique::MessageView(), status ); }, timeout ) ) return pPromise->get_future();
+	}
+	auto pConnection=pImple_->connection();
+	if( !pConnection ) throw communique::impl::Exception( "No connection" );
+	return pConnection->sendRequest( message, timeout );
+}
+
+void communique::Client::sendRequest( std::string&& message, std::function<void(const std::string&)> responseHandler )
+{
+	// Never buffered while reconnecting, since there'd be no way to tell the handler if the request is never sent
+	auto pConnection=pImple_->connection();
+	if( !pConnection ) throw communique::impl::Exception( "No connection" );
+	pConnection->sendRequest( std::move(message), responseHandler );
+}
+
+void communique::Client::sendRequest( std::string&& message, std::function<void(const std::string&,communique::ResponseStatus)> responseHandler, std::chrono::milliseconds timeout )
+{
+	if( pImple_->reconnecting_ )
+	{
+		auto pMessage=std::make_shared<std::string>( std::move(message) );
+		if( pImple_->bufferRequestIfReconnecting( [pMessage,responseHandler](communique::impl::Connection& connection,std::chrono::milliseconds remaining) { connection.sendRequest( std::move(*pMessage), responseHandler, remaining ); }, [responseHandler](communique::ResponseStatus status){ responseHandler( std::string(), status ); }, timeout ) ) return;
+		message=std::move(*pMessage); // Not buffered after all, so take it back
+	}
+	auto pConnection=pImple_->connection();
+	if( !pConnection ) throw communique::impl::Exception( "No connection" );
+	pConnection->sendRequest( std::move(message), responseHandler, timeout );
+}
+
+void communique::Client::sendRequest( std::string&& message, std::function<void(const communique::MessageView&,communique::ResponseStatus)> responseHandler, std::chrono::milliseconds timeout )
+{
+	if( pImple_->reconnecting_ )
+	{
+		auto pMessage=std::make_shared<std::string>( std::move(message) );
+		if( pImple_->bufferRequestIfReconnecting( [pMessage,responseHandler](communique::impl::Connection& connection,std::chrono::milliseconds remaining) { connection.sendRequest( std::move(*pMessage), responseHandler, remaining ); }, [responseHandler](communique::ResponseStatus status){ responseHandler( communique::MessageView(), status ); }, timeout ) ) return;
+		message=std::move(*pMessage); // Not buffered after all, so take it back
+	}
+	auto pConnection=pImple_->connection();
+	if( !pConnection ) throw communique::impl::Exception( "No connection" );
+	pConnection->sendRequest( std::move(message), responseHandler, timeout );
+}
+
+std::future<std::string> communique::Client::sendRequest( std::string&& message, std::chrono::milliseconds timeout )
+{
+	if( pImple_->reconnecting_ )
+	{
+		auto pPromise=std::make_shared< std::promise<std::string> >();
+		auto responseHandler=communique::impl::Connection::promiseHandler( pPromise );
+		auto pMessage=std::make_shared<std::string>( std::move(message) );
+		if( pImple_->bufferRequestIfReconnecting( [pMessage,responseHandler](communique::impl::Connection& connection,std::chrono::milliseconds remaining) { connection.sendRequest( std::move(*pMessage), responseHandler, remaining ); }, [responseHandler](communique::ResponseStatus status){ responseHandler( communique::MessageView(), status ); }, timeout ) ) return pPromise->get_future();
+		message=std::move(*pMessage); // Not buffered after all, so take it back
+	}
+	auto pConnection=pImple_->connection();
+	if( !pConnection ) throw communique::impl::Exception( "No connection" );
+	return pConnection->sendRequest( std::move(message), timeout );
+}
+
+void communique::Client::sendRequest( communique::MessageBuffer&& message, std::function<void(const communique::MessageView&,communique::ResponseStatus)> responseHandler, std::chrono::milliseconds timeout )
+{
+	if( pImple_->reconnecting_ )
+	{
+		auto pMessage=std::make_shared<communique::MessageBuffer>( std::move(message) );
+		if( pImple_->bufferRequestIfReconnecting( [pMessage,responseHandler](communique::impl::Connection& connection,std::chrono::milliseconds remaining) { connection.sendRequest( std::move(*pMessage), responseHandler, remaining ); }, [responseHandler](communique::ResponseStatus status){ responseHandler( communique::MessageView(), status ); }, timeout ) ) return;
+		message=std::move(*pMessage); // Not buffered after all, so take it back
+	}
+	auto pConnection=pImple_->connection();
+	if( !pConnection ) throw communique::impl::Exception( "No connection" );
+	pConnection->sendRequest( std::move(message), responseHandler, timeout );
+}
+
+std::future<std::string> communique::Client::sendRequest( communique::MessageBuffer&& message, std::chrono::milliseconds timeout )
+{
+	if( pImple_->reconnecting_ )
+	{
+		auto pPromise=std::make_shared< std::promise<std::string> >();
+		auto responseHandler=communique::impl::Connection::promiseHandler( pPromise );
+		auto pMessage=std::make_shared<communique::MessageBuffer>( std::move(message) );
+		if( pImple_->bufferRequestIfReconnecting( [pMessage,responseHandler](communique::impl::Connection& connection,std::chrono::milliseconds remaining) { connection.sendRequest( std::move(*pMessage), responseHandler, remaining ); }, [responseHandler](communique::ResponseStatus status){ responseHandler( communique::MessageView(), status ); }, timeout ) ) return pPromise->get_future();
+		message=std::move(*pMessage); // Not buffered after all, so take it back
+	}
+	auto pConnection=pImple_->connection();
+	if( !pConnection ) throw communique::impl::Exception( "No connection" );
+	return pConnection->sendRequest( std::move(message), timeout );
 }
 
 void communique::Client::sendInfo( const std::string& message )
 {
-	if( !pImple_->pConnection_ ) throw communique::impl::Exception( "No connection" );
-	pImple_->pConnection_->sendInfo( message );
+	if( pImple_->reconnecting_ && pImple_->bufferIfReconnecting( [message](communique::impl::Connection* pConnection) mutable { if( pConnection ) pConnection->sendInfo( std::move(message) ); } ) ) return;
+	auto pConnection=pImple_->connection();
+	if( !pConnection ) throw communique::impl::Exception( "No connection" );
+	pConnection->sendInfo( message );
+}
+
+void communique::Client::sendInfo( std::string&& message )
+{
+	if( pImple_->reconnecting_ )
+	{
+		auto pMessage=std::make_shared<std::string>( std::move(message) );
+		if( pImple_->bufferIfReconnecting( [pMessage](communique::impl::Connection* pConnection) { if( pConnection ) pConnection->sendInfo( std::move(*pMessage) ); } ) ) return;
+		message=std::move(*pMessage); // Not buffered after all, so take it back
+	}
+	auto pConnection=pImple_->connection();
+	if( !pConnection ) throw communique::impl::Exception( "No connection" );
+	pConnection->sendInfo( std::move(message) );
+}
+
+void communique::Client::sendInfo( communique::MessageBuffer&& message )
+{
+	if( pImple_->reconnecting_ )
+	{
+		auto pMessage=std::make_shared<communique::MessageBuffer>( std::move(message) );
+		if( pImple_->bufferIfReconnecting( [pMessage](communique::impl::Connection* pConnection) { if( pConnection ) pConnection->sendInfo( std::move(*pMessage) ); } ) ) return;
+		message=std::move(*pMessage); // Not buffered after all, so take it back
+	}
+	auto pConnection=pImple_->connection();
+	if( !pConnection ) throw communique::impl::Exception( "No connection" );
+	pConnection->sendInfo( std::move(message) );
 }
 
 void communique::Client::setInfoHandler( std::function<void(const std::string&)> infoHandler )
 {
-	// Wrap in a function that drops the connection argument
-	pImple_->infoHandler_=std::bind( infoHandler, std::placeholders::_1 );
-	if( pImple_->pConnection_ )
+	auto pConnection=pImple_->connection();
+	// Wrap in a function that copies the message and drops the connection argument
+	if( infoHandler ) pImple_->infoHandler_=[infoHandler](const communique::MessageView& message,std::weak_ptr<communique::IConnection>){ infoHandler( message.str() ); };
+	else pImple_->infoHandler_=nullptr;
+	if( pConnection )
 	{
-		pImple_->pConnection_->setInfoHandler( pImple_->infoHandler_ );
+		pConnection->setInfoHandler( pImple_->infoHandler_ );
 	}
 }
 
 void communique::Client::setInfoHandler( std::function<void(const std::string&,std::weak_ptr<communique::IConnection>)> infoHandler )
 {
+	auto pConnection=pImple_->connection();
+	// Wrap in a function that copies the message
+	if( infoHandler ) pImple_->infoHandler_=[infoHandler](const communique::MessageView& message,std::weak_ptr<communique::IConnection> pConnection){ infoHandler( message.str(), pConnection ); };
+	else pImple_->infoHandler_=nullptr;
+	if( pConnection )
+	{
+		pConnection->setInfoHandler( pImple_->infoHandler_ );
+	}
+}
+
+void communique::Client::setInfoHandler( std::function<void(const communique::MessageView&,std::weak_ptr<communique::IConnection>)> infoHandler )
+{
+	auto pConnection=pImple_->connection();
 	pImple_->infoHandler_=infoHandler;
-	if( pImple_->pConnection_ )
+	if( pConnection )
 	{
-		pImple_->pConnection_->setInfoHandler( pImple_->infoHandler_ );
+		pConnection->setInfoHandler( pImple_->infoHandler_ );
 	}
 }
 
 void communique::Client::setRequestHandler( std::function<std::string(const std::string&)> requestHandler )
 {
-	// Wrap in a function that drops the connection argument
-	pImple_->requestHandler_=std::bind( requestHandler, std::placeholders::_1 );
-	if( pImple_->pConnection_ )
+	auto pConnection=pImple_->connection();
+	// Wrap in a function that copies the message and drops the connection argument
+	if( requestHandler ) pImple_->requestHandler_=[requestHandler](const communique::MessageView& message,std::weak_ptr<communique::IConnection>){ return requestHandler( message.str() ); };
+	else pImple_->requestHandler_=nullptr;
+	if( pConnection )
 	{
-		pImple_->pConnection_->setRequestHandler( pImple_->requestHandler_ );
+		pConnection->setRequestHandler( pImple_->requestHandler_ );
 	}
 }
 
 void communique::Client::setRequestHandler( std::function<std::string(const std::string&,std::weak_ptr<communique::IConnection>)> requestHandler )
 {
+	auto pConnection=pImple_->connection();
+	// Wrap in a function that copies the message
+	if( requestHandler ) pImple_->requestHandler_=[requestHandler](const communique::MessageView& message,std::weak_ptr<communique::IConnection> pConnection){ return requestHandler( message.str(), pConnection ); };
+	else pImple_->requestHandler_=nullptr;
+	if( pConnection )
+	{
+		pConnection->setRequestHandler( pImple_->requestHandler_ );
+	}
+}
+
+void communique::Client::setRequestHandler( std::function<std::string(const communique::MessageView&,std::weak_ptr<communique::IConnection>)> requestHandler )
+{
+	auto pConnection=pImple_->connection();
 	pImple_->requestHandler_=requestHandler;
-	if( pImple_->pConnection_ )
+	if( pConnection )
 	{
-		pImple_->pConnection_->setRequestHandler( pImple_->requestHandler_ );
+		pConnection->setRequestHandler( pImple_->requestHandler_ );
 	}
 }
 
 void communique::Client::setErrorLogLocation( std::ostream& outputStream )
 {
-	pImple_->client_.get_elog().set_ostream( &outputStream );
+	pImple_->pTransport_->setErrorLogLocation( outputStream );
 }
 
 void communique::Client::setErrorLogLevel( uint32_t level )
 {
-	pImple_->client_.set_error_channels(level);
+	pImple_->pTransport_->setErrorLogLevel( level );
 }
 
 void communique::Client::setAccessLogLocation( std::ostream& outputStream )
 {
-	pImple_->client_.get_alog().set_ostream( &outputStream );
+	pImple_->pTransport_->setAccessLogLocation( outputStream );
 }
 
 void communique::Client::setAccessLogLevel( uint32_t level )
 {
-	pImple_->client_.set_access_channels(level);
+	pImple_->pTransport_->setAccessLogLevel( level );
 }
 
-void communique::ClientPrivateMembers::on_open( websocketpp::connection_hdl hdl )
+void communique::ClientPrivateMembers::on_open()
 {
+	auto pConnection=connection();
+	if( pConnection )
+	{
+		pConnection->notifyStateChange();
+		sendBufferedMessages( *pConnection );
+	}
+	{ // Block to limit lifetime of the lock_guard
+		std::lock_guard<std::mutex> lock( reconnectMutex_ );
+		reconnectAttempts_=0;
+	}
+
+	std::shared_ptr< std::promise<void> > pConnectPromise;
+	{ // Block to limit lifetime of the lock_guard
+		std::lock_guard<std::mutex> myMutex( connectPromiseMutex_ );
+		pConnectPromise.swap( pConnectPromise_ );
+	}
+	if( pConnectPromise ) pConnectPromise->set_value();
+}
+
+void communique::ClientPrivateMembers::on_close()
+{
+	// Decide whether to reconnect first, so that anything sent from now on is buffered rather than failing
+	bool gaveUp=false;
+	{ // Block to limit lifetime of the lock_guard
+		std::lock_guard<std::mutex> lock( reconnectMutex_ );
+		if( reconnectEnabled_ && !userDisconnected_ && !pReconnectTimer_ )
+		{
+			reconnecting_=true;
+			gaveUp=!scheduleReconnect();
+		}
+	}
+	if( gaveUp ) failBufferedMessages();
+
+	// Take a copy in case connect is called on another thread at the same time
+	auto pConnection=connection();
+	if( pConnection )
+	{
+		pConnection->notifyStateChange();
+		pConnection->failPendingRequests();
+	}
 }
 
-void communique::ClientPrivateMembers::on_close( websocketpp::connection_hdl hdl )
+void communique::ClientPrivateMembers::on_fail( const std::string& reason )
 {
+	// A connection that fails to open never gets a close, but any requests sent while connecting still need failing
+	on_close();
+
+	std::shared_ptr< std::promise<void> > pConnectPromise;
+	{ // Block to limit lifetime of the lock_guard
+		std::lock_guard<std::mutex> myMutex( connectPromiseMutex_ );
+		pConnectPromise.swap( pConnectPromise_ );
+	}
+	if( pConnectPromise ) pConnectPromise->set_exception( std::make_exception_ptr( communique::impl::Exception( "Unable to connect - "+reason ) ) );
 }
 
-void communique::ClientPrivateMembers::on_interrupt( websocketpp::connection_hdl hdl )
+void communique::ClientPrivateMembers::on_interrupt()
 {
 	std::cout << "Connection has been interrupted" << std::endl;
+	auto pConnection=connection();
+	if( pConnection ) pConnection->failPendingRequests();
+}
+
+void communique::ClientPrivateMembers::setConnection( std::shared_ptr<communique::impl::Connection> pConnection )
+{
+	std::lock_guard<std::mutex> lock( statsMutex_ );
+	std::shared_ptr<communique::impl::Connection> pOldConnection=std::atomic_exchange( &pConnection_, pConnection );
+	if( pOldConnection ) previousConnections_+=communique::impl::StatsCounters::countsOnly( pOldConnection->stats() );
+}
+
+std::shared_ptr<communique::impl::Connection> communique::ClientPrivateMembers::createConnection( const std::string& URI )
+{
+	auto pNewConnection=pTransport_->createConnection( URI );
+	pNewConnection->setInfoHandler( infoHandler_ );
+	pNewConnection->setRequestHandler( requestHandler_ );
+	if( !pExecutor_ ) pExecutor_=( pEventLoop_ ? pEventLoop_->defaultExecutor() : communique::impl::processDefaultExecutor() );
+	pNewConnection->setExecutor( pExecutor_ );
+	pNewConnection->setResponseExecutor( pResponseExecutor_ );
+	pNewConnection->setTimingWheel( pTimingWheel_ );
+	pNewConnection->setDefaultRequestTimeout( defaultRequestTimeout_ );
+	return pNewConnection;
+}
+
+bool communique::ClientPrivateMembers::scheduleReconnect()
+{
+	if( reconnectPolicy_.maximumAttempts!=0 && reconnectAttempts_>=reconnectPolicy_.maximumAttempts )
+	{
+		reconnecting_=false;
+		return false;
+	}
+
+	double delay=static_cast<double>( reconnectPolicy_.initialDelay.count() )*std::pow( reconnectPolicy_.multiplier, static_cast<double>(reconnectAttempts_) );
+	delay=std::min( delay, static_cast<double>( reconnectPolicy_.maximumDelay.count() ) );
+	const double jitter=std::min( std::max( reconnectPolicy_.jitter, 0.0 ), 1.0 );
+	delay*=std::uniform_real_distribution<double>( 1.0-jitter, 1.0 )( randomEngine_ );
+	++reconnectAttempts_;
+
+	pReconnectTimer_=std::make_shared<websocketpp::lib::asio::steady_timer>( pTransport_->ioService(), std::chrono::milliseconds( static_cast<long>(delay) ) );
+	std::weak_ptr<ClientPrivateMembers> pWeakThis( shared_from_this() );
+	pReconnectTimer_->async_wait( [pWeakThis]( const websocketpp::lib::asio::error_code& errorCode ){ auto pThis=pWeakThis.lock(); if( pThis ) pThis->on_reconnectTimer( errorCode ); } );
+	return true;
+}
+
+void communique::ClientPrivateMembers::on_reconnectTimer( const websocketpp::lib::asio::error_code& errorCode )
+{
+	if( errorCode ) return; // Timer was cancelled
+
+	bool gaveUp=false;
+	{ // Block to limit lifetime of the lock_guard
+		std::lock_guard<std::mutex> lock( reconnectMutex_ );
+		pReconnectTimer_.reset();
+		// Holding the lock while connecting means disconnect either stops this or sees the new connection
+		if( !reconnectEnabled_ || userDisconnected_ ) return;
+
+		try
+		{
+			setConnection( createConnection( URI_ ) );
+			pTransport_->connect( *connection() );
+		}
+		catch( const std::exception& error )
+		{
+			std::cerr << "communique::Client - unable to reconnect: " << error.what() << std::endl;
+			gaveUp=!scheduleReconnect();
+		}
+	}
+	if( gaveUp ) failBufferedMessages();
+}
+
+bool communique::ClientPrivateMembers::bufferIfReconnecting( BufferedMessage message )
+{
+	std::lock_guard<std::mutex> lock( bufferMutex_ );
+	// Check again now that the lock is held, in case the connection has just opened
+	if( !reconnecting_ || maximumBufferedMessages_==0 ) return false;
+	if( bufferedMessages_.size()>=maximumBufferedMessages_ ) throw communique::impl::Exception( "Too many messages waiting for the connection to be re-established" );
+	bufferedMessages_.push_back( std::move(message) );
+	return true;
+}
+
+bool communique::ClientPrivateMembers::bufferRequestIfReconnecting( std::function<void(communique::impl::Connection&,std::chrono::milliseconds)> send, std::function<void(communique::ResponseStatus)> fail, std::chrono::milliseconds timeout )
+{
+	// Shared between the buffer and the timeout, so that whichever gets to the request first completes it
+	struct BufferedRequest
+	{
+		std::atomic<bool> finished;
+		communique::impl::TimingWheel::TimerId timerId; ///< Zero if the request has no timeout
+		std::chrono::steady_clock::time_point deadline;
+	};
+	auto pRequest=std::make_shared<BufferedRequest>();
+	pRequest->finished=false;
+	pRequest->timerId=( timeout.count()>0 ? pTimingWheel_->newId() : 0 );
+	pRequest->deadline=std::chrono::steady_clock::now()+timeout;
+
+	// Start the timer before buffering, so that it's already running if the connection opens straight away.
+	// A request that times out stays in the buffer (and counts towards the maximum) until the buffer is sent
+	// or failed, but does nothing then.
+	if( pRequest->timerId!=0 )
+	{
+		pTimingWheel_->add( pRequest->timerId, timeout, [pRequest,fail]()
+			{
+				if( !pRequest->finished.exchange(true) ) fail( communique::ResponseStatus::TIMEDOUT );
+			} );
+	}
+
+	std::shared_ptr<communique::impl::TimingWheel> pTimingWheel=pTimingWheel_;
+	bool buffered=false;
+	try
+	{
+		buffered=bufferIfReconnecting( [pRequest,send,fail,pTimingWheel](communique::impl::Connection* pConnection) mutable
+			{
+				if( pRequest->finished.exchange(true) ) return; // Already timed out
+				if( pRequest->timerId!=0 ) pTimingWheel->cancel( pRequest->timerId );
+
+				if( !pConnection ) fail( communique::ResponseStatus::CONNECTIONCLOSED );
+				else if( pRequest->timerId==0 ) send( *pConnection, std::chrono::milliseconds(0) );
+				else
+				{
+					// The timer has just been cancelled, so round up so that the rest of the timeout is never zero, which means wait forever
+					const auto remaining=std::chrono::duration_cast<std::chrono::milliseconds>( pRequest->deadline-std::chrono::steady_clock::now() )+std::chrono::milliseconds(1);
+					if( remaining.count()>0 ) send( *pConnection, remaining );
+					else fail( communique::ResponseStatus::TIMEDOUT );
+				}
+			} );
+	}
+	catch(...)
+	{
+		if( pRequest->timerId!=0 ) pTimingWheel_->cancel( pRequest->timerId );
+		throw;
+	}
+	if( !buffered && pRequest->timerId!=0 ) pTimingWheel_->cancel( pRequest->timerId );
+	return buffered;
+}
+
+void communique::ClientPrivateMembers::sendBufferedMessages( communique::impl::Connection& connection )
+{
+	// Keep the lock while sending so that nothing sent by other threads in the meantime can overtake these
+	std::lock_guard<std::mutex> lock( bufferMutex_ );
+	reconnecting_=false;
+	for( auto& message : bufferedMessages_ )
+	{
+		try
+		{
+			message( &connection );
+		}
+		catch( const std::exception& error )
+		{
+			std::cerr << "communique::Client - unable to send a buffered message: " << error.what() << std::endl;
+		}
+	}
+	bufferedMessages_.clear();
+}
+
+void communique::ClientPrivateMembers::failBufferedMessages()
+{
+	std::deque<BufferedMessage> bufferedMessages;
+	{ // Block to limit lifetime of the lock_guard
+		std::lock_guard<std::mutex> lock( bufferMutex_ );
+		bufferedMessages.swap( bufferedMessages_ );
+	}
+	// Handlers could do anything, so don't call them with the lock held
+	for( auto& message : bufferedMessages ) message( nullptr );
+}
+
+communique::ClientPrivateMembers::timer_ptr communique::ClientPrivateMembers::stopReconnecting()
+{
+	std::lock_guard<std::mutex> lock( reconnectMutex_ );
+	userDisconnected_=true;
+	reconnecting_=false;
+	timer_ptr pReconnectTimer;
+	pReconnectTimer.swap( pReconnectTimer_ );
+	return pReconnectTimer;
 }
@@ -0,0 +1,393 @@
+#include "communique/ClientPool.h"
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <algorithm>
+#include <iostream>
+#include "communique/Client.h"
+#include "communique/EventLoop.h"
+#include "communique/impl/Exceptions.h"
+#include "communique/impl/StatsCounters.h"
+
+//
+// Declaration of the pimple
+//
+namespace communique
+{
+	class ClientPoolPrivateMembers
+	{
+	public:
+		ClientPoolPrivateMembers( size_t numberOfConnections, std::function<void(communique::Client&)> configureClient, std::shared_ptr<communique::EventLoop> pEventLoop );
+		std::shared_ptr<communique::EventLoop> pEventLoop_;
+		const size_t numberOfConnections_;
+		const std::function<void(communique::Client&)> configureClient_;
+		std::atomic<communique::ClientPool::Balancing> balancing_;
+		std::atomic<size_t> nextMember_; ///< Where the search for a connection starts, so that ties are spread evenly
+
+		typedef std::vector< std::shared_ptr<communique::Client> > MemberList;
+		/// Never modified once published, so that sending only has to std::atomic_load the pointer. Changes are
+		/// made by storing a new list with std::atomic_store, with mutex_ held so that two changes can't interleave.
+		std::shared_ptr<const MemberList> pMembers_;
+
+		mutable std::mutex mutex_; ///< Guards everything below, apart from the thread
+		communique::Stats previousMembers_; ///< The counts from members that have been replaced or disconnected
+		std::string URI_; ///< Empty if not connected, which also stops the members being replaced
+		std::chrono::milliseconds reconnectInterval_;
+		bool stopping_;
+		std::condition_variable wakeMonitor_; ///< Signalled when the reconnect interval changes or the pool is destroyed
+		std::function<void(const communique::MessageView&,std::weak_ptr<communique::IConnection>)> infoHandler_;
+		std::function<std::string(const communique::MessageView&,std::weak_ptr<communique::IConnection>)> requestHandler_;
+		std::thread monitorThread_;
+
+		/// Create and configure a Client, but don't connect it
+		std::shared_ptr<communique::Client> newMember();
+		/// Picks the connection to send the next message on, or throws if none are open
+		std::shared_ptr<communique::Client> chooseMember();
+		/// Checks the members every reconnectInterval_ and replaces any that have closed
+		void monitorLoop();
+	};
+}
+
+communique::ClientPool::ClientPool( size_t numberOfConnections, std::function<void(communique::Client&)> configureClient, std::shared_ptr<communique::EventLoop> pEventLoop )
+	: pImple_( new ClientPoolPrivateMembers( numberOfConnections>0 ? numberOfConnections : 1, std::move(configureClient), std::move(pEventLoop) ) )
+{
+	pImple_->monitorThread_=std::thread( &ClientPoolPrivateMembers::monitorLoop, pImple_.get() );
+}
+
+communique::ClientPool::~ClientPool()
+{
+	try
+	{
+		{ // Block to limit lifetime of the lock
+			std::lock_guard<std::mutex> lock( pImple_->mutex_ );
+			pImple_->stopping_=true;
+		}
+		pImple_->wakeMonitor_.notify_all();
+		if( pImple_->monitorThread_.joinable() ) pImple_->monitorThread_.join();
+		disconnect();
+	}
+	catch(...) { /* Make sure no exceptions propagate out */ }
+}
+
+void communique::ClientPool::connect( const std::string& URI )
+{
+	disconnect(); // In case already connected somewhere
+
+	auto pMembers=std::make_shared<ClientPoolPrivateMembers::MemberList>();
+	for( size_t index=0; index<pImple_->numberOfConnections_; ++index )
+	{
+		pMembers->push_back( pImple_->newMember() );
+		pMembers->back()->connect( URI );
+	}
+
+	std::lock_guard<std::mutex> lock( pImple_->mutex_ );
+	std::atomic_store( &pImple_->pMembers_, std::shared_ptr<const ClientPoolPrivateMembers::MemberList>( std::move(pMembers) ) );
+	pImple_->URI_=URI;
+}
+
+bool communique::ClientPool::waitConnected( std::chrono::milliseconds timeout )
+{
+	const auto deadline=std::chrono::steady_clock::now()+timeout;
+	const auto pMembers=std::atomic_load( &pImple_->pMembers_ );
+	if( !pMembers || pMembers->empty() ) return false;
+
+	bool allConnected=true;
+	for( auto& pMember : *pMembers )
+	{
+		const auto remainingTime=std::max( std::chrono::duration_cast<std::chrono::milliseconds>( deadline-std::chrono::steady_clock::now() ), std::chrono::milliseconds(0) );
+		if( !pMember->waitConnected( remainingTime ) ) allConnected=false;
+	}
+	return allConnected;
+}
+
+void communique::ClientPool::disconnect()
+{
+	std::shared_ptr<const ClientPoolPrivateMembers::MemberList> pMembers;
+	{ // Block to limit lifetime of the lock
+		std::lock_guard<std::mutex> lock( pImple_->mutex_ );
+		pImple_->URI_.clear();
+		pMembers=std::atomic_exchange( &pImple_->pMembers_, std::shared_ptr<const ClientPoolPrivateMembers::MemberList>() );
+	}
+	if( !pMembers || pMembers->empty() ) return;
+
+	communique::Stats memberStats;
+	for( auto& pMember : *pMembers )
+	{
+		pMember->disconnect();
+		memberStats+=communique::impl::StatsCounters::countsOnly( pMember->stats() );
+	}
+	std::lock_guard<std::mutex> lock( pImple_->mutex_ );
+	pImple_->previousMembers_+=memberStats;
+}
+
+size_t communique::ClientPool::size() const
+{
+	return pImple_->numberOfConnections_;
+}
+
+size_t communique::ClientPool::numberConnected() const
+{
+	const auto pMembers=std::atomic_load( &pImple_->pMembers_ );
+	if( !pMembers ) return 0;
+
+	size_t returnValue=0;
+	for( auto& pMember : *pMembers )
+	{
+		if( pMember->waitConnected( std::chrono::milliseconds(0) ) ) ++returnValue;
+	}
+	return returnValue;
+}
+
+communique::Stats communique::ClientPool::stats() const
+{
+	std::shared_ptr<const ClientPoolPrivateMembers::MemberList> pMembers;
+	communique::Stats result;
+	{ // Block to limit lifetime of the lock
+		// Take the list with the lock held, so that a member being replaced isn't counted twice or not at all
+		std::lock_guard<std::mutex> lock( pImple_->mutex_ );
+		pMembers=std::atomic_load( &pImple_->pMembers_ );
+		result=pImple_->previousMembers_;
+	}
+	if( pMembers )
+	{
+		for( auto& pMember : *pMembers ) result+=pMember->stats();
+	}
+	return result;
+}
+
+void communique::ClientPool::setBalancing( Balancing balancing )
+{
+	pImple_->balancing_=balancing;
+}
+
+void communique::ClientPool::setReconnectInterval( std::chrono::milliseconds interval )
+{
+	{ // Block to limit lifetime of the lock
+		std::lock_guard<std::mutex> lock( pImple_->mutex_ );
+		pImple_->reconnectInterval_=interval;
+	}
+	pImple_->wakeMonitor_.notify_all();
+}
+
+void communique::ClientPool::sendRequest( const std::string& message, std::function<void(const std::string&)> responseHandler )
+{
+	pImple_->chooseMember()->sendRequest( message, responseHandler );
+}
+
+void communique::ClientPool::sendRequest( const std::string& message, std::function<void(const std::string&,communique::ResponseStatus)> responseHandler, std::chrono::milliseconds timeout )
+{
+	pImple_->chooseMember()->sendRequest( message, responseHandler, timeout );
+}
+
+void communique::ClientPool::sendRequest( const std::string& message, std::function<void(const communique::MessageView&,communique::ResponseStatus)> responseHandler, std::chrono::milliseconds timeout )
+{
+	pImple_->chooseMember()->sendRequest( message, responseHandler, timeout );
+}
+
+std::future<std::string> communique::ClientPool::sendRequest( const std::string& message, std::chrono::milliseconds timeout )
+{
+	return pImple_->chooseMember()->sendRequest( message, timeout );
+}
+
+void communique::ClientPool::sendRequest( std::string&& message, std::function<void(const std::string&)> responseHandler )
+{
+	pImple_->chooseMember()->sendRequest( std::move(message), responseHandler );
+}
+
+void communique::ClientPool::sendRequest( std::string&& message, std::function<void(const std::string&,communique::ResponseStatus)> responseHandler, std::chrono::milliseconds timeout )
+{
+	pImple_->chooseMember()->sendRequest( std::move(message), responseHandler, timeout );
+}
+
+void communique::ClientPool::sendRequest( std::string&& message, std::function<void(const communique::MessageView&,communique::ResponseStatus)> responseHandler, std::chrono::milliseconds timeout )
+{
+	pImple_->chooseMember()->sendRequest( std::move(message), responseHandler, timeout );
+}
+
+std::future<std::string> communique::ClientPool::sendRequest( std::string&& message, std::chrono::milliseconds timeout )
+{
+	return pImple_->chooseMember()->sendRequest( std::move(message), timeout );
+}
+
+void communique::ClientPool::sendRequest( communique::MessageBuffer&& message, std::function<void(const communique::MessageView&,communique::ResponseStatus)> responseHandler, std::chrono::milliseconds timeout )
+{
+	pImple_->chooseMember()->sendRequest( std::move(message), responseHandler, timeout );
+}
+
+std::future<std::string> communique::ClientPool::sendRequest( communique::MessageBuffer&& message, std::chrono::milliseconds timeout )
+{
+	return pImple_->chooseMember()->sendRequest( std::move(message), timeout );
+}
+
+void communique::ClientPool::sendInfo( const std::string& message )
+{
+	pImple_->chooseMember()->sendInfo( message );
+}
+
+void communique::ClientPool::sendInfo( std::string&& message )
+{
+	pImple_->chooseMember()->sendInfo( std::move(message) );
+}
+
+void communique::ClientPool::sendInfo( communique::MessageBuffer&& message )
+{
+	pImple_->chooseMember()->sendInfo( std::move(message) );
+}
+
+void communique::ClientPool::setInfoHandler( std::function<void(const std::string&)> infoHandler )
+{
+	// Wrap in a function that copies the message and drops the connection argument
+	if( infoHandler ) setInfoHandler( [infoHandler](const communique::MessageView& message,std::weak_ptr<communique::IConnection>){ infoHandler( message.str() ); } );
+	else setInfoHandler( std::function<void(const communique::MessageView&,std::weak_ptr<communique::IConnection>)>() );
+}
+
+void communique::ClientPool::setInfoHandler( std::function<void(const std::string&,std::weak_ptr<communique::IConnection>)> infoHandler )
+{
+	// Wrap in a function that copies the message
+	if( infoHandler ) setInfoHandler( [infoHandler](const communique::MessageView& message,std::weak_ptr<communique::IConnection> pConnection){ infoHandler( message.str(), pConnection ); } );
+	else setInfoHandler( std::function<void(const communique::MessageView&,std::weak_ptr<communique::IConnection>)>() );
+}
+
+void communique::ClientPool::setInfoHandler( std::function<void(const communique::MessageView&,std::weak_ptr<communique::IConnection>)> infoHandler )
+{
+	std::lock_guard<std::mutex> lock( pImple_->mutex_ );
+	pImple_->infoHandler_=infoHandler;
+	const auto pMembers=std::atomic_load( &pImple_->pMembers_ );
+	if( pMembers )
+	{
+		for( auto& pMember : *pMembers ) pMember->setInfoHandler( pImple_->infoHandler_ );
+	}
+}
+
+void communique::ClientPool::setRequestHandler( std::function<std::string(const std::string&)> requestHandler )
+{
+	// Wrap in a function that copies the message and drops the connection argument
+	if( requestHandler ) setRequestHandler( [requestHandler](const communique::MessageView& message,std::weak_ptr<communique::IConnection>){ return requestHandler( message.str() ); } );
+	else setRequestHandler( std::function<std::string(const communique::MessageView&,std::weak_ptr<communique::IConnection>)>() );
+}
+
+void communique::ClientPool::setRequestHandler( std::function<std::string(const std::string&,std::weak_ptr<communique::IConnection>)> requestHandler )
+{
+	// Wrap in a function that copies the message
+	if( requestHandler ) setRequestHandler( [requestHandler](const communique::MessageView& message,std::weak_ptr<communique::IConnection> pConnection){ return requestHandler( message.str(), pConnection ); } );
+	else setRequestHandler( std::function<std::string(const communique::MessageView&,std::weak_ptr<communique::IConnection>)>() );
+}
+
+void communique::ClientPool::setRequestHandler( std::function<std::string(const communique::MessageView&,std::weak_ptr<communique::IConnection>)> requestHandler )
+{
+	std::lock_guard<std::mutex> lock( pImple_->mutex_ );
+	pImple_->requestHandler_=requestHandler;
+	const auto pMembers=std::atomic_load( &pImple_->pMembers_ );
+	if( pMembers )
+	{
+		for( auto& pMember : *pMembers ) pMember->setRequestHandler( pImple_->requestHandler_ );
+	}
+}
+
+communique::ClientPoolPrivateMembers::ClientPoolPrivateMembers( size_t numberOfConnections, std::function<void(communique::Client&)> configureClient, std::shared_ptr<communique::EventLoop> pEventLoop )
+	: pEventLoop_( pEventLoop ? std::move(pEventLoop) : std::make_shared<communique::EventLoop>(numberOfConnections) ),
+	  numberOfConnections_(numberOfConnections),
+	  configureClient_( std::move(configureClient) ),
+	  balancing_( communique::ClientPool::Balancing::ROUNDROBIN ),
+	  nextMember_(0),
+	  reconnectInterval_( std::chrono::seconds(1) ),
+	  stopping_(false)
+{
+	// No operation besides the initialiser list
+}
+
+std::shared_ptr<communique::Client> communique::ClientPoolPrivateMembers::newMember()
+{
+	auto pNewMember=std::make_shared<communique::Client>( pEventLoop_ );
+	if( configureClient_ ) configureClient_( *pNewMember );
+
+	std::lock_guard<std::mutex> lock( mutex_ );
+	if( infoHandler_ ) pNewMember->setInfoHandler( infoHandler_ );
+	if( requestHandler_ ) pNewMember->setRequestHandler( requestHandler_ );
+	return pNewMember;
+}
+
+std::shared_ptr<communique::Client> communique::ClientPoolPrivateMembers::chooseMember()
+{
+	// No lock and no copy, since a published list is never modified
+	const auto pMembers=std::atomic_load( &pMembers_ );
+	if( !pMembers || pMembers->empty() ) throw communique::impl::Exception( "No connection" );
+	const MemberList& members=*pMembers;
+
+	// Start at a different member each time, so that round robin works and ties are spread evenly
+	const size_t start=nextMember_++;
+	std::shared_ptr<communique::Client> pBestMember;
+	size_t bestOutstanding=0;
+	for( size_t offset=0; offset<members.size(); ++offset )
+	{
+		auto& pMember=members[(start+offset)%members.size()];
+		if( !pMember->waitConnected( std::chrono::milliseconds(0) ) ) continue;
+		if( balancing_==communique::ClientPool::Balancing::ROUNDROBIN ) return pMember;
+
+		const size_t outstanding=pMember->requestsOutstanding();
+		if( !pBestMember || outstanding<bestOutstanding )
+		{
+			pBestMember=pMember;
+			bestOutstanding=outstanding;
+		}
+	}
+	if( !pBestMember ) throw communique::impl::Exception( "No connection in the pool is open" );
+	return pBestMember;
+}
+
+void communique::ClientPoolPrivateMembers::monitorLoop()
+{
+	std::unique_lock<std::mutex> lock( mutex_ );
+	while( !stopping_ )
+	{
+		wakeMonitor_.wait_for( lock, reconnectInterval_ );
+		auto pMembers=std::atomic_load( &pMembers_ );
+		if( stopping_ || URI_.empty() || !pMembers ) continue;
+
+		const std::string URI=URI_;
+		lock.unlock();
+		const MemberList& members=*pMembers;
+
+		// Connect the replacements without the lock, since it's needed to send
+		std::vector< std::pair<size_t,std::shared_ptr<communique::Client>> > replacements;
+		for( size_t index=0; index<members.size(); ++index )
+		{
+			if( !members[index]->isDisconnected() ) continue;
+			try
+			{
+				auto pReplacement=newMember();
+				pReplacement->connect( URI );
+				replacements.emplace_back( index, std::move(pReplacement) );
+			}
+			catch( const std::exception& error )
+			{
+				std::cerr << "communique::ClientPool - couldn't replace a closed connection: " << error.what() << std::endl;
+			}
+		}
+
+		std::vector< std::shared_ptr<communique::Client> > oldMembers;
+		lock.lock();
+		// Only swap in if nothing has changed in the meantime, e.g. disconnect or connect to a new URI
+		if( URI_==URI && std::atomic_load( &pMembers_ )==pMembers && !replacements.empty() )
+		{
+			auto pNewMembers=std::make_shared<MemberList>( members );
+			for( auto& indexReplacementPair : replacements )
+			{
+				const size_t index=indexReplacementPair.first;
+				previousMembers_+=communique::impl::StatsCounters::countsOnly( members[index]->stats() );
+				oldMembers.push_back( members[index] );
+				(*pNewMembers)[index]=std::move(indexReplacementPair.second);
+			}
+			std::atomic_store( &pMembers_, std::shared_ptr<const MemberList>( std::move(pNewMembers) ) );
+		}
+		// Clients disconnect on destruction, so don't do that with the lock held
+		lock.unlock();
+		oldMembers.clear();
+		replacements.clear();
+		pMembers.reset();
+		lock.lock();
+	}
+}
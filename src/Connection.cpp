@@ -1,83 +1,245 @@
 #include <communique/impl/Connection.h>
 #include <future>
 #include "communique/impl/Message.h"
+#include "communique/Exceptions.h"
 
-communique::impl::Connection::Connection( connection_ptr pConnection )
-	: pConnection_(pConnection)
+communique::impl::Connection::Connection()
+	: defaultRequestTimeout_( std::chrono::milliseconds(0) ), acceptingRequests_(true), requestsInProgress_(0), requestsOutstanding_(0)
 {
-	pConnection_->set_message_handler( std::bind( &communique::impl::Connection::on_message, this, std::placeholders::_1, std::placeholders::_2 ) );
-//	pConnection_->set_open_handler( std::bind( &communique::impl::Connection::on_open, this, std::placeholders::_1 ) );
-//	pConnection_->set_close_handler( std::bind( &communique::impl::Connection::on_close, this, std::placeholders::_1 ) );
-//	pConnection_->set_interrupt_handler( std::bind( &communique::impl::Connection::on_interrupt, this, std::placeholders::_1 ) );
+	// No operation besides the initialiser list
 }
 
-communique::impl::Connection::Connection( connection_ptr pConnection, std::function<void(const std::string&)>& infoHandler, std::function<std::string(const std::string&)>& requestHandler )
-	: pConnection_(pConnection)
+communique::impl::Connection::~Connection()
 {
-	pConnection_->set_message_handler( std::bind( &communique::impl::Connection::on_message, this, std::placeholders::_1, std::placeholders::_2 ) );
-//	pConnection_->set_open_handler( std::bind( &communique::impl::Connection::on_open, this, std::placeholders::_1 ) );
-//	pConnection_->set_close_handler( std::bind( &communique::impl::Connection::on_close, this, std::placeholders::_1 ) );
-//	pConnection_->set_interrupt_handler( std::bind( &communique::impl::Connection::on_interrupt, this, std::placeholders::_1 ) );
-	setInfoHandler( infoHandler );
-	setRequestHandler( requestHandler );
+
 }
 
-communique::impl::Connection::Connection( connection_ptr pConnection, std::function<void(const std::string&,std::weak_ptr<communique::IConnection>)>& infoHandler, std::function<std::string(const std::string&,std::weak_ptr<communique::IConnection>)>& requestHandler )
-	: pConnection_(pConnection)
+namespace
 {
-	pConnection_->set_message_handler( std::bind( &communique::impl::Connection::on_message, this, std::placeholders::_1, std::placeholders::_2 ) );
-	setInfoHandler( infoHandler );
-	setRequestHandler( requestHandler );
+	/** @brief Wraps a handler that only wants successful responses in the form stored internally.
+	 * Handlers without a status only ever get told about successful responses. */
+	std::function<void(const communique::MessageView&,communique::ResponseStatus)> wrapHandler( std::function<void(const std::string&)> responseHandler )
+	{
+		return [responseHandler](const communique::MessageView& response,communique::ResponseStatus status)
+			{
+				if( status==communique::ResponseStatus::OK ) responseHandler( response.str() );
+			};
+	}
+
+	/** @brief Wraps a handler in a function that copies the response into a string. */
+	std::function<void(const communique::MessageView&,communique::ResponseStatus)> wrapHandler( std::function<void(const std::string&,communique::ResponseStatus)> responseHandler )
+	{
+		return [responseHandler](const communique::MessageView& response,communique::ResponseStatus status){ responseHandler( response.str(), status ); };
+	}
 }
 
-communique::impl::Connection::~Connection()
+std::function<void(const communique::MessageView&,communique::ResponseStatus)> communique::impl::Connection::promiseHandler( std::shared_ptr< std::promise<std::string> > pPromise )
+{
+	return [pPromise](const communique::MessageView& response,communique::ResponseStatus status)
+		{
+			if( status==communique::ResponseStatus::OK ) pPromise->set_value( response.str() );
+			else if( status==communique::ResponseStatus::REQUESTERROR ) pPromise->set_exception( std::make_exception_ptr( communique::RequestFailed( status, response.str() ) ) );
+			else if( status==communique::ResponseStatus::TIMEDOUT ) pPromise->set_exception( std::make_exception_ptr( communique::RequestFailed( status, "Request timed out" ) ) );
+			else pPromise->set_exception( std::make_exception_ptr( communique::RequestFailed( status, "Connection closed before the response arrived" ) ) );
+		};
+}
+
+template<class T_String>
+void communique::impl::Connection::sendRequestMessage( T_String&& message, PendingRequest&& pendingRequest, std::chrono::milliseconds timeout )
 {
+	communique::impl::TimingWheel::TimerId timerId;
+	communique::impl::Message::UserReference userReference=registerRequest( std::move(pendingRequest), timeout, timerId );
+	communique::impl::Message newMessage( std::forward<T_String>(message), communique::impl::Message::REQUEST, userReference );
+	if( sendMessage( newMessage.websocketppMessage() ) ) return;
 
+	// The connection is closed or closing, so failPendingRequests may already have run and nothing else is
+	// going to complete the handler. If it hasn't run yet, whichever gets to the request first completes it.
+	// Check the timer ID in case the token has been reused since, although a reused token can only belong
+	// to another request on this connection that can't be sent either.
+	PendingRequest failedRequest;
+	if( responseHandlers_.popIf( userReference, failedRequest, [timerId](const PendingRequest& request){ return request.timerId==timerId; } ) )
+	{
+		--requestsOutstanding_;
+		if( timerId!=0 ) std::atomic_load( &pTimingWheel_ )->cancel( timerId );
+		dispatchResponse( failedRequest, communique::MessageView(), communique::ResponseStatus::CONNECTIONCLOSED );
+	}
 }
 
 void communique::impl::Connection::sendRequest( const std::string& message, std::function<void(const std::string&)> responseHandler )
 {
+	sendRequestMessage( message, PendingRequest{ wrapHandler(responseHandler), 0, false }, defaultRequestTimeout_ );
+}
+
+void communique::impl::Connection::sendRequest( const std::string& message, std::function<void(const std::string&,communique::ResponseStatus)> responseHandler, std::chrono::milliseconds timeout )
+{
+	sendRequestMessage( message, PendingRequest{ wrapHandler(responseHandler), 0, false }, timeout );
+}
+
+void communique::impl::Connection::sendRequest( const std::string& message, std::function<void(const communique::MessageView&,communique::ResponseStatus)> responseHandler, std::chrono::milliseconds timeout )
+{
+	sendRequestMessage( message, PendingRequest{ std::move(responseHandler), 0, false }, timeout );
+}
+
+std::future<std::string> communique::impl::Connection::sendRequest( const std::string& message, std::chrono::milliseconds timeout )
+{
+	// std::function has to be copyable, so the promise needs to be held by pointer
+	auto pPromise=std::make_shared< std::promise<std::string> >();
+	std::future<std::string> result=pPromise->get_future();
+	// Completing a promise is cheap, so there's no point handing it off to another thread
+	sendRequestMessage( message, PendingRequest{ promiseHandler(pPromise), 0, true }, timeout );
+	return result;
+}
+
+void communique::impl::Connection::sendRequest( std::string&& message, std::function<void(const std::string&)> responseHandler )
+{
+	sendRequestMessage( std::move(message), PendingRequest{ wrapHandler(responseHandler), 0, false }, defaultRequestTimeout_ );
+}
+
+void communique::impl::Connection::sendRequest( std::string&& message, std::function<void(const std::string&,communique::ResponseStatus)> responseHandler, std::chrono::milliseconds timeout )
+{
+	sendRequestMessage( std::move(message), PendingRequest{ wrapHandler(responseHandler), 0, false }, timeout );
+}
+
+void communique::impl::Connection::sendRequest( std::string&& message, std::function<void(const communique::MessageView&,communique::ResponseStatus)> responseHandler, std::chrono::milliseconds timeout )
+{
+	sendRequestMessage( std::move(message), PendingRequest{ std::move(responseHandler), 0, false }, timeout );
+}
+
+std::future<std::string> communique::impl::Connection::sendRequest( std::string&& message, std::chrono::milliseconds timeout )
+{
+	auto pPromise=std::make_shared< std::promise<std::string> >();
+	std::future<std::string> result=pPromise->get_future();
+	sendRequestMessage( std::move(message), PendingRequest{ promiseHandler(pPromise), 0, true }, timeout );
+	return result;
+}
+
+void communique::impl::Connection::sendRequest( communique::MessageBuffer&& message, std::function<void(const communique::MessageView&,communique::ResponseStatus)> responseHandler, std::chrono::milliseconds timeout )
+{
+	sendRequestMessage( std::move(message), PendingRequest{ std::move(responseHandler), 0, false }, timeout );
+}
+
+std::future<std::string> communique::impl::Connection::sendRequest( communique::MessageBuffer&& message, std::chrono::milliseconds timeout )
+{
+	auto pPromise=std::make_shared< std::promise<std::string> >();
+	std::future<std::string> result=pPromise->get_future();
+	sendRequestMessage( std::move(message), PendingRequest{ promiseHandler(pPromise), 0, true }, timeout );
+	return result;
+}
+
+communique::impl::Message::UserReference communique::impl::Connection::registerRequest( PendingRequest&& pendingRequest, std::chrono::milliseconds timeout, communique::impl::TimingWheel::TimerId& timerId )
+{
+	// Get the timer ID before storing the handler, so that it's stored along with the handler. That way the
+	// timeout can tell whether the token still refers to this request or has since been reused.
+	std::shared_ptr<communique::impl::TimingWheel> pTimingWheel=std::atomic_load( &pTimingWheel_ );
+	const bool useTimeout=( pTimingWheel && timeout.count()>0 );
+	pendingRequest.timerId=( useTimeout ? pTimingWheel->newId() : 0 );
+
 	// This call will give me a unique token that I can use to retrieve the handler
 	// later. I'll transmit this token to the other side of the connection so that
 	// they use it in the response. Once I get the response with the token in it
 	// I can use the token to retrieve the correct handler.
-	communique::impl::Message::UserReference userReference=responseHandlers_.push( responseHandler );
+	timerId=pendingRequest.timerId;
+	pendingRequest.sent=communique::impl::StatsCounters::startTimer();
+	// Count the request before storing it, so that a response arriving straight away can't take the count below zero
+	++requestsOutstanding_;
+	communique::impl::Message::UserReference userReference;
+	try
+	{
+		userReference=responseHandlers_.push( std::move(pendingRequest) );
+	}
+	catch(...)
+	{
+		--requestsOutstanding_;
+		throw;
+	}
 
-	communique::impl::Message newMessage( pConnection_, message, communique::impl::Message::REQUEST, userReference );
-	pConnection_->send( newMessage.websocketppMessage() );
+	if( useTimeout )
+	{
+		std::weak_ptr<Connection> pWeakThis=shared_from_this();
+		pTimingWheel->add( timerId, timeout, [pWeakThis,userReference,timerId]()
+			{
+				auto pThis=pWeakThis.lock();
+				if( pThis ) pThis->expireRequest( userReference, timerId );
+			} );
+	}
+
+	return userReference;
 }
 
 void communique::impl::Connection::sendInfo( const std::string& message )
 {
-	communique::impl::Message newMessage( pConnection_, message, communique::impl::Message::INFO, 0 );
-	pConnection_->send( newMessage.websocketppMessage() );
+	communique::impl::Message newMessage( message, communique::impl::Message::INFO, 0 );
+	sendMessage( newMessage.websocketppMessage() );
+}
+
+void communique::impl::Connection::sendInfo( std::string&& message )
+{
+	communique::impl::Message newMessage( std::move(message), communique::impl::Message::INFO, 0 );
+	sendMessage( newMessage.websocketppMessage() );
+}
+
+void communique::impl::Connection::sendInfo( communique::MessageBuffer&& message )
+{
+	communique::impl::Message newMessage( std::move(message), communique::impl::Message::INFO, 0 );
+	sendMessage( newMessage.websocketppMessage() );
 }
 
 void communique::impl::Connection::setInfoHandler( std::function<void(const std::string&)> infoHandler )
 {
-	// Wrap in a function that drops the connection argument
-	infoHandler_=std::bind( infoHandler, std::placeholders::_1 );;
+	// Wrap in a function that copies the message and drops the connection argument
+	if( infoHandler ) infoHandler_=[infoHandler](const communique::MessageView& message,std::weak_ptr<communique::IConnection>){ infoHandler( message.str() ); };
+	else infoHandler_=nullptr;
 }
 
 void communique::impl::Connection::setInfoHandler( std::function<void(const std::string&,std::weak_ptr<communique::IConnection>)> infoHandler )
+{
+	// Wrap in a function that copies the message
+	if( infoHandler ) infoHandler_=[infoHandler](const communique::MessageView& message,std::weak_ptr<communique::IConnection> pConnection){ infoHandler( message.str(), pConnection ); };
+	else infoHandler_=nullptr;
+}
+
+void communique::impl::Connection::setInfoHandler( std::function<void(const communique::MessageView&,std::weak_ptr<communique::IConnection>)> infoHandler )
 {
 	infoHandler_=infoHandler;
 }
 
 void communique::impl::Connection::setRequestHandler( std::function<std::string(const std::string&)> requestHandler )
 {
-	// Wrap in a function that drops the connection argument
-	requestHandler_=std::bind( requestHandler, std::placeholders::_1 );
+	// Wrap in a function that copies the message and drops the connection argument
+	if( requestHandler ) requestHandler_=[requestHandler](const communique::MessageView& message,std::weak_ptr<communique::IConnection>){ return requestHandler( message.str() ); };
+	else requestHandler_=nullptr;
 }
 
 void communique::impl::Connection::setRequestHandler( std::function<std::string(const std::string&,std::weak_ptr<communique::IConnection>)> requestHandler )
+{
+	// Wrap in a function that copies the message
+	if( requestHandler ) requestHandler_=[requestHandler](const communique::MessageView& message,std::weak_ptr<communique::IConnection> pConnection){ return requestHandler( message.str(), pConnection ); };
+	else requestHandler_=nullptr;
+}
+
+void communique::impl::Connection::setRequestHandler( std::function<std::string(const communique::MessageView&,std::weak_ptr<communique::IConnection>)> requestHandler )
 {
 	requestHandler_=requestHandler;
 }
 
-communique::impl::Connection::connection_ptr& communique::impl::Connection::underlyingPointer()
+void communique::impl::Connection::setExecutor( std::shared_ptr<communique::IExecutor> pExecutor )
+{
+	std::atomic_store( &pExecutor_, pExecutor );
+}
+
+void communique::impl::Connection::setResponseExecutor( std::shared_ptr<communique::IExecutor> pExecutor )
 {
-	return pConnection_;
+	std::atomic_store( &pResponseExecutor_, pExecutor );
+}
+
+void communique::impl::Connection::setTimingWheel( std::shared_ptr<communique::impl::TimingWheel> pTimingWheel )
+{
+	std::atomic_store( &pTimingWheel_, pTimingWheel );
+}
+
+void communique::impl::Connection::setDefaultRequestTimeout( std::chrono::milliseconds timeout )
+{
+	defaultRequestTimeout_=timeout;
 }
 
 bool communique::impl::Connection::isConnected()
@@ -87,12 +249,18 @@ bool communique::impl::Connection::isConnected()
 	// Not fussed if the connection is "closing" because I know it won't transition to state that
 	// would require returning true.
 	//
-	while( pConnection_->get_state()==websocketpp::session::state::connecting )
-	{
-		std::this_thread::sleep_for( std::chrono::milliseconds(50) );
-	}
+	std::unique_lock<std::mutex> lock( stateMutex_ );
+	stateChanged_.wait( lock, [this](){ return state()!=websocketpp::session::state::connecting; } );
 
-	return pConnection_->get_state()==websocketpp::session::state::open;
+	return state()==websocketpp::session::state::open;
+}
+
+bool communique::impl::Connection::waitConnected( std::chrono::milliseconds timeout )
+{
+	std::unique_lock<std::mutex> lock( stateMutex_ );
+	stateChanged_.wait_for( lock, timeout, [this](){ return state()!=websocketpp::session::state::connecting; } );
+
+	return state()==websocketpp::session::state::open;
 }
 
 bool communique::impl::Connection::isDisconnected()
@@ -102,12 +270,10 @@ bool communique::impl::Connection::isDisconnected()
 	// This isn't quite the same as "!isConnected()" because this method can be used to block
 	// while a client disconnects, whereas isConnected() only blocks while the client is connecting.
 	//
-	while( pConnection_->get_state()==websocketpp::session::state::closing )
-	{
-		std::this_thread::sleep_for( std::chrono::milliseconds(50) );
-	}
+	std::unique_lock<std::mutex> lock( stateMutex_ );
+	stateChanged_.wait( lock, [this](){ return state()!=websocketpp::session::state::closing; } );
 
-	return pConnection_->get_state()==websocketpp::session::state::closed;
+	return state()==websocketpp::session::state::closed;
 }
 
 void communique::impl::Connection::close()
@@ -116,39 +282,168 @@ void communique::impl::Connection::close()
 	// If the connection is open, tell it to close. If the connection is in the "connecting"
 	// state the isConnected call blocks until it changes to something else.
 	//
-	if( isConnected() )
+	if( isConnected() ) closeTransport();
+}
+
+void communique::impl::Connection::failPendingRequests()
+{
+	std::shared_ptr<communique::impl::TimingWheel> pTimingWheel=std::atomic_load( &pTimingWheel_ );
+	for( auto& pendingRequest : responseHandlers_.popAll() )
 	{
-		websocketpp::lib::error_code errorCode;
+		--requestsOutstanding_;
+		if( pendingRequest.timerId!=0 && pTimingWheel ) pTimingWheel->cancel( pendingRequest.timerId );
+		dispatchResponse( pendingRequest, communique::MessageView(), communique::ResponseStatus::CONNECTIONCLOSED );
+	}
+}
+
+void communique::impl::Connection::notifyStateChange()
+{
+	// Websocketpp changes the state before calling the handlers, so anything waiting will see the new
+	// state. Taking the lock makes sure nothing is between checking the state and starting to wait.
+	std::lock_guard<std::mutex> lock( stateMutex_ );
+	stateChanged_.notify_all();
+}
+
+void communique::impl::Connection::stopAcceptingRequests( std::function<void()> drainedHandler )
+{
+	if( drainedHandler ) std::atomic_store( &pDrainedHandler_, std::make_shared< std::function<void()> >( std::move(drainedHandler) ) );
+	acceptingRequests_=false;
+}
+
+void communique::impl::Connection::finishRequest()
+{
+	if( --requestsInProgress_!=0 ) return;
+	auto pDrainedHandler=std::atomic_load( &pDrainedHandler_ );
+	if( pDrainedHandler ) (*pDrainedHandler)();
+}
+
+size_t communique::impl::Connection::requestsInProgress() const
+{
+	return requestsInProgress_;
+}
 
-		pConnection_->close( websocketpp::close::status::normal, "Had enough. Bye.", errorCode );
+size_t communique::impl::Connection::requestsOutstanding() const
+{
+	return requestsOutstanding_;
+}
+
+void communique::impl::Connection::dispatchResponse( PendingRequest& pendingRequest, const communique::MessageView& message, communique::ResponseStatus status )
+{
+	// setResponseExecutor can be called from another thread at any time
+	std::shared_ptr<communique::IExecutor> pResponseExecutor=std::atomic_load( &pResponseExecutor_ );
+	if( pResponseExecutor && !pendingRequest.runInline )
+	{
+		try
+		{
+			auto handler=pendingRequest.handler;
+			pResponseExecutor->execute( [handler,message,status](){ handler( message, status ); } );
+			return;
+		}
+		catch( std::exception& error )
+		{
+			// The executor is probably shutting down. Better to run the handler here than not at all.
+			std::cerr << "communique::impl::Connection::dispatchResponse() - couldn't use the executor: " << error.what() << std::endl;
+		}
+	}
 
-		//if( errorCode ) pImple_->client_.get_elog().write( websocketpp::log::alevel::app, errorCode.message() );
-		if( errorCode ) std::cerr << "communique::impl::Connection::close() - " << errorCode.message() << std::endl;
+	try
+	{
+		pendingRequest.handler( message, status );
+	}
+	catch( std::exception& error )
+	{
+		std::cerr << "communique::impl::Connection::dispatchResponse() - handler threw: " << error.what() << std::endl;
+	}
+	catch(...)
+	{
+		std::cerr << "communique::impl::Connection::dispatchResponse() - handler threw an unknown exception" << std::endl;
 	}
 }
 
-void communique::impl::Connection::on_message( websocketpp::connection_hdl hdl, communique::impl::Connection::message_ptr msg )
+bool communique::impl::Connection::sessionResumed()
 {
-//	std::cout << "Received message '" << msg->get_payload() << "'" << std::flush;
-	communique::impl::Message receivedMessage( msg );
+	return false;
+}
+
+void communique::impl::Connection::setCloseTimeout( std::chrono::milliseconds timeout )
+{
+	// No operation by default
+}
+
+bool communique::impl::Connection::sendBroadcast( communique::impl::Message& message, const message_ptr& pServerFrame )
+{
+	if( !transmitBroadcast( message, pServerFrame ) ) return false;
+	statsCounters_.messageSent( message.fullMessage() );
+	return true;
+}
+
+bool communique::impl::Connection::transmitBroadcast( communique::impl::Message& message, const message_ptr& pServerFrame )
+{
+	return transmit( message.websocketppMessage() );
+}
+
+size_t communique::impl::Connection::sendQueueBytes() const
+{
+	return 0;
+}
+
+communique::Stats communique::impl::Connection::stats() const
+{
+	communique::Stats result;
+	statsCounters_.addTo( result );
+	// These cost nothing to keep, so they're there even if the counters are compiled out
+	result.requestsOutstanding=requestsOutstanding();
+	result.requestsInProgress=requestsInProgress();
+	result.sendQueueBytes=sendQueueBytes();
+	result.connections=( state()==websocketpp::session::state::open ? 1 : 0 );
+	return result;
+}
+
+bool communique::impl::Connection::sendMessage( const message_ptr& pMessage )
+{
+	if( !transmit( pMessage ) ) return false;
+	statsCounters_.messageSent( pMessage->get_payload() );
+	return true;
+}
+
+void communique::impl::Connection::receiveMessage( const message_ptr& pMessage )
+{
+//	std::cout << "Received message '" << pMessage->get_payload() << "'" << std::flush;
+	communique::impl::Message receivedMessage( pMessage );
 //	std::cout << " type=" << receivedMessage.type() << " userReference=" << receivedMessage.userReference() << std::endl;
+	statsCounters_.messageReceived( receivedMessage.type(), pMessage->get_payload().size() );
 
 	if( receivedMessage.type()==communique::impl::Message::INFO )
 	{
-		if( infoHandler_ ) infoHandler_( receivedMessage.messageBody(), shared_from_this() );
-		else std::cout << "Ignoring info message '" << receivedMessage.messageBody() << "'" << std::endl;
+		if( infoHandler_ )
+		{
+			const auto startTime=communique::impl::StatsCounters::startTimer();
+			infoHandler_( receivedMessage.messageBodyView(), shared_from_this() );
+			statsCounters_.infoHandled( startTime );
+		}
+		else std::cout << "Ignoring info message of " << receivedMessage.messageBodyView().size() << " bytes" << std::endl;
 	}
 	else if( receivedMessage.type()==communique::impl::Message::REQUEST )
 	{
-		if( requestHandler_ )
+		if( !acceptingRequests_ )
 		{
-			std::async( std::launch::async, [ this, receivedMessage ]() // Copy receivedMessage by value because internally it holds a shared_ptr to the message
+			communique::impl::Message newMessage( "Shutting down", communique::impl::Message::REQUESTERROR, receivedMessage.userReference() );
+			sendMessage( newMessage.websocketppMessage() );
+		}
+		else if( requestHandler_ )
+		{
+			// Take a shared_ptr to myself so that the connection stays alive until the task has
+			// finished. Copy receivedMessage by value because internally it holds a shared_ptr
+			// to the message.
+			auto pThis=shared_from_this();
+			std::function<void()> task=[ pThis, receivedMessage ]()
 			{
 				std::string handlerResponse;
 				communique::impl::Message::MessageType responseType=communique::impl::Message::RESPONSE;
+				const auto startTime=communique::impl::StatsCounters::startTimer();
 				try
 				{
-					handlerResponse=requestHandler_( receivedMessage.messageBody(), shared_from_this() );
+					handlerResponse=pThis->requestHandler_( receivedMessage.messageBodyView(), pThis );
 				}
 				catch( std::exception& error )
 				{
@@ -160,50 +455,87 @@ void communique::impl::Connection::on_message( websocketpp::connection_hdl hdl,
 					handlerResponse="Unknown exception";
 					responseType=communique::impl::Message::REQUESTERROR;
 				}
-				communique::impl::Message newMessage( pConnection_, handlerResponse, responseType, receivedMessage.userReference() );
+				pThis->statsCounters_.requestHandled( startTime );
+				communique::impl::Message newMessage( std::move(handlerResponse), responseType, receivedMessage.userReference() );
 				// Send the rest of the message with the header stripped off first, and use the
 				// return from the handler
-				pConnection_->send( newMessage.websocketppMessage() );
-			} );
+				pThis->sendMessage( newMessage.websocketppMessage() );
+				pThis->finishRequest();
+			};
+
+			// Hand the request off to the executor so that the IO thread can carry on reading
+			// other messages. If there isn't one the best I can do is run it here.
+			++requestsInProgress_;
+			// setExecutor can be called from another thread at any time
+			std::shared_ptr<communique::IExecutor> pExecutor=std::atomic_load( &pExecutor_ );
+			if( !pExecutor ) task();
+			else
+			{
+				// If the executor is full or shutting down the request still needs an answer. Throwing from
+				// here would go out through the transport and could take the IO thread with it.
+				bool rejected=false;
+				try
+				{
+					pExecutor->execute( std::move(task) );
+				}
+				catch( std::exception& error )
+				{
+					std::cerr << "communique::impl::Connection::receiveMessage() - executor rejected the request: " << error.what() << std::endl;
+					rejected=true;
+				}
+				catch(...)
+				{
+					std::cerr << "communique::impl::Connection::receiveMessage() - executor rejected the request" << std::endl;
+					rejected=true;
+				}
+				if( rejected )
+				{
+					finishRequest();
+					communique::impl::Message newMessage( "Executor rejected the request", communique::impl::Message::REQUESTERROR, receivedMessage.userReference() );
+					sendMessage( newMessage.websocketppMessage() );
+				}
+			}
 		}
 		else
 		{
-			std::cout << "Ignoring request message '" << receivedMessage.messageBody() << "'" << std::endl;
-			communique::impl::Message newMessage( pConnection_, "No request handler set", communique::impl::Message::REQUESTERROR, receivedMessage.userReference() );
-			pConnection_->send( newMessage.websocketppMessage() );
+			std::cout << "Ignoring request message of " << receivedMessage.messageBodyView().size() << " bytes" << std::endl;
+			communique::impl::Message newMessage( "No request handler set", communique::impl::Message::REQUESTERROR, receivedMessage.userReference() );
+			sendMessage( newMessage.websocketppMessage() );
 		}
 	}
-	else if( receivedMessage.type()==communique::impl::Message::RESPONSE )
+	else if( receivedMessage.type()==communique::impl::Message::RESPONSE || receivedMessage.type()==communique::impl::Message::REQUESTERROR )
 	{
 		// This will be the response to a request that I've sent out, so
 		// I need to search for the handler that was stored when the message
 		// was sent.
 
-		std::function<void(const std::string&)> responseHandler;
-		if( responseHandlers_.pop( receivedMessage.userReference(), responseHandler ) )
+		PendingRequest pendingRequest;
+		if( responseHandlers_.pop( receivedMessage.userReference(), pendingRequest ) )
 		{
-			std::async( std::launch::async, responseHandler, receivedMessage.messageBody() );
+			--requestsOutstanding_;
+			if( pendingRequest.timerId!=0 ) std::atomic_load( &pTimingWheel_ )->cancel( pendingRequest.timerId );
+			statsCounters_.responseReceived( pendingRequest.sent );
+			communique::ResponseStatus status=( receivedMessage.type()==communique::impl::Message::RESPONSE ? communique::ResponseStatus::OK : communique::ResponseStatus::REQUESTERROR );
+			dispatchResponse( pendingRequest, receivedMessage.messageBodyView(), status );
 		}
 		else // response handler was not found in the list for the userReference
 		{
 			// This should never happen for well behaved clients/servers. I guess an attacker
-			// could try crafting messages to force this.
-			std::cout << "Ignoring response message '" << receivedMessage.messageBody() << "' because no handler found" << std::endl;
+			// could try crafting messages to force this. It can also happen if the request
+			// has already timed out.
+			std::cout << "Ignoring response message of " << receivedMessage.messageBodyView().size() << " bytes because no handler found" << std::endl;
 		}
 	}
 }
 
-//void communique::impl::Connection::on_open( websocketpp::connection_hdl hdl )
-//{
-//
-//}
-//
-//void communique::impl::Connection::on_close( websocketpp::connection_hdl hdl )
-//{
-//
-//}
-//
-//void communique::impl::Connection::on_interrupt( websocketpp::connection_hdl hdl )
-//{
-//
-//}
+void communique::impl::Connection::expireRequest( communique::impl::Message::UserReference userReference, communique::impl::TimingWheel::TimerId timerId )
+{
+	// Only remove the handler if it's still the one for this timer. If the response arrived just before the
+	// timeout fired the token could have been reused for a different request since.
+	PendingRequest pendingRequest;
+	if( responseHandlers_.popIf( userReference, pendingRequest, [timerId](const PendingRequest& request){ return request.timerId==timerId; } ) )
+	{
+		--requestsOutstanding_;
+		dispatchResponse( pendingRequest, communique::MessageView(), communique::ResponseStatus::TIMEDOUT );
+	}
+}
@@ -0,0 +1,75 @@
+#include "communique/EventLoop.h"
+#include "communique/impl/EventLoopPrivateMembers.h"
+
+#include <iostream>
+#include "communique/ThreadPool.h"
+#include "communique/impl/TimingWheel.h"
+
+std::shared_ptr<communique::IExecutor> communique::EventLoopPrivateMembers::defaultExecutor()
+{
+	std::lock_guard<std::mutex> lock( sharedMutex_ );
+	if( !pDefaultExecutor_ ) pDefaultExecutor_=std::make_shared<communique::ThreadPool>();
+	return pDefaultExecutor_;
+}
+
+std::shared_ptr<communique::impl::TimingWheel> communique::EventLoopPrivateMembers::timingWheel()
+{
+	std::lock_guard<std::mutex> lock( sharedMutex_ );
+	if( !pTimingWheel_ ) pTimingWheel_=std::make_shared<communique::impl::TimingWheel>();
+	return pTimingWheel_;
+}
+
+communique::EventLoop::EventLoop( size_t numberOfThreads )
+	: pImple_( std::make_shared<EventLoopPrivateMembers>() )
+{
+	if( numberOfThreads==0 ) numberOfThreads=std::thread::hardware_concurrency();
+	if( numberOfThreads==0 ) numberOfThreads=1; // hardware_concurrency() is allowed to return zero if it doesn't know
+
+	for( size_t index=0; index<numberOfThreads; ++index )
+	{
+		// Each thread keeps the pimple alive, in case the EventLoop is destroyed on it (see the destructor)
+		std::shared_ptr<EventLoopPrivateMembers> pImple( pImple_ );
+		pImple_->threads_.emplace_back( [pImple]()
+			{
+				// Exceptions from handlers propagate out of run(). Don't let one take down the whole
+				// process, just carry on with the next handler.
+				while( true )
+				{
+					try
+					{
+						pImple->ioService_.run();
+						return;
+					}
+					catch( const std::exception& error )
+					{
+						std::cerr << "communique::EventLoop - exception from a handler: " << error.what() << std::endl;
+					}
+					catch(...)
+					{
+						std::cerr << "communique::EventLoop - unknown exception from a handler" << std::endl;
+					}
+				}
+			} );
+	}
+}
+
+communique::EventLoop::~EventLoop()
+{
+	// Nothing can still be using the loop because every Client and Server holds a shared_ptr to it. Anything
+	// left queued for a transport that outlived its Client or Server is released when ioService_ is destroyed.
+	pImple_->pWork_.reset();
+	pImple_->ioService_.stop();
+	for( auto& thread : pImple_->threads_ )
+	{
+		// The last shared_ptr can be released by a handler on one of the loop threads, which can't join itself.
+		// It finishes once the handler returns, because the loop has been stopped, and its copy of pImple_ is
+		// what finally deletes everything.
+		if( thread.get_id()==std::this_thread::get_id() ) thread.detach();
+		else if( thread.joinable() ) thread.join();
+	}
+}
+
+size_t communique::EventLoop::numberOfThreads() const
+{
+	return pImple_->threads_.size();
+}
@@ -14,3 +14,23 @@ const char* communique::impl::Exception::what() const noexcept
 {
 	return what_.c_str();
 }
+
+communique::RequestFailed::RequestFailed( communique::ResponseStatus status, const std::string& what ) : status_(status), what_(what)
+{
+
+}
+
+communique::RequestFailed::~RequestFailed()
+{
+
+}
+
+const char* communique::RequestFailed::what() const noexcept
+{
+	return what_.c_str();
+}
+
+communique::ResponseStatus communique::RequestFailed::status() const
+{
+	return status_;
+}
@@ -0,0 +1,91 @@
+#include "communique/impl/InProcessClientTransport.h"
+#include <stdexcept>
+#include "communique/impl/InProcessConnection.h"
+#include "communique/impl/InProcessServerTransport.h"
+
+communique::impl::InProcessClientTransport::InProcessClientTransport( websocketpp::lib::asio::io_service* pIoService )
+	: pOwnIoService_( pIoService ? nullptr : new websocketpp::lib::asio::io_service ),
+	  ioService_( pIoService ? *pIoService : *pOwnIoService_ ),
+	  accessLog_( websocketpp::log::channel_type_hint::access ),
+	  errorLog_( websocketpp::log::channel_type_hint::error )
+{
+	accessLog_.set_channels(websocketpp::log::alevel::none);
+	errorLog_.set_channels(websocketpp::log::elevel::none);
+}
+
+std::shared_ptr<communique::impl::Connection> communique::impl::InProcessClientTransport::createConnection( const std::string& URI )
+{
+	static const std::string scheme="inproc://";
+	if( URI.size()<=scheme.size() || URI.compare( 0, scheme.size(), scheme )!=0 )
+	{
+		throw std::runtime_error( "In process URIs have to be \""+scheme+"\" followed by the name the server is listening under, not \""+URI+"\"" );
+	}
+
+	{ // Block to limit lifetime of the lock_guard
+		std::lock_guard<std::mutex> lock( nameMutex_ );
+		name_=URI.substr( scheme.size() );
+	}
+	return std::make_shared<communique::impl::InProcessConnection>( ioService_ );
+}
+
+void communique::impl::InProcessClientTransport::connect( communique::impl::Connection& connection )
+{
+	auto pConnection=std::static_pointer_cast<communique::impl::InProcessConnection>( connection.shared_from_this() );
+	std::string name;
+	{ // Block to limit lifetime of the lock_guard
+		std::lock_guard<std::mutex> lock( nameMutex_ );
+		name=name_;
+	}
+
+	// Unlike the other transports there's nothing waiting on the io_service while the connection is open,
+	// so keep it running until the connection finishes. The callbacks share this, so that whichever runs
+	// last releases it. It's also released if the connection is destroyed without finishing.
+	auto pWork=std::make_shared< std::unique_ptr<websocketpp::lib::asio::io_service::work> >( new websocketpp::lib::asio::io_service::work(ioService_) );
+	// They also keep this alive for as long as the connection.
+	std::shared_ptr<communique::impl::ClientTransport> pThis=shared_from_this();
+	pConnection->onOpen=[pThis](){ if( pThis->onOpen ) pThis->onOpen(); };
+	pConnection->onClose=[pThis,pWork](){ if( pThis->onClose ) pThis->onClose(); pWork->reset(); };
+	pConnection->onFail=[pThis,pWork]( const std::string& reason ){ if( pThis->onFail ) pThis->onFail( reason ); pWork->reset(); };
+
+	if( !communique::impl::InProcessServerTransport::connect( name, pConnection ) ) pConnection->fail( "Nobody is listening on inproc://"+name );
+}
+
+void communique::impl::InProcessClientTransport::run()
+{
+	ioService_.run();
+}
+
+void communique::impl::InProcessClientTransport::reset()
+{
+	ioService_.reset();
+}
+
+websocketpp::lib::asio::io_service& communique::impl::InProcessClientTransport::ioService()
+{
+	return ioService_;
+}
+
+websocketpp::config::asio::alog_type& communique::impl::InProcessClientTransport::accessLog()
+{
+	return accessLog_;
+}
+
+void communique::impl::InProcessClientTransport::setErrorLogLocation( std::ostream& outputStream )
+{
+	errorLog_.set_ostream( &outputStream );
+}
+
+void communique::impl::InProcessClientTransport::setErrorLogLevel( uint32_t level )
+{
+	errorLog_.set_channels(level);
+}
+
+void communique::impl::InProcessClientTransport::setAccessLogLocation( std::ostream& outputStream )
+{
+	accessLog_.set_ostream( &outputStream );
+}
+
+void communique::impl::InProcessClientTransport::setAccessLogLevel( uint32_t level )
+{
+	accessLog_.set_channels(level);
+}
@@ -0,0 +1,89 @@
+#include "communique/impl/InProcessConnection.h"
+
+communique::impl::InProcessConnection::InProcessConnection( websocketpp::lib::asio::io_service& ioService )
+	: state_(websocketpp::session::state::connecting), strand_(ioService), failReason_("The other end closed before the connection opened")
+{
+	// No operation besides initialiser list
+}
+
+communique::impl::InProcessConnection::~InProcessConnection()
+{
+	// If this end has gone without closing, e.g. because its Server was destroyed, the other end still needs to know
+	auto pOtherEnd=pOtherEnd_.lock();
+	if( pOtherEnd ) pOtherEnd->finish();
+}
+
+void communique::impl::InProcessConnection::connect( const std::shared_ptr<InProcessConnection>& pClientEnd, const std::shared_ptr<InProcessConnection>& pServerEnd )
+{
+	pClientEnd->pOtherEnd_=pServerEnd;
+	pServerEnd->pOtherEnd_=pClientEnd;
+	pServerEnd->strand_.post( std::bind( &InProcessConnection::open, pServerEnd, pClientEnd ) );
+}
+
+void communique::impl::InProcessConnection::fail( const std::string& reason )
+{
+	failReason_=reason;
+	finish();
+}
+
+const void* communique::impl::InProcessConnection::key() const
+{
+	return this;
+}
+
+websocketpp::session::state::value communique::impl::InProcessConnection::state() const
+{
+	return state_;
+}
+
+bool communique::impl::InProcessConnection::transmit( const message_ptr& pMessage )
+{
+	if( state_!=websocketpp::session::state::open ) return false;
+	auto pOtherEnd=pOtherEnd_.lock();
+	if( !pOtherEnd ) return false;
+
+	// Posting to the other end's strand keeps the messages in the order they were sent
+	pOtherEnd->strand_.post( [pOtherEnd,pMessage](){ pOtherEnd->receiveMessage( pMessage ); } );
+	return true;
+}
+
+void communique::impl::InProcessConnection::closeTransport()
+{
+	// There's no handshake, both ends close straight away. Anything already sent is still delivered
+	// before the close callbacks, because they're queued behind it.
+	auto pOtherEnd=pOtherEnd_.lock();
+	if( pOtherEnd ) pOtherEnd->finish();
+	finish();
+}
+
+std::shared_ptr<communique::impl::InProcessConnection> communique::impl::InProcessConnection::self()
+{
+	return std::static_pointer_cast<InProcessConnection>( shared_from_this() );
+}
+
+void communique::impl::InProcessConnection::open( std::shared_ptr<InProcessConnection> pNext )
+{
+	websocketpp::session::state::value expected=websocketpp::session::state::connecting;
+	if( !state_.compare_exchange_strong( expected, websocketpp::session::state::open ) ) return; // Closed before it had chance to open
+
+	// Queue the next end opening before calling onOpen, so that it doesn't have to wait for it. Anything
+	// it sends goes on this end's strand, so can't be received until onOpen has finished anyway.
+	if( pNext ) pNext->strand_.post( std::bind( &InProcessConnection::open, pNext, std::shared_ptr<InProcessConnection>() ) );
+	if( onOpen ) onOpen();
+}
+
+void communique::impl::InProcessConnection::finish()
+{
+	const websocketpp::session::state::value previousState=state_.exchange( websocketpp::session::state::closed );
+	if( previousState==websocketpp::session::state::closed ) return;
+
+	auto pThis=self();
+	strand_.post( [pThis,previousState]()
+		{
+			if( previousState==websocketpp::session::state::connecting )
+			{
+				if( pThis->onFail ) pThis->onFail( pThis->failReason_ );
+			}
+			else if( pThis->onClose ) pThis->onClose();
+		} );
+}
@@ -0,0 +1,138 @@
+#include "communique/impl/InProcessServerTransport.h"
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include "communique/impl/InProcessConnection.h"
+
+namespace
+{
+	/** @brief The servers currently listening, by name. Has to be locked with registryMutex(). Weak, because a
+	 * server that is being destroyed is still in here until its destructor gets the lock. */
+	std::map< std::string,std::weak_ptr<communique::impl::InProcessServerTransport> >& registry()
+	{
+		static std::map< std::string,std::weak_ptr<communique::impl::InProcessServerTransport> > servers;
+		return servers;
+	}
+
+	std::mutex& registryMutex()
+	{
+		static std::mutex mutex;
+		return mutex;
+	}
+}
+
+communique::impl::InProcessServerTransport::InProcessServerTransport( websocketpp::lib::asio::io_service* pIoService )
+	: pOwnIoService_( pIoService ? nullptr : new websocketpp::lib::asio::io_service ),
+	  ioService_( pIoService ? *pIoService : *pOwnIoService_ ),
+	  accessLog_( websocketpp::log::channel_type_hint::access ),
+	  errorLog_( websocketpp::log::channel_type_hint::error )
+{
+	accessLog_.set_channels(websocketpp::log::alevel::none);
+	errorLog_.set_channels(websocketpp::log::elevel::none);
+}
+
+communique::impl::InProcessServerTransport::~InProcessServerTransport()
+{
+	stopListening();
+}
+
+bool communique::impl::InProcessServerTransport::connect( const std::string& name, const std::shared_ptr<communique::impl::InProcessConnection>& pClientEnd )
+{
+	// Declared before the lock so that it's released after it, since if this is the last reference the destructor needs the lock
+	std::shared_ptr<InProcessServerTransport> pServer;
+	// Keep the registry locked while accepting, so that the server can't stop listening part way through
+	std::lock_guard<std::mutex> lock( registryMutex() );
+	auto iFindResult=registry().find( name );
+	if( iFindResult==registry().end() ) return false;
+	pServer=iFindResult->second.lock();
+	if( !pServer ) return false;
+
+	pServer->accept( pClientEnd );
+	return true;
+}
+
+void communique::impl::InProcessServerTransport::listen( const std::string& name )
+{
+	if( name.empty() ) throw std::runtime_error( "Communique server listen error: the name to listen under can't be empty" );
+
+	std::lock_guard<std::mutex> lock( registryMutex() );
+	std::weak_ptr<InProcessServerTransport> pWeakThis=std::static_pointer_cast<InProcessServerTransport>( shared_from_this() );
+	if( !registry().insert( std::make_pair( name, pWeakThis ) ).second ) throw std::runtime_error( "Communique server listen error: another server is already listening under the name \""+name+"\"" );
+	name_=name;
+	pWork_.reset( new websocketpp::lib::asio::io_service::work(ioService_) );
+}
+
+bool communique::impl::InProcessServerTransport::isListening() const
+{
+	std::lock_guard<std::mutex> lock( registryMutex() );
+	return !name_.empty();
+}
+
+void communique::impl::InProcessServerTransport::stopListening()
+{
+	std::lock_guard<std::mutex> lock( registryMutex() );
+	if( !name_.empty() ) registry().erase( name_ );
+	name_.clear();
+	pWork_.reset();
+}
+
+void communique::impl::InProcessServerTransport::run()
+{
+	ioService_.run();
+}
+
+void communique::impl::InProcessServerTransport::stop()
+{
+	ioService_.stop();
+}
+
+void communique::impl::InProcessServerTransport::reset()
+{
+	ioService_.reset();
+}
+
+websocketpp::config::asio::alog_type& communique::impl::InProcessServerTransport::accessLog()
+{
+	return accessLog_;
+}
+
+void communique::impl::InProcessServerTransport::setErrorLogLocation( std::ostream& outputStream )
+{
+	errorLog_.set_ostream( &outputStream );
+}
+
+void communique::impl::InProcessServerTransport::setErrorLogLevel( uint32_t level )
+{
+	errorLog_.set_channels(level);
+}
+
+void communique::impl::InProcessServerTransport::setAccessLogLocation( std::ostream& outputStream )
+{
+	accessLog_.set_ostream( &outputStream );
+}
+
+void communique::impl::InProcessServerTransport::setAccessLogLevel( uint32_t level )
+{
+	accessLog_.set_channels(level);
+}
+
+void communique::impl::InProcessServerTransport::accept( const std::shared_ptr<communique::impl::InProcessConnection>& pClientEnd )
+{
+	auto pServerEnd=std::make_shared<communique::impl::InProcessConnection>( ioService_ );
+
+	// The callbacks can't hold a shared_ptr to the connection, because the connection owns them. They do
+	// hold one to this, so that this stays alive as long as the connection.
+	std::weak_ptr<communique::impl::InProcessConnection> pWeakServerEnd=pServerEnd;
+	const void* key=pServerEnd->key();
+	std::shared_ptr<communique::impl::ServerTransport> pThis=shared_from_this();
+	// Keep the io_service running until the connection closes, even if the server stops listening first
+	auto pWork=std::make_shared< std::unique_ptr<websocketpp::lib::asio::io_service::work> >( new websocketpp::lib::asio::io_service::work(ioService_) );
+	pServerEnd->onOpen=[pThis,pWeakServerEnd]()
+		{
+			auto pServerEnd=pWeakServerEnd.lock();
+			if( pServerEnd && pThis->onOpen ) pThis->onOpen( pServerEnd );
+		};
+	pServerEnd->onClose=[pThis,key,pWork](){ if( pThis->onClose ) pThis->onClose( key ); pWork->reset(); };
+
+	communique::impl::InProcessConnection::connect( pClientEnd, pServerEnd );
+}
@@ -1,4 +1,19 @@
 #include "communique/impl/Message.h"
+#include <cstring>
+#include <websocketpp/processors/hybi13.hpp>
+
+namespace
+{
+	typedef websocketpp::config::asio_tls::con_msg_manager_type msg_manager_type;
+
+	/** @brief Where new messages are allocated from. The manager doesn't keep any state, so messages don't
+	 * need to come from the connection they're sent on and one can be shared by everything. */
+	const msg_manager_type::ptr& messageManager()
+	{
+		static const msg_manager_type::ptr pManager=std::make_shared<msg_manager_type>();
+		return pManager;
+	}
+}
 
 communique::impl::Message::Message( message_ptr pMessage )
 	: pFullMessage_( pMessage )
@@ -6,8 +21,8 @@ communique::impl::Message::Message( message_ptr pMessage )
 	if( pMessage->get_payload().size()<5 ) throw std::runtime_error("Received a websocket message that is too small to be a Communique message");
 }
 
-communique::impl::Message::Message( connection_ptr pConnection, const std::string& messageBody, MessageType type, UserReference userReference )
-	: pFullMessage_( pConnection->get_message(websocketpp::frame::opcode::BINARY,messageBody.size()+sizeof(UserReference)+sizeof(char)) )
+communique::impl::Message::Message( const std::string& messageBody, MessageType type, UserReference userReference )
+	: pFullMessage_( messageManager()->get_message(websocketpp::frame::opcode::BINARY,messageBody.size()+sizeof(UserReference)+sizeof(char)) )
 {
 	// Write directly into the payload. It should be the correct size from the initialiser list
 	std::string& payload=pFullMessage_->get_raw_payload();
@@ -20,6 +35,34 @@ communique::impl::Message::Message( connection_ptr pConnection, const std::strin
 	payload.replace( 5, std::string::npos, messageBody ); // Then put the message in everything after that
 }
 
+communique::impl::Message::Message( std::string&& messageBody, MessageType type, UserReference userReference )
+	: pFullMessage_( messageManager()->get_message(websocketpp::frame::opcode::BINARY,0) )
+{
+	// Take over the caller's buffer, then put the header in front of the body. If the buffer has
+	// enough spare capacity the insert just shifts the body along rather than reallocating.
+	std::string& payload=pFullMessage_->get_raw_payload();
+	payload.swap( messageBody );
+
+	char header[sizeof(char)+sizeof(UserReference)];
+	UserReference userNetorder=htonl(userReference);
+	header[0]=static_cast<char>( type );
+	std::memcpy( &header[1], &userNetorder, sizeof(UserReference) );
+	payload.insert( 0, header, sizeof(header) );
+}
+
+communique::impl::Message::Message( communique::MessageBuffer&& messageBody, MessageType type, UserReference userReference )
+	: pFullMessage_( messageManager()->get_message(websocketpp::frame::opcode::BINARY,0) )
+{
+	static_assert( communique::MessageBuffer::HEADROOM==sizeof(char)+sizeof(UserReference), "MessageBuffer doesn't leave the right amount of room for the header" );
+	// The first HEADROOM bytes were left free for the header, so it can be written in place
+	std::string& payload=pFullMessage_->get_raw_payload();
+	payload=messageBody.release();
+
+	UserReference userNetorder=htonl(userReference);
+	payload[0]=static_cast<char>( type );
+	std::memcpy( &payload[1], &userNetorder, sizeof(UserReference) );
+}
+
 communique::impl::Message::~Message()
 {
 
@@ -40,6 +83,23 @@ std::string communique::impl::Message::messageBody() const
 	return pFullMessage_->get_payload().substr( 5 );
 }
 
+communique::MessageView communique::impl::Message::messageBodyView() const
+{
+	const std::string& payload=pFullMessage_->get_payload();
+	return communique::MessageView( pFullMessage_, payload.data()+5, payload.size()-5 );
+}
+
+communique::impl::Message::message_ptr communique::impl::Message::serverFrame() const
+{
+	// Framing for servers never uses the random number generator because there's no masking
+	websocketpp::config::asio_tls::rng_type unusedGenerator;
+	websocketpp::processor::hybi13<websocketpp::config::asio_tls> processor( true, true, messageManager(), unusedGenerator );
+
+	message_ptr pFramedMessage=messageManager()->get_message();
+	if( processor.prepare_data_frame( pFullMessage_, pFramedMessage ) ) return message_ptr();
+	return pFramedMessage;
+}
+
 const std::string& communique::impl::Message::fullMessage() const
 {
 	return pFullMessage_->get_payload();
@@ -49,3 +109,8 @@ communique::impl::Message::message_ptr communique::impl::Message::websocketppMes
 {
 	return pFullMessage_;
 }
+
+communique::impl::Message::message_ptr communique::impl::Message::newBuffer()
+{
+	return messageManager()->get_message( websocketpp::frame::opcode::BINARY, 0 );
+}
@@ -0,0 +1,126 @@
+#include "communique/impl/RawClientTransport.h"
+#include <stdexcept>
+#include "communique/impl/RawConnection.h"
+#include "communique/impl/TLSHandler.h"
+
+communique::impl::RawClientTransport::RawClientTransport( websocketpp::lib::asio::io_service* pIoService, bool useTLS )
+	: pOwnIoService_( pIoService ? nullptr : new websocketpp::lib::asio::io_service ),
+	  ioService_( pIoService ? *pIoService : *pOwnIoService_ ),
+	  useTLS_(useTLS),
+	  accessLog_( websocketpp::log::channel_type_hint::access ),
+	  errorLog_( websocketpp::log::channel_type_hint::error )
+{
+	accessLog_.set_channels(websocketpp::log::alevel::none);
+	errorLog_.set_channels(websocketpp::log::elevel::none);
+}
+
+std::shared_ptr<communique::impl::Connection> communique::impl::RawClientTransport::createConnection( const std::string& URI )
+{
+	const std::string scheme=( useTLS_ ? "tls://" : "tcp://" );
+	const std::string badURIMessage="Raw framing URIs have to be \""+scheme+"\" followed by the host and port, e.g. \""+scheme+"localhost:9000\", not \""+URI+"\"";
+	if( URI.size()<=scheme.size() || URI.compare( 0, scheme.size(), scheme )!=0 ) throw std::runtime_error( badURIMessage );
+
+	// Anything after the port is ignored, since there's nowhere to send it
+	std::string authority=URI.substr( scheme.size() );
+	authority=authority.substr( 0, authority.find('/') );
+	std::string host, port;
+	if( authority[0]=='[' )
+	{
+		const size_t closingBracket=authority.find(']');
+		if( closingBracket!=std::string::npos && closingBracket+1<authority.size() && authority[closingBracket+1]==':' )
+		{
+			host=authority.substr( 1, closingBracket-1 );
+			port=authority.substr( closingBracket+2 );
+		}
+	}
+	else
+	{
+		const size_t colon=authority.rfind(':');
+		if( colon!=std::string::npos )
+		{
+			host=authority.substr( 0, colon );
+			port=authority.substr( colon+1 );
+		}
+	}
+	if( host.empty() || port.empty() || port.find_first_not_of("0123456789")!=std::string::npos ) throw std::runtime_error( badURIMessage );
+
+	std::shared_ptr<websocketpp::lib::asio::ssl::context> pTLSContext;
+	if( useTLS_ )
+	{
+		if( !pTLSHandler_ ) throw std::runtime_error( "No TLS settings have been given to the transport" );
+		pTLSContext=pTLSHandler_->context();
+	}
+
+	{ // Block to limit lifetime of the lock_guard
+		std::lock_guard<std::mutex> lock( targetMutex_ );
+		host_=host;
+		port_=port;
+		URI_=URI;
+	}
+	return std::make_shared<communique::impl::RawConnection>( ioService_, pTLSContext, pTLSHandler_.get() );
+}
+
+void communique::impl::RawClientTransport::connect( communique::impl::Connection& connection )
+{
+	auto& rawConnection=static_cast<communique::impl::RawConnection&>(connection);
+	std::string host, port, URI;
+	{ // Block to limit lifetime of the lock_guard
+		std::lock_guard<std::mutex> lock( targetMutex_ );
+		host=host_;
+		port=port_;
+		URI=URI_;
+	}
+
+	// The connection never lets go of these, so this (and the TLSHandler it was given) stays alive as long as the connection
+	std::shared_ptr<communique::impl::ClientTransport> pThis=shared_from_this();
+	rawConnection.onOpen=[pThis](){ if( pThis->onOpen ) pThis->onOpen(); };
+	rawConnection.onClose=[pThis](){ if( pThis->onClose ) pThis->onClose(); };
+	rawConnection.onFail=[pThis]( const std::string& reason ){ if( pThis->onFail ) pThis->onFail( reason ); };
+	// Previous TLS sessions are looked up by URI, the same as for WebSocket
+	rawConnection.connect( host, port, URI );
+}
+
+void communique::impl::RawClientTransport::run()
+{
+	ioService_.run();
+}
+
+void communique::impl::RawClientTransport::reset()
+{
+	ioService_.reset();
+}
+
+websocketpp::lib::asio::io_service& communique::impl::RawClientTransport::ioService()
+{
+	return ioService_;
+}
+
+void communique::impl::RawClientTransport::setTLSHandler( std::shared_ptr<communique::impl::TLSHandler> pTLSHandler )
+{
+	pTLSHandler_=std::move(pTLSHandler);
+}
+
+websocketpp::config::asio::alog_type& communique::impl::RawClientTransport::accessLog()
+{
+	return accessLog_;
+}
+
+void communique::impl::RawClientTransport::setErrorLogLocation( std::ostream& outputStream )
+{
+	errorLog_.set_ostream( &outputStream );
+}
+
+void communique::impl::RawClientTransport::setErrorLogLevel( uint32_t level )
+{
+	errorLog_.set_channels(level);
+}
+
+void communique::impl::RawClientTransport::setAccessLogLocation( std::ostream& outputStream )
+{
+	accessLog_.set_ostream( &outputStream );
+}
+
+void communique::impl::RawClientTransport::setAccessLogLevel( uint32_t level )
+{
+	accessLog_.set_channels(level);
+}
@@ -0,0 +1,455 @@
+#include "communique/impl/RawConnection.h"
+#include <stdexcept>
+#include <iostream>
+#include <algorithm>
+#include <limits>
+#include <cstring>
+#include <arpa/inet.h>
+#include "communique/impl/TLSHandler.h"
+
+namespace
+{
+	/** @brief Sent by the client once connected, and echoed back by the server.
+	 * It ends with a blank line so that an HTTP server, e.g. a WebSocket one, sees a complete (if nonsensical)
+	 * request and answers with an error straight away rather than waiting for the rest of it. */
+	const char PREAMBLE[]="CMQRAW/1\r\n\r\n";
+	const size_t PREAMBLE_SIZE=sizeof(PREAMBLE)-1;
+	/// The Communique header that has to be at the start of every message, i.e. the type and user reference
+	const size_t COMMUNIQUE_HEADER_SIZE=5;
+	/// The most queued messages gathered into one write. Two buffers each keeps plain TCP to a single system call.
+	const size_t MAXIMUM_BATCH=32;
+}
+
+//
+// The streams have different types, so these pick whichever one is in use. Only used in this file.
+//
+template<class T_Buffers, class T_Handler>
+void communique::impl::RawConnection::asyncRead( const T_Buffers& buffers, T_Handler handler )
+{
+	if( pTLSStream_ ) websocketpp::lib::asio::async_read( *pTLSStream_, buffers, handler );
+	else websocketpp::lib::asio::async_read( *pSocket_, buffers, handler );
+}
+
+template<class T_Buffers, class T_Handler>
+void communique::impl::RawConnection::asyncReadSome( const T_Buffers& buffers, T_Handler handler )
+{
+	if( pTLSStream_ ) pTLSStream_->async_read_some( buffers, handler );
+	else pSocket_->async_read_some( buffers, handler );
+}
+
+template<class T_Buffers, class T_Handler>
+void communique::impl::RawConnection::asyncWrite( const T_Buffers& buffers, T_Handler handler )
+{
+	if( pTLSStream_ ) websocketpp::lib::asio::async_write( *pTLSStream_, buffers, handler );
+	else websocketpp::lib::asio::async_write( *pSocket_, buffers, handler );
+}
+
+communique::impl::RawConnection::RawConnection( websocketpp::lib::asio::io_service& ioService, std::shared_ptr<websocketpp::lib::asio::ssl::context> pTLSContext, communique::impl::TLSHandler* pTLSHandler )
+	: state_(websocketpp::session::state::connecting), pTLSContext_(pTLSContext), pTLSHandler_(pTLSHandler),
+	  pSocket_( pTLSContext ? nullptr : new socket_type(ioService) ),
+	  pTLSStream_( pTLSContext ? new tls_stream_type(ioService,*pTLSContext) : nullptr ),
+	  strand_(ioService), resolver_(ioService), closeTimeoutMilliseconds_(5000), closeTimer_(ioService),
+	  writing_(false), queuedBytes_(0), closeRequested_(false), lengthBytes_(0), incomingRemaining_(0)
+{
+	static_assert( sizeof(PREAMBLE)-1==std::tuple_size<decltype(preamble_)>::value, "The preamble buffer is the wrong size" );
+}
+
+communique::impl::RawConnection::socket_type& communique::impl::RawConnection::socket()
+{
+	return pTLSStream_ ? pTLSStream_->next_layer() : *pSocket_;
+}
+
+void communique::impl::RawConnection::connect( const std::string& host, const std::string& port, const std::string& sessionKey )
+{
+	if( pTLSStream_ && pTLSHandler_ ) pTLSHandler_->prepareClientSession( pTLSStream_->native_handle(), sessionKey );
+
+	auto pThis=self();
+	strand_.post( [pThis]() { pThis->startCloseTimer(); } );
+	resolver_.async_resolve( websocketpp::lib::asio::ip::tcp::resolver::query( host, port ),
+		strand_.wrap( std::bind( &RawConnection::on_resolve, pThis, std::placeholders::_1, std::placeholders::_2 ) ) );
+}
+
+void communique::impl::RawConnection::accept()
+{
+	auto pThis=self();
+	strand_.post( [pThis]()
+		{
+			// Small messages shouldn't wait around to be merged with later ones
+			websocketpp::lib::asio::error_code ignoredError;
+			pThis->socket().set_option( websocketpp::lib::asio::ip::tcp::no_delay(true), ignoredError );
+			pThis->startCloseTimer();
+			pThis->startHandshake( false );
+		} );
+}
+
+bool communique::impl::RawConnection::sessionResumed()
+{
+	return pTLSStream_ && SSL_session_reused( pTLSStream_->native_handle() )!=0;
+}
+
+void communique::impl::RawConnection::setCloseTimeout( std::chrono::milliseconds timeout )
+{
+	closeTimeoutMilliseconds_=timeout.count();
+}
+
+const void* communique::impl::RawConnection::key() const
+{
+	return this;
+}
+
+websocketpp::session::state::value communique::impl::RawConnection::state() const
+{
+	return state_;
+}
+
+bool communique::impl::RawConnection::transmit( const message_ptr& pMessage )
+{
+	if( state_!=websocketpp::session::state::open ) return false;
+	if( pMessage->get_payload().size()>std::numeric_limits<uint32_t>::max() ) return false;
+
+	bool startWriting=false;
+	{ // Block to limit lifetime of the lock_guard
+		std::lock_guard<std::mutex> lock( sendMutex_ );
+		sendQueue_.push_back( pMessage );
+		queuedBytes_+=pMessage->get_payload().size();
+		if( !writing_ ) startWriting=writing_=true;
+	}
+	// Anything sent while a write is in progress is picked up when it finishes, along with everything else queued by then
+	if( startWriting ) strand_.post( std::bind( &RawConnection::writeQueued, self() ) );
+	return true;
+}
+
+size_t communique::impl::RawConnection::sendQueueBytes() const
+{
+	return queuedBytes_;
+}
+
+void communique::impl::RawConnection::closeTransport()
+{
+	websocketpp::session::state::value expected=websocketpp::session::state::open;
+	if( !state_.compare_exchange_strong( expected, websocketpp::session::state::closing ) ) return;
+
+	// Anything already queued still goes out first, so the socket is only shut down once the send queue is empty
+	auto pThis=self();
+	strand_.post( [pThis]()
+		{
+			pThis->closeRequested_=true;
+			pThis->startCloseTimer();
+			bool isWriting;
+			{ // Block to limit lifetime of the lock_guard
+				std::lock_guard<std::mutex> lock( pThis->sendMutex_ );
+				isWriting=pThis->writing_;
+			}
+			if( !isWriting ) pThis->shutdownSend();
+		} );
+}
+
+std::shared_ptr<communique::impl::RawConnection> communique::impl::RawConnection::self()
+{
+	return std::static_pointer_cast<RawConnection>( shared_from_this() );
+}
+
+void communique::impl::RawConnection::startHandshake( bool isClient )
+{
+	if( pTLSStream_ )
+	{
+		pTLSStream_->async_handshake( isClient ? tls_stream_type::client : tls_stream_type::server,
+			strand_.wrap( std::bind( &RawConnection::on_handshake, self(), isClient, std::placeholders::_1 ) ) );
+	}
+	else on_handshake( isClient, websocketpp::lib::asio::error_code() );
+}
+
+void communique::impl::RawConnection::writeQueued()
+{
+	if( state_==websocketpp::session::state::closed ) return;
+
+	{ // Block to limit lifetime of the lock_guard
+		std::lock_guard<std::mutex> lock( sendMutex_ );
+		const size_t count=std::min( sendQueue_.size(), MAXIMUM_BATCH );
+		for( size_t index=0; index<count; ++index )
+		{
+			messagesBeingWritten_.push_back( std::move(sendQueue_.front()) );
+			sendQueue_.pop_front();
+		}
+		if( count==0 ) writing_=false;
+	}
+
+	if( messagesBeingWritten_.empty() )
+	{
+		if( closeRequested_ ) shutdownSend();
+		return;
+	}
+
+	lengthsBeingWritten_.resize( messagesBeingWritten_.size() );
+	for( size_t index=0; index<messagesBeingWritten_.size(); ++index )
+	{
+		lengthsBeingWritten_[index]=htonl( static_cast<uint32_t>( messagesBeingWritten_[index]->get_payload().size() ) );
+	}
+
+	auto handler=strand_.wrap( std::bind( &RawConnection::on_write, self(), std::placeholders::_1 ) );
+	if( pTLSStream_ )
+	{
+		// TLS would encrypt each buffer as a separate record, so it's worth the copy to put them all together
+		coalescedWrite_.clear();
+		for( size_t index=0; index<messagesBeingWritten_.size(); ++index )
+		{
+			coalescedWrite_.append( reinterpret_cast<const char*>(&lengthsBeingWritten_[index]), sizeof(uint32_t) );
+			coalescedWrite_.append( messagesBeingWritten_[index]->get_payload() );
+		}
+		asyncWrite( websocketpp::lib::asio::buffer(coalescedWrite_), handler );
+	}
+	else
+	{
+		writeBuffers_.clear();
+		for( size_t index=0; index<messagesBeingWritten_.size(); ++index )
+		{
+			writeBuffers_.push_back( websocketpp::lib::asio::buffer( &lengthsBeingWritten_[index], sizeof(uint32_t) ) );
+			writeBuffers_.push_back( websocketpp::lib::asio::buffer( messagesBeingWritten_[index]->get_payload() ) );
+		}
+		asyncWrite( writeBuffers_, handler );
+	}
+}
+
+void communique::impl::RawConnection::shutdownSend()
+{
+	// A TLS close_notify would need a read of its own in reply, which would clash with the one already
+	// in progress. Shutting down the TCP underneath is just as clear to the other end.
+	websocketpp::lib::asio::error_code ignoredError;
+	socket().shutdown( socket_type::shutdown_send, ignoredError );
+}
+
+void communique::impl::RawConnection::startRead()
+{
+	if( pIncoming_ && incomingRemaining_>readBuffer_.size() )
+	{
+		// Large messages are read straight into place rather than copied through the buffer
+		std::string& payload=pIncoming_->get_raw_payload();
+		const size_t alreadyRead=payload.size();
+		payload.resize( alreadyRead+incomingRemaining_ );
+		asyncRead( websocketpp::lib::asio::buffer( &payload[alreadyRead], incomingRemaining_ ),
+			strand_.wrap( std::bind( &RawConnection::on_readBody, self(), std::placeholders::_1 ) ) );
+	}
+	else
+	{
+		asyncReadSome( websocketpp::lib::asio::buffer( readBuffer_ ),
+			strand_.wrap( std::bind( &RawConnection::on_read, self(), std::placeholders::_1, std::placeholders::_2 ) ) );
+	}
+}
+
+void communique::impl::RawConnection::consume( const char* pData, size_t size )
+{
+	while( size>0 && state_!=websocketpp::session::state::closed )
+	{
+		if( !pIncoming_ )
+		{
+			// The length can be split across reads like anything else
+			const size_t count=std::min( size, lengthBuffer_.size()-lengthBytes_ );
+			std::memcpy( &lengthBuffer_[lengthBytes_], pData, count );
+			lengthBytes_+=count;
+			pData+=count;
+			size-=count;
+			if( lengthBytes_<lengthBuffer_.size() ) break;
+			lengthBytes_=0;
+
+			uint32_t length;
+			std::memcpy( &length, lengthBuffer_.data(), sizeof(length) );
+			length=ntohl( length );
+			if( length<COMMUNIQUE_HEADER_SIZE ) throw std::runtime_error( "Received a message that is too small to be a Communique message" );
+			if( length>MAXIMUM_MESSAGE_SIZE ) throw std::runtime_error( "Received a message of "+std::to_string(length)+" bytes, which is over the maximum of "+std::to_string(MAXIMUM_MESSAGE_SIZE) );
+
+			pIncoming_=communique::impl::Message::newBuffer();
+			pIncoming_->get_raw_payload().reserve( length );
+			incomingRemaining_=length;
+		}
+
+		const size_t count=std::min( size, incomingRemaining_ );
+		pIncoming_->get_raw_payload().append( pData, count );
+		pData+=count;
+		size-=count;
+		incomingRemaining_-=count;
+		if( incomingRemaining_==0 )
+		{
+			message_ptr pMessage;
+			pMessage.swap( pIncoming_ );
+			receiveMessage( pMessage );
+		}
+	}
+}
+
+void communique::impl::RawConnection::startCloseTimer()
+{
+	closeTimer_.expires_from_now( std::chrono::milliseconds( closeTimeoutMilliseconds_.load() ) );
+	closeTimer_.async_wait( strand_.wrap( std::bind( &RawConnection::on_closeTimeout, self(), std::placeholders::_1 ) ) );
+}
+
+void communique::impl::RawConnection::finish()
+{
+	const websocketpp::session::state::value previousState=state_.exchange( websocketpp::session::state::closed );
+	if( previousState==websocketpp::session::state::closed ) return;
+
+	websocketpp::lib::asio::error_code ignoredError;
+	closeTimer_.cancel( ignoredError );
+	resolver_.cancel();
+	socket().close( ignoredError );
+	{ // Block to limit lifetime of the lock_guard
+		std::lock_guard<std::mutex> lock( sendMutex_ );
+		sendQueue_.clear();
+		queuedBytes_=0;
+	}
+
+	if( previousState==websocketpp::session::state::connecting )
+	{
+		if( onFail ) onFail( failReason_ );
+	}
+	else if( onClose ) onClose();
+}
+
+void communique::impl::RawConnection::on_resolve( const websocketpp::lib::asio::error_code& errorCode, websocketpp::lib::asio::ip::tcp::resolver::iterator endpoints )
+{
+	if( state_==websocketpp::session::state::closed ) return;
+	if( errorCode )
+	{
+		failReason_=errorCode.message();
+		return finish();
+	}
+	websocketpp::lib::asio::async_connect( socket(), endpoints,
+		strand_.wrap( std::bind( &RawConnection::on_connect, self(), std::placeholders::_1 ) ) );
+}
+
+void communique::impl::RawConnection::on_connect( const websocketpp::lib::asio::error_code& errorCode )
+{
+	if( state_==websocketpp::session::state::closed ) return;
+	if( errorCode )
+	{
+		failReason_=errorCode.message();
+		return finish();
+	}
+
+	websocketpp::lib::asio::error_code ignoredError;
+	socket().set_option( websocketpp::lib::asio::ip::tcp::no_delay(true), ignoredError );
+	startHandshake( true );
+}
+
+void communique::impl::RawConnection::on_handshake( bool isClient, const websocketpp::lib::asio::error_code& errorCode )
+{
+	if( state_==websocketpp::session::state::closed ) return;
+	if( errorCode )
+	{
+		failReason_="TLS handshake failed - "+errorCode.message();
+		return finish();
+	}
+	if( pTLSStream_ && pTLSHandler_ ) pTLSHandler_->recordHandshake( pTLSStream_->native_handle() );
+
+	if( isClient )
+	{
+		asyncWrite( websocketpp::lib::asio::buffer( PREAMBLE, PREAMBLE_SIZE ),
+			strand_.wrap( std::bind( &RawConnection::on_preambleSent, self(), isClient, std::placeholders::_1 ) ) );
+	}
+	else
+	{
+		asyncRead( websocketpp::lib::asio::buffer( preamble_ ),
+			strand_.wrap( std::bind( &RawConnection::on_preambleReceived, self(), isClient, std::placeholders::_1 ) ) );
+	}
+}
+
+void communique::impl::RawConnection::on_preambleSent( bool isClient, const websocketpp::lib::asio::error_code& errorCode )
+{
+	if( state_==websocketpp::session::state::closed ) return;
+	if( errorCode )
+	{
+		failReason_=errorCode.message();
+		return finish();
+	}
+
+	// The client waits for the server to echo the preamble back. The server is done.
+	if( isClient )
+	{
+		asyncRead( websocketpp::lib::asio::buffer( preamble_ ),
+			strand_.wrap( std::bind( &RawConnection::on_preambleReceived, self(), isClient, std::placeholders::_1 ) ) );
+	}
+	else open();
+}
+
+void communique::impl::RawConnection::on_preambleReceived( bool isClient, const websocketpp::lib::asio::error_code& errorCode )
+{
+	if( state_==websocketpp::session::state::closed ) return;
+	if( errorCode )
+	{
+		failReason_=( isClient ? "The server closed the connection during the handshake. It might not use the raw framing - " : "" )+errorCode.message();
+		return finish();
+	}
+	if( std::memcmp( preamble_.data(), PREAMBLE, PREAMBLE_SIZE )!=0 )
+	{
+		if( isClient ) failReason_="The server doesn't use the Communique raw framing. It might be using WebSocket.";
+		else failReason_="The client doesn't use the Communique raw framing. It might be using WebSocket.";
+		return finish();
+	}
+
+	if( isClient ) open();
+	else
+	{
+		asyncWrite( websocketpp::lib::asio::buffer( PREAMBLE, PREAMBLE_SIZE ),
+			strand_.wrap( std::bind( &RawConnection::on_preambleSent, self(), isClient, std::placeholders::_1 ) ) );
+	}
+}
+
+void communique::impl::RawConnection::on_write( const websocketpp::lib::asio::error_code& errorCode )
+{
+	// If the connection has already finished the count was reset then
+	if( state_!=websocketpp::session::state::closed )
+	{
+		for( const auto& pMessage : messagesBeingWritten_ ) queuedBytes_-=pMessage->get_payload().size();
+	}
+	messagesBeingWritten_.clear();
+	if( errorCode ) return finish();
+	writeQueued();
+}
+
+void communique::impl::RawConnection::on_read( const websocketpp::lib::asio::error_code& errorCode, size_t bytesRead )
+{
+	if( state_==websocketpp::session::state::closed ) return;
+
+	try
+	{
+		consume( readBuffer_.data(), bytesRead );
+	}
+	catch( const std::exception& error )
+	{
+		// Whatever the other end is sending isn't Communique messages, so nothing after this can be trusted
+		std::cerr << "communique::impl::RawConnection - " << error.what() << std::endl;
+		return finish();
+	}
+
+	// An error includes the other end shutting down, which is how it says it's closing
+	if( errorCode ) return finish();
+	startRead();
+}
+
+void communique::impl::RawConnection::on_readBody( const websocketpp::lib::asio::error_code& errorCode )
+{
+	if( state_==websocketpp::session::state::closed ) return;
+	if( errorCode ) return finish();
+
+	incomingRemaining_=0;
+	message_ptr pMessage;
+	pMessage.swap( pIncoming_ );
+	receiveMessage( pMessage );
+	if( state_!=websocketpp::session::state::closed ) startRead();
+}
+
+void communique::impl::RawConnection::on_closeTimeout( const websocketpp::lib::asio::error_code& errorCode )
+{
+	if( errorCode ) return; // Cancelled because the handshake or close finished in time
+	if( state_==websocketpp::session::state::connecting ) failReason_="Timed out waiting for the other end to finish the handshake";
+	finish();
+}
+
+void communique::impl::RawConnection::open()
+{
+	websocketpp::lib::asio::error_code ignoredError;
+	closeTimer_.cancel( ignoredError );
+
+	state_=websocketpp::session::state::open;
+	if( onOpen ) onOpen();
+	startRead();
+}
@@ -0,0 +1,160 @@
+#include "communique/impl/RawServerTransport.h"
+#include <stdexcept>
+#include "communique/impl/RawConnection.h"
+#include "communique/impl/TLSHandler.h"
+
+communique::impl::RawServerTransport::RawServerTransport( websocketpp::lib::asio::io_service* pIoService, bool useTLS )
+	: pOwnIoService_( pIoService ? nullptr : new websocketpp::lib::asio::io_service ),
+	  ioService_( pIoService ? *pIoService : *pOwnIoService_ ),
+	  acceptor_( ioService_ ),
+	  useTLS_(useTLS),
+	  accessLog_( websocketpp::log::channel_type_hint::access ),
+	  errorLog_( websocketpp::log::channel_type_hint::error )
+{
+	accessLog_.set_channels(websocketpp::log::alevel::none);
+	errorLog_.set_channels(websocketpp::log::elevel::none);
+}
+
+communique::impl::RawServerTransport::~RawServerTransport()
+{
+	stopListening();
+}
+
+void communique::impl::RawServerTransport::listen( size_t port )
+{
+	// Listen on IPv6 if possible, which takes IPv4 connections as well. Fall back to IPv4 only if not.
+	websocketpp::lib::asio::error_code errorCode;
+	websocketpp::lib::asio::ip::tcp::endpoint endpoint( websocketpp::lib::asio::ip::tcp::v6(), static_cast<unsigned short>(port) );
+	acceptor_.open( endpoint.protocol(), errorCode );
+	if( errorCode )
+	{
+		errorCode.clear();
+		endpoint=websocketpp::lib::asio::ip::tcp::endpoint( websocketpp::lib::asio::ip::tcp::v4(), static_cast<unsigned short>(port) );
+		acceptor_.open( endpoint.protocol(), errorCode );
+	}
+	// The same as for WebSocket, so that the server can listen on the same port again while old connections are in TIME_WAIT
+	if( !errorCode ) acceptor_.set_option( websocketpp::lib::asio::ip::tcp::acceptor::reuse_address(true), errorCode );
+	if( !errorCode ) acceptor_.bind( endpoint, errorCode );
+	if( !errorCode ) acceptor_.listen( websocketpp::lib::asio::socket_base::max_connections, errorCode );
+	if( errorCode )
+	{
+		websocketpp::lib::asio::error_code ignoredError;
+		acceptor_.close( ignoredError );
+		throw std::runtime_error( "Communique server listen error: "+errorCode.message() );
+	}
+
+	try
+	{
+		startAccept();
+	}
+	catch(...)
+	{
+		stopListening();
+		throw;
+	}
+}
+
+bool communique::impl::RawServerTransport::isListening() const
+{
+	return acceptor_.is_open();
+}
+
+void communique::impl::RawServerTransport::stopListening()
+{
+	websocketpp::lib::asio::error_code ignoredError;
+	acceptor_.close( ignoredError );
+}
+
+void communique::impl::RawServerTransport::run()
+{
+	ioService_.run();
+}
+
+void communique::impl::RawServerTransport::stop()
+{
+	ioService_.stop();
+}
+
+void communique::impl::RawServerTransport::reset()
+{
+	ioService_.reset();
+}
+
+void communique::impl::RawServerTransport::setTLSHandler( std::shared_ptr<communique::impl::TLSHandler> pTLSHandler )
+{
+	pTLSHandler_=std::move(pTLSHandler);
+}
+
+websocketpp::config::asio::alog_type& communique::impl::RawServerTransport::accessLog()
+{
+	return accessLog_;
+}
+
+void communique::impl::RawServerTransport::setErrorLogLocation( std::ostream& outputStream )
+{
+	errorLog_.set_ostream( &outputStream );
+}
+
+void communique::impl::RawServerTransport::setErrorLogLevel( uint32_t level )
+{
+	errorLog_.set_channels(level);
+}
+
+void communique::impl::RawServerTransport::setAccessLogLocation( std::ostream& outputStream )
+{
+	accessLog_.set_ostream( &outputStream );
+}
+
+void communique::impl::RawServerTransport::setAccessLogLevel( uint32_t level )
+{
+	accessLog_.set_channels(level);
+}
+
+void communique::impl::RawServerTransport::startAccept()
+{
+	std::shared_ptr<websocketpp::lib::asio::ssl::context> pTLSContext;
+	if( useTLS_ )
+	{
+		if( !pTLSHandler_ ) throw std::runtime_error( "Communique server listen error: no TLS settings have been given to the transport" );
+		pTLSContext=pTLSHandler_->context();
+	}
+
+	auto pConnection=std::make_shared<communique::impl::RawConnection>( ioService_, pTLSContext, pTLSHandler_.get() );
+	auto pThis=std::static_pointer_cast<RawServerTransport>( shared_from_this() );
+	acceptor_.async_accept( pConnection->socket(), [pThis,pConnection]( const websocketpp::lib::asio::error_code& errorCode ){ pThis->on_accept( pConnection, errorCode ); } );
+}
+
+void communique::impl::RawServerTransport::on_accept( std::shared_ptr<communique::impl::RawConnection> pConnection, const websocketpp::lib::asio::error_code& errorCode )
+{
+	if( errorCode==websocketpp::lib::asio::error::operation_aborted ) return; // stopListening has been called
+
+	if( !errorCode )
+	{
+		// The callbacks can't hold a shared_ptr to the connection, because the connection owns them. They do
+		// hold one to this, so that this (and the TLSHandler it was given) stays alive as long as the connection.
+		std::weak_ptr<communique::impl::RawConnection> pWeakConnection=pConnection;
+		const void* key=pConnection->key();
+		auto pThis=std::static_pointer_cast<RawServerTransport>( shared_from_this() );
+		pConnection->onOpen=[pThis,pWeakConnection]()
+			{
+				auto pConnection=pWeakConnection.lock();
+				if( pConnection && pThis->onOpen ) pThis->onOpen( pConnection );
+			};
+		pConnection->onClose=[pThis,key](){ if( pThis->onClose ) pThis->onClose( key ); };
+		pConnection->onFail=[pThis]( const std::string& reason ){ pThis->errorLog_.write( websocketpp::log::elevel::rerror, "Raw framing handshake failed: "+reason ); };
+		pConnection->accept();
+	}
+	else errorLog_.write( websocketpp::log::elevel::rerror, "Raw framing accept failed: "+errorCode.message() );
+
+	if( !acceptor_.is_open() ) return;
+	try
+	{
+		startAccept();
+	}
+	catch( const std::exception& error )
+	{
+		// The TLS settings have been changed to something that doesn't work. Nothing can be accepted until they're fixed.
+		errorLog_.write( websocketpp::log::elevel::rerror, error.what() );
+		stopListening();
+	}
+}
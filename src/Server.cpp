@@ -1,11 +1,23 @@
 #include "communique/Server.h"
+#include <condition_variable>
 
 #define _WEBSOCKETPP_CPP11_STL_ // Make sure websocketpp uses c++11 features in preference to boost ones
-#include <websocketpp/server.hpp>
 #include <websocketpp/config/asio.hpp>
-#include <list>
+#include "communique/EventLoop.h"
 #include "communique/impl/Connection.h"
+#include "communique/impl/EventLoopPrivateMembers.h"
+#include "communique/impl/ConnectionRegistry.h"
 #include "communique/impl/TLSHandler.h"
+#include "communique/impl/TimingWheel.h"
+#include "communique/impl/processDefaults.h"
+#include "communique/impl/StatsCounters.h"
+#include "communique/impl/WebsocketServerTransport.h"
+#include "communique/impl/UnixSocketServerTransport.h"
+#ifndef COMMUNIQUE_NO_SHAREDMEMORY
+#include "communique/impl/SharedMemoryServerTransport.h"
+#endif
+#include "communique/impl/InProcessServerTransport.h"
+#include "communique/impl/RawServerTransport.h"
 
 
 //
@@ -16,37 +28,104 @@ namespace communique
 	class ServerPrivateMembers
 	{
 	public:
-		typedef websocketpp::server<websocketpp::config::asio_tls> server_type;
-
-		ServerPrivateMembers() : tlsHandler_(server_.get_alog()) { /*No operation besides initialiser list*/ }
-		server_type server_;
-		std::thread ioThread_;
-		std::list< std::shared_ptr<communique::impl::Connection> > currentConnections_;
-		mutable std::mutex currentConnectionsMutex_;
-		communique::impl::TLSHandler tlsHandler_;
-
-		void on_http( websocketpp::connection_hdl hdl );
-		void on_open( websocketpp::connection_hdl hdl );
-		void on_close( websocketpp::connection_hdl hdl );
-		void on_interrupt( websocketpp::connection_hdl hdl );
-
-		std::function<void(const std::string&,std::weak_ptr<communique::IConnection>)> defaultInfoHandler_;
-		std::function<std::string(const std::string&,std::weak_ptr<communique::IConnection>)> defaultRequestHandler_;
+		ServerPrivateMembers( communique::Transport transport, communique::EventLoopPrivateMembers* pEventLoop );
+		communique::Transport transport_;
+		communique::EventLoopPrivateMembers* pEventLoop_; ///< Null unless using a shared EventLoop, which the Server keeps alive
+		/// Null if using a shared EventLoop. Owned here rather than by the transport, because anything still queued holds a
+		/// shared_ptr to the transport, and declared first so that destroying it is what finally releases those.
+		std::unique_ptr<websocketpp::lib::asio::io_service> pOwnIoService_;
+		std::shared_ptr<communique::impl::ServerTransport> pTransport_; ///< Can outlive this, while anything it queued is still to run
+		std::vector<std::thread> ioThreads_;
+		std::shared_ptr<communique::IExecutor> pExecutor_; // Declared after pTransport_ so that queued tasks finish before the transport is destroyed
+		std::shared_ptr<communique::IExecutor> pResponseExecutor_; // Null means run response handlers on the IO thread
+		std::shared_ptr<communique::impl::TimingWheel> pTimingWheel_; // Used for request timeouts
+		std::chrono::milliseconds defaultRequestTimeout_;
+		/// Keyed by impl::Connection::key(), i.e. the address of the underlying connection
+		communique::impl::ConnectionRegistry<communique::impl::Connection> currentConnections_;
+		/// Makes sure new connections don't miss changes to the executors and timeout while they're being set up
+		std::mutex connectionSettingsMutex_;
+		/// Notified whenever a connection closes, or finishes its last request once stop has been called, so that stop can wait for them
+		std::condition_variable connectionClosed_;
+		std::mutex connectionClosedMutex_;
+		std::shared_ptr<communique::impl::TLSHandler> pTLSHandler_;
+		/// Held while a connection is removed, so that stats() never counts a connection twice or not at all
+		std::mutex statsMutex_;
+		communique::Stats closedConnections_; ///< The counts from every connection that has closed
+
+		/// Starts the IO threads, unless using a shared EventLoop. Common to both listen methods.
+		void startIO( size_t ioThreadCount, bool sharedEventLoop );
+
+		/// Takes the connection out of currentConnections_, keeping its counts. Returns null if it wasn't there.
+		std::shared_ptr<communique::impl::Connection> removeConnection( const void* key );
+
+		void on_open( std::shared_ptr<communique::impl::Connection> pNewConnection );
+		void on_close( const void* key );
+		void on_interrupt( const void* key );
+
+		std::function<void(const communique::MessageView&,std::weak_ptr<communique::IConnection>)> defaultInfoHandler_;
+		std::function<std::string(const communique::MessageView&,std::weak_ptr<communique::IConnection>)> defaultRequestHandler_;
 	};
 }
 
+namespace
+{
+	std::shared_ptr<communique::impl::ServerTransport> createTransport( communique::Transport transport, websocketpp::lib::asio::io_service* pIoService )
+	{
+		switch( transport )
+		{
+			case communique::Transport::TLS:
+				return std::make_shared< communique::impl::WebsocketServerTransport<websocketpp::config::asio_tls> >( pIoService );
+			case communique::Transport::PLAIN:
+				return std::make_shared< communique::impl::WebsocketServerTransport<websocketpp::config::asio> >( pIoService );
+			case communique::Transport::UNIXSOCKET:
+				return std::make_shared<communique::impl::UnixSocketServerTransport>( pIoService );
+			case communique::Transport::SHAREDMEMORY:
+#ifndef COMMUNIQUE_NO_SHAREDMEMORY
+				return std::make_shared<communique::impl::SharedMemoryServerTransport>( pIoService );
+#else
+				throw std::runtime_error( "communique::Transport::SHAREDMEMORY is only available on Linux" );
+#endif
+			case communique::Transport::INPROCESS:
+				return std::make_shared<communique::impl::InProcessServerTransport>( pIoService );
+			case communique::Transport::RAWTLS:
+				return std::make_shared<communique::impl::RawServerTransport>( pIoService, true );
+			case communique::Transport::RAWTCP:
+				return std::make_shared<communique::impl::RawServerTransport>( pIoService, false );
+		}
+		throw std::runtime_error( "Unknown communique::Transport" );
+	}
+}
+
+communique::ServerPrivateMembers::ServerPrivateMembers( communique::Transport transport, communique::EventLoopPrivateMembers* pEventLoop )
+	: transport_(transport), pEventLoop_(pEventLoop), pOwnIoService_( pEventLoop ? nullptr : new websocketpp::lib::asio::io_service ),
+	  pTransport_( createTransport( transport, pEventLoop ? &pEventLoop->ioService_ : pOwnIoService_.get() ) ),
+	  pTimingWheel_( pEventLoop ? pEventLoop->timingWheel() : communique::impl::processTimingWheel() ),
+	  defaultRequestTimeout_(0), pTLSHandler_( std::make_shared<communique::impl::TLSHandler>( pTransport_->accessLog() ) )
+{
+	// No operation besides initialiser list
+}
+
 communique::Server::Server()
-	: pImple_( new ServerPrivateMembers )
+	: Server( communique::Transport::TLS, nullptr )
+{
+	// No operation, everything done in the delegated constructor
+}
+
+communique::Server::Server( std::shared_ptr<communique::EventLoop> pEventLoop )
+	: Server( communique::Transport::TLS, std::move(pEventLoop) )
+{
+	// No operation, everything done in the delegated constructor
+}
+
+communique::Server::Server( communique::Transport transport, std::shared_ptr<communique::EventLoop> pEventLoop )
+	: pEventLoop_( std::move(pEventLoop) ), pImple_( std::make_shared<ServerPrivateMembers>( transport, pEventLoop_ ? pEventLoop_->pImple_.get() : nullptr ) )
 {
-	pImple_->server_.set_access_channels(websocketpp::log::alevel::none);
-	//pImple_->server_.set_error_channels(websocketpp::log::elevel::all ^ websocketpp::log::elevel::info);
-	pImple_->server_.set_error_channels(websocketpp::log::elevel::none);
-	pImple_->server_.set_tls_init_handler( std::bind( &communique::impl::TLSHandler::on_tls_init, &pImple_->tlsHandler_, std::placeholders::_1 ) );
-	pImple_->server_.set_http_handler( std::bind( &ServerPrivateMembers::on_http, pImple_.get(), std::placeholders::_1 ) );
-	pImple_->server_.init_asio();
-	pImple_->server_.set_open_handler( std::bind( &ServerPrivateMembers::on_open, pImple_.get(), std::placeholders::_1 ) );
-	pImple_->server_.set_close_handler( std::bind( &ServerPrivateMembers::on_close, pImple_.get(), std::placeholders::_1 ) );
-	pImple_->server_.set_interrupt_handler( std::bind( &ServerPrivateMembers::on_interrupt, pImple_.get(), std::placeholders::_1 ) );
+	pImple_->pTransport_->setTLSHandler( pImple_->pTLSHandler_ );
+	// The transport can outlive pImple_ while anything it queued is still to run, so it only gets weak references
+	std::weak_ptr<ServerPrivateMembers> pWeakImple( pImple_ );
+	pImple_->pTransport_->onOpen=[pWeakImple]( std::shared_ptr<communique::impl::Connection> pNewConnection ){ auto pImple=pWeakImple.lock(); if( pImple ) pImple->on_open( std::move(pNewConnection) ); };
+	pImple_->pTransport_->onClose=[pWeakImple]( const void* key ){ auto pImple=pWeakImple.lock(); if( pImple ) pImple->on_close( key ); };
+	pImple_->pTransport_->onInterrupt=[pWeakImple]( const void* key ){ auto pImple=pWeakImple.lock(); if( pImple ) pImple->on_interrupt( key ); };
 }
 
 communique::Server::~Server()
@@ -54,30 +133,44 @@ communique::Server::~Server()
 	try
 	{
 		stop();
+		// Anything still queued for the transport (e.g. the aborted accept after stopListening) holds a shared_ptr
+		// to it, so it goes once that has run
 	}
 	catch(...) { /* Make sure no exceptions propagate out */ }
 }
 
-bool communique::Server::listen( size_t port )
+bool communique::Server::listen( size_t port, size_t ioThreadCount )
 {
 	try
 	{
-		if( pImple_->ioThread_.joinable() ) stop(); // If already running stop the current IO
+		if( !pImple_->ioThreads_.empty() || pImple_->pTransport_->isListening() ) stop(); // If already running stop the current IO
 
-		websocketpp::lib::error_code errorCode;
-		websocketpp::lib::asio::error_code underlyingErrorCode;
-		pImple_->server_.listen(port,errorCode,&underlyingErrorCode);
-		if( errorCode )
-		{
-			std::string errorMessage="Communique server listen error: "+errorCode.message();
-			if( underlyingErrorCode ) errorMessage+=" ("+underlyingErrorCode.message()+")";
-			throw std::runtime_error( errorMessage );
-		}
+		// Build the TLS context now, so that any problems with the certificate files are reported
+		// here rather than on the first handshake.
+		if( pImple_->transport_==communique::Transport::TLS || pImple_->transport_==communique::Transport::RAWTLS ) pImple_->pTLSHandler_->context();
 
-		pImple_->server_.start_accept();
+		pImple_->pTransport_->listen( port );
+		pImple_->startIO( ioThreadCount, pEventLoop_!=nullptr );
+		return true;
+	}
+	catch( std::exception& error )
+	{
+		throw;
+	}
+	catch(...)
+	{
+		throw std::runtime_error( "Unknown exception in communique::Server::listen" );
+	}
+}
 
-		pImple_->ioThread_=std::thread( &ServerPrivateMembers::server_type::run, &pImple_->server_ );
+bool communique::Server::listen( const std::string& socketPath, size_t ioThreadCount )
+{
+	try
+	{
+		if( !pImple_->ioThreads_.empty() || pImple_->pTransport_->isListening() ) stop(); // If already running stop the current IO
 
+		pImple_->pTransport_->listen( socketPath );
+		pImple_->startIO( ioThreadCount, pEventLoop_!=nullptr );
 		return true;
 	}
 	catch( std::exception& error )
@@ -90,114 +183,336 @@ bool communique::Server::listen( size_t port )
 	}
 }
 
-void communique::Server::stop()
+void communique::Server::stop( std::chrono::milliseconds drainTimeout )
 {
-	if( pImple_->server_.is_listening() ) pImple_->server_.stop_listening();
+	const auto deadline=std::chrono::steady_clock::now()+drainTimeout;
+	if( pImple_->pTransport_->isListening() ) pImple_->pTransport_->stopListening();
+
+	auto pConnections=pImple_->currentConnections_.snapshot();
 
-	{ // Block to limit lifetime of the lock_guard
-		std::lock_guard<std::mutex> myMutex( pImple_->currentConnectionsMutex_ );
-		for( auto& pConnection : pImple_->currentConnections_ )
+	// Let requests that are already being handled send their response before the close frame
+	// goes out, but don't let any more start. Each connection wakes this up when its last one finishes.
+	std::weak_ptr<ServerPrivateMembers> pWeakImple( pImple_ );
+	auto notifyDrained=[pWeakImple]()
 		{
-			//pImple_->server_.get_con_from_hdl(connection_hdl)->get_raw_socket().shutdown(boost::asio::ip::tcp::socket::shutdown_both);
-			pConnection->close();
-		}
+			auto pImple=pWeakImple.lock();
+			if( !pImple ) return;
+			{ // Make sure stop() isn't between checking for requests and starting to wait
+				std::lock_guard<std::mutex> lock( pImple->connectionClosedMutex_ );
+			}
+			pImple->connectionClosed_.notify_all();
+		};
+	for( auto& pConnection : *pConnections ) pConnection->stopAcceptingRequests( notifyDrained );
+	{ // Block to limit lifetime of the lock
+		std::unique_lock<std::mutex> lock( pImple_->connectionClosedMutex_ );
+		pImple_->connectionClosed_.wait_until( lock, deadline, [&pConnections]()
+			{
+				for( auto& pConnection : *pConnections ) if( pConnection->requestsInProgress()!=0 ) return false;
+				return true;
+			} );
+	}
+
+	// Close frames are only queued here, so all the close handshakes happen at the same time. Take
+	// a new snapshot in case any handshakes that were already underway have finished since. The close
+	// timeout makes the transport drop the connection itself if it goes past the deadline.
+	const auto remainingTime=std::chrono::duration_cast<std::chrono::milliseconds>( deadline-std::chrono::steady_clock::now() );
+	for( auto& pConnection : *pImple_->currentConnections_.snapshot() )
+	{
+		pConnection->setCloseTimeout( std::max( remainingTime, std::chrono::milliseconds(1) ) );
+		pConnection->close();
 	}
+	{ // Block to limit lifetime of the lock
+		std::unique_lock<std::mutex> lock( pImple_->connectionClosedMutex_ );
+		// When sharing an EventLoop it can't be stopped, so give the transport a moment to drop
+		// the connections that timed out.
+		const auto waitUntil=pEventLoop_ ? deadline+std::chrono::seconds(1) : deadline;
+		pImple_->connectionClosed_.wait_until( lock, waitUntil, [this](){ return pImple_->currentConnections_.empty(); } );
+	}
+
+	// Anything left hasn't finished closing in time, so stop the event loop rather than wait for it
+	const bool forced=!pImple_->currentConnections_.empty();
+	if( forced && !pImple_->ioThreads_.empty() ) pImple_->pTransport_->stop();
 
-	if( pImple_->ioThread_.joinable() ) pImple_->ioThread_.join();
+	for( auto& ioThread : pImple_->ioThreads_ )
+	{
+		if( ioThread.joinable() ) ioThread.join();
+	}
+	pImple_->ioThreads_.clear();
+
+	if( forced )
+	{
+		// The close handler will never be called for these now
+		for( auto& pConnection : *pImple_->currentConnections_.snapshot() )
+		{
+			pImple_->removeConnection( pConnection->key() );
+			pConnection->notifyStateChange();
+			pConnection->failPendingRequests();
+		}
+		// The event loop needs resetting before it can be run again
+		if( !pEventLoop_ ) pImple_->pTransport_->reset();
+	}
 }
 
 void communique::Server::setCertificateChainFile( const std::string& filename )
 {
-	pImple_->tlsHandler_.setCertificateChainFile(filename);
+	pImple_->pTLSHandler_->setCertificateChainFile(filename);
 }
 
 void communique::Server::setPrivateKeyFile( const std::string& filename )
 {
-	pImple_->tlsHandler_.setPrivateKeyFile(filename);
+	pImple_->pTLSHandler_->setPrivateKeyFile(filename);
 }
 
 void communique::Server::setVerifyFile( const std::string& filename )
 {
-	pImple_->tlsHandler_.setVerifyFile(filename);
+	pImple_->pTLSHandler_->setVerifyFile(filename);
 }
 
 void communique::Server::setDiffieHellmanParamsFile( const std::string& filename )
 {
-	pImple_->tlsHandler_.setDiffieHellmanParamsFile(filename);
+	pImple_->pTLSHandler_->setDiffieHellmanParamsFile(filename);
+}
+
+void communique::Server::setProtocolVersions( communique::TLSVersion minimum, communique::TLSVersion maximum )
+{
+	pImple_->pTLSHandler_->setProtocolVersions(minimum,maximum);
+}
+
+void communique::Server::setCipherList( const std::string& cipherList )
+{
+	pImple_->pTLSHandler_->setCipherList(cipherList);
+}
+
+void communique::Server::setCipherSuites( const std::string& cipherSuites )
+{
+	pImple_->pTLSHandler_->setCipherSuites(cipherSuites);
+}
+
+void communique::Server::setCurves( const std::string& curves )
+{
+	pImple_->pTLSHandler_->setCurves(curves);
+}
+
+void communique::Server::setServerCipherPreference( bool serverPreference )
+{
+	pImple_->pTLSHandler_->setServerCipherPreference(serverPreference);
+}
+
+void communique::Server::setSessionResumption( bool enabled )
+{
+	pImple_->pTLSHandler_->setSessionResumption(enabled);
+}
+
+void communique::Server::setSessionCacheSize( size_t numberOfSessions )
+{
+	pImple_->pTLSHandler_->setSessionCacheSize(numberOfSessions);
+}
+
+void communique::Server::setSessionTimeout( std::chrono::seconds timeout )
+{
+	pImple_->pTLSHandler_->setSessionTimeout(timeout);
+}
+
+void communique::Server::rotateSessionTicketKeys()
+{
+	pImple_->pTLSHandler_->rotateSessionTicketKeys();
+}
+
+size_t communique::Server::completedHandshakes() const
+{
+	return pImple_->pTLSHandler_->completedHandshakes();
+}
+
+size_t communique::Server::resumedHandshakes() const
+{
+	return pImple_->pTLSHandler_->resumedHandshakes();
+}
+
+communique::Stats communique::Server::stats() const
+{
+	std::lock_guard<std::mutex> lock( pImple_->statsMutex_ );
+	communique::Stats result=pImple_->closedConnections_;
+	for( auto& pConnection : *pImple_->currentConnections_.snapshot() ) result+=pConnection->stats();
+	return result;
 }
 
 void communique::Server::setDefaultInfoHandler( std::function<void(const std::string&)> infoHandler )
 {
-	// Wrap in a function that drops the connection argument
-	pImple_->defaultInfoHandler_=std::bind( infoHandler, std::placeholders::_1 );
+	// Wrap in a function that copies the message and drops the connection argument
+	if( infoHandler ) pImple_->defaultInfoHandler_=[infoHandler](const communique::MessageView& message,std::weak_ptr<communique::IConnection>){ infoHandler( message.str() ); };
+	else pImple_->defaultInfoHandler_=nullptr;
 }
 
 void communique::Server::setDefaultInfoHandler( std::function<void(const std::string&,std::weak_ptr<communique::IConnection>)> infoHandler )
+{
+	// Wrap in a function that copies the message
+	if( infoHandler ) pImple_->defaultInfoHandler_=[infoHandler](const communique::MessageView& message,std::weak_ptr<communique::IConnection> pConnection){ infoHandler( message.str(), pConnection ); };
+	else pImple_->defaultInfoHandler_=nullptr;
+}
+
+void communique::Server::setDefaultInfoHandler( std::function<void(const communique::MessageView&,std::weak_ptr<communique::IConnection>)> infoHandler )
 {
 	pImple_->defaultInfoHandler_=infoHandler;
 }
 
 void communique::Server::setDefaultRequestHandler( std::function<std::string(const std::string&)> requestHandler )
 {
-	// Wrap in a function that drops the connection argument
-	pImple_->defaultRequestHandler_=std::bind( requestHandler, std::placeholders::_1 );
+	// Wrap in a function that copies the message and drops the connection argument
+	if( requestHandler ) pImple_->defaultRequestHandler_=[requestHandler](const communique::MessageView& message,std::weak_ptr<communique::IConnection>){ return requestHandler( message.str() ); };
+	else pImple_->defaultRequestHandler_=nullptr;
 }
 
 void communique::Server::setDefaultRequestHandler( std::function<std::string(const std::string&,std::weak_ptr<communique::IConnection>)> requestHandler )
+{
+	// Wrap in a function that copies the message
+	if( requestHandler ) pImple_->defaultRequestHandler_=[requestHandler](const communique::MessageView& message,std::weak_ptr<communique::IConnection> pConnection){ return requestHandler( message.str(), pConnection ); };
+	else pImple_->defaultRequestHandler_=nullptr;
+}
+
+void communique::Server::setDefaultRequestHandler( std::function<std::string(const communique::MessageView&,std::weak_ptr<communique::IConnection>)> requestHandler )
 {
 	pImple_->defaultRequestHandler_=requestHandler;
 }
 
 std::vector<std::weak_ptr<communique::IConnection> > communique::Server::currentConnections()
 {
-	std::lock_guard<std::mutex> myMutex( pImple_->currentConnectionsMutex_ );
-	return std::vector<std::weak_ptr<communique::IConnection> >( pImple_->currentConnections_.begin(), pImple_->currentConnections_.end() );
+	auto pSnapshot=pImple_->currentConnections_.snapshot();
+	return std::vector<std::weak_ptr<communique::IConnection> >( pSnapshot->begin(), pSnapshot->end() );
+}
+
+uint64_t communique::Server::connectionId( const std::weak_ptr<communique::IConnection>& pConnection ) const
+{
+	// Anything that isn't one of the server's connections, e.g. a Client, can't be in the registry
+	auto pImplConnection=std::dynamic_pointer_cast<communique::impl::Connection>( pConnection.lock() );
+	if( !pImplConnection ) return 0;
+	return pImple_->currentConnections_.id( pImplConnection->key() );
+}
+
+std::weak_ptr<communique::IConnection> communique::Server::connection( uint64_t connectionId ) const
+{
+	return pImple_->currentConnections_.findById( connectionId );
+}
+
+size_t communique::Server::broadcastInfo( const std::string& message, std::function<bool(std::weak_ptr<communique::IConnection>)> filter )
+{
+	// The snapshot doesn't change, so no lock is held while the filter runs or the messages are queued
+	auto pSnapshot=pImple_->currentConnections_.snapshot();
+	const auto& connections=*pSnapshot;
+	if( connections.empty() ) return 0;
+
+	// Encode and frame once, rather than once per connection
+	communique::impl::Message newMessage( message, communique::impl::Message::INFO, 0 );
+	communique::impl::Message::message_ptr pFramedMessage=newMessage.serverFrame();
+
+	size_t numberSent=0;
+	for( auto& pConnection : connections )
+	{
+		if( filter && !filter(pConnection) ) continue;
+		if( pConnection->sendBroadcast( newMessage, pFramedMessage ) ) ++numberSent;
+	}
+	return numberSent;
+}
+
+void communique::Server::setExecutor( std::shared_ptr<communique::IExecutor> pExecutor )
+{
+	std::lock_guard<std::mutex> myMutex( pImple_->connectionSettingsMutex_ );
+	pImple_->pExecutor_=pExecutor;
+	for( auto& pConnection : *pImple_->currentConnections_.snapshot() ) pConnection->setExecutor( pExecutor );
+}
+
+void communique::Server::setResponseExecutor( std::shared_ptr<communique::IExecutor> pExecutor )
+{
+	std::lock_guard<std::mutex> myMutex( pImple_->connectionSettingsMutex_ );
+	pImple_->pResponseExecutor_=pExecutor;
+	for( auto& pConnection : *pImple_->currentConnections_.snapshot() ) pConnection->setResponseExecutor( pExecutor );
+}
+
+void communique::Server::setDefaultRequestTimeout( std::chrono::milliseconds timeout )
+{
+	std::lock_guard<std::mutex> myMutex( pImple_->connectionSettingsMutex_ );
+	pImple_->defaultRequestTimeout_=timeout;
+	for( auto& pConnection : *pImple_->currentConnections_.snapshot() ) pConnection->setDefaultRequestTimeout( timeout );
+}
+
+void communique::Server::setBusyPollTime( std::chrono::microseconds busyPollTime )
+{
+	pImple_->pTransport_->setBusyPollTime( busyPollTime );
 }
 
 void communique::Server::setErrorLogLocation( std::ostream& outputStream )
 {
-	pImple_->server_.get_elog().set_ostream( &outputStream );
+	pImple_->pTransport_->setErrorLogLocation( outputStream );
 }
 
 void communique::Server::setErrorLogLevel( uint32_t level )
 {
-	pImple_->server_.set_error_channels(level);
+	pImple_->pTransport_->setErrorLogLevel( level );
 }
 
 void communique::Server::setAccessLogLocation( std::ostream& outputStream )
 {
-	pImple_->server_.get_alog().set_ostream( &outputStream );
+	pImple_->pTransport_->setAccessLogLocation( outputStream );
 }
 
 void communique::Server::setAccessLogLevel( uint32_t level )
 {
-	pImple_->server_.set_access_channels(level);
+	pImple_->pTransport_->setAccessLogLevel( level );
 }
 
-void communique::ServerPrivateMembers::on_http( websocketpp::connection_hdl hdl )
+void communique::ServerPrivateMembers::startIO( size_t ioThreadCount, bool sharedEventLoop )
 {
-	server_type::connection_ptr con = server_.get_con_from_hdl(hdl);
-	//con->set_body("Hello World!\n");
-	con->set_status(websocketpp::http::status_code::ok);
+	if( !pExecutor_ ) pExecutor_=( pEventLoop_ ? pEventLoop_->defaultExecutor() : communique::impl::processDefaultExecutor() );
+	if( ioThreadCount==0 ) ioThreadCount=1;
+
+	// The asio configs have multithreading enabled, so websocketpp wraps each connection's handlers
+	// in its own strand, and the Unix socket transport does the same. That means a connection never
+	// sees its messages concurrently or out of order however many threads are running the io_service.
+	// A shared EventLoop's threads are already running.
+	if( !sharedEventLoop ) for( size_t index=0; index<ioThreadCount; ++index )
+	{
+		ioThreads_.emplace_back( &communique::impl::ServerTransport::run, pTransport_.get() );
+	}
 }
 
-void communique::ServerPrivateMembers::on_open( websocketpp::connection_hdl hdl )
+void communique::ServerPrivateMembers::on_open( std::shared_ptr<communique::impl::Connection> pNewConnection )
 {
-	std::lock_guard<std::mutex> myMutex( currentConnectionsMutex_ );
-	currentConnections_.emplace_back( new communique::impl::Connection( server_.get_con_from_hdl(hdl), defaultInfoHandler_, defaultRequestHandler_ ) );
+	pNewConnection->setInfoHandler( defaultInfoHandler_ );
+	pNewConnection->setRequestHandler( defaultRequestHandler_ );
+	std::lock_guard<std::mutex> myMutex( connectionSettingsMutex_ );
+	pNewConnection->setExecutor( pExecutor_ );
+	pNewConnection->setResponseExecutor( pResponseExecutor_ );
+	pNewConnection->setTimingWheel( pTimingWheel_ );
+	pNewConnection->setDefaultRequestTimeout( defaultRequestTimeout_ );
+	currentConnections_.add( pNewConnection->key(), pNewConnection );
 }
 
-void communique::ServerPrivateMembers::on_close( websocketpp::connection_hdl hdl )
+std::shared_ptr<communique::impl::Connection> communique::ServerPrivateMembers::removeConnection( const void* key )
 {
-	std::lock_guard<std::mutex> myMutex( currentConnectionsMutex_ );
-	auto pRawConnection=server_.get_con_from_hdl(hdl);
-	auto findResult=std::find_if( currentConnections_.begin(), currentConnections_.end(), [&pRawConnection](std::shared_ptr<communique::impl::Connection>& other){return pRawConnection==other->underlyingPointer();} );
-	if( findResult!=currentConnections_.end() ) currentConnections_.erase( findResult );
-	else std::cout << "Couldn't find connection to remove" << std::endl;
+	std::lock_guard<std::mutex> lock( statsMutex_ );
+	std::shared_ptr<communique::impl::Connection> pConnection=currentConnections_.remove( key );
+	if( pConnection ) closedConnections_+=communique::impl::StatsCounters::countsOnly( pConnection->stats() );
+	return pConnection;
+}
+
+void communique::ServerPrivateMembers::on_close( const void* key )
+{
+	std::shared_ptr<communique::impl::Connection> pClosedConnection=removeConnection( key );
+	if( !pClosedConnection ) std::cout << "Couldn't find connection to remove" << std::endl;
 
+	// Wake anything waiting for the close to finish, and tell anyone waiting on a response that it's not coming
+	if( pClosedConnection )
+	{
+		pClosedConnection->notifyStateChange();
+		pClosedConnection->failPendingRequests();
+	}
+
+	{ // Make sure stop() isn't between checking for connections and starting to wait
+		std::lock_guard<std::mutex> lock( connectionClosedMutex_ );
+	}
+	connectionClosed_.notify_all();
 }
 
-void communique::ServerPrivateMembers::on_interrupt( websocketpp::connection_hdl hdl )
+void communique::ServerPrivateMembers::on_interrupt( const void* key )
 {
 	std::cout << "Connection has been interrupted" << std::endl;
 //	auto findResult=std::find_if( currentConnections_.begin(), currentConnections_.end(), [&hdl](websocketpp::connection_hdl& other){return !other.owner_before(hdl) && !hdl.owner_before(other);} );
@@ -0,0 +1,92 @@
+#include "communique/impl/SharedMemoryClientTransport.h"
+#include <stdexcept>
+#include "communique/impl/SharedMemoryConnection.h"
+
+communique::impl::SharedMemoryClientTransport::SharedMemoryClientTransport( websocketpp::lib::asio::io_service* pIoService )
+	: pOwnIoService_( pIoService ? nullptr : new websocketpp::lib::asio::io_service ),
+	  ioService_( pIoService ? *pIoService : *pOwnIoService_ ),
+	  busyPollMicroseconds_(0),
+	  accessLog_( websocketpp::log::channel_type_hint::access ),
+	  errorLog_( websocketpp::log::channel_type_hint::error )
+{
+	accessLog_.set_channels(websocketpp::log::alevel::none);
+	errorLog_.set_channels(websocketpp::log::elevel::none);
+}
+
+std::shared_ptr<communique::impl::Connection> communique::impl::SharedMemoryClientTransport::createConnection( const std::string& URI )
+{
+	static const std::string scheme="shm://";
+	if( URI.size()<=scheme.size() || URI.compare( 0, scheme.size(), scheme )!=0 )
+	{
+		throw std::runtime_error( "Shared memory URIs have to be \""+scheme+"\" followed by the path to the server's socket, not \""+URI+"\"" );
+	}
+	websocketpp::lib::asio::local::stream_protocol::endpoint endpoint( URI.substr( scheme.size() ) );
+
+	{ // Block to limit lifetime of the lock_guard
+		std::lock_guard<std::mutex> lock( endpointMutex_ );
+		endpoint_=endpoint;
+	}
+	return std::make_shared<communique::impl::SharedMemoryConnection>( ioService_, std::chrono::microseconds( busyPollMicroseconds_.load() ) );
+}
+
+void communique::impl::SharedMemoryClientTransport::connect( communique::impl::Connection& connection )
+{
+	auto& sharedMemoryConnection=static_cast<communique::impl::SharedMemoryConnection&>(connection);
+	websocketpp::lib::asio::local::stream_protocol::endpoint endpoint;
+	{ // Block to limit lifetime of the lock_guard
+		std::lock_guard<std::mutex> lock( endpointMutex_ );
+		endpoint=endpoint_;
+	}
+
+	// The connection never lets go of these, so this stays alive as long as the connection
+	std::shared_ptr<communique::impl::ClientTransport> pThis=shared_from_this();
+	sharedMemoryConnection.onOpen=[pThis](){ if( pThis->onOpen ) pThis->onOpen(); };
+	sharedMemoryConnection.onClose=[pThis](){ if( pThis->onClose ) pThis->onClose(); };
+	sharedMemoryConnection.onFail=[pThis]( const std::string& reason ){ if( pThis->onFail ) pThis->onFail( reason ); };
+	sharedMemoryConnection.connect( endpoint );
+}
+
+void communique::impl::SharedMemoryClientTransport::run()
+{
+	ioService_.run();
+}
+
+void communique::impl::SharedMemoryClientTransport::reset()
+{
+	ioService_.reset();
+}
+
+websocketpp::lib::asio::io_service& communique::impl::SharedMemoryClientTransport::ioService()
+{
+	return ioService_;
+}
+
+void communique::impl::SharedMemoryClientTransport::setBusyPollTime( std::chrono::microseconds busyPollTime )
+{
+	busyPollMicroseconds_=busyPollTime.count();
+}
+
+websocketpp::config::asio::alog_type& communique::impl::SharedMemoryClientTransport::accessLog()
+{
+	return accessLog_;
+}
+
+void communique::impl::SharedMemoryClientTransport::setErrorLogLocation( std::ostream& outputStream )
+{
+	errorLog_.set_ostream( &outputStream );
+}
+
+void communique::impl::SharedMemoryClientTransport::setErrorLogLevel( uint32_t level )
+{
+	errorLog_.set_channels(level);
+}
+
+void communique::impl::SharedMemoryClientTransport::setAccessLogLocation( std::ostream& outputStream )
+{
+	accessLog_.set_ostream( &outputStream );
+}
+
+void communique::impl::SharedMemoryClientTransport::setAccessLogLevel( uint32_t level )
+{
+	accessLog_.set_channels(level);
+}
@@ -0,0 +1,512 @@
+#include "communique/impl/SharedMemoryConnection.h"
+#include <stdexcept>
+#include <system_error>
+#include <iostream>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+	/// What the client sends the server, along with the file descriptors for the shared memory and the two eventfds
+	struct Hello
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint64_t ringCapacity;
+	};
+	const uint32_t HELLO_MAGIC=0x436f6d71;
+	const uint32_t PROTOCOL_VERSION=2; ///< Version 2 seals the shared memory
+	/// The shared memory, the eventfd the server sleeps on and the eventfd the client sleeps on, in that order
+	const size_t NUMBER_OF_DESCRIPTORS=3;
+	/// Sent back by the server once it has mapped the shared memory
+	const char ACKNOWLEDGE=1;
+	/// The seals the server insists on before it maps the client's shared memory
+	const int REQUIRED_SEALS=F_SEAL_SHRINK|F_SEAL_GROW;
+	/// The most records read in one go, so that a connection that never runs dry doesn't hog the IO thread
+	const size_t MAXIMUM_BATCH=256;
+
+	/** @brief Closes the file descriptor when it goes out of scope, unless it has been released. */
+	class FileDescriptor
+	{
+	public:
+		explicit FileDescriptor( int descriptor=-1 ) : descriptor_(descriptor) {}
+		~FileDescriptor() { if( descriptor_>=0 ) ::close( descriptor_ ); }
+		FileDescriptor( const FileDescriptor& )=delete;
+		FileDescriptor& operator=( const FileDescriptor& )=delete;
+		int get() const { return descriptor_; }
+		int release() { int descriptor=descriptor_; descriptor_=-1; return descriptor; }
+		void reset( int descriptor ) { if( descriptor_>=0 ) ::close( descriptor_ ); descriptor_=descriptor; }
+	private:
+		int descriptor_;
+	};
+
+	std::system_error systemError( const std::string& what )
+	{
+		return std::system_error( errno, std::generic_category(), what );
+	}
+}
+
+communique::impl::SharedMemoryConnection::SharedMemoryConnection( websocketpp::lib::asio::io_service& ioService, std::chrono::microseconds busyPollTime )
+	: state_(websocketpp::session::state::connecting), socket_(ioService), strand_(ioService), busyPollTime_(busyPollTime),
+	  closeTimeoutMilliseconds_(5000), closeTimer_(ioService), overflowTimer_(ioService), overflowBackoff_(0),
+	  pSharedMemory_(nullptr), sharedMemorySize_(0), incomingSignal_(ioService), outgoingSignal_(-1),
+	  overflowPosition_(0), draining_(false), overflowBytes_(0), closeRequested_(false)
+{
+	// No operation besides initialiser list
+}
+
+communique::impl::SharedMemoryConnection::~SharedMemoryConnection()
+{
+	// These are only released here, because another thread could have been sending right up until the end
+	if( pSharedMemory_ ) ::munmap( pSharedMemory_, sharedMemorySize_ );
+	if( outgoingSignal_>=0 ) ::close( outgoingSignal_ );
+}
+
+communique::impl::SharedMemoryConnection::socket_type& communique::impl::SharedMemoryConnection::socket()
+{
+	return socket_;
+}
+
+void communique::impl::SharedMemoryConnection::connect( const endpoint_type& endpoint )
+{
+	socket_.async_connect( endpoint, strand_.wrap( std::bind( &SharedMemoryConnection::on_connect, self(), std::placeholders::_1 ) ) );
+}
+
+void communique::impl::SharedMemoryConnection::accept()
+{
+	socket_.async_wait( socket_type::wait_read, strand_.wrap( std::bind( &SharedMemoryConnection::on_hello, self(), std::placeholders::_1 ) ) );
+}
+
+void communique::impl::SharedMemoryConnection::setCloseTimeout( std::chrono::milliseconds timeout )
+{
+	closeTimeoutMilliseconds_=timeout.count();
+}
+
+const void* communique::impl::SharedMemoryConnection::key() const
+{
+	return this;
+}
+
+websocketpp::session::state::value communique::impl::SharedMemoryConnection::state() const
+{
+	return state_;
+}
+
+bool communique::impl::SharedMemoryConnection::transmit( const message_ptr& pMessage )
+{
+	if( state_!=websocketpp::session::state::open ) return false;
+
+	const std::string& payload=pMessage->get_payload();
+	bool startDraining=false;
+	{ // Block to limit lifetime of the lock_guard
+		std::lock_guard<std::mutex> lock( sendMutex_ );
+		size_t position=0;
+		if( !overflow_.empty() ) overflowBytes_+=payload.size(); // Has to wait its turn
+		else if( writeRecords( payload, position ) ) return true;
+		else
+		{
+			// The ring is full. Rather than hold up this thread, which could be an IO thread the other end is
+			// waiting on, leave the rest for the strand to write once the other end has made room.
+			overflowPosition_=position;
+			overflowBytes_+=payload.size()-position;
+		}
+		overflow_.push_back( pMessage );
+		if( !draining_ ) startDraining=draining_=true;
+	}
+	if( startDraining ) strand_.post( std::bind( &SharedMemoryConnection::drainOverflow, self() ) );
+	return true;
+}
+
+size_t communique::impl::SharedMemoryConnection::sendQueueBytes() const
+{
+	return overflowBytes_;
+}
+
+void communique::impl::SharedMemoryConnection::closeTransport()
+{
+	websocketpp::session::state::value expected=websocketpp::session::state::open;
+	if( !state_.compare_exchange_strong( expected, websocketpp::session::state::closing ) ) return;
+
+	// Anything still waiting for room in the ring goes first, so the socket is only shut down once that's empty
+	auto pThis=self();
+	strand_.post( [pThis]()
+		{
+			pThis->closeRequested_=true;
+			pThis->startCloseTimer();
+			bool isDraining;
+			{ // Block to limit lifetime of the lock_guard
+				std::lock_guard<std::mutex> lock( pThis->sendMutex_ );
+				isDraining=pThis->draining_;
+			}
+			if( !isDraining ) pThis->shutdownSend();
+		} );
+}
+
+void communique::impl::SharedMemoryConnection::shutdownSend()
+{
+	// Shutting down the sending side of the socket tells the other end, which closes its socket in reply
+	websocketpp::lib::asio::error_code ignoredError;
+	socket_.shutdown( socket_type::shutdown_send, ignoredError );
+}
+
+std::shared_ptr<communique::impl::SharedMemoryConnection> communique::impl::SharedMemoryConnection::self()
+{
+	return std::static_pointer_cast<SharedMemoryConnection>( shared_from_this() );
+}
+
+void communique::impl::SharedMemoryConnection::mapSharedMemory( int memoryFileDescriptor, size_t ringCapacity, bool initialise, int incomingRing )
+{
+	const size_t regionSize=communique::impl::SharedMemoryRing::regionSize( ringCapacity );
+	void* pMemory=::mmap( nullptr, 2*regionSize, PROT_READ|PROT_WRITE, MAP_SHARED, memoryFileDescriptor, 0 );
+	if( pMemory==MAP_FAILED ) throw systemError( "Unable to map the shared memory" );
+	pSharedMemory_=pMemory;
+	sharedMemorySize_=2*regionSize;
+
+	std::unique_ptr<communique::impl::SharedMemoryRing> pRings[2];
+	for( int index=0; index<2; ++index )
+	{
+		pRings[index].reset( new communique::impl::SharedMemoryRing( static_cast<char*>(pMemory)+index*regionSize, ringCapacity, initialise ) );
+	}
+	pIncoming_=std::move( pRings[incomingRing] );
+	pOutgoing_=std::move( pRings[1-incomingRing] );
+}
+
+bool communique::impl::SharedMemoryConnection::writeRecords( const std::string& payload, size_t& position )
+{
+	// Messages too long for one record go as several, which the other end puts back together. There's
+	// always at least the Communique header, so there's never an empty message to worry about.
+	const size_t maximumRecordSize=pOutgoing_->maximumRecordSize();
+	while( position<payload.size() )
+	{
+		const size_t length=std::min( maximumRecordSize, payload.size()-position );
+		if( !pOutgoing_->tryWrite( payload.data()+position, length, position+length<payload.size() ) ) return false;
+		position+=length;
+
+		if( pOutgoing_->consumerNeedsWaking() )
+		{
+			const uint64_t increment=1;
+			if( ::write( outgoingSignal_, &increment, sizeof(increment) )<0 ) { /* Only if the other end has gone, in which case the socket closing finishes the connection */ }
+		}
+	}
+	return true;
+}
+
+void communique::impl::SharedMemoryConnection::drainOverflow()
+{
+	bool finished=false;
+	bool madeProgress=false;
+	{ // Block to limit lifetime of the lock_guard
+		std::lock_guard<std::mutex> lock( sendMutex_ );
+		if( state_==websocketpp::session::state::closed )
+		{
+			// Nothing is going to read it now
+			overflow_.clear();
+			overflowPosition_=0;
+			overflowBytes_=0;
+		}
+		while( !overflow_.empty() )
+		{
+			const size_t previousPosition=overflowPosition_;
+			const bool complete=writeRecords( overflow_.front()->get_payload(), overflowPosition_ );
+			overflowBytes_-=overflowPosition_-previousPosition;
+			if( overflowPosition_!=previousPosition ) madeProgress=true;
+			if( !complete ) break;
+			overflow_.pop_front();
+			overflowPosition_=0;
+		}
+		if( overflow_.empty() )
+		{
+			draining_=false;
+			finished=true;
+		}
+	}
+
+	if( finished )
+	{
+		overflowBackoff_=std::chrono::microseconds(0);
+		if( closeRequested_ && state_!=websocketpp::session::state::closed ) shutdownSend();
+		return;
+	}
+
+	// Nothing says when the other end has made room, so check again shortly. Back off gradually while it
+	// isn't reading so as not to take a core away from it, but never for long because it could catch up any time.
+	if( madeProgress ) overflowBackoff_=std::chrono::microseconds(0);
+	overflowBackoff_=std::min( overflowBackoff_*2+std::chrono::microseconds(10), std::chrono::microseconds(1000) );
+	overflowTimer_.expires_from_now( overflowBackoff_ );
+	overflowTimer_.async_wait( strand_.wrap( std::bind( &SharedMemoryConnection::on_overflowTimer, self(), std::placeholders::_1 ) ) );
+}
+
+bool communique::impl::SharedMemoryConnection::readAvailable()
+{
+	bool receivedAny=false;
+	try
+	{
+		for( size_t count=0; count<MAXIMUM_BATCH; ++count )
+		{
+			if( !pPartialMessage_ ) pPartialMessage_=communique::impl::Message::newBuffer();
+			bool moreFragments;
+			if( !pIncoming_->tryRead( pPartialMessage_->get_raw_payload(), moreFragments ) ) break;
+			receivedAny=true;
+			if( !moreFragments )
+			{
+				message_ptr pMessage;
+				pMessage.swap( pPartialMessage_ );
+				receiveMessage( pMessage );
+			}
+		}
+	}
+	catch( const std::exception& error )
+	{
+		// Either the other end has written something that isn't a Communique message, or has overwritten
+		// the ring. Either way nothing else it sends can be trusted.
+		std::cerr << "communique::impl::SharedMemoryConnection - " << error.what() << std::endl;
+		finish();
+	}
+	return receivedAny;
+}
+
+void communique::impl::SharedMemoryConnection::receive()
+{
+	if( state_==websocketpp::session::state::closed ) return;
+
+	// Keep checking for a while before going to sleep. When both ends do this a message can go from
+	// one to the other without either having to make a system call, which saves the eventfd write and
+	// the wake up for every message. See SHM+POLL in benchmark/RawFraming_benchmark.cpp for how much.
+	bool receivedAny=readAvailable();
+	if( !receivedAny && busyPollTime_.count()>0 )
+	{
+		const auto pollUntil=std::chrono::steady_clock::now()+busyPollTime_;
+		while( !receivedAny && state_!=websocketpp::session::state::closed && std::chrono::steady_clock::now()<pollUntil ) receivedAny=readAvailable();
+	}
+	if( state_==websocketpp::session::state::closed ) return;
+
+	// Give anything else waiting for the IO thread a turn before reading any more
+	auto pThis=self();
+	if( receivedAny || !pIncoming_->prepareToWait() ) strand_.post( [pThis](){ pThis->receive(); } );
+	else waitForSignal();
+}
+
+void communique::impl::SharedMemoryConnection::waitForSignal()
+{
+	incomingSignal_.async_read_some( websocketpp::lib::asio::buffer( &signalBuffer_, sizeof(signalBuffer_) ),
+		strand_.wrap( std::bind( &SharedMemoryConnection::on_signal, self(), std::placeholders::_1 ) ) );
+}
+
+void communique::impl::SharedMemoryConnection::waitForSocketClose()
+{
+	socket_.async_read_some( websocketpp::lib::asio::buffer( &socketBuffer_, sizeof(socketBuffer_) ),
+		strand_.wrap( std::bind( &SharedMemoryConnection::on_socketClosed, self(), std::placeholders::_1 ) ) );
+}
+
+void communique::impl::SharedMemoryConnection::startCloseTimer()
+{
+	closeTimer_.expires_from_now( std::chrono::milliseconds( closeTimeoutMilliseconds_.load() ) );
+	closeTimer_.async_wait( strand_.wrap( std::bind( &SharedMemoryConnection::on_closeTimeout, self(), std::placeholders::_1 ) ) );
+}
+
+void communique::impl::SharedMemoryConnection::finish()
+{
+	const websocketpp::session::state::value previousState=state_.exchange( websocketpp::session::state::closed );
+	if( previousState==websocketpp::session::state::closed ) return;
+
+	websocketpp::lib::asio::error_code ignoredError;
+	closeTimer_.cancel( ignoredError );
+	overflowTimer_.cancel( ignoredError );
+	socket_.close( ignoredError );
+	incomingSignal_.close( ignoredError );
+
+	if( previousState==websocketpp::session::state::connecting )
+	{
+		if( onFail ) onFail( failReason_ );
+	}
+	else if( onClose ) onClose();
+}
+
+void communique::impl::SharedMemoryConnection::on_connect( const websocketpp::lib::asio::error_code& errorCode )
+{
+	if( errorCode )
+	{
+		failReason_=errorCode.message();
+		return finish();
+	}
+
+	try
+	{
+		const size_t ringCapacity=RING_CAPACITY;
+		FileDescriptor memoryDescriptor( ::memfd_create( "communique", MFD_CLOEXEC|MFD_ALLOW_SEALING ) );
+		if( memoryDescriptor.get()<0 ) throw systemError( "Unable to create the shared memory" );
+		if( ::ftruncate( memoryDescriptor.get(), 2*communique::impl::SharedMemoryRing::regionSize(ringCapacity) )!=0 ) throw systemError( "Unable to size the shared memory" );
+		// Promise the server the size will never change, so that it can't be made to fault by shrinking it after it's mapped
+		if( ::fcntl( memoryDescriptor.get(), F_ADD_SEALS, REQUIRED_SEALS|F_SEAL_SEAL )!=0 ) throw systemError( "Unable to seal the shared memory" );
+		FileDescriptor serverSignal( ::eventfd( 0, EFD_CLOEXEC|EFD_NONBLOCK ) );
+		FileDescriptor clientSignal( ::eventfd( 0, EFD_CLOEXEC|EFD_NONBLOCK ) );
+		if( serverSignal.get()<0 || clientSignal.get()<0 ) throw systemError( "Unable to create an eventfd" );
+
+		// The server reads from the first ring, the client from the second
+		mapSharedMemory( memoryDescriptor.get(), ringCapacity, true, 1 );
+
+		Hello hello;
+		hello.magic=HELLO_MAGIC;
+		hello.version=PROTOCOL_VERSION;
+		hello.ringCapacity=ringCapacity;
+		struct iovec ioVector;
+		ioVector.iov_base=&hello;
+		ioVector.iov_len=sizeof(hello);
+
+		char controlBuffer[CMSG_SPACE(sizeof(int)*NUMBER_OF_DESCRIPTORS)];
+		std::memset( controlBuffer, 0, sizeof(controlBuffer) );
+		struct msghdr message;
+		std::memset( &message, 0, sizeof(message) );
+		message.msg_iov=&ioVector;
+		message.msg_iovlen=1;
+		message.msg_control=controlBuffer;
+		message.msg_controllen=sizeof(controlBuffer);
+		struct cmsghdr* pControlMessage=CMSG_FIRSTHDR( &message );
+		pControlMessage->cmsg_level=SOL_SOCKET;
+		pControlMessage->cmsg_type=SCM_RIGHTS;
+		pControlMessage->cmsg_len=CMSG_LEN(sizeof(int)*NUMBER_OF_DESCRIPTORS);
+		const int descriptors[NUMBER_OF_DESCRIPTORS]={ memoryDescriptor.get(), serverSignal.get(), clientSignal.get() };
+		std::memcpy( CMSG_DATA(pControlMessage), descriptors, sizeof(descriptors) );
+
+		if( ::sendmsg( socket_.native_handle(), &message, MSG_NOSIGNAL )!=static_cast<ssize_t>(sizeof(hello)) ) throw systemError( "Unable to send the shared memory to the server" );
+
+		// The mapping stays valid after the shared memory descriptor is closed
+		outgoingSignal_=serverSignal.release();
+		incomingSignal_.assign( clientSignal.release() );
+	}
+	catch( const std::exception& error )
+	{
+		failReason_=error.what();
+		return finish();
+	}
+
+	websocketpp::lib::asio::async_read( socket_, websocketpp::lib::asio::buffer( &socketBuffer_, sizeof(socketBuffer_) ),
+		strand_.wrap( std::bind( &SharedMemoryConnection::on_acknowledge, self(), std::placeholders::_1 ) ) );
+}
+
+void communique::impl::SharedMemoryConnection::on_hello( const websocketpp::lib::asio::error_code& errorCode )
+{
+	if( errorCode )
+	{
+		failReason_=errorCode.message();
+		return finish();
+	}
+
+	try
+	{
+		// The hello is small enough that it always arrives in one piece, along with the descriptors
+		Hello hello;
+		struct iovec ioVector;
+		ioVector.iov_base=&hello;
+		ioVector.iov_len=sizeof(hello);
+		char controlBuffer[CMSG_SPACE(sizeof(int)*NUMBER_OF_DESCRIPTORS)];
+		struct msghdr message;
+		std::memset( &message, 0, sizeof(message) );
+		message.msg_iov=&ioVector;
+		message.msg_iovlen=1;
+		message.msg_control=controlBuffer;
+		message.msg_controllen=sizeof(controlBuffer);
+
+		const ssize_t bytesReceived=::recvmsg( socket_.native_handle(), &message, MSG_CMSG_CLOEXEC );
+		if( bytesReceived<0 ) throw systemError( "Unable to receive the shared memory from the client" );
+
+		// Take ownership of whatever descriptors came, so that they're closed if anything is wrong
+		FileDescriptor memoryDescriptor, serverSignal, clientSignal;
+		struct cmsghdr* pControlMessage=CMSG_FIRSTHDR( &message );
+		if( pControlMessage && pControlMessage->cmsg_level==SOL_SOCKET && pControlMessage->cmsg_type==SCM_RIGHTS
+			&& pControlMessage->cmsg_len==CMSG_LEN(sizeof(int)*NUMBER_OF_DESCRIPTORS) )
+		{
+			int descriptors[NUMBER_OF_DESCRIPTORS];
+			std::memcpy( descriptors, CMSG_DATA(pControlMessage), sizeof(descriptors) );
+			memoryDescriptor.reset( descriptors[0] );
+			serverSignal.reset( descriptors[1] );
+			clientSignal.reset( descriptors[2] );
+		}
+
+		if( bytesReceived!=static_cast<ssize_t>(sizeof(hello)) || hello.magic!=HELLO_MAGIC || memoryDescriptor.get()<0 )
+		{
+			throw std::runtime_error( "The client didn't set up a Communique shared memory connection" );
+		}
+		if( hello.version!=PROTOCOL_VERSION ) throw std::runtime_error( "The client uses an incompatible version of the Communique shared memory protocol" );
+
+		// Without the seals the client could shrink the memory after it's mapped, and the next access here would be
+		// a SIGBUS. With them the size checked below is the size for good.
+		const int seals=::fcntl( memoryDescriptor.get(), F_GET_SEALS );
+		if( seals<0 || (seals&REQUIRED_SEALS)!=REQUIRED_SEALS ) throw std::runtime_error( "The shared memory from the client isn't sealed against resizing" );
+		struct stat fileStatus;
+		if( ::fstat( memoryDescriptor.get(), &fileStatus )!=0 ) throw systemError( "Unable to check the shared memory" );
+		if( hello.ringCapacity>(1u<<30) || static_cast<uint64_t>(fileStatus.st_size)<2*communique::impl::SharedMemoryRing::regionSize(hello.ringCapacity) )
+		{
+			throw std::runtime_error( "The shared memory from the client is the wrong size" );
+		}
+
+		mapSharedMemory( memoryDescriptor.get(), hello.ringCapacity, false, 0 );
+		outgoingSignal_=clientSignal.release();
+		incomingSignal_.assign( serverSignal.release() );
+
+		websocketpp::lib::asio::error_code writeError;
+		websocketpp::lib::asio::write( socket_, websocketpp::lib::asio::buffer( &ACKNOWLEDGE, sizeof(ACKNOWLEDGE) ), writeError );
+		if( writeError ) throw std::runtime_error( "Unable to reply to the client - "+writeError.message() );
+	}
+	catch( const std::exception& error )
+	{
+		failReason_=error.what();
+		return finish();
+	}
+
+	open();
+}
+
+void communique::impl::SharedMemoryConnection::on_acknowledge( const websocketpp::lib::asio::error_code& errorCode )
+{
+	if( errorCode || socketBuffer_!=ACKNOWLEDGE )
+	{
+		failReason_=( errorCode ? errorCode.message() : std::string("The server didn't accept the shared memory") );
+		return finish();
+	}
+
+	open();
+}
+
+void communique::impl::SharedMemoryConnection::on_signal( const websocketpp::lib::asio::error_code& errorCode )
+{
+	if( errorCode ) return; // The descriptor has been closed because the connection has finished
+	receive();
+}
+
+void communique::impl::SharedMemoryConnection::on_socketClosed( const websocketpp::lib::asio::error_code& errorCode )
+{
+	if( errorCode==websocketpp::lib::asio::error::operation_aborted ) return; // Closed from this end by finish
+
+	// Whatever the other end sent before closing is still in the ring, and has to be delivered first
+	while( state_!=websocketpp::session::state::closed && readAvailable() ) {}
+	finish();
+}
+
+void communique::impl::SharedMemoryConnection::on_closeTimeout( const websocketpp::lib::asio::error_code& errorCode )
+{
+	if( errorCode ) return; // Cancelled because the close finished in time
+	finish();
+}
+
+void communique::impl::SharedMemoryConnection::on_overflowTimer( const websocketpp::lib::asio::error_code& errorCode )
+{
+	// Even if cancelled because the connection has finished, the overflow still needs emptying
+	drainOverflow();
+}
+
+void communique::impl::SharedMemoryConnection::open()
+{
+	state_=websocketpp::session::state::open;
+	if( onOpen ) onOpen();
+	waitForSocketClose();
+	// The other end may have sent something already
+	receive();
+}
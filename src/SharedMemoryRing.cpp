@@ -0,0 +1,119 @@
+#include "communique/impl/SharedMemoryRing.h"
+#include <stdexcept>
+#include <cstring>
+#include <algorithm>
+#include <new>
+
+// The control block is shared between processes, which only works if the atomics don't need a lock
+static_assert( ATOMIC_LLONG_LOCK_FREE==2 && ATOMIC_INT_LOCK_FREE==2, "communique::impl::SharedMemoryRing needs lock free atomics" );
+
+communique::impl::SharedMemoryRing::SharedMemoryRing( void* pMemory, size_t capacity, bool initialise )
+	: pControl_( static_cast<ControlBlock*>(pMemory) ), pData_( static_cast<char*>(pMemory)+sizeof(ControlBlock) ), capacity_(capacity)
+{
+	if( capacity_<64 || (capacity_ & (capacity_-1))!=0 ) throw std::runtime_error( "SharedMemoryRing capacity has to be a power of two and at least 64" );
+
+	if( initialise )
+	{
+		new (pControl_) ControlBlock;
+		pControl_->writePosition.store( 0 );
+		pControl_->readPosition.store( 0 );
+		pControl_->consumerWaiting.store( 0 );
+	}
+}
+
+size_t communique::impl::SharedMemoryRing::regionSize( size_t capacity )
+{
+	return sizeof(ControlBlock)+capacity;
+}
+
+size_t communique::impl::SharedMemoryRing::maximumRecordSize() const
+{
+	return capacity_/4-sizeof(RecordHeader);
+}
+
+bool communique::impl::SharedMemoryRing::tryWrite( const char* pData, size_t length, bool moreFragments )
+{
+	if( length>maximumRecordSize() ) throw std::runtime_error( "SharedMemoryRing record is too long" );
+
+	const uint64_t writePosition=pControl_->writePosition.load( std::memory_order_relaxed );
+	const uint64_t readPosition=pControl_->readPosition.load( std::memory_order_acquire );
+	const size_t size=recordSize( length );
+	if( capacity_-(writePosition-readPosition)<size ) return false;
+
+	RecordHeader header;
+	header.length=static_cast<uint32_t>( length );
+	header.flags=( moreFragments ? MORE_FRAGMENTS : 0 );
+	copyIn( writePosition, reinterpret_cast<const char*>(&header), sizeof(header) );
+	copyIn( writePosition+sizeof(header), pData, length );
+
+	// Sequentially consistent rather than release, so that it can't be reordered with the load in
+	// consumerNeedsWaking. Otherwise the consumer could check for data and go to sleep in between.
+	pControl_->writePosition.store( writePosition+size, std::memory_order_seq_cst );
+	return true;
+}
+
+bool communique::impl::SharedMemoryRing::consumerNeedsWaking()
+{
+	if( pControl_->consumerWaiting.load( std::memory_order_seq_cst )==0 ) return false;
+	return pControl_->consumerWaiting.exchange( 0, std::memory_order_seq_cst )!=0;
+}
+
+bool communique::impl::SharedMemoryRing::tryRead( std::string& destination, bool& moreFragments )
+{
+	const uint64_t readPosition=pControl_->readPosition.load( std::memory_order_relaxed );
+	const uint64_t writePosition=pControl_->writePosition.load( std::memory_order_acquire );
+	if( readPosition==writePosition ) return false;
+
+	// The other end is a different process, so don't trust anything it wrote without checking
+	RecordHeader header;
+	copyOut( readPosition, reinterpret_cast<char*>(&header), sizeof(header) );
+	if( header.length>maximumRecordSize() || recordSize(header.length)>writePosition-readPosition )
+	{
+		throw std::runtime_error( "SharedMemoryRing record is corrupt" );
+	}
+
+	const size_t oldSize=destination.size();
+	destination.resize( oldSize+header.length );
+	copyOut( readPosition+sizeof(header), &destination[oldSize], header.length );
+	moreFragments=( (header.flags & MORE_FRAGMENTS)!=0 );
+
+	pControl_->readPosition.store( readPosition+recordSize(header.length), std::memory_order_release );
+	return true;
+}
+
+bool communique::impl::SharedMemoryRing::prepareToWait()
+{
+	pControl_->consumerWaiting.store( 1, std::memory_order_seq_cst );
+	if( !empty() )
+	{
+		pControl_->consumerWaiting.store( 0, std::memory_order_relaxed );
+		return false;
+	}
+	return true;
+}
+
+bool communique::impl::SharedMemoryRing::empty() const
+{
+	return pControl_->writePosition.load( std::memory_order_seq_cst )==pControl_->readPosition.load( std::memory_order_relaxed );
+}
+
+void communique::impl::SharedMemoryRing::copyIn( uint64_t position, const char* pSource, size_t length )
+{
+	const size_t offset=static_cast<size_t>( position & (capacity_-1) );
+	const size_t firstPart=std::min( length, capacity_-offset );
+	std::memcpy( pData_+offset, pSource, firstPart );
+	if( firstPart<length ) std::memcpy( pData_, pSource+firstPart, length-firstPart );
+}
+
+void communique::impl::SharedMemoryRing::copyOut( uint64_t position, char* pDestination, size_t length ) const
+{
+	const size_t offset=static_cast<size_t>( position & (capacity_-1) );
+	const size_t firstPart=std::min( length, capacity_-offset );
+	std::memcpy( pDestination, pData_+offset, firstPart );
+	if( firstPart<length ) std::memcpy( pDestination+firstPart, pData_, length-firstPart );
+}
+
+size_t communique::impl::SharedMemoryRing::recordSize( size_t length )
+{
+	return sizeof(RecordHeader)+( (length+7) & ~static_cast<size_t>(7) );
+}
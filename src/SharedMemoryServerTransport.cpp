@@ -0,0 +1,118 @@
+#include "communique/impl/SharedMemoryServerTransport.h"
+#include <unistd.h>
+#include "communique/impl/SharedMemoryConnection.h"
+#include "communique/impl/unixSocketTools.h"
+
+communique::impl::SharedMemoryServerTransport::SharedMemoryServerTransport( websocketpp::lib::asio::io_service* pIoService )
+	: pOwnIoService_( pIoService ? nullptr : new websocketpp::lib::asio::io_service ),
+	  ioService_( pIoService ? *pIoService : *pOwnIoService_ ),
+	  acceptor_( ioService_ ),
+	  busyPollMicroseconds_(0),
+	  accessLog_( websocketpp::log::channel_type_hint::access ),
+	  errorLog_( websocketpp::log::channel_type_hint::error )
+{
+	accessLog_.set_channels(websocketpp::log::alevel::none);
+	errorLog_.set_channels(websocketpp::log::elevel::none);
+}
+
+communique::impl::SharedMemoryServerTransport::~SharedMemoryServerTransport()
+{
+	stopListening();
+}
+
+void communique::impl::SharedMemoryServerTransport::listen( const std::string& socketPath )
+{
+	communique::impl::listenOnUnixSocket( acceptor_, socketPath );
+	socketPath_=socketPath;
+	startAccept();
+}
+
+bool communique::impl::SharedMemoryServerTransport::isListening() const
+{
+	return acceptor_.is_open();
+}
+
+void communique::impl::SharedMemoryServerTransport::stopListening()
+{
+	websocketpp::lib::asio::error_code ignoredError;
+	acceptor_.close( ignoredError );
+	if( !socketPath_.empty() ) ::unlink( socketPath_.c_str() );
+	socketPath_.clear();
+}
+
+void communique::impl::SharedMemoryServerTransport::run()
+{
+	ioService_.run();
+}
+
+void communique::impl::SharedMemoryServerTransport::stop()
+{
+	ioService_.stop();
+}
+
+void communique::impl::SharedMemoryServerTransport::reset()
+{
+	ioService_.reset();
+}
+
+void communique::impl::SharedMemoryServerTransport::setBusyPollTime( std::chrono::microseconds busyPollTime )
+{
+	busyPollMicroseconds_=busyPollTime.count();
+}
+
+websocketpp::config::asio::alog_type& communique::impl::SharedMemoryServerTransport::accessLog()
+{
+	return accessLog_;
+}
+
+void communique::impl::SharedMemoryServerTransport::setErrorLogLocation( std::ostream& outputStream )
+{
+	errorLog_.set_ostream( &outputStream );
+}
+
+void communique::impl::SharedMemoryServerTransport::setErrorLogLevel( uint32_t level )
+{
+	errorLog_.set_channels(level);
+}
+
+void communique::impl::SharedMemoryServerTransport::setAccessLogLocation( std::ostream& outputStream )
+{
+	accessLog_.set_ostream( &outputStream );
+}
+
+void communique::impl::SharedMemoryServerTransport::setAccessLogLevel( uint32_t level )
+{
+	accessLog_.set_channels(level);
+}
+
+void communique::impl::SharedMemoryServerTransport::startAccept()
+{
+	auto pConnection=std::make_shared<communique::impl::SharedMemoryConnection>( ioService_, std::chrono::microseconds( busyPollMicroseconds_.load() ) );
+	auto pThis=std::static_pointer_cast<SharedMemoryServerTransport>( shared_from_this() );
+	acceptor_.async_accept( pConnection->socket(), [pThis,pConnection]( const websocketpp::lib::asio::error_code& errorCode ){ pThis->on_accept( pConnection, errorCode ); } );
+}
+
+void communique::impl::SharedMemoryServerTransport::on_accept( std::shared_ptr<communique::impl::SharedMemoryConnection> pConnection, const websocketpp::lib::asio::error_code& errorCode )
+{
+	if( errorCode==websocketpp::lib::asio::error::operation_aborted ) return; // stopListening has been called
+
+	if( !errorCode )
+	{
+		// The callbacks can't hold a shared_ptr to the connection, because the connection owns them. They do
+		// hold one to this, so that this stays alive as long as the connection.
+		std::weak_ptr<communique::impl::SharedMemoryConnection> pWeakConnection=pConnection;
+		const void* key=pConnection->key();
+		auto pThis=std::static_pointer_cast<SharedMemoryServerTransport>( shared_from_this() );
+		pConnection->onOpen=[pThis,pWeakConnection]()
+			{
+				auto pConnection=pWeakConnection.lock();
+				if( pConnection && pThis->onOpen ) pThis->onOpen( pConnection );
+			};
+		pConnection->onClose=[pThis,key](){ if( pThis->onClose ) pThis->onClose( key ); };
+		pConnection->onFail=[pThis]( const std::string& reason ){ pThis->errorLog_.write( websocketpp::log::elevel::rerror, "Shared memory handshake failed: "+reason ); };
+		pConnection->accept();
+	}
+	else errorLog_.write( websocketpp::log::elevel::rerror, "Shared memory accept failed: "+errorCode.message() );
+
+	if( acceptor_.is_open() ) startAccept();
+}
@@ -0,0 +1,94 @@
+#include "communique/Stats.h"
+#include <cmath>
+#include <algorithm>
+
+communique::LatencyHistogram::LatencyHistogram()
+	: count(0), totalMicroseconds(0)
+{
+	buckets.fill(0);
+}
+
+std::chrono::microseconds communique::LatencyHistogram::bucketUpperBound( size_t bucket )
+{
+	if( bucket>=NUMBER_OF_BUCKETS-1 ) return std::chrono::microseconds::max();
+	return std::chrono::microseconds( static_cast<std::chrono::microseconds::rep>(1)<<bucket );
+}
+
+std::chrono::microseconds communique::LatencyHistogram::quantile( double fraction ) const
+{
+	if( count==0 ) return std::chrono::microseconds(0);
+
+	const uint64_t target=std::max<uint64_t>( 1, static_cast<uint64_t>( std::ceil( fraction*count ) ) );
+	uint64_t cumulative=0;
+	for( size_t bucket=0; bucket<NUMBER_OF_BUCKETS; ++bucket )
+	{
+		cumulative+=buckets[bucket];
+		if( cumulative>=target ) return bucketUpperBound( bucket );
+	}
+	return bucketUpperBound( NUMBER_OF_BUCKETS-1 );
+}
+
+std::chrono::microseconds communique::LatencyHistogram::mean() const
+{
+	if( count==0 ) return std::chrono::microseconds(0);
+	return std::chrono::microseconds( totalMicroseconds/count );
+}
+
+communique::LatencyHistogram& communique::LatencyHistogram::operator+=( const LatencyHistogram& other )
+{
+	for( size_t bucket=0; bucket<NUMBER_OF_BUCKETS; ++bucket ) buckets[bucket]+=other.buckets[bucket];
+	count+=other.count;
+	totalMicroseconds+=other.totalMicroseconds;
+	return *this;
+}
+
+communique::MessageCounts::MessageCounts()
+	: requests(0), responses(0), infos(0), requestErrors(0)
+{
+	// No operation besides initialiser list
+}
+
+uint64_t communique::MessageCounts::total() const
+{
+	return requests+responses+infos+requestErrors;
+}
+
+communique::MessageCounts& communique::MessageCounts::operator+=( const MessageCounts& other )
+{
+	requests+=other.requests;
+	responses+=other.responses;
+	infos+=other.infos;
+	requestErrors+=other.requestErrors;
+	return *this;
+}
+
+communique::Stats::Stats()
+	: bytesSent(0), bytesReceived(0), requestsOutstanding(0), requestsInProgress(0), sendQueueBytes(0), connections(0)
+{
+	// No operation besides initialiser list
+}
+
+bool communique::Stats::enabled()
+{
+#ifdef COMMUNIQUE_NO_STATS
+	return false;
+#else
+	return true;
+#endif
+}
+
+communique::Stats& communique::Stats::operator+=( const Stats& other )
+{
+	messagesSent+=other.messagesSent;
+	messagesReceived+=other.messagesReceived;
+	bytesSent+=other.bytesSent;
+	bytesReceived+=other.bytesReceived;
+	requestsOutstanding+=other.requestsOutstanding;
+	requestsInProgress+=other.requestsInProgress;
+	sendQueueBytes+=other.sendQueueBytes;
+	connections+=other.connections;
+	requestHandlerTime+=other.requestHandlerTime;
+	infoHandlerTime+=other.infoHandlerTime;
+	responseTime+=other.responseTime;
+	return *this;
+}
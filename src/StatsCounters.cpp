@@ -0,0 +1,43 @@
+#include "communique/impl/StatsCounters.h"
+
+#ifndef COMMUNIQUE_NO_STATS
+#include <mutex>
+#include <bitset>
+
+// Unnamed namespace for things only used in this file
+namespace
+{
+	/// Which of the writer indices are held by a thread. Only access while holding writerSlotsMutex.
+	std::bitset<communique::impl::StatsCounters::NUMBER_OF_WRITERS> writerSlotsTaken;
+	std::mutex writerSlotsMutex;
+
+	size_t claimWriterSlot()
+	{
+		std::lock_guard<std::mutex> lock( writerSlotsMutex );
+		for( size_t index=0; index<writerSlotsTaken.size(); ++index )
+		{
+			if( !writerSlotsTaken[index] )
+			{
+				writerSlotsTaken[index]=true;
+				return index;
+			}
+		}
+		return communique::impl::StatsCounters::NUMBER_OF_WRITERS;
+	}
+} // end of the unnamed namespace
+
+// The mutex also means whichever thread gets an index next sees everything the last one stored there
+communique::impl::StatsCounters::WriterSlot::WriterSlot()
+	: index( claimWriterSlot() )
+{
+	// No operation besides initialiser list
+}
+
+communique::impl::StatsCounters::WriterSlot::~WriterSlot()
+{
+	if( index>=NUMBER_OF_WRITERS ) return;
+	std::lock_guard<std::mutex> lock( writerSlotsMutex );
+	writerSlotsTaken[index]=false;
+}
+
+#endif // end of ifndef COMMUNIQUE_NO_STATS
@@ -1,38 +1,337 @@
 #include "communique/impl/TLSHandler.h"
 
 #include "communique/impl/Certificate.h"
+#include <cstring>
+#include <openssl/rand.h>
+#include <openssl/evp.h>
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+#	include <openssl/core_names.h>
+#else
+#	include <openssl/hmac.h>
+#endif
+
+//
+// Unnamed namespace for things only used in this file
+//
+namespace
+{
+	/// The index for storing a pointer to the TLSHandler in the SSL_CTX ex_data
+	int handlerIndex()
+	{
+		static const int index=SSL_CTX_get_ex_new_index( 0, nullptr, nullptr, nullptr, nullptr );
+		return index;
+	}
+
+	/// Frees the session key stored against an SSL object when the SSL object is freed
+	void freeSessionKey( void* pParent, void* pPointer, CRYPTO_EX_DATA* pData, int index, long argl, void* argp )
+	{
+		delete static_cast<std::string*>(pPointer);
+	}
+
+	/// The index for storing the client session key (a heap allocated std::string) in the SSL ex_data
+	int sessionKeyIndex()
+	{
+		static const int index=SSL_get_ex_new_index( 0, nullptr, nullptr, nullptr, &freeSessionKey );
+		return index;
+	}
+
+	/** Default cipher list for TLS 1.2 and below. Forward secret key exchange and AEAD ciphers only, which
+	 * are both the most secure and (with AES-NI or on hardware without it for ChaCha20) the fastest. */
+	const char* defaultCipherList="ECDHE-ECDSA-AES128-GCM-SHA256:ECDHE-RSA-AES128-GCM-SHA256:"
+		"ECDHE-ECDSA-AES256-GCM-SHA384:ECDHE-RSA-AES256-GCM-SHA384:"
+		"ECDHE-ECDSA-CHACHA20-POLY1305:ECDHE-RSA-CHACHA20-POLY1305:"
+		"DHE-RSA-AES128-GCM-SHA256:DHE-RSA-AES256-GCM-SHA384";
+
+	/** Converts to the OpenSSL version number. Returns zero if the version is not supported by the
+	 * OpenSSL library being compiled against, which for SSL_CTX_set_min/max_proto_version means no limit. */
+	int openSSLVersion( communique::TLSVersion version )
+	{
+		switch( version )
+		{
+			case communique::TLSVersion::TLSv1_0 : return TLS1_VERSION;
+			case communique::TLSVersion::TLSv1_1 : return TLS1_1_VERSION;
+			case communique::TLSVersion::TLSv1_2 : return TLS1_2_VERSION;
+#ifdef TLS1_3_VERSION
+			case communique::TLSVersion::TLSv1_3 : return TLS1_3_VERSION;
+#endif
+			default : return 0;
+		}
+	}
+
+	communique::impl::TLSHandler* handlerFromSSL( SSL* pSSL )
+	{
+		return static_cast<communique::impl::TLSHandler*>( SSL_CTX_get_ex_data( SSL_get_SSL_CTX(pSSL), handlerIndex() ) );
+	}
+
+	/// Called by OpenSSL whenever a client receives a new session from the server
+	int newSessionCallback( SSL* pSSL, SSL_SESSION* pSession )
+	{
+		communique::impl::TLSHandler* pHandler=handlerFromSSL( pSSL );
+		if( !pHandler ) return 0;
+		return pHandler->storeClientSession( pSSL, pSession ) ? 1 : 0;
+	}
+
+	/** Called by OpenSSL to encrypt or decrypt session tickets on the server side.
+	 *
+	 * Return values are as specified by OpenSSL: -1 for error, 0 if the key name wasn't found (forces
+	 * a full handshake), 1 for success and 2 to say the ticket was fine but a fresh one should be issued. */
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+	int sessionTicketCallback( SSL* pSSL, unsigned char* pKeyName, unsigned char* pIV, EVP_CIPHER_CTX* pCipherContext, EVP_MAC_CTX* pHMACContext, int encrypt )
+#else
+	int sessionTicketCallback( SSL* pSSL, unsigned char* pKeyName, unsigned char* pIV, EVP_CIPHER_CTX* pCipherContext, HMAC_CTX* pHMACContext, int encrypt )
+#endif
+	{
+		communique::impl::TLSHandler* pHandler=handlerFromSSL( pSSL );
+		if( !pHandler ) return -1;
+
+		communique::impl::TLSHandler::SessionTicketKey key;
+		bool isCurrent;
+		if( encrypt )
+		{
+			if( !pHandler->sessionTicketKey( nullptr, key, isCurrent ) ) return -1;
+			if( RAND_bytes( pIV, EVP_CIPHER_iv_length(EVP_aes_256_cbc()) )!=1 ) return -1;
+			std::memcpy( pKeyName, key.name, sizeof(key.name) );
+			if( EVP_EncryptInit_ex( pCipherContext, EVP_aes_256_cbc(), nullptr, key.aesKey, pIV )!=1 ) return -1;
+		}
+		else
+		{
+			if( !pHandler->sessionTicketKey( pKeyName, key, isCurrent ) ) return 0;
+			if( EVP_DecryptInit_ex( pCipherContext, EVP_aes_256_cbc(), nullptr, key.aesKey, pIV )!=1 ) return -1;
+		}
+
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+		char digestName[]="SHA256";
+		OSSL_PARAM parameters[]={
+			OSSL_PARAM_construct_octet_string( OSSL_MAC_PARAM_KEY, key.hmacKey, sizeof(key.hmacKey) ),
+			OSSL_PARAM_construct_utf8_string( OSSL_MAC_PARAM_DIGEST, digestName, 0 ),
+			OSSL_PARAM_construct_end()
+		};
+		if( EVP_MAC_CTX_set_params( pHMACContext, parameters )!=1 ) return -1;
+#else
+		if( HMAC_Init_ex( pHMACContext, key.hmacKey, sizeof(key.hmacKey), EVP_sha256(), nullptr )!=1 ) return -1;
+#endif
+
+		// If the ticket was encrypted with an old key, ask OpenSSL to issue a new one
+		if( !encrypt && !isCurrent ) return 2;
+		return 1;
+	}
+} // end of the unnamed namespace
 
 communique::impl::TLSHandler::TLSHandler( websocketpp::config::asio::alog_type& logger )
-	: logger_(logger)
+	: minimumVersion_(communique::TLSVersion::TLSv1_2),
+	  maximumVersion_(communique::TLSVersion::TLSv1_3),
+	  cipherList_(defaultCipherList),
+	  serverCipherPreference_(false),
+	  logger_(logger),
+	  sessionResumption_(false),
+	  sessionCacheSize_(SSL_SESSION_CACHE_MAX_SIZE_DEFAULT),
+	  sessionTimeout_(300),
+	  completedHandshakes_(0),
+	  resumedHandshakes_(0)
 {
 	// No operation besides the initialiser list
 }
 
+communique::impl::TLSHandler::~TLSHandler()
+{
+	for( auto& keySessionPair : clientSessions_ ) SSL_SESSION_free( keySessionPair.second );
+}
+
 void communique::impl::TLSHandler::setCertificateChainFile( const std::string& filename )
 {
+	std::lock_guard<std::mutex> lock( contextMutex_ );
 	certificateChainFileName_=filename;
+	pContext_.reset(); // Force a rebuild the next time a context is required
 }
 
 void communique::impl::TLSHandler::setPrivateKeyFile( const std::string& filename )
 {
+	std::lock_guard<std::mutex> lock( contextMutex_ );
 	privateKeyFileName_=filename;
+	pContext_.reset(); // Force a rebuild the next time a context is required
 }
 
 void communique::impl::TLSHandler::setVerifyFile( const std::string& filename )
 {
+	std::lock_guard<std::mutex> lock( contextMutex_ );
 	verifyFileName_=filename;
+	pContext_.reset(); // Force a rebuild the next time a context is required
 }
 
 void communique::impl::TLSHandler::setDiffieHellmanParamsFile( const std::string& filename )
 {
+	std::lock_guard<std::mutex> lock( contextMutex_ );
 	diffieHellmanParamsFileName_=filename;
+	pContext_.reset(); // Force a rebuild the next time a context is required
+}
+
+void communique::impl::TLSHandler::setProtocolVersions( communique::TLSVersion minimum, communique::TLSVersion maximum )
+{
+	if( minimum>maximum ) throw std::runtime_error( "communique::impl::TLSHandler::setProtocolVersions minimum version is higher than the maximum" );
+	std::lock_guard<std::mutex> lock( contextMutex_ );
+	minimumVersion_=minimum;
+	maximumVersion_=maximum;
+	pContext_.reset(); // Force a rebuild the next time a context is required
+}
+
+void communique::impl::TLSHandler::setCipherList( const std::string& cipherList )
+{
+	std::lock_guard<std::mutex> lock( contextMutex_ );
+	cipherList_=cipherList;
+	pContext_.reset(); // Force a rebuild the next time a context is required
+}
+
+void communique::impl::TLSHandler::setCipherSuites( const std::string& cipherSuites )
+{
+	std::lock_guard<std::mutex> lock( contextMutex_ );
+	cipherSuites_=cipherSuites;
+	pContext_.reset(); // Force a rebuild the next time a context is required
+}
+
+void communique::impl::TLSHandler::setCurves( const std::string& curves )
+{
+	std::lock_guard<std::mutex> lock( contextMutex_ );
+	curves_=curves;
+	pContext_.reset(); // Force a rebuild the next time a context is required
+}
+
+void communique::impl::TLSHandler::setServerCipherPreference( bool serverPreference )
+{
+	std::lock_guard<std::mutex> lock( contextMutex_ );
+	serverCipherPreference_=serverPreference;
+	pContext_.reset(); // Force a rebuild the next time a context is required
+}
+
+void communique::impl::TLSHandler::setSessionResumption( bool enabled )
+{
+	std::lock_guard<std::mutex> lock( contextMutex_ );
+	sessionResumption_=enabled;
+	pContext_.reset(); // Force a rebuild the next time a context is required
+	// Make sure there's a key to encrypt tickets with
+	if( enabled && sessionTicketKeys_.empty() ) rotateSessionTicketKeys();
+}
+
+void communique::impl::TLSHandler::setSessionCacheSize( size_t numberOfSessions )
+{
+	std::lock_guard<std::mutex> lock( contextMutex_ );
+	sessionCacheSize_=numberOfSessions;
+	pContext_.reset(); // Force a rebuild the next time a context is required
+}
+
+void communique::impl::TLSHandler::setSessionTimeout( std::chrono::seconds timeout )
+{
+	std::lock_guard<std::mutex> lock( contextMutex_ );
+	sessionTimeout_=timeout;
+	pContext_.reset(); // Force a rebuild the next time a context is required
+}
+
+void communique::impl::TLSHandler::rotateSessionTicketKeys()
+{
+	SessionTicketKey newKey;
+	if( RAND_bytes( newKey.name, sizeof(newKey.name) )!=1
+		|| RAND_bytes( newKey.aesKey, sizeof(newKey.aesKey) )!=1
+		|| RAND_bytes( newKey.hmacKey, sizeof(newKey.hmacKey) )!=1 ) throw std::runtime_error( "communique::impl::TLSHandler::rotateSessionTicketKeys couldn't generate random key" );
+
+	std::lock_guard<std::mutex> lock( sessionTicketKeysMutex_ );
+	sessionTicketKeys_.push_front( newKey );
+	// Keep the previous key for decryption, but nothing older than that
+	while( sessionTicketKeys_.size()>2 ) sessionTicketKeys_.pop_back();
+}
+
+void communique::impl::TLSHandler::prepareClientSession( SSL* pSSL, const std::string& sessionKey ) const
+{
+	if( !sessionResumption_ ) return;
+
+	// Record the key so that when the server sends a session it can be stored in the right place.
+	// Ownership passes to the SSL object, and it's deleted by freeSessionKey.
+	SSL_set_ex_data( pSSL, sessionKeyIndex(), new std::string(sessionKey) );
+
+	std::lock_guard<std::mutex> lock( clientSessionsMutex_ );
+	auto iFindResult=clientSessions_.find( sessionKey );
+	if( iFindResult!=clientSessions_.end() ) SSL_set_session( pSSL, iFindResult->second );
+}
+
+void communique::impl::TLSHandler::recordHandshake( SSL* pSSL )
+{
+	++completedHandshakes_;
+	if( pSSL && SSL_session_reused(pSSL) ) ++resumedHandshakes_;
+}
+
+size_t communique::impl::TLSHandler::completedHandshakes() const
+{
+	return completedHandshakes_;
+}
+
+size_t communique::impl::TLSHandler::resumedHandshakes() const
+{
+	return resumedHandshakes_;
+}
+
+bool communique::impl::TLSHandler::sessionTicketKey( const unsigned char* pName, SessionTicketKey& key, bool& isCurrent ) const
+{
+	std::lock_guard<std::mutex> lock( sessionTicketKeysMutex_ );
+	for( auto iKey=sessionTicketKeys_.begin(); iKey!=sessionTicketKeys_.end(); ++iKey )
+	{
+		if( pName==nullptr || std::memcmp( pName, iKey->name, sizeof(iKey->name) )==0 )
+		{
+			key=*iKey;
+			isCurrent=( iKey==sessionTicketKeys_.begin() );
+			return true;
+		}
+	}
+	return false;
+}
+
+bool communique::impl::TLSHandler::storeClientSession( SSL* pSSL, SSL_SESSION* pSession ) const
+{
+	// Server side sessions won't have a key, those are left to OpenSSL's internal cache
+	const std::string* pSessionKey=static_cast<const std::string*>( SSL_get_ex_data( pSSL, sessionKeyIndex() ) );
+	if( !pSessionKey ) return false;
+
+	std::lock_guard<std::mutex> lock( clientSessionsMutex_ );
+	SSL_SESSION*& pStoredSession=clientSessions_[*pSessionKey];
+	if( pStoredSession ) SSL_SESSION_free( pStoredSession );
+	pStoredSession=pSession;
+	return true;
+}
+
+websocketpp::lib::shared_ptr<websocketpp::lib::asio::ssl::context> communique::impl::TLSHandler::context() const
+{
+	std::lock_guard<std::mutex> lock( contextMutex_ );
+	if( !pContext_ ) pContext_=buildContext();
+	return pContext_;
 }
 
 websocketpp::lib::shared_ptr<websocketpp::lib::asio::ssl::context> communique::impl::TLSHandler::on_tls_init( websocketpp::connection_hdl hdl ) const
 {
+	return context();
+}
+
+websocketpp::lib::shared_ptr<websocketpp::lib::asio::ssl::context> communique::impl::TLSHandler::buildContext() const
+{
+	// Don't lock - assume this has already been done by the caller.
 	namespace asio=websocketpp::lib::asio;
-	websocketpp::lib::shared_ptr<asio::ssl::context> pContext( new asio::ssl::context(asio::ssl::context::tlsv1) );
-	pContext->set_options( asio::ssl::context::default_workarounds | asio::ssl::context::no_sslv2 | asio::ssl::context::single_dh_use );
+	// sslv23 is the generic method that can negotiate any version, it's restricted to the requested versions below
+	websocketpp::lib::shared_ptr<asio::ssl::context> pContext( new asio::ssl::context(asio::ssl::context::sslv23) );
+	pContext->set_options( asio::ssl::context::default_workarounds | asio::ssl::context::no_sslv2 | asio::ssl::context::no_sslv3 | asio::ssl::context::single_dh_use );
+
+	SSL_CTX* pRawContext=pContext->native_handle();
+#if OPENSSL_VERSION_NUMBER >= 0x10100000L
+	if( !SSL_CTX_set_min_proto_version( pRawContext, openSSLVersion(minimumVersion_) )
+		|| !SSL_CTX_set_max_proto_version( pRawContext, openSSLVersion(maximumVersion_) ) ) throw std::runtime_error( "Unable to set the TLS protocol versions" );
+#else
+	// Older OpenSSL versions can only turn off individual versions
+	if( minimumVersion_>communique::TLSVersion::TLSv1_0 || maximumVersion_<communique::TLSVersion::TLSv1_0 ) pContext->set_options( asio::ssl::context::no_tlsv1 );
+	if( minimumVersion_>communique::TLSVersion::TLSv1_1 || maximumVersion_<communique::TLSVersion::TLSv1_1 ) pContext->set_options( asio::ssl::context::no_tlsv1_1 );
+	if( minimumVersion_>communique::TLSVersion::TLSv1_2 || maximumVersion_<communique::TLSVersion::TLSv1_2 ) pContext->set_options( asio::ssl::context::no_tlsv1_2 );
+#endif
+	if( !cipherList_.empty() && !SSL_CTX_set_cipher_list( pRawContext, cipherList_.c_str() ) ) throw std::runtime_error( "Unable to set the cipher list \""+cipherList_+"\"" );
+#ifdef TLS1_3_VERSION
+	if( !cipherSuites_.empty() && !SSL_CTX_set_ciphersuites( pRawContext, cipherSuites_.c_str() ) ) throw std::runtime_error( "Unable to set the TLS 1.3 cipher suites \""+cipherSuites_+"\"" );
+#endif
+	if( !curves_.empty() && !SSL_CTX_set1_curves_list( pRawContext, curves_.c_str() ) ) throw std::runtime_error( "Unable to set the ECDHE curves \""+curves_+"\"" );
+	if( serverCipherPreference_ ) SSL_CTX_set_options( pRawContext, SSL_OP_CIPHER_SERVER_PREFERENCE );
+
 	//pContext->set_password_callback( websocketpp::lib::bind( &server::get_password, this ) );
 	if( !certificateChainFileName_.empty() ) pContext->use_certificate_chain_file( certificateChainFileName_ );
 	if( !privateKeyFileName_.empty() ) pContext->use_private_key_file( privateKeyFileName_, asio::ssl::context::pem );
@@ -45,6 +344,31 @@ websocketpp::lib::shared_ptr<websocketpp::lib::asio::ssl::context> communique::i
 	else pContext->set_verify_mode( asio::ssl::verify_none );
 	if( !diffieHellmanParamsFileName_.empty() ) pContext->use_tmp_dh_file( diffieHellmanParamsFileName_ );
 
+	if( sessionResumption_ )
+	{
+		// The callbacks need to find this instance from the raw OpenSSL context
+		SSL_CTX_set_ex_data( pRawContext, handlerIndex(), const_cast<TLSHandler*>(this) );
+		// Don't know whether this is a client or server context, but the settings for one are ignored by the other.
+		// Client sessions are stored by this class rather than OpenSSL so that they can be keyed by URI.
+		SSL_CTX_set_session_cache_mode( pRawContext, SSL_SESS_CACHE_SERVER | SSL_SESS_CACHE_CLIENT );
+		SSL_CTX_sess_set_cache_size( pRawContext, sessionCacheSize_ );
+		SSL_CTX_set_timeout( pRawContext, static_cast<long>(sessionTimeout_.count()) );
+		SSL_CTX_sess_set_new_cb( pRawContext, &newSessionCallback );
+		// Servers that verify the peer have to set a session ID context or resumption fails
+		static const unsigned char sessionIdContext[]="communique";
+		SSL_CTX_set_session_id_context( pRawContext, sessionIdContext, sizeof(sessionIdContext)-1 );
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+		SSL_CTX_set_tlsext_ticket_key_evp_cb( pRawContext, &sessionTicketCallback );
+#else
+		SSL_CTX_set_tlsext_ticket_key_cb( pRawContext, &sessionTicketCallback );
+#endif
+	}
+	else
+	{
+		SSL_CTX_set_session_cache_mode( pRawContext, SSL_SESS_CACHE_OFF );
+		SSL_CTX_set_options( pRawContext, SSL_OP_NO_TICKET );
+	}
+
 	return pContext;
 }
 
@@ -0,0 +1,124 @@
+#include "communique/ThreadPool.h"
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <vector>
+#include <stdexcept>
+#include <iostream>
+
+//
+// Declaration of the pimple
+//
+namespace communique
+{
+	class ThreadPoolPrivateMembers
+	{
+	public:
+		ThreadPoolPrivateMembers( size_t maximumQueueSize ) : maximumQueueSize_(maximumQueueSize), stopping_(false) { /*No operation besides initialiser list*/ }
+		std::vector<std::thread> threads_;
+		std::deque< std::function<void()> > tasks_;
+		const size_t maximumQueueSize_;
+		bool stopping_;
+		mutable std::mutex tasksMutex_;
+		std::condition_variable taskAvailable_; ///< Signalled when a task is added or the pool is stopping
+		std::condition_variable spaceAvailable_; ///< Signalled when a task is taken off the queue
+
+		void workerLoop();
+	};
+}
+
+communique::ThreadPool::ThreadPool( size_t numberOfThreads, size_t maximumQueueSize )
+	: pImple_( new ThreadPoolPrivateMembers( maximumQueueSize>0 ? maximumQueueSize : 1 ) )
+{
+	if( numberOfThreads==0 ) numberOfThreads=std::thread::hardware_concurrency();
+	if( numberOfThreads==0 ) numberOfThreads=1; // hardware_concurrency() is allowed to return zero if it doesn't know
+
+	for( size_t index=0; index<numberOfThreads; ++index )
+	{
+		pImple_->threads_.emplace_back( &ThreadPoolPrivateMembers::workerLoop, pImple_.get() );
+	}
+}
+
+communique::ThreadPool::ThreadPool( ThreadPool&& otherThreadPool ) noexcept
+	: pImple_( std::move(otherThreadPool.pImple_) )
+{
+	// No operation, everything done in initialiser list
+}
+
+communique::ThreadPool::~ThreadPool()
+{
+	// If std::move is used then pImple_ can be null, in which
+	// case I don't want to do any cleanup.
+	if( !pImple_ ) return;
+
+	{ // Block to limit lifetime of the lock_guard
+		std::lock_guard<std::mutex> lock( pImple_->tasksMutex_ );
+		pImple_->stopping_=true;
+	}
+	pImple_->taskAvailable_.notify_all();
+	pImple_->spaceAvailable_.notify_all();
+
+	for( auto& thread : pImple_->threads_ )
+	{
+		if( thread.joinable() ) thread.join();
+	}
+}
+
+void communique::ThreadPool::execute( std::function<void()> task )
+{
+	{ // Block to limit lifetime of the lock
+		std::unique_lock<std::mutex> lock( pImple_->tasksMutex_ );
+		pImple_->spaceAvailable_.wait( lock, [this]{ return pImple_->stopping_ || pImple_->tasks_.size()<pImple_->maximumQueueSize_; } );
+		if( pImple_->stopping_ ) throw std::runtime_error( "communique::ThreadPool::execute called while the pool is shutting down" );
+		pImple_->tasks_.emplace_back( std::move(task) );
+	}
+	pImple_->taskAvailable_.notify_one();
+}
+
+size_t communique::ThreadPool::numberOfThreads() const
+{
+	return pImple_->threads_.size();
+}
+
+size_t communique::ThreadPool::maximumQueueSize() const
+{
+	return pImple_->maximumQueueSize_;
+}
+
+size_t communique::ThreadPool::queueSize() const
+{
+	std::lock_guard<std::mutex> lock( pImple_->tasksMutex_ );
+	return pImple_->tasks_.size();
+}
+
+void communique::ThreadPoolPrivateMembers::workerLoop()
+{
+	while( true )
+	{
+		std::function<void()> task;
+		{ // Block to limit lifetime of the lock
+			std::unique_lock<std::mutex> lock( tasksMutex_ );
+			taskAvailable_.wait( lock, [this]{ return stopping_ || !tasks_.empty(); } );
+			// Only quit once everything that was queued has been run
+			if( tasks_.empty() ) return;
+			task=std::move( tasks_.front() );
+			tasks_.pop_front();
+		}
+		spaceAvailable_.notify_one();
+
+		try
+		{
+			task();
+		}
+		catch( std::exception& error )
+		{
+			std::cerr << "communique::ThreadPool - task threw an exception: " << error.what() << std::endl;
+		}
+		catch(...)
+		{
+			std::cerr << "communique::ThreadPool - task threw an unknown exception" << std::endl;
+		}
+	}
+}
@@ -0,0 +1,149 @@
+#include "communique/impl/TimingWheel.h"
+
+#include <iostream>
+
+communique::impl::TimingWheel::TimingWheel( std::chrono::milliseconds tickDuration, size_t numberOfSlots )
+	: tickDuration_( tickDuration.count()>0 ? tickDuration : std::chrono::milliseconds(1) ),
+	  slots_( numberOfSlots>0 ? numberOfSlots : 1 ),
+	  currentSlot_(0),
+	  nextId_(1),
+	  stopping_(false),
+	  pDestroyedByCallback_(nullptr)
+{
+	// No operation besides the initialiser list. The thread isn't started until a timer is added.
+}
+
+communique::impl::TimingWheel::~TimingWheel()
+{
+	{ // Block to limit lifetime of the lock_guard
+		std::lock_guard<std::mutex> lock( mutex_ );
+		stopping_=true;
+	}
+	wakeUp_.notify_all();
+	if( !tickThread_.joinable() ) return;
+
+	if( std::this_thread::get_id()==tickThread_.get_id() )
+	{
+		// A callback dropped the last reference to the wheel, e.g. by destroying the Client it belongs to. The
+		// thread can't join itself, so leave it to finish on its own and tell it not to touch anything here again.
+		if( pDestroyedByCallback_ ) *pDestroyedByCallback_=true;
+		tickThread_.detach();
+	}
+	else tickThread_.join();
+}
+
+communique::impl::TimingWheel::TimerId communique::impl::TimingWheel::newId()
+{
+	std::lock_guard<std::mutex> lock( mutex_ );
+	return nextId_++;
+}
+
+communique::impl::TimingWheel::TimerId communique::impl::TimingWheel::add( std::chrono::milliseconds timeout, std::function<void()> callback )
+{
+	TimerId id=newId();
+	add( id, timeout, std::move(callback) );
+	return id;
+}
+
+void communique::impl::TimingWheel::add( TimerId id, std::chrono::milliseconds timeout, std::function<void()> callback )
+{
+	// Round up, so that the timer never fires early. Always at least one tick, because the current tick
+	// could be just about to finish.
+	size_t ticks=static_cast<size_t>( (timeout.count()+tickDuration_.count()-1)/tickDuration_.count() );
+	if( ticks==0 ) ticks=1;
+
+	bool wasEmpty;
+	{ // Block to limit lifetime of the lock_guard
+		std::lock_guard<std::mutex> lock( mutex_ );
+		if( stopping_ ) return;
+		wasEmpty=timerLocations_.empty();
+
+		size_t slot=(currentSlot_+ticks)%slots_.size();
+		Timer newTimer={ id, (ticks-1)/slots_.size(), std::move(callback) };
+		auto iTimer=slots_[slot].insert( slots_[slot].end(), std::move(newTimer) );
+		timerLocations_[id]=std::make_pair( slot, iTimer );
+
+		if( !tickThread_.joinable() ) tickThread_=std::thread( &TimingWheel::tickLoop, this );
+	}
+	// The thread sleeps without a timeout when there's nothing to do, so make sure it starts ticking again
+	if( wasEmpty ) wakeUp_.notify_all();
+}
+
+bool communique::impl::TimingWheel::cancel( TimerId id )
+{
+	std::lock_guard<std::mutex> lock( mutex_ );
+	auto iFindResult=timerLocations_.find( id );
+	if( iFindResult==timerLocations_.end() ) return false;
+
+	slots_[iFindResult->second.first].erase( iFindResult->second.second );
+	timerLocations_.erase( iFindResult );
+	return true;
+}
+
+size_t communique::impl::TimingWheel::size() const
+{
+	std::lock_guard<std::mutex> lock( mutex_ );
+	return timerLocations_.size();
+}
+
+void communique::impl::TimingWheel::tickLoop()
+{
+	std::unique_lock<std::mutex> lock( mutex_ );
+	bool destroyed=false;
+	pDestroyedByCallback_=&destroyed;
+	auto nextTick=std::chrono::steady_clock::now()+tickDuration_;
+	while( !stopping_ )
+	{
+		if( timerLocations_.empty() )
+		{
+			// Nothing to do, so sleep until a timer is added. The wheel doesn't need to turn while it's empty.
+			wakeUp_.wait( lock, [this]{ return stopping_ || !timerLocations_.empty(); } );
+			nextTick=std::chrono::steady_clock::now()+tickDuration_;
+			continue;
+		}
+
+		if( wakeUp_.wait_until( lock, nextTick, [this]{ return stopping_; } ) ) break;
+		nextTick+=tickDuration_;
+
+		// Move on to the next slot, and take out everything that's due
+		currentSlot_=(currentSlot_+1)%slots_.size();
+		std::list<Timer>& slot=slots_[currentSlot_];
+		std::list<Timer> expired;
+		for( auto iTimer=slot.begin(); iTimer!=slot.end(); )
+		{
+			if( iTimer->rounds==0 )
+			{
+				timerLocations_.erase( iTimer->id );
+				auto iNext=std::next(iTimer);
+				expired.splice( expired.end(), slot, iTimer );
+				iTimer=iNext;
+			}
+			else
+			{
+				--iTimer->rounds;
+				++iTimer;
+			}
+		}
+
+		// Don't hold the lock while running the callbacks, since they might want to add or cancel timers
+		lock.unlock();
+		for( auto& timer : expired )
+		{
+			try
+			{
+				timer.callback();
+			}
+			catch( std::exception& error )
+			{
+				std::cerr << "communique::impl::TimingWheel - callback threw an exception: " << error.what() << std::endl;
+			}
+			catch(...)
+			{
+				std::cerr << "communique::impl::TimingWheel - callback threw an unknown exception" << std::endl;
+			}
+			// The rest of expired is local, so it's safe to let it go without running it
+			if( destroyed ) return;
+		}
+		lock.lock();
+	}
+}
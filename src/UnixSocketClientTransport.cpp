@@ -0,0 +1,125 @@
+#include "communique/impl/UnixSocketClientTransport.h"
+#include <stdexcept>
+#include "communique/impl/UnixSocketSession.h"
+#include "communique/impl/WebsocketConnection.h"
+
+communique::impl::UnixSocketClientTransport::UnixSocketClientTransport( websocketpp::lib::asio::io_service* pIoService )
+	: pOwnIoService_( pIoService ? nullptr : new websocketpp::lib::asio::io_service ),
+	  ioService_( pIoService ? *pIoService : *pOwnIoService_ )
+{
+	client_.set_access_channels(websocketpp::log::alevel::none);
+	client_.set_error_channels(websocketpp::log::elevel::none);
+	// The handlers are set on each connection in createConnection rather than on the endpoint
+}
+
+std::shared_ptr<communique::impl::Connection> communique::impl::UnixSocketClientTransport::createConnection( const std::string& URI )
+{
+	static const std::string scheme="unix://";
+	if( URI.size()<=scheme.size() || URI.compare( 0, scheme.size(), scheme )!=0 )
+	{
+		throw std::runtime_error( "Unix socket URIs have to be \""+scheme+"\" followed by the path to the socket, not \""+URI+"\"" );
+	}
+	websocketpp::lib::asio::local::stream_protocol::endpoint endpoint( URI.substr( scheme.size() ) );
+
+	// The WebSocket handshake still needs a URI, but the host in it is never used
+	websocketpp::lib::error_code errorCode;
+	auto pWebPPConnection=client_.get_connection( "ws://localhost/", errorCode );
+	if( errorCode.value()!=0 ) throw std::runtime_error( "Unable to get the websocketpp connection - "+errorCode.message() );
+	// The session keeps the connection, so these keep this alive for as long as there's any IO for it
+	auto pThis=std::static_pointer_cast<UnixSocketClientTransport>( shared_from_this() );
+	pWebPPConnection->set_open_handler( [pThis]( websocketpp::connection_hdl hdl ){ pThis->on_open( hdl ); } );
+	pWebPPConnection->set_close_handler( [pThis]( websocketpp::connection_hdl hdl ){ pThis->on_close( hdl ); } );
+	pWebPPConnection->set_interrupt_handler( [pThis]( websocketpp::connection_hdl hdl ){ pThis->on_interrupt( hdl ); } );
+	pWebPPConnection->set_fail_handler( [pThis]( websocketpp::connection_hdl hdl ){ pThis->on_fail( hdl ); } );
+
+	{ // Block to limit lifetime of the lock_guard
+		std::lock_guard<std::mutex> lock( endpointMutex_ );
+		endpoint_=endpoint;
+	}
+	return communique::impl::WebsocketConnection<websocketpp::config::core>::create( pWebPPConnection );
+}
+
+void communique::impl::UnixSocketClientTransport::connect( communique::impl::Connection& connection )
+{
+	auto pRawConnection=static_cast< communique::impl::WebsocketConnection<websocketpp::config::core>& >(connection).underlyingPointer();
+	websocketpp::lib::asio::local::stream_protocol::endpoint endpoint;
+	{ // Block to limit lifetime of the lock_guard
+		std::lock_guard<std::mutex> lock( endpointMutex_ );
+		endpoint=endpoint_;
+	}
+
+	auto pSession=std::make_shared<communique::impl::UnixSocketSession>( ioService_ );
+	pSession->attach( pRawConnection );
+	auto pThis=std::static_pointer_cast<UnixSocketClientTransport>( shared_from_this() );
+	pSession->socket().async_connect( endpoint, [pThis,pSession,pRawConnection]( const websocketpp::lib::asio::error_code& errorCode )
+		{
+			// Start the connection whether the socket connected or not. If it didn't, the handshake
+			// fails to send and the fail handler is called the same as for any other transport.
+			if( errorCode ) pSession->failWrites( errorCode );
+			pThis->client_.connect( pRawConnection );
+			if( !errorCode ) pSession->startReading();
+		} );
+}
+
+void communique::impl::UnixSocketClientTransport::run()
+{
+	ioService_.run();
+}
+
+void communique::impl::UnixSocketClientTransport::reset()
+{
+	ioService_.reset();
+}
+
+websocketpp::lib::asio::io_service& communique::impl::UnixSocketClientTransport::ioService()
+{
+	return ioService_;
+}
+
+websocketpp::config::asio::alog_type& communique::impl::UnixSocketClientTransport::accessLog()
+{
+	return client_.get_alog();
+}
+
+void communique::impl::UnixSocketClientTransport::setErrorLogLocation( std::ostream& outputStream )
+{
+	client_.get_elog().set_ostream( &outputStream );
+}
+
+void communique::impl::UnixSocketClientTransport::setErrorLogLevel( uint32_t level )
+{
+	client_.set_error_channels(level);
+}
+
+void communique::impl::UnixSocketClientTransport::setAccessLogLocation( std::ostream& outputStream )
+{
+	client_.get_alog().set_ostream( &outputStream );
+}
+
+void communique::impl::UnixSocketClientTransport::setAccessLogLevel( uint32_t level )
+{
+	client_.set_access_channels(level);
+}
+
+void communique::impl::UnixSocketClientTransport::on_open( websocketpp::connection_hdl hdl )
+{
+	if( onOpen ) onOpen();
+}
+
+void communique::impl::UnixSocketClientTransport::on_close( websocketpp::connection_hdl hdl )
+{
+	if( onClose ) onClose();
+}
+
+void communique::impl::UnixSocketClientTransport::on_fail( websocketpp::connection_hdl hdl )
+{
+	websocketpp::lib::error_code errorCode;
+	auto pRawConnection=client_.get_con_from_hdl( hdl, errorCode );
+	std::string reason=( pRawConnection ? pRawConnection->get_ec().message() : errorCode.message() );
+	if( onFail ) onFail( reason );
+}
+
+void communique::impl::UnixSocketClientTransport::on_interrupt( websocketpp::connection_hdl hdl )
+{
+	if( onInterrupt ) onInterrupt();
+}
@@ -0,0 +1,124 @@
+#include "communique/impl/UnixSocketServerTransport.h"
+#include <stdexcept>
+#include <unistd.h>
+#include "communique/impl/UnixSocketSession.h"
+#include "communique/impl/unixSocketTools.h"
+#include "communique/impl/WebsocketConnection.h"
+
+communique::impl::UnixSocketServerTransport::UnixSocketServerTransport( websocketpp::lib::asio::io_service* pIoService )
+	: pOwnIoService_( pIoService ? nullptr : new websocketpp::lib::asio::io_service ),
+	  ioService_( pIoService ? *pIoService : *pOwnIoService_ ),
+	  acceptor_( ioService_ )
+{
+	server_.set_access_channels(websocketpp::log::alevel::none);
+	server_.set_error_channels(websocketpp::log::elevel::none);
+	// The handlers are set on each connection in on_accept rather than on the endpoint
+}
+
+communique::impl::UnixSocketServerTransport::~UnixSocketServerTransport()
+{
+	stopListening();
+}
+
+void communique::impl::UnixSocketServerTransport::listen( const std::string& socketPath )
+{
+	communique::impl::listenOnUnixSocket( acceptor_, socketPath );
+	socketPath_=socketPath;
+	startAccept();
+}
+
+bool communique::impl::UnixSocketServerTransport::isListening() const
+{
+	return acceptor_.is_open();
+}
+
+void communique::impl::UnixSocketServerTransport::stopListening()
+{
+	websocketpp::lib::asio::error_code ignoredError;
+	acceptor_.close( ignoredError );
+	if( !socketPath_.empty() ) ::unlink( socketPath_.c_str() );
+	socketPath_.clear();
+}
+
+void communique::impl::UnixSocketServerTransport::run()
+{
+	ioService_.run();
+}
+
+void communique::impl::UnixSocketServerTransport::stop()
+{
+	ioService_.stop();
+}
+
+void communique::impl::UnixSocketServerTransport::reset()
+{
+	ioService_.reset();
+}
+
+websocketpp::config::asio::alog_type& communique::impl::UnixSocketServerTransport::accessLog()
+{
+	return server_.get_alog();
+}
+
+void communique::impl::UnixSocketServerTransport::setErrorLogLocation( std::ostream& outputStream )
+{
+	server_.get_elog().set_ostream( &outputStream );
+}
+
+void communique::impl::UnixSocketServerTransport::setErrorLogLevel( uint32_t level )
+{
+	server_.set_error_channels(level);
+}
+
+void communique::impl::UnixSocketServerTransport::setAccessLogLocation( std::ostream& outputStream )
+{
+	server_.get_alog().set_ostream( &outputStream );
+}
+
+void communique::impl::UnixSocketServerTransport::setAccessLogLevel( uint32_t level )
+{
+	server_.set_access_channels(level);
+}
+
+void communique::impl::UnixSocketServerTransport::startAccept()
+{
+	auto pSession=std::make_shared<communique::impl::UnixSocketSession>( ioService_ );
+	auto pThis=std::static_pointer_cast<UnixSocketServerTransport>( shared_from_this() );
+	acceptor_.async_accept( pSession->socket(), [pThis,pSession]( const websocketpp::lib::asio::error_code& errorCode ){ pThis->on_accept( pSession, errorCode ); } );
+}
+
+void communique::impl::UnixSocketServerTransport::on_accept( std::shared_ptr<communique::impl::UnixSocketSession> pSession, const websocketpp::lib::asio::error_code& errorCode )
+{
+	if( errorCode==websocketpp::lib::asio::error::operation_aborted ) return; // stopListening has been called
+
+	if( !errorCode )
+	{
+		auto pRawConnection=server_.get_connection();
+		// The session keeps the connection, so these keep this alive for as long as there's any IO for it
+		auto pThis=std::static_pointer_cast<UnixSocketServerTransport>( shared_from_this() );
+		pRawConnection->set_open_handler( [pThis]( websocketpp::connection_hdl hdl ){ pThis->on_open( hdl ); } );
+		pRawConnection->set_close_handler( [pThis]( websocketpp::connection_hdl hdl ){ pThis->on_close( hdl ); } );
+		pRawConnection->set_interrupt_handler( [pThis]( websocketpp::connection_hdl hdl ){ pThis->on_interrupt( hdl ); } );
+		pSession->attach( pRawConnection );
+		pRawConnection->start();
+		pSession->startReading();
+	}
+	else server_.get_elog().write( websocketpp::log::elevel::rerror, "Unix socket accept failed: "+errorCode.message() );
+
+	if( acceptor_.is_open() ) startAccept();
+}
+
+void communique::impl::UnixSocketServerTransport::on_open( websocketpp::connection_hdl hdl )
+{
+	if( onOpen ) onOpen( communique::impl::WebsocketConnection<websocketpp::config::core>::create( server_.get_con_from_hdl(hdl) ) );
+}
+
+void communique::impl::UnixSocketServerTransport::on_close( websocketpp::connection_hdl hdl )
+{
+	if( onClose ) onClose( server_.get_con_from_hdl(hdl).get() );
+}
+
+void communique::impl::UnixSocketServerTransport::on_interrupt( websocketpp::connection_hdl hdl )
+{
+	if( onInterrupt ) onInterrupt( server_.get_con_from_hdl(hdl).get() );
+}
@@ -0,0 +1,131 @@
+#include "communique/impl/UnixSocketSession.h"
+
+communique::impl::UnixSocketSession::UnixSocketSession( websocketpp::lib::asio::io_service& ioService )
+	: socket_(ioService), strand_(ioService), writing_(false), closeRequested_(false)
+{
+	// No operation besides the initialiser list
+}
+
+communique::impl::UnixSocketSession::socket_type& communique::impl::UnixSocketSession::socket()
+{
+	return socket_;
+}
+
+void communique::impl::UnixSocketSession::attach( connection_ptr pConnection )
+{
+	pConnection_=pConnection;
+
+	// The connection is owned by this session, so only hold weak pointers back to it
+	std::weak_ptr<UnixSocketSession> pWeakThis=shared_from_this();
+	pConnection_->set_write_handler( [pWeakThis]( websocketpp::connection_hdl hdl, const char* data, size_t length ) -> websocketpp::lib::error_code
+		{
+			auto pThis=pWeakThis.lock();
+			if( !pThis ) return websocketpp::transport::error::make_error_code( websocketpp::transport::error::action_after_shutdown );
+			return pThis->write( data, length );
+		} );
+	pConnection_->set_shutdown_handler( [pWeakThis]( websocketpp::connection_hdl hdl ) -> websocketpp::lib::error_code
+		{
+			// Closing the socket cancels the read, so has to be done on the strand. Anything already queued,
+			// e.g. the close frame, still goes out first.
+			auto pThis=pWeakThis.lock();
+			if( pThis ) pThis->strand_.post( [pThis]()
+				{
+					pThis->closeRequested_=true;
+					bool isWriting;
+					{ // Block to limit lifetime of the lock_guard
+						std::lock_guard<std::mutex> lock( pThis->writeMutex_ );
+						isWriting=pThis->writing_;
+					}
+					if( !isWriting ) pThis->closeSocket();
+				} );
+			return websocketpp::lib::error_code();
+		} );
+}
+
+void communique::impl::UnixSocketSession::startReading()
+{
+	auto pThis=shared_from_this();
+	socket_.async_read_some( websocketpp::lib::asio::buffer( readBuffer_ ), strand_.wrap( [pThis]( const websocketpp::lib::asio::error_code& errorCode, size_t bytesRead )
+		{
+			pThis->on_read( errorCode, bytesRead );
+		} ) );
+}
+
+void communique::impl::UnixSocketSession::failWrites( const websocketpp::lib::asio::error_code& errorCode )
+{
+	std::lock_guard<std::mutex> lock( writeMutex_ );
+	writeError_=errorCode;
+}
+
+websocketpp::lib::error_code communique::impl::UnixSocketSession::write( const char* data, size_t length )
+{
+	bool startWriting=false;
+	{ // Block to limit lifetime of the lock_guard
+		std::lock_guard<std::mutex> lock( writeMutex_ );
+		if( writeError_ ) return writeError_;
+		pendingWrite_.append( data, length );
+		if( !writing_ ) startWriting=writing_=true;
+	}
+	// Anything sent while a write is in progress is picked up when it finishes, along with everything else sent by then
+	if( startWriting ) strand_.post( std::bind( &UnixSocketSession::writeQueued, shared_from_this() ) );
+	return websocketpp::lib::error_code();
+}
+
+void communique::impl::UnixSocketSession::writeQueued()
+{
+	{ // Block to limit lifetime of the lock_guard
+		std::lock_guard<std::mutex> lock( writeMutex_ );
+		bytesBeingWritten_.clear();
+		bytesBeingWritten_.swap( pendingWrite_ );
+		if( bytesBeingWritten_.empty() ) writing_=false;
+	}
+
+	if( bytesBeingWritten_.empty() )
+	{
+		if( closeRequested_ ) closeSocket();
+		return;
+	}
+
+	websocketpp::lib::asio::async_write( socket_, websocketpp::lib::asio::buffer( bytesBeingWritten_ ),
+		strand_.wrap( std::bind( &UnixSocketSession::on_write, shared_from_this(), std::placeholders::_1 ) ) );
+}
+
+void communique::impl::UnixSocketSession::closeSocket()
+{
+	websocketpp::lib::asio::error_code ignoredError;
+	socket_.shutdown( socket_type::shutdown_both, ignoredError );
+	socket_.close( ignoredError );
+}
+
+void communique::impl::UnixSocketSession::on_write( const websocketpp::lib::asio::error_code& errorCode )
+{
+	if( errorCode )
+	{
+		// Fail everything sent from now on. Closing the socket makes the read fail too, which tells the connection.
+		{ // Block to limit lifetime of the lock_guard
+			std::lock_guard<std::mutex> lock( writeMutex_ );
+			writeError_=errorCode;
+			writing_=false;
+			pendingWrite_.clear();
+		}
+		closeSocket();
+		return;
+	}
+	writeQueued();
+}
+
+void communique::impl::UnixSocketSession::on_read( const websocketpp::lib::asio::error_code& errorCode, size_t bytesRead )
+{
+	if( errorCode )
+	{
+		// If the connection hasn't already closed this tells it the other end has gone, which calls
+		// the close or fail handler. If it has this does nothing.
+		if( errorCode==websocketpp::lib::asio::error::eof ) pConnection_->eof();
+		else pConnection_->fatal_error();
+		closeSocket();
+		return;
+	}
+
+	pConnection_->read_all( readBuffer_.data(), bytesRead );
+	startReading();
+}
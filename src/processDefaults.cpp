@@ -0,0 +1,19 @@
+#include "communique/impl/processDefaults.h"
+
+#include "communique/ThreadPool.h"
+#include "communique/impl/TimingWheel.h"
+
+// Function local statics are only initialised once even if several threads get here at the same time. Holding
+// them until exit also means the last reference can never be dropped on one of their own threads.
+
+std::shared_ptr<communique::IExecutor> communique::impl::processDefaultExecutor()
+{
+	static const std::shared_ptr<communique::IExecutor> pExecutor=std::make_shared<communique::ThreadPool>();
+	return pExecutor;
+}
+
+std::shared_ptr<communique::impl::TimingWheel> communique::impl::processTimingWheel()
+{
+	static const std::shared_ptr<communique::impl::TimingWheel> pTimingWheel=std::make_shared<communique::impl::TimingWheel>();
+	return pTimingWheel;
+}
@@ -0,0 +1,23 @@
+#include "communique/impl/unixSocketTools.h"
+#include <stdexcept>
+#include <sys/stat.h>
+#include <unistd.h>
+
+void communique::impl::listenOnUnixSocket( websocketpp::lib::asio::local::stream_protocol::acceptor& acceptor, const std::string& socketPath )
+{
+	// Only remove the file if it really is a socket, so that a typo can't delete anything else
+	struct stat fileStatus;
+	if( ::lstat( socketPath.c_str(), &fileStatus )==0 && S_ISSOCK(fileStatus.st_mode) ) ::unlink( socketPath.c_str() );
+
+	websocketpp::lib::asio::error_code errorCode;
+	websocketpp::lib::asio::local::stream_protocol::endpoint endpoint( socketPath );
+	acceptor.open( endpoint.protocol(), errorCode );
+	if( !errorCode ) acceptor.bind( endpoint, errorCode );
+	if( !errorCode ) acceptor.listen( websocketpp::lib::asio::socket_base::max_connections, errorCode );
+	if( errorCode )
+	{
+		websocketpp::lib::asio::error_code ignoredError;
+		acceptor.close( ignoredError );
+		throw std::runtime_error( "Communique server listen error: "+errorCode.message()+" ("+socketPath+")" );
+	}
+}
@@ -2,10 +2,17 @@
 
 #include <communique/Client.h>
 #include <communique/Server.h>
+#include <communique/Exceptions.h>
+#include <communique/ThreadPool.h>
+#include <communique/EventLoop.h>
+#include <communique/ClientPool.h>
 #include <thread>
 #include <iostream>
 #include <list>
 #include <mutex>
+#include <algorithm>
+#include <atomic>
+#include <fstream>
 
 #include "testinputs.h"
 
@@ -35,6 +42,46 @@ SCENARIO( "Test that the Client and Server can interact properly", "[integration
 			REQUIRE_NOTHROW( myClient.disconnect() );
 			REQUIRE_NOTHROW( myServer.stop() );
 		}
+		WHEN( "I connect asynchronously" )
+		{
+			REQUIRE_NOTHROW( myServer.listen( ++testinputs::portNumber ) );
+			std::this_thread::sleep_for( testinputs::shortWait );
+
+			std::future<void> connected=myClient.connectAsync( "ws://localhost:"+std::to_string(testinputs::portNumber) );
+			REQUIRE( connected.wait_for( std::chrono::seconds(2) )==std::future_status::ready );
+			CHECK_NOTHROW( connected.get() );
+			// Should return straight away now that the connection is open
+			CHECK( myClient.waitConnected( std::chrono::milliseconds(0) ) );
+			CHECK( myClient.isConnected() );
+
+			REQUIRE_NOTHROW( myClient.disconnect() );
+			CHECK( myClient.isDisconnected() );
+			REQUIRE_NOTHROW( myServer.stop() );
+		}
+		WHEN( "I stop the server while a request is being handled" )
+		{
+			REQUIRE_NOTHROW( myServer.setDefaultRequestHandler( [](const std::string& message)
+				{
+					std::this_thread::sleep_for( std::chrono::milliseconds(300) );
+					return "Answer is: "+message;
+				} ) );
+			REQUIRE_NOTHROW( myServer.listen( ++testinputs::portNumber ) );
+			std::this_thread::sleep_for( testinputs::shortWait );
+			REQUIRE_NOTHROW( myClient.connect( "ws://localhost:"+std::to_string(testinputs::portNumber) ) );
+			REQUIRE( myClient.isConnected() );
+
+			std::future<std::string> response=myClient.sendRequest( "slow" );
+			std::this_thread::sleep_for( std::chrono::milliseconds(50) ); // Make sure the request has arrived
+
+			const auto startTime=std::chrono::steady_clock::now();
+			REQUIRE_NOTHROW( myServer.stop( std::chrono::seconds(3) ) );
+			// Should have waited for the request, but not the whole drain timeout
+			const auto stopTime=std::chrono::steady_clock::now()-startTime;
+			CHECK( stopTime<std::chrono::seconds(2) );
+			REQUIRE( response.wait_for( std::chrono::seconds(1) )==std::future_status::ready );
+			CHECK( response.get()=="Answer is: slow" );
+			CHECK( myClient.isDisconnected() );
+		}
 		WHEN( "I send info messages from a client to a server" )
 		{
 			std::string concatenatedInfoMessages; // Store all received info message in here
@@ -109,6 +156,428 @@ SCENARIO( "Test that the Client and Server can interact properly", "[integration
 			std::this_thread::sleep_for( std::chrono::seconds(2) );
 			REQUIRE_NOTHROW( myServer.stop() );
 		}
+		WHEN( "I send requests that return futures" )
+		{
+			REQUIRE_NOTHROW( myServer.setDefaultRequestHandler( [](const std::string& message)
+				{
+					if( message=="slow" ) std::this_thread::sleep_for( std::chrono::milliseconds(300) );
+					else if( message=="throw" ) throw std::runtime_error( "Deliberate failure" );
+					return "Answer is: "+message;
+				} ) );
+
+			REQUIRE_NOTHROW( myServer.listen( ++testinputs::portNumber ) );
+			std::this_thread::sleep_for( testinputs::shortWait );
+			REQUIRE_NOTHROW( myClient.connect( "ws://localhost:"+std::to_string(testinputs::portNumber) ) );
+			REQUIRE( myClient.isConnected() );
+
+			std::future<std::string> fastResponse=myClient.sendRequest( "fast" );
+			std::future<std::string> slowResponse=myClient.sendRequest( "slow", std::chrono::milliseconds(100) );
+			std::future<std::string> errorResponse=myClient.sendRequest( "throw", std::chrono::milliseconds(1000) );
+
+			REQUIRE( fastResponse.wait_for( std::chrono::seconds(1) )==std::future_status::ready );
+			CHECK( fastResponse.get()=="Answer is: fast" );
+			REQUIRE( errorResponse.wait_for( std::chrono::seconds(1) )==std::future_status::ready );
+			try{ errorResponse.get(); FAIL( "Expected an exception" ); }
+			catch( communique::RequestFailed& error )
+			{
+				CHECK( error.status()==communique::ResponseStatus::REQUESTERROR );
+				CHECK( std::string(error.what())=="Deliberate failure" );
+			}
+			REQUIRE( slowResponse.wait_for( std::chrono::seconds(1) )==std::future_status::ready );
+			try{ slowResponse.get(); FAIL( "Expected an exception" ); }
+			catch( communique::RequestFailed& error )
+			{
+				CHECK( error.status()==communique::ResponseStatus::TIMEDOUT );
+			}
+
+			REQUIRE_NOTHROW( myClient.disconnect() );
+			std::this_thread::sleep_for( testinputs::shortWait );
+			REQUIRE_NOTHROW( myServer.stop() );
+		}
+		WHEN( "The server's executor refuses to take a request" )
+		{
+			struct RejectingExecutor : public communique::IExecutor
+			{
+				virtual void execute( std::function<void()> task ) override { throw std::runtime_error( "Executor is full" ); }
+			};
+			REQUIRE_NOTHROW( myServer.setExecutor( std::make_shared<RejectingExecutor>() ) );
+			REQUIRE_NOTHROW( myServer.setDefaultRequestHandler( [](const std::string& message){ return "Answer is: "+message; } ) );
+
+			REQUIRE_NOTHROW( myServer.listen( ++testinputs::portNumber ) );
+			std::this_thread::sleep_for( testinputs::shortWait );
+			REQUIRE_NOTHROW( myClient.connect( "ws://localhost:"+std::to_string(testinputs::portNumber) ) );
+			REQUIRE( myClient.isConnected() );
+
+			std::future<std::string> response=myClient.sendRequest( "hello" );
+			REQUIRE( response.wait_for( std::chrono::seconds(1) )==std::future_status::ready );
+			try{ response.get(); FAIL( "Expected an exception" ); }
+			catch( communique::RequestFailed& error )
+			{
+				CHECK( error.status()==communique::ResponseStatus::REQUESTERROR );
+				CHECK( std::string(error.what())=="Executor rejected the request" );
+			}
+			// The server should carry on working
+			CHECK( myClient.isConnected() );
+
+			REQUIRE_NOTHROW( myClient.disconnect() );
+			std::this_thread::sleep_for( testinputs::shortWait );
+			REQUIRE_NOTHROW( myServer.stop() );
+		}
+		WHEN( "I use handlers that take a view of the message rather than a copy" )
+		{
+			std::mutex resultsMutex;
+			std::vector<communique::MessageView> infoMessages;
+			REQUIRE_NOTHROW( myServer.setDefaultInfoHandler( [&](const communique::MessageView& message,std::weak_ptr<communique::IConnection>){ std::lock_guard<std::mutex> lock(resultsMutex); infoMessages.push_back(message); } ) );
+			REQUIRE_NOTHROW( myServer.setDefaultRequestHandler( [](const communique::MessageView& message,std::weak_ptr<communique::IConnection>){ return "Answer is: "+message.str(); } ) );
+
+			REQUIRE_NOTHROW( myServer.listen( ++testinputs::portNumber ) );
+			std::this_thread::sleep_for( testinputs::shortWait );
+			REQUIRE_NOTHROW( myClient.connect( "ws://localhost:"+std::to_string(testinputs::portNumber) ) );
+			REQUIRE( myClient.isConnected() );
+
+			const std::string largeMessage( 1024*1024, 'x' );
+			REQUIRE_NOTHROW( myClient.sendInfo( largeMessage ) );
+			REQUIRE_NOTHROW( myClient.sendInfo( "Second message" ) );
+			std::promise<std::string> response;
+			REQUIRE_NOTHROW( myClient.sendRequest( "test", [&](const communique::MessageView& message,communique::ResponseStatus){ response.set_value( message.str() ); }, std::chrono::seconds(1) ) );
+			std::future<std::string> responseFuture=response.get_future();
+			REQUIRE( responseFuture.wait_for( std::chrono::seconds(1) )==std::future_status::ready );
+			CHECK( responseFuture.get()=="Answer is: test" );
+
+			std::this_thread::sleep_for( testinputs::shortWait );
+			{
+				// The views should still be valid after the handler has returned because they keep the message alive
+				std::lock_guard<std::mutex> lock(resultsMutex);
+				REQUIRE( infoMessages.size()==2 );
+				CHECK( infoMessages[0]==largeMessage );
+				CHECK( infoMessages[1]=="Second message" );
+			}
+
+			REQUIRE_NOTHROW( myClient.disconnect() );
+			std::this_thread::sleep_for( testinputs::shortWait );
+			REQUIRE_NOTHROW( myServer.stop() );
+		}
+		WHEN( "I send messages by moving them in rather than copying" )
+		{
+			std::mutex resultsMutex;
+			std::vector<std::string> infoMessages;
+			REQUIRE_NOTHROW( myServer.setDefaultInfoHandler( [&](const std::string& message){ std::lock_guard<std::mutex> lock(resultsMutex); infoMessages.push_back(message); } ) );
+			REQUIRE_NOTHROW( myServer.setDefaultRequestHandler( [](const std::string& message){ return "Answer is: "+message; } ) );
+
+			REQUIRE_NOTHROW( myServer.listen( ++testinputs::portNumber ) );
+			std::this_thread::sleep_for( testinputs::shortWait );
+			REQUIRE_NOTHROW( myClient.connect( "ws://localhost:"+std::to_string(testinputs::portNumber) ) );
+			REQUIRE( myClient.isConnected() );
+
+			// One with spare capacity for the header and one without
+			std::string withHeadroom;
+			withHeadroom.reserve( 1024+5 );
+			withHeadroom.assign( 1024, 'a' );
+			REQUIRE_NOTHROW( myClient.sendInfo( std::move(withHeadroom) ) );
+			std::string withoutHeadroom( 1024, 'b' );
+			withoutHeadroom.shrink_to_fit();
+			REQUIRE_NOTHROW( myClient.sendInfo( std::move(withoutHeadroom) ) );
+			communique::MessageBuffer inBuffer( 1024 );
+			inBuffer.resize( 1024 );
+			std::fill( inBuffer.data(), inBuffer.data()+inBuffer.size(), 'c' );
+			REQUIRE_NOTHROW( myClient.sendInfo( std::move(inBuffer) ) );
+			std::future<std::string> response=myClient.sendRequest( std::string("test") );
+			REQUIRE( response.wait_for( std::chrono::seconds(1) )==std::future_status::ready );
+			CHECK( response.get()=="Answer is: test" );
+			std::future<std::string> bufferResponse=myClient.sendRequest( communique::MessageBuffer( std::string("buffered") ) );
+			REQUIRE( bufferResponse.wait_for( std::chrono::seconds(1) )==std::future_status::ready );
+			CHECK( bufferResponse.get()=="Answer is: buffered" );
+
+			std::this_thread::sleep_for( testinputs::shortWait );
+			{
+				std::lock_guard<std::mutex> lock(resultsMutex);
+				REQUIRE( infoMessages.size()==3 );
+				CHECK( infoMessages[0]==std::string( 1024, 'a' ) );
+				CHECK( infoMessages[1]==std::string( 1024, 'b' ) );
+				CHECK( infoMessages[2]==std::string( 1024, 'c' ) );
+			}
+
+			REQUIRE_NOTHROW( myClient.disconnect() );
+			std::this_thread::sleep_for( testinputs::shortWait );
+			REQUIRE_NOTHROW( myServer.stop() );
+		}
+		WHEN( "I give the client an executor to run response handlers on" )
+		{
+			auto pResponseExecutor=std::make_shared<communique::ThreadPool>( 1 );
+			REQUIRE_NOTHROW( myClient.setResponseExecutor( pResponseExecutor ) );
+			REQUIRE_NOTHROW( myServer.setDefaultRequestHandler( [](const std::string& message){ return "Answer is: "+message; } ) );
+
+			REQUIRE_NOTHROW( myServer.listen( ++testinputs::portNumber ) );
+			std::this_thread::sleep_for( testinputs::shortWait );
+			REQUIRE_NOTHROW( myClient.connect( "ws://localhost:"+std::to_string(testinputs::portNumber) ) );
+			REQUIRE( myClient.isConnected() );
+
+			// Find out which thread the executor runs on so that I can check the handler runs there
+			std::promise<std::thread::id> executorThread;
+			pResponseExecutor->execute( [&executorThread](){ executorThread.set_value( std::this_thread::get_id() ); } );
+			const std::thread::id expectedThread=executorThread.get_future().get();
+
+			std::promise<std::thread::id> handlerThread;
+			std::string response;
+			REQUIRE_NOTHROW( myClient.sendRequest( "test", [&](const std::string& message){ response=message; handlerThread.set_value( std::this_thread::get_id() ); } ) );
+			std::future<std::thread::id> handlerThreadFuture=handlerThread.get_future();
+			REQUIRE( handlerThreadFuture.wait_for( std::chrono::seconds(1) )==std::future_status::ready );
+			CHECK( handlerThreadFuture.get()==expectedThread );
+			CHECK( response=="Answer is: test" );
+
+			REQUIRE_NOTHROW( myClient.disconnect() );
+			std::this_thread::sleep_for( testinputs::shortWait );
+			REQUIRE_NOTHROW( myServer.stop() );
+		}
+		WHEN( "I send a request that takes longer than its timeout" )
+		{
+			REQUIRE_NOTHROW( myServer.setDefaultRequestHandler( [](const std::string& message)
+				{
+					if( message=="slow" ) std::this_thread::sleep_for( std::chrono::milliseconds(300) );
+					else if( message=="throw" ) throw std::runtime_error( "Deliberate failure" );
+					return "Answer is: "+message;
+				} ) );
+
+			REQUIRE_NOTHROW( myServer.listen( ++testinputs::portNumber ) );
+			std::this_thread::sleep_for( testinputs::shortWait );
+			REQUIRE_NOTHROW( myClient.connect( "ws://localhost:"+std::to_string(testinputs::portNumber) ) );
+			REQUIRE( myClient.isConnected() );
+
+			std::mutex resultsMutex;
+			std::vector< std::pair<std::string,communique::ResponseStatus> > results;
+			auto recordResult=[&](const std::string& message,communique::ResponseStatus status){ std::lock_guard<std::mutex> lock(resultsMutex); results.emplace_back(message,status); };
+
+			REQUIRE_NOTHROW( myClient.sendRequest( "slow", recordResult, std::chrono::milliseconds(100) ) );
+			std::this_thread::sleep_for( std::chrono::milliseconds(200) );
+			{
+				std::lock_guard<std::mutex> lock(resultsMutex);
+				REQUIRE( results.size()==1 );
+				CHECK( results[0].second==communique::ResponseStatus::TIMEDOUT );
+			}
+			// The late response should be ignored
+			std::this_thread::sleep_for( std::chrono::milliseconds(200) );
+			REQUIRE_NOTHROW( myClient.sendRequest( "fast", recordResult, std::chrono::milliseconds(1000) ) );
+			REQUIRE_NOTHROW( myClient.sendRequest( "throw", recordResult, std::chrono::milliseconds(1000) ) );
+			std::this_thread::sleep_for( testinputs::shortWait*2 );
+			{
+				std::lock_guard<std::mutex> lock(resultsMutex);
+				REQUIRE( results.size()==3 );
+				// These could arrive in either order
+				for( size_t index=1; index<results.size(); ++index )
+				{
+					if( results[index].second==communique::ResponseStatus::OK ) CHECK( results[index].first=="Answer is: fast" );
+					else
+					{
+						CHECK( results[index].second==communique::ResponseStatus::REQUESTERROR );
+						CHECK( results[index].first=="Deliberate failure" );
+					}
+				}
+			}
+
+			REQUIRE_NOTHROW( myClient.disconnect() );
+			std::this_thread::sleep_for( testinputs::shortWait );
+			REQUIRE_NOTHROW( myServer.stop() );
+		}
+		WHEN( "A client is destroyed from inside the handler for a request that timed out" )
+		{
+			REQUIRE_NOTHROW( myServer.setDefaultRequestHandler( [](const std::string& message)
+				{
+					std::this_thread::sleep_for( std::chrono::milliseconds(300) );
+					return "Answer is: "+message;
+				} ) );
+			REQUIRE_NOTHROW( myServer.listen( ++testinputs::portNumber ) );
+			std::this_thread::sleep_for( testinputs::shortWait );
+
+			std::unique_ptr<communique::Client> pClient( new communique::Client );
+			pClient->setVerifyFile( testinputs::testFileDirectory+"certificateAuthority_cert.pem" );
+			REQUIRE_NOTHROW( pClient->connect( "ws://localhost:"+std::to_string(testinputs::portNumber) ) );
+			REQUIRE( pClient->isConnected() );
+
+			// The handler runs on the timer thread, so destroying the client there drops the last reference
+			// to the timer from its own thread. That used to throw from a destructor and terminate.
+			std::promise<communique::ResponseStatus> handlerFinished;
+			REQUIRE_NOTHROW( pClient->sendRequest( "slow", [&pClient,&handlerFinished](const std::string&,communique::ResponseStatus status)
+				{
+					pClient.reset();
+					handlerFinished.set_value( status );
+				}, std::chrono::milliseconds(50) ) );
+			std::future<communique::ResponseStatus> finished=handlerFinished.get_future();
+			REQUIRE( finished.wait_for( std::chrono::seconds(2) )==std::future_status::ready );
+			CHECK( finished.get()==communique::ResponseStatus::TIMEDOUT );
+
+			std::this_thread::sleep_for( testinputs::shortWait );
+			REQUIRE_NOTHROW( myServer.stop() );
+		}
+		WHEN( "The connection closes while requests are still outstanding" )
+		{
+			REQUIRE_NOTHROW( myServer.setDefaultRequestHandler( [](const std::string& message)
+				{
+					std::this_thread::sleep_for( std::chrono::milliseconds(500) );
+					return "Answer is: "+message;
+				} ) );
+
+			REQUIRE_NOTHROW( myServer.listen( ++testinputs::portNumber ) );
+			std::this_thread::sleep_for( testinputs::shortWait );
+			REQUIRE_NOTHROW( myClient.connect( "ws://localhost:"+std::to_string(testinputs::portNumber) ) );
+			REQUIRE( myClient.isConnected() );
+
+			std::mutex resultsMutex;
+			std::vector<communique::ResponseStatus> results;
+			auto recordResult=[&](const std::string& message,communique::ResponseStatus status){ std::lock_guard<std::mutex> lock(resultsMutex); results.push_back(status); };
+
+			for( size_t index=0; index<5; ++index ) REQUIRE_NOTHROW( myClient.sendRequest( "slow", recordResult, std::chrono::seconds(10) ) );
+			REQUIRE_NOTHROW( myClient.disconnect() );
+			std::this_thread::sleep_for( testinputs::shortWait );
+			{
+				// Should all have failed well before the timeout
+				std::lock_guard<std::mutex> lock(resultsMutex);
+				REQUIRE( results.size()==5 );
+				for( const auto& status : results ) CHECK( status==communique::ResponseStatus::CONNECTIONCLOSED );
+			}
+
+			// Requests sent after the connection has closed have to fail straight away too, rather than
+			// wait for a response that can never come. These have no timeout, so would wait forever.
+			std::future<std::string> lateResponse=myClient.sendRequest( "late" );
+			REQUIRE( lateResponse.wait_for( std::chrono::seconds(1) )==std::future_status::ready );
+			try{ lateResponse.get(); FAIL( "Expected an exception" ); }
+			catch( communique::RequestFailed& error )
+			{
+				CHECK( error.status()==communique::ResponseStatus::CONNECTIONCLOSED );
+			}
+			results.clear();
+			REQUIRE_NOTHROW( myClient.sendRequest( "late", recordResult, std::chrono::milliseconds(0) ) );
+			REQUIRE( results.size()==1 );
+			CHECK( results[0]==communique::ResponseStatus::CONNECTIONCLOSED );
+			REQUIRE_NOTHROW( myServer.stop() );
+		}
+		WHEN( "The server restarts while the client is set to reconnect automatically" )
+		{
+			REQUIRE_NOTHROW( myServer.setDefaultRequestHandler( [](const std::string& message){ return "Answer is: "+message; } ) );
+			communique::ReconnectPolicy policy;
+			policy.initialDelay=std::chrono::milliseconds(10);
+			policy.maximumDelay=std::chrono::milliseconds(100);
+			policy.maximumBufferedMessages=10;
+			REQUIRE_NOTHROW( myClient.setAutoReconnect( true, policy ) );
+
+			REQUIRE_NOTHROW( myServer.listen( ++testinputs::portNumber ) );
+			std::this_thread::sleep_for( testinputs::shortWait );
+			REQUIRE_NOTHROW( myClient.connect( "ws://localhost:"+std::to_string(testinputs::portNumber) ) );
+			REQUIRE( myClient.isConnected() );
+
+			REQUIRE_NOTHROW( myServer.stop() );
+			std::this_thread::sleep_for( testinputs::shortWait );
+			CHECK_FALSE( myClient.waitConnected( std::chrono::milliseconds(0) ) );
+
+			// Sent during the outage, so should be held until the connection is back
+			std::future<std::string> response;
+			REQUIRE_NOTHROW( response=myClient.sendRequest( "while disconnected" ) );
+			std::string statusResponse;
+			communique::ResponseStatus status=communique::ResponseStatus::REQUESTERROR;
+			REQUIRE_NOTHROW( myClient.sendRequest( "also while disconnected", [&](const std::string& message,communique::ResponseStatus responseStatus){ statusResponse=message; status=responseStatus; }, std::chrono::milliseconds(0) ) );
+			std::future<std::string> bufferResponse;
+			REQUIRE_NOTHROW( bufferResponse=myClient.sendRequest( communique::MessageBuffer( std::string("moved in while disconnected") ) ) );
+
+			// The timeout of a held request starts when it's sent, not when the connection comes back
+			std::promise<communique::ResponseStatus> timedOutPromise;
+			std::future<communique::ResponseStatus> timedOutStatus=timedOutPromise.get_future();
+			REQUIRE_NOTHROW( myClient.sendRequest( "times out while disconnected", [&](const communique::MessageView& message,communique::ResponseStatus responseStatus){ timedOutPromise.set_value( responseStatus ); }, std::chrono::milliseconds(20) ) );
+			REQUIRE( timedOutStatus.wait_for( std::chrono::seconds(1) )==std::future_status::ready );
+			CHECK( timedOutStatus.get()==communique::ResponseStatus::TIMEDOUT );
+
+			REQUIRE_NOTHROW( myServer.listen( testinputs::portNumber ) );
+			REQUIRE( response.wait_for( std::chrono::seconds(5) )==std::future_status::ready );
+			CHECK( response.get()=="Answer is: while disconnected" );
+			REQUIRE( bufferResponse.wait_for( std::chrono::seconds(1) )==std::future_status::ready );
+			CHECK( bufferResponse.get()=="Answer is: moved in while disconnected" );
+			std::this_thread::sleep_for( testinputs::shortWait );
+			CHECK( status==communique::ResponseStatus::OK );
+			CHECK( statusResponse=="Answer is: also while disconnected" );
+			CHECK( myClient.isConnected() );
+
+			// Once disconnected deliberately it shouldn't come back
+			REQUIRE_NOTHROW( myClient.disconnect() );
+			std::this_thread::sleep_for( testinputs::shortWait );
+			CHECK( myClient.isDisconnected() );
+			REQUIRE_NOTHROW( myServer.stop() );
+		}
+		WHEN( "I check the stats after sending some messages" )
+		{
+			REQUIRE_NOTHROW( myServer.setDefaultRequestHandler( [](const std::string& message)
+				{
+					std::this_thread::sleep_for( std::chrono::milliseconds(20) );
+					if( message=="throw" ) throw std::runtime_error( "Deliberate failure" );
+					return "Answer is: "+message;
+				} ) );
+			REQUIRE_NOTHROW( myServer.setDefaultInfoHandler( [](const std::string& message){} ) );
+
+			REQUIRE_NOTHROW( myServer.listen( ++testinputs::portNumber ) );
+			std::this_thread::sleep_for( testinputs::shortWait );
+			REQUIRE_NOTHROW( myClient.connect( "ws://localhost:"+std::to_string(testinputs::portNumber) ) );
+			REQUIRE( myClient.isConnected() );
+
+			std::vector< std::future<std::string> > responses;
+			// Enough requests that at least one is timed, whatever the sampling on this thread is up to
+			for( size_t index=0; index<20; ++index ) responses.push_back( myClient.sendRequest( "request" ) );
+			std::future<std::string> errorResponse=myClient.sendRequest( "throw" );
+			for( size_t index=0; index<5; ++index ) myClient.sendInfo( "info" );
+			for( auto& response : responses )
+			{
+				REQUIRE( response.wait_for( std::chrono::seconds(2) )==std::future_status::ready );
+				CHECK( response.get()=="Answer is: request" );
+			}
+			REQUIRE( errorResponse.wait_for( std::chrono::seconds(1) )==std::future_status::ready );
+			std::this_thread::sleep_for( testinputs::shortWait ); // So that the info messages have definitely arrived
+
+			communique::Stats clientStats=myClient.stats();
+			communique::Stats serverStats=myServer.stats();
+			// How things are at the moment is always reported, even without COLLECT_STATS
+			CHECK( clientStats.connections==1 );
+			CHECK( clientStats.requestsOutstanding==0 );
+			CHECK( serverStats.connections==1 );
+			CHECK( serverStats.requestsInProgress==0 );
+			if( communique::Stats::enabled() )
+			{
+				CHECK( clientStats.messagesSent.requests==21 );
+				CHECK( clientStats.messagesSent.infos==5 );
+				CHECK( clientStats.messagesReceived.responses==20 );
+				CHECK( clientStats.messagesReceived.requestErrors==1 );
+				CHECK( clientStats.responseTime.count>=1 );
+				CHECK( clientStats.responseTime.count<=2 );
+				CHECK( clientStats.responseTime.quantile(0.5)>=std::chrono::milliseconds(20) );
+				// Everything one end sent the other should have received
+				CHECK( serverStats.messagesReceived.total()==clientStats.messagesSent.total() );
+				CHECK( serverStats.bytesReceived==clientStats.bytesSent );
+				CHECK( serverStats.bytesSent==clientStats.bytesReceived );
+				CHECK( serverStats.requestHandlerTime.count>=1 );
+				CHECK( serverStats.requestHandlerTime.quantile(0.99)>=std::chrono::milliseconds(20) );
+				CHECK( serverStats.infoHandlerTime.count>=1 );
+			}
+			else CHECK( clientStats.messagesSent.total()==0 );
+
+			// The counts from closed connections are kept
+			REQUIRE_NOTHROW( myClient.disconnect() );
+			std::this_thread::sleep_for( testinputs::shortWait );
+			communique::Stats closedStats=myServer.stats();
+			CHECK( closedStats.connections==0 );
+			CHECK( closedStats.messagesReceived.total()==serverStats.messagesReceived.total() );
+			CHECK( myClient.stats().messagesSent.total()==clientStats.messagesSent.total() );
+			REQUIRE_NOTHROW( myServer.stop() );
+		}
+	}
+}
+
+namespace
+{
+	/// The number of threads in this process, or zero if that can't be found out
+	size_t numberOfThreadsInProcess()
+	{
+		std::ifstream status( "/proc/self/status" );
+		std::string line;
+		while( std::getline( status, line ) )
+		{
+			if( line.compare( 0, 8, "Threads:" )==0 ) return std::stoul( line.substr(8) );
+		}
+		return 0;
 	}
 }
 
@@ -139,6 +608,16 @@ SCENARIO( "Test that a Server can handle multiple connections", "[integration][l
 				CHECK( myServer.currentConnections().size()==index+1 );
 			}
 
+			// Connections are oldest first, and the IDs go up in the same order
+			std::vector<uint64_t> connectionIds;
+			for( const auto& pConnection : myServer.currentConnections() ) connectionIds.push_back( myServer.connectionId( pConnection ) );
+			REQUIRE( connectionIds.size()==numberOfClients );
+			CHECK( connectionIds.front()!=0u );
+			CHECK( std::is_sorted( connectionIds.begin(), connectionIds.end() ) );
+			CHECK( std::adjacent_find( connectionIds.begin(), connectionIds.end() )==connectionIds.end() );
+			CHECK( myServer.connection( connectionIds.back() ).lock()==myServer.currentConnections().back().lock() );
+			CHECK( myServer.connectionId( std::weak_ptr<communique::IConnection>() )==0u );
+
 			// disconnect all the clients, and check that the server realises they're disconnected
 			for( size_t index=0; index<clients.size(); ++index )
 			{
@@ -146,6 +625,633 @@ SCENARIO( "Test that a Server can handle multiple connections", "[integration][l
 				std::this_thread::sleep_for( testinputs::shortWait );
 				CHECK( myServer.currentConnections().size()==clients.size()-index-1 );
 			}
+			CHECK( myServer.connection( connectionIds.front() ).expired() );
+		}
+		WHEN( "I run the server event loop on several threads" )
+		{
+			const size_t numberOfClients=4;
+			REQUIRE_NOTHROW( myServer.setDefaultRequestHandler( [](const std::string& message){ return "Answer is: "+message; } ) );
+			REQUIRE_NOTHROW( myServer.listen( ++testinputs::portNumber, 4 ) );
+			std::this_thread::sleep_for( testinputs::shortWait );
+
+			std::vector<communique::Client> clients;
+			for( size_t index=0; index<numberOfClients; ++index ) clients.emplace_back();
+			size_t threadsAfterFirstClient=0;
+			for( auto& client : clients )
+			{
+				REQUIRE_NOTHROW( client.connect( "ws://localhost:"+std::to_string(testinputs::portNumber) ) );
+				CHECK( client.isConnected() );
+				if( threadsAfterFirstClient==0 ) threadsAfterFirstClient=numberOfThreadsInProcess();
+			}
+			// Each further client only adds its IO thread, since they all share the process' default executor
+			if( threadsAfterFirstClient!=0 ) CHECK( numberOfThreadsInProcess()<=threadsAfterFirstClient+numberOfClients-1 );
+
+			// Requests are handled on a thread pool so responses can come back in any order. Just make sure
+			// each client got every response back.
+			std::vector<std::string> responses( numberOfClients );
+			std::mutex responsesMutex;
+			for( size_t message=0; message<10; ++message )
+			{
+				for( size_t index=0; index<clients.size(); ++index )
+				{
+					REQUIRE_NOTHROW( clients[index].sendRequest( std::to_string(message), [&,index](const std::string& response){ std::lock_guard<std::mutex> lock(responsesMutex); responses[index]+=response.substr(11); } ) );
+				}
+				std::this_thread::sleep_for( std::chrono::milliseconds(5) );
+			}
+			std::this_thread::sleep_for( testinputs::shortWait );
+			for( auto& clientResponses : responses )
+			{
+				std::sort( clientResponses.begin(), clientResponses.end() );
+				CHECK( clientResponses=="0123456789" );
+			}
+
+			for( auto& client : clients ) REQUIRE_NOTHROW( client.disconnect() );
+			std::this_thread::sleep_for( testinputs::shortWait );
+			REQUIRE_NOTHROW( myServer.stop() );
+		}
+	}
+}
+
+SCENARIO( "Test that Clients and Servers can share an EventLoop", "[integration][local]" )
+{
+	GIVEN( "An EventLoop with two threads and a server using it" )
+	{
+		auto pEventLoop=std::make_shared<communique::EventLoop>( 2 );
+		CHECK( pEventLoop->numberOfThreads()==2 );
+
+		communique::Server myServer( pEventLoop );
+		myServer.setCertificateChainFile( testinputs::testFileDirectory+"server_cert.pem" );
+		myServer.setPrivateKeyFile( testinputs::testFileDirectory+"server_key.pem" );
+
+		WHEN( "I connect several clients that use the same EventLoop" )
+		{
+			const size_t numberOfClients=10;
+			REQUIRE_NOTHROW( myServer.setDefaultRequestHandler( [](const std::string& message){ return "Answer is: "+message; } ) );
+			REQUIRE_NOTHROW( myServer.listen( ++testinputs::portNumber ) );
+			std::this_thread::sleep_for( testinputs::shortWait );
+			const size_t threadsBeforeClients=numberOfThreadsInProcess();
+
+			std::vector<communique::Client> clients;
+			for( size_t index=0; index<numberOfClients; ++index ) clients.emplace_back( pEventLoop );
+			for( auto& client : clients )
+			{
+				REQUIRE_NOTHROW( client.connect( "ws://localhost:"+std::to_string(testinputs::portNumber) ) );
+				CHECK( client.isConnected() );
+			}
+			CHECK( myServer.currentConnections().size()==numberOfClients );
+
+			for( size_t index=0; index<clients.size(); ++index )
+			{
+				std::future<std::string> response;
+				REQUIRE_NOTHROW( response=clients[index].sendRequest( std::to_string(index), std::chrono::seconds(5) ) );
+				CHECK( response.get()=="Answer is: "+std::to_string(index) );
+			}
+			// The clients use the executor and timer the server already made on the loop, rather than starting their own threads
+			if( threadsBeforeClients!=0 ) CHECK( numberOfThreadsInProcess()<=threadsBeforeClients );
+
+			// The EventLoop threads keep running, so disconnecting has to wait for the close handshake instead
+			for( auto& client : clients )
+			{
+				REQUIRE_NOTHROW( client.disconnect() );
+				CHECK( client.isDisconnected() );
+			}
+			std::this_thread::sleep_for( testinputs::shortWait );
+			CHECK( myServer.currentConnections().empty() );
+			REQUIRE_NOTHROW( myServer.stop() );
+
+			// The server should be able to start again on the same loop
+			REQUIRE_NOTHROW( myServer.listen( ++testinputs::portNumber ) );
+			std::this_thread::sleep_for( testinputs::shortWait );
+			communique::Client myClient( pEventLoop );
+			REQUIRE_NOTHROW( myClient.connect( "ws://localhost:"+std::to_string(testinputs::portNumber) ) );
+			CHECK( myClient.isConnected() );
+			REQUIRE_NOTHROW( myServer.stop() );
+			CHECK( myClient.isDisconnected() );
+		}
+	}
+}
+
+SCENARIO( "Test that the Client and Server work over the transports without TLS", "[integration][local]" )
+{
+	GIVEN( "A server and client using plain TCP" )
+	{
+		communique::Server myServer( communique::Transport::PLAIN );
+		communique::Client myClient( communique::Transport::PLAIN );
+		REQUIRE_NOTHROW( myServer.setDefaultRequestHandler( [](const std::string& message){ return "Answer is: "+message; } ) );
+
+		WHEN( "I connect and send a request" )
+		{
+			REQUIRE_NOTHROW( myServer.listen( ++testinputs::portNumber ) );
+			std::this_thread::sleep_for( testinputs::shortWait );
+
+			REQUIRE_NOTHROW( myClient.connect( "ws://localhost:"+std::to_string(testinputs::portNumber) ) );
+			REQUIRE( myClient.isConnected() );
+			CHECK( !myClient.sessionWasResumed() );
+			CHECK( myClient.completedHandshakes()==0 );
+			CHECK( myClient.sendRequest( "plain" ).get()=="Answer is: plain" );
+
+			REQUIRE_NOTHROW( myClient.disconnect() );
+			REQUIRE_NOTHROW( myServer.stop() );
+		}
+		WHEN( "I try to listen on a socket file" )
+		{
+			CHECK_THROWS( myServer.listen( "/tmp/communiqueTest.sock" ) );
+		}
+	}
+	GIVEN( "A server and client using a Unix domain socket" )
+	{
+		const std::string socketPath="/tmp/communiqueTest"+std::to_string(++testinputs::portNumber)+".sock";
+		communique::Server myServer( communique::Transport::UNIXSOCKET );
+		communique::Client myClient( communique::Transport::UNIXSOCKET );
+		REQUIRE_NOTHROW( myServer.setDefaultRequestHandler( [](const std::string& message){ return "Answer is: "+message; } ) );
+		std::string lastInfo;
+		std::mutex infoMutex;
+		REQUIRE_NOTHROW( myClient.setInfoHandler( [&](const std::string& message){ std::lock_guard<std::mutex> lock(infoMutex); lastInfo=message; } ) );
+
+		WHEN( "I connect and send requests and info messages" )
+		{
+			REQUIRE_NOTHROW( myServer.listen( socketPath, 2 ) );
+
+			REQUIRE_NOTHROW( myClient.connect( "unix://"+socketPath ) );
+			REQUIRE( myClient.isConnected() );
+			CHECK( myServer.currentConnections().size()==1 );
+
+			for( size_t index=0; index<100; ++index )
+			{
+				CHECK( myClient.sendRequest( std::to_string(index) ).get()=="Answer is: "+std::to_string(index) );
+			}
+			CHECK( myServer.broadcastInfo( "Hello over the socket" )==1 );
+			std::this_thread::sleep_for( testinputs::shortWait );
+			{ // Block to limit lifetime of the lock_guard
+				std::lock_guard<std::mutex> lock(infoMutex);
+				CHECK( lastInfo=="Hello over the socket" );
+			}
+
+			REQUIRE_NOTHROW( myClient.disconnect() );
+			CHECK( myClient.isDisconnected() );
+			std::this_thread::sleep_for( testinputs::shortWait );
+			CHECK( myServer.currentConnections().empty() );
+			REQUIRE_NOTHROW( myServer.stop() );
+		}
+		WHEN( "Both ends send large messages from their IO threads at the same time" )
+		{
+			// Far more than the socket buffers hold, so if a write blocked until the other end read it both IO
+			// threads would be stuck writing and neither would ever read.
+			const std::string bigMessage( 1024*1024, 'x' );
+			const size_t numberOfRounds=10;
+			std::atomic<size_t> received(0);
+			std::function<void(const std::string&,std::weak_ptr<communique::IConnection>)> echo=[](const std::string& message,std::weak_ptr<communique::IConnection> pWeakConnection)
+				{
+					auto pConnection=pWeakConnection.lock();
+					if( pConnection ) pConnection->sendInfo( message );
+				};
+			REQUIRE_NOTHROW( myServer.setDefaultInfoHandler( echo ) );
+			REQUIRE_NOTHROW( myClient.setInfoHandler( [&](const std::string& message)
+				{
+					if( ++received<4*numberOfRounds ) myClient.sendInfo( message );
+				} ) );
+			REQUIRE_NOTHROW( myServer.listen( socketPath, 2 ) );
+			REQUIRE_NOTHROW( myClient.connect( "unix://"+socketPath ) );
+			REQUIRE( myClient.isConnected() );
+
+			for( size_t index=0; index<4; ++index ) REQUIRE_NOTHROW( myClient.sendInfo( bigMessage ) );
+			for( size_t wait=0; wait<100 && received<4*numberOfRounds; ++wait ) std::this_thread::sleep_for( testinputs::shortWait );
+			CHECK( received>=4*numberOfRounds );
+			CHECK( myClient.sendRequest( "still working" ).get()=="Answer is: still working" );
+
+			REQUIRE_NOTHROW( myClient.disconnect() );
+			REQUIRE_NOTHROW( myServer.stop() );
+		}
+		WHEN( "I connect to a socket that nobody is listening on" )
+		{
+			std::future<void> connected=myClient.connectAsync( "unix://"+socketPath );
+			REQUIRE( connected.wait_for( std::chrono::seconds(2) )==std::future_status::ready );
+			CHECK_THROWS( connected.get() );
+			CHECK( !myClient.isConnected() );
+		}
+		WHEN( "I use a URI that isn't for a Unix socket" )
+		{
+			CHECK_THROWS( myClient.connect( "ws://localhost:"+std::to_string(testinputs::portNumber) ) );
+			CHECK_THROWS( myServer.listen( testinputs::portNumber ) );
+		}
+	}
+#ifndef COMMUNIQUE_NO_SHAREDMEMORY
+	GIVEN( "A server and client using shared memory" )
+	{
+		const std::string socketPath="/tmp/communiqueTest"+std::to_string(++testinputs::portNumber)+".sock";
+		communique::Server myServer( communique::Transport::SHAREDMEMORY );
+		communique::Client myClient( communique::Transport::SHAREDMEMORY );
+		REQUIRE_NOTHROW( myServer.setDefaultRequestHandler( [](const std::string& message){ return "Answer is: "+message; } ) );
+		std::string lastInfo;
+		std::mutex infoMutex;
+		REQUIRE_NOTHROW( myClient.setInfoHandler( [&](const std::string& message){ std::lock_guard<std::mutex> lock(infoMutex); lastInfo=message; } ) );
+
+		WHEN( "I connect and send requests and info messages" )
+		{
+			REQUIRE_NOTHROW( myServer.setBusyPollTime( std::chrono::microseconds(50) ) );
+			REQUIRE_NOTHROW( myClient.setBusyPollTime( std::chrono::microseconds(50) ) );
+			REQUIRE_NOTHROW( myServer.listen( socketPath ) );
+
+			REQUIRE_NOTHROW( myClient.connect( "shm://"+socketPath ) );
+			REQUIRE( myClient.isConnected() );
+			CHECK( myServer.currentConnections().size()==1 );
+
+			for( size_t index=0; index<1000; ++index )
+			{
+				CHECK( myClient.sendRequest( std::to_string(index) ).get()=="Answer is: "+std::to_string(index) );
+			}
+			// Longer than the rings, so it has to be split up and wait for the other end to make room
+			const std::string longMessage( 3*1024*1024, 'x' );
+			CHECK( myClient.sendRequest( longMessage ).get()=="Answer is: "+longMessage );
+
+			CHECK( myServer.broadcastInfo( "Hello through shared memory" )==1 );
+			std::this_thread::sleep_for( testinputs::shortWait );
+			{ // Block to limit lifetime of the lock_guard
+				std::lock_guard<std::mutex> lock(infoMutex);
+				CHECK( lastInfo=="Hello through shared memory" );
+			}
+
+			REQUIRE_NOTHROW( myClient.disconnect() );
+			CHECK( myClient.isDisconnected() );
+			std::this_thread::sleep_for( testinputs::shortWait );
+			CHECK( myServer.currentConnections().empty() );
+			REQUIRE_NOTHROW( myServer.stop() );
+		}
+		WHEN( "I send more than fits in the ring while the server is busy" )
+		{
+			std::atomic<size_t> infosReceived(0);
+			// The info handler runs on the IO thread, so while the first one sleeps nothing is read from the ring
+			REQUIRE_NOTHROW( myServer.setDefaultInfoHandler( [&](const std::string& message){ if( infosReceived++==0 ) std::this_thread::sleep_for( std::chrono::milliseconds(300) ); } ) );
+			REQUIRE_NOTHROW( myServer.listen( socketPath ) );
+			REQUIRE_NOTHROW( myClient.connect( "shm://"+socketPath ) );
+			REQUIRE( myClient.isConnected() );
+
+			myClient.sendInfo( "Start sleeping" );
+			std::this_thread::sleep_for( std::chrono::milliseconds(20) );
+			const auto startTime=std::chrono::steady_clock::now();
+			const std::string longMessage( 1024*1024, 'x' );
+			for( size_t index=0; index<4; ++index ) myClient.sendInfo( longMessage );
+			std::future<std::string> response=myClient.sendRequest( "After the long ones" );
+			// The sender shouldn't have to wait for the server, only queue what doesn't fit
+			const auto sendTime=std::chrono::steady_clock::now()-startTime;
+			CHECK( sendTime<std::chrono::milliseconds(200) );
+			CHECK( myClient.stats().sendQueueBytes>0u );
+
+			REQUIRE( response.wait_for( std::chrono::seconds(2) )==std::future_status::ready );
+			CHECK( response.get()=="Answer is: After the long ones" );
+			CHECK( infosReceived==5u );
+			CHECK( myClient.stats().sendQueueBytes==0u );
+			REQUIRE_NOTHROW( myServer.stop() );
+		}
+		WHEN( "The server stops while the client is connected" )
+		{
+			REQUIRE_NOTHROW( myServer.listen( socketPath ) );
+			REQUIRE_NOTHROW( myClient.connect( "shm://"+socketPath ) );
+			REQUIRE( myClient.isConnected() );
+
+			REQUIRE_NOTHROW( myServer.stop() );
+			std::this_thread::sleep_for( testinputs::shortWait );
+			CHECK( myClient.isDisconnected() );
+		}
+		WHEN( "I connect to a socket that nobody is listening on" )
+		{
+			std::future<void> connected=myClient.connectAsync( "shm://"+socketPath );
+			REQUIRE( connected.wait_for( std::chrono::seconds(2) )==std::future_status::ready );
+			CHECK_THROWS( connected.get() );
+			CHECK( !myClient.isConnected() );
+		}
+		WHEN( "I use a URI that isn't for shared memory" )
+		{
+			CHECK_THROWS( myClient.connect( "unix://"+socketPath ) );
+			CHECK_THROWS( myServer.listen( testinputs::portNumber ) );
+		}
+	}
+#else
+	GIVEN( "A platform without shared memory support" )
+	{
+		CHECK_THROWS( communique::Server( communique::Transport::SHAREDMEMORY ) );
+		CHECK_THROWS( communique::Client( communique::Transport::SHAREDMEMORY ) );
+	}
+#endif // end of ifndef COMMUNIQUE_NO_SHAREDMEMORY
+	GIVEN( "A server and client in the same process" )
+	{
+		const std::string name="communiqueTest"+std::to_string(++testinputs::portNumber);
+		communique::Server myServer( communique::Transport::INPROCESS );
+		communique::Client myClient( communique::Transport::INPROCESS );
+		REQUIRE_NOTHROW( myServer.setDefaultRequestHandler( [](const std::string& message){ return "Answer is: "+message; } ) );
+		std::string lastInfo;
+		std::mutex infoMutex;
+		REQUIRE_NOTHROW( myClient.setInfoHandler( [&](const std::string& message){ std::lock_guard<std::mutex> lock(infoMutex); lastInfo=message; } ) );
+
+		WHEN( "I connect and send requests and info messages" )
+		{
+			REQUIRE_NOTHROW( myServer.listen( name ) );
+			// Names are shared by the whole process, so another server can't use the same one
+			communique::Server otherServer( communique::Transport::INPROCESS );
+			CHECK_THROWS( otherServer.listen( name ) );
+
+			REQUIRE_NOTHROW( myClient.connect( "inproc://"+name ) );
+			REQUIRE( myClient.isConnected() );
+			CHECK( myServer.currentConnections().size()==1 );
+
+			for( size_t index=0; index<1000; ++index )
+			{
+				CHECK( myClient.sendRequest( std::to_string(index) ).get()=="Answer is: "+std::to_string(index) );
+			}
+			CHECK( myServer.broadcastInfo( "Hello from the same process" )==1 );
+			std::this_thread::sleep_for( testinputs::shortWait );
+			{ // Block to limit lifetime of the lock_guard
+				std::lock_guard<std::mutex> lock(infoMutex);
+				CHECK( lastInfo=="Hello from the same process" );
+			}
+
+			REQUIRE_NOTHROW( myClient.disconnect() );
+			CHECK( myClient.isDisconnected() );
+			std::this_thread::sleep_for( testinputs::shortWait );
+			CHECK( myServer.currentConnections().empty() );
+			REQUIRE_NOTHROW( myServer.stop() );
+
+			// Once stopped the name is free again
+			CHECK_NOTHROW( otherServer.listen( name ) );
+			CHECK_NOTHROW( otherServer.stop() );
+		}
+		WHEN( "The server stops while the client is connected" )
+		{
+			REQUIRE_NOTHROW( myServer.listen( name ) );
+			REQUIRE_NOTHROW( myClient.connect( "inproc://"+name ) );
+			REQUIRE( myClient.isConnected() );
+
+			REQUIRE_NOTHROW( myServer.stop() );
+			std::this_thread::sleep_for( testinputs::shortWait );
+			CHECK( myClient.isDisconnected() );
+		}
+		WHEN( "I connect to a name that nobody is listening under" )
+		{
+			std::future<void> connected=myClient.connectAsync( "inproc://"+name );
+			REQUIRE( connected.wait_for( std::chrono::seconds(2) )==std::future_status::ready );
+			CHECK_THROWS( connected.get() );
+			CHECK( !myClient.isConnected() );
+		}
+		WHEN( "I use a URI that isn't for a server in the same process" )
+		{
+			CHECK_THROWS( myClient.connect( "ws://localhost:"+std::to_string(testinputs::portNumber) ) );
+			CHECK_THROWS( myServer.listen( testinputs::portNumber ) );
+		}
+	}
+}
+
+SCENARIO( "Test that a ClientPool spreads messages over several connections", "[integration][local]" )
+{
+	GIVEN( "A server and a ClientPool with four connections" )
+	{
+		communique::Server myServer;
+		myServer.setCertificateChainFile( testinputs::testFileDirectory+"server_cert.pem" );
+		myServer.setPrivateKeyFile( testinputs::testFileDirectory+"server_key.pem" );
+
+		// Record which connection each request arrived on
+		std::mutex connectionsMutex;
+		std::vector< std::shared_ptr<communique::IConnection> > requestConnections;
+		myServer.setDefaultRequestHandler( [&](const std::string& message,std::weak_ptr<communique::IConnection> pConnection)
+			{
+				std::lock_guard<std::mutex> lock(connectionsMutex);
+				requestConnections.push_back( pConnection.lock() );
+				return "Answer is: "+message;
+			} );
+
+		communique::ClientPool myPool( 4, [](communique::Client& client){ client.setVerifyFile( testinputs::testFileDirectory+"certificateAuthority_cert.pem" ); } );
+		CHECK( myPool.size()==4 );
+		CHECK( myPool.numberConnected()==0 );
+		CHECK_THROWS( myPool.sendInfo( "Not connected yet" ) );
+
+		WHEN( "I send requests round robin" )
+		{
+			REQUIRE_NOTHROW( myServer.listen( ++testinputs::portNumber ) );
+			std::this_thread::sleep_for( testinputs::shortWait );
+			REQUIRE_NOTHROW( myPool.connect( "ws://localhost:"+std::to_string(testinputs::portNumber) ) );
+			REQUIRE( myPool.waitConnected( std::chrono::seconds(5) ) );
+			CHECK( myPool.numberConnected()==4 );
+			CHECK( myServer.currentConnections().size()==4 );
+
+			std::vector< std::future<std::string> > responses;
+			for( size_t index=0; index<8; ++index ) responses.push_back( myPool.sendRequest( std::to_string(index) ) );
+			for( size_t index=0; index<responses.size(); ++index ) CHECK( responses[index].get()=="Answer is: "+std::to_string(index) );
+
+			// Every connection should have been used exactly twice
+			std::lock_guard<std::mutex> lock(connectionsMutex);
+			REQUIRE( requestConnections.size()==8 );
+			for( const auto& pConnection : requestConnections )
+			{
+				CHECK( std::count( requestConnections.begin(), requestConnections.end(), pConnection )==2 );
+			}
+		}
+		WHEN( "I send requests to the least busy connection" )
+		{
+			REQUIRE_NOTHROW( myServer.listen( ++testinputs::portNumber ) );
+			std::this_thread::sleep_for( testinputs::shortWait );
+			REQUIRE_NOTHROW( myPool.connect( "ws://localhost:"+std::to_string(testinputs::portNumber) ) );
+			REQUIRE( myPool.waitConnected( std::chrono::seconds(5) ) );
+			myPool.setBalancing( communique::ClientPool::Balancing::LEASTOUTSTANDING );
+
+			std::vector< std::future<std::string> > responses;
+			for( size_t index=0; index<20; ++index ) responses.push_back( myPool.sendRequest( std::to_string(index) ) );
+			for( size_t index=0; index<responses.size(); ++index ) CHECK( responses[index].get()=="Answer is: "+std::to_string(index) );
+		}
+		WHEN( "The server restarts" )
+		{
+			myPool.setReconnectInterval( std::chrono::milliseconds(50) );
+			REQUIRE_NOTHROW( myServer.listen( ++testinputs::portNumber ) );
+			std::this_thread::sleep_for( testinputs::shortWait );
+			REQUIRE_NOTHROW( myPool.connect( "ws://localhost:"+std::to_string(testinputs::portNumber) ) );
+			REQUIRE( myPool.waitConnected( std::chrono::seconds(5) ) );
+
+			REQUIRE_NOTHROW( myServer.stop() );
+			std::this_thread::sleep_for( testinputs::shortWait );
+			CHECK( myPool.numberConnected()==0 );
+
+			// The pool should replace all the closed connections without being asked
+			REQUIRE_NOTHROW( myServer.listen( testinputs::portNumber ) );
+			const auto giveUpTime=std::chrono::steady_clock::now()+std::chrono::seconds(5);
+			while( myPool.numberConnected()<4 && std::chrono::steady_clock::now()<giveUpTime ) std::this_thread::sleep_for( std::chrono::milliseconds(10) );
+			CHECK( myPool.numberConnected()==4 );
+			CHECK( myPool.sendRequest( "again" ).get()=="Answer is: again" );
+		}
+
+		REQUIRE_NOTHROW( myPool.disconnect() );
+		REQUIRE_NOTHROW( myServer.stop() );
+	}
+}
+
+SCENARIO( "Test that TLS sessions can be resumed", "[integration][local]" )
+{
+	GIVEN( "A Client and server with session resumption enabled" )
+	{
+		communique::Server myServer;
+		myServer.setCertificateChainFile( testinputs::testFileDirectory+"server_cert.pem" );
+		myServer.setPrivateKeyFile( testinputs::testFileDirectory+"server_key.pem" );
+		myServer.setSessionResumption( true );
+
+		communique::Client myClient;
+		myClient.setVerifyFile( testinputs::testFileDirectory+"certificateAuthority_cert.pem" );
+		myClient.setSessionResumption( true );
+
+		WHEN( "I connect the client twice to the same server" )
+		{
+			REQUIRE_NOTHROW( myServer.listen( ++testinputs::portNumber ) );
+			std::this_thread::sleep_for( testinputs::shortWait );
+			const std::string URI="ws://localhost:"+std::to_string(testinputs::portNumber);
+
+			REQUIRE_NOTHROW( myClient.connect( URI ) );
+			REQUIRE( myClient.isConnected() );
+			CHECK( myClient.sessionWasResumed()==false );
+			std::this_thread::sleep_for( testinputs::shortWait ); // TLS 1.3 sends the session after the handshake
+			REQUIRE_NOTHROW( myClient.disconnect() );
+
+			REQUIRE_NOTHROW( myClient.connect( URI ) );
+			REQUIRE( myClient.isConnected() );
+			CHECK( myClient.sessionWasResumed()==true );
+			CHECK( myClient.completedHandshakes()==2 );
+			CHECK( myClient.resumedHandshakes()==1 );
+			std::this_thread::sleep_for( testinputs::shortWait );
+			CHECK( myServer.completedHandshakes()==2 );
+			CHECK( myServer.resumedHandshakes()==1 );
+
+			REQUIRE_NOTHROW( myClient.disconnect() );
+			std::this_thread::sleep_for( testinputs::shortWait );
+			REQUIRE_NOTHROW( myServer.stop() );
+		}
+	}
+}
+
+SCENARIO( "Test that the Client and Server work with raw framing instead of WebSocket", "[integration][local]" )
+{
+	GIVEN( "A server and client using raw framing over TLS" )
+	{
+		communique::Server myServer( communique::Transport::RAWTLS );
+		myServer.setCertificateChainFile( testinputs::testFileDirectory+"server_cert.pem" );
+		myServer.setPrivateKeyFile( testinputs::testFileDirectory+"server_key.pem" );
+		myServer.setSessionResumption( true );
+		REQUIRE_NOTHROW( myServer.setDefaultRequestHandler( [](const std::string& message){ return "Answer is: "+message; } ) );
+
+		communique::Client myClient( communique::Transport::RAWTLS );
+		myClient.setVerifyFile( testinputs::testFileDirectory+"certificateAuthority_cert.pem" );
+		myClient.setSessionResumption( true );
+		std::string lastInfo;
+		std::mutex infoMutex;
+		REQUIRE_NOTHROW( myClient.setInfoHandler( [&](const std::string& message){ std::lock_guard<std::mutex> lock(infoMutex); lastInfo=message; } ) );
+
+		WHEN( "I connect and send requests and info messages" )
+		{
+			REQUIRE_NOTHROW( myServer.listen( ++testinputs::portNumber ) );
+			std::this_thread::sleep_for( testinputs::shortWait );
+			const std::string URI="tls://localhost:"+std::to_string(testinputs::portNumber);
+
+			REQUIRE_NOTHROW( myClient.connect( URI ) );
+			REQUIRE( myClient.isConnected() );
+			CHECK( myServer.currentConnections().size()==1 );
+			CHECK( myClient.completedHandshakes()==1 );
+
+			for( size_t index=0; index<1000; ++index )
+			{
+				CHECK( myClient.sendRequest( std::to_string(index) ).get()=="Answer is: "+std::to_string(index) );
+			}
+			// Long enough to be read straight into place rather than through the read buffer
+			const std::string longMessage( 3*1024*1024, 'x' );
+			CHECK( myClient.sendRequest( longMessage ).get()=="Answer is: "+longMessage );
+
+			CHECK( myServer.broadcastInfo( "Hello without WebSocket" )==1 );
+			std::this_thread::sleep_for( testinputs::shortWait );
+			{ // Block to limit lifetime of the lock_guard
+				std::lock_guard<std::mutex> lock(infoMutex);
+				CHECK( lastInfo=="Hello without WebSocket" );
+			}
+
+			REQUIRE_NOTHROW( myClient.disconnect() );
+			CHECK( myClient.isDisconnected() );
+			std::this_thread::sleep_for( testinputs::shortWait );
+			CHECK( myServer.currentConnections().empty() );
+
+			// Sessions are resumed the same as for WebSocket over TLS
+			REQUIRE_NOTHROW( myClient.connect( URI ) );
+			REQUIRE( myClient.isConnected() );
+			CHECK( myClient.sessionWasResumed()==true );
+			REQUIRE_NOTHROW( myClient.disconnect() );
+			REQUIRE_NOTHROW( myServer.stop() );
+		}
+		WHEN( "The server stops while the client is connected" )
+		{
+			REQUIRE_NOTHROW( myServer.listen( ++testinputs::portNumber ) );
+			std::this_thread::sleep_for( testinputs::shortWait );
+			REQUIRE_NOTHROW( myClient.connect( "tls://localhost:"+std::to_string(testinputs::portNumber) ) );
+			REQUIRE( myClient.isConnected() );
+
+			REQUIRE_NOTHROW( myServer.stop() );
+			std::this_thread::sleep_for( testinputs::shortWait );
+			CHECK( myClient.isDisconnected() );
+		}
+		WHEN( "I connect to a WebSocket server" )
+		{
+			communique::Server webSocketServer;
+			webSocketServer.setCertificateChainFile( testinputs::testFileDirectory+"server_cert.pem" );
+			webSocketServer.setPrivateKeyFile( testinputs::testFileDirectory+"server_key.pem" );
+			REQUIRE_NOTHROW( webSocketServer.listen( ++testinputs::portNumber ) );
+			std::this_thread::sleep_for( testinputs::shortWait );
+
+			std::future<void> connected=myClient.connectAsync( "tls://localhost:"+std::to_string(testinputs::portNumber) );
+			REQUIRE( connected.wait_for( std::chrono::seconds(2) )==std::future_status::ready );
+			CHECK_THROWS( connected.get() );
+			CHECK( !myClient.isConnected() );
+			REQUIRE_NOTHROW( webSocketServer.stop() );
+		}
+	}
+	GIVEN( "A server and client using raw framing over plain TCP" )
+	{
+		communique::Server myServer( communique::Transport::RAWTCP );
+		communique::Client myClient( communique::Transport::RAWTCP );
+		REQUIRE_NOTHROW( myServer.setDefaultRequestHandler( [](const std::string& message){ return "Answer is: "+message; } ) );
+
+		WHEN( "I connect and send requests" )
+		{
+			REQUIRE_NOTHROW( myServer.listen( ++testinputs::portNumber ) );
+			std::this_thread::sleep_for( testinputs::shortWait );
+
+			REQUIRE_NOTHROW( myClient.connect( "tcp://localhost:"+std::to_string(testinputs::portNumber) ) );
+			REQUIRE( myClient.isConnected() );
+			CHECK( !myClient.sessionWasResumed() );
+			CHECK( myClient.completedHandshakes()==0 );
+
+			// Sent all at once, so that several go out in each write
+			std::vector< std::future<std::string> > responses;
+			for( size_t index=0; index<1000; ++index ) responses.push_back( myClient.sendRequest( std::to_string(index) ) );
+			for( size_t index=0; index<responses.size(); ++index ) CHECK( responses[index].get()=="Answer is: "+std::to_string(index) );
+
+			REQUIRE_NOTHROW( myClient.disconnect() );
+			REQUIRE_NOTHROW( myServer.stop() );
+		}
+		WHEN( "A WebSocket client connects to the server" )
+		{
+			REQUIRE_NOTHROW( myServer.listen( ++testinputs::portNumber ) );
+			std::this_thread::sleep_for( testinputs::shortWait );
+
+			communique::Client webSocketClient( communique::Transport::PLAIN );
+			std::future<void> connected=webSocketClient.connectAsync( "ws://localhost:"+std::to_string(testinputs::portNumber) );
+			REQUIRE( connected.wait_for( std::chrono::seconds(2) )==std::future_status::ready );
+			CHECK_THROWS( connected.get() );
+			CHECK( myServer.currentConnections().empty() );
+			REQUIRE_NOTHROW( myServer.stop() );
+		}
+		WHEN( "I connect to a port that nobody is listening on" )
+		{
+			std::future<void> connected=myClient.connectAsync( "tcp://localhost:"+std::to_string(++testinputs::portNumber) );
+			REQUIRE( connected.wait_for( std::chrono::seconds(2) )==std::future_status::ready );
+			CHECK_THROWS( connected.get() );
+			CHECK( !myClient.isConnected() );
+		}
+		WHEN( "I use a URI that isn't for raw framing" )
+		{
+			CHECK_THROWS( myClient.connect( "ws://localhost:"+std::to_string(testinputs::portNumber) ) );
+			CHECK_THROWS( myClient.connect( "tls://localhost:"+std::to_string(testinputs::portNumber) ) );
+			CHECK_THROWS( myClient.connect( "tcp://localhost" ) );
+			CHECK_THROWS( myServer.listen( "/tmp/communiqueTest.sock" ) );
 		}
 	}
 }
@@ -222,6 +1328,43 @@ SCENARIO( "Test that the Server can communicate with two clients correctly", "[i
 			CHECK_NOTHROW( client2.disconnect() ); // Disconnecting the clients first frees up the port quicker (apparently)
 			std::this_thread::sleep_for( testinputs::shortWait );
 		}
+		WHEN( "When I broadcast info messages to connected clients" )
+		{
+			std::stringstream client1Info;
+			std::stringstream client2Info;
+			REQUIRE_NOTHROW( client1.setInfoHandler( [&](const std::string& message){ client1Info << message << '\n'; } ) );
+			REQUIRE_NOTHROW( client2.setInfoHandler( [&](const std::string& message){ client2Info << message << '\n'; } ) );
+
+			REQUIRE_NOTHROW( myServer.listen( ++testinputs::portNumber ) );
+			std::this_thread::sleep_for( testinputs::shortWait );
+			REQUIRE_NOTHROW( client1.connect( "ws://localhost:"+std::to_string(testinputs::portNumber) ) );
+			REQUIRE_NOTHROW( client2.connect( "ws://localhost:"+std::to_string(testinputs::portNumber) ) );
+			CHECK( client1.isConnected() );
+			CHECK( client2.isConnected() );
+
+			CHECK( myServer.broadcastInfo( "This is message 1" )==2 );
+			// Only send the second message to the first connection
+			std::weak_ptr<communique::IConnection> firstConnection=myServer.currentConnections().front();
+			CHECK( myServer.broadcastInfo( "This is message 2", [&](std::weak_ptr<communique::IConnection> connection){ return connection.lock()==firstConnection.lock(); } )==1 );
+
+			std::this_thread::sleep_for( testinputs::shortWait );
+			// Don't know which client is the first connection
+			if( client1Info.str().size()>client2Info.str().size() )
+			{
+				CHECK( client1Info.str() == "This is message 1\nThis is message 2\n" );
+				CHECK( client2Info.str() == "This is message 1\n" );
+			}
+			else
+			{
+				CHECK( client1Info.str() == "This is message 1\n" );
+				CHECK( client2Info.str() == "This is message 1\nThis is message 2\n" );
+			}
+
+			CHECK_NOTHROW( client1.disconnect() );
+			CHECK_NOTHROW( client2.disconnect() );
+			std::this_thread::sleep_for( testinputs::shortWait );
+			CHECK( myServer.broadcastInfo( "Nobody to send to" )==0 );
+		}
 	}
 	GIVEN( "A subscription server and some clients" )
 	{
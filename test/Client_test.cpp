@@ -3,6 +3,7 @@
 #include <communique/Client.h>
 #include <thread>
 #include <iostream>
+#include <future>
 
 
 SCENARIO( "Test that Client behaves as expected", "[client]" )
@@ -39,5 +40,14 @@ SCENARIO( "Test that Client behaves as expected", "[client]" )
 			// This call should have no effect
 			REQUIRE_NOTHROW( myClient.disconnect() );
 		}
+		WHEN( "I connect asynchronously to a port nothing is listening on" )
+		{
+			std::future<void> connected;
+			REQUIRE_NOTHROW( connected=myClient.connectAsync( "ws://localhost:1" ) );
+			REQUIRE( connected.wait_for( std::chrono::seconds(5) )==std::future_status::ready );
+			CHECK_THROWS( connected.get() );
+			CHECK( myClient.waitConnected( std::chrono::milliseconds(10) )==false );
+			REQUIRE_NOTHROW( myClient.disconnect() );
+		}
 	}
 }
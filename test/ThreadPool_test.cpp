@@ -0,0 +1,53 @@
+#include "catch.hpp"
+
+#include <communique/ThreadPool.h>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+SCENARIO( "Test that ThreadPool behaves as expected", "[ThreadPool][tools]" )
+{
+	GIVEN( "A ThreadPool with four threads" )
+	{
+		communique::ThreadPool myPool( 4, 16 );
+		CHECK( myPool.numberOfThreads()==4u );
+		CHECK( myPool.maximumQueueSize()==16u );
+
+		WHEN( "I submit lots of tasks and destroy the pool" )
+		{
+			std::atomic<size_t> tasksRun(0);
+			{ // Block to limit the lifetime of the pool
+				communique::ThreadPool temporaryPool( 4, 16 );
+				for( size_t index=0; index<1000; ++index )
+				{
+					REQUIRE_NOTHROW( temporaryPool.execute( [&]{ ++tasksRun; } ) );
+				}
+			}
+			// All queued tasks should have been run before the destructor returned
+			CHECK( tasksRun==1000u );
+		}
+		WHEN( "I submit a slow task" )
+		{
+			// Block one thread until told to continue, and make sure the other threads still run tasks
+			std::mutex blockMutex;
+			std::condition_variable blockCondition;
+			bool carryOn=false;
+			std::atomic<size_t> tasksRun(0);
+
+			REQUIRE_NOTHROW( myPool.execute( [&]{ std::unique_lock<std::mutex> lock(blockMutex); blockCondition.wait( lock, [&]{return carryOn;} ); } ) );
+			for( size_t index=0; index<10; ++index )
+			{
+				REQUIRE_NOTHROW( myPool.execute( [&]{ ++tasksRun; } ) );
+			}
+			std::this_thread::sleep_for( std::chrono::milliseconds(50) );
+			CHECK( tasksRun==10u );
+
+			{
+				std::lock_guard<std::mutex> lock(blockMutex);
+				carryOn=true;
+			}
+			blockCondition.notify_all();
+		}
+	}
+}
@@ -0,0 +1,99 @@
+#include <communique/impl/ConnectionRegistry.h>
+#include "../catch.hpp"
+
+#include <thread>
+#include <vector>
+#include <string>
+
+SCENARIO( "Test that ConnectionRegistry behaves as expected", "[ConnectionRegistry][tools]" )
+{
+	GIVEN( "A ConnectionRegistry<std::string,int> instance" )
+	{
+		communique::impl::ConnectionRegistry<std::string,int> myRegistry;
+
+		WHEN( "I use an empty registry" )
+		{
+			CHECK( myRegistry.empty() );
+			CHECK( myRegistry.size()==0 );
+			CHECK( myRegistry.find(3)==nullptr );
+			CHECK( myRegistry.remove(3)==nullptr );
+			CHECK( myRegistry.id(3)==0 );
+			CHECK( myRegistry.findById(1)==nullptr );
+			REQUIRE( myRegistry.snapshot()!=nullptr );
+			CHECK( myRegistry.snapshot()->empty() );
+		}
+		WHEN( "I add and remove elements" )
+		{
+			const auto firstId=myRegistry.add( 30, std::make_shared<std::string>("thirty") );
+			const auto secondId=myRegistry.add( 10, std::make_shared<std::string>("ten") );
+			const auto thirdId=myRegistry.add( 20, std::make_shared<std::string>("twenty") );
+			CHECK( firstId<secondId );
+			CHECK( secondId<thirdId );
+			CHECK( myRegistry.id(10)==secondId );
+			REQUIRE( myRegistry.findById(secondId)!=nullptr );
+			CHECK( *myRegistry.findById(secondId)=="ten" );
+			CHECK( myRegistry.size()==3 );
+			REQUIRE( myRegistry.find(20)!=nullptr );
+			CHECK( *myRegistry.find(20)=="twenty" );
+
+			// Should be in the order added, not the key order
+			auto pSnapshot=myRegistry.snapshot();
+			REQUIRE( pSnapshot->size()==3 );
+			CHECK( *(*pSnapshot)[0]=="thirty" );
+			CHECK( *(*pSnapshot)[1]=="ten" );
+			CHECK( *(*pSnapshot)[2]=="twenty" );
+			// Nothing has changed so should get the same snapshot back
+			CHECK( myRegistry.snapshot()==pSnapshot );
+
+			auto pRemoved=myRegistry.remove(10);
+			REQUIRE( pRemoved!=nullptr );
+			CHECK( *pRemoved=="ten" );
+			CHECK( myRegistry.find(10)==nullptr );
+			CHECK( myRegistry.findById(secondId)==nullptr );
+			CHECK( myRegistry.size()==2 );
+
+			// The old snapshot shouldn't change, but a new one should reflect the removal
+			CHECK( pSnapshot->size()==3 );
+			auto pNewSnapshot=myRegistry.snapshot();
+			REQUIRE( pNewSnapshot->size()==2 );
+			CHECK( *(*pNewSnapshot)[0]=="thirty" );
+			CHECK( *(*pNewSnapshot)[1]=="twenty" );
+
+			// A key added again should get a new ID and go to the end
+			myRegistry.add( 30, std::make_shared<std::string>("thirty again") );
+			CHECK( myRegistry.id(30)>thirdId );
+			CHECK( myRegistry.findById(firstId)==nullptr );
+			REQUIRE( myRegistry.findById(myRegistry.id(30))!=nullptr );
+			CHECK( *myRegistry.findById(myRegistry.id(30))=="thirty again" );
+			CHECK( myRegistry.size()==2 );
+			CHECK( *myRegistry.snapshot()->back()=="thirty again" );
+		}
+		WHEN( "I add and remove from several threads while taking snapshots" )
+		{
+			const int numberOfThreads=4;
+			const int itemsPerThread=10000;
+			std::vector<std::thread> threads;
+			for( int threadNumber=0; threadNumber<numberOfThreads; ++threadNumber )
+			{
+				threads.emplace_back( [&,threadNumber]()
+					{
+						for( int index=0; index<itemsPerThread; ++index )
+						{
+							const int key=threadNumber*itemsPerThread+index;
+							myRegistry.add( key, std::make_shared<std::string>(std::to_string(key)) );
+							if( index%100==0 ) myRegistry.snapshot();
+							if( index%2==0 ) myRegistry.remove( key );
+						}
+					} );
+			}
+			for( auto& thread : threads ) thread.join();
+
+			CHECK( myRegistry.size()==numberOfThreads*itemsPerThread/2 );
+			auto pSnapshot=myRegistry.snapshot();
+			REQUIRE( pSnapshot->size()==myRegistry.size() );
+			size_t numberOdd=0;
+			for( const auto& pElement : *pSnapshot ) numberOdd+=std::stoi(*pElement)%2;
+			CHECK( numberOdd==pSnapshot->size() );
+		}
+	}
+}
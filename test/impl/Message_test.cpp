@@ -0,0 +1,60 @@
+#include <communique/impl/Message.h>
+#include "../catch.hpp"
+
+SCENARIO( "Test that Message puts the header in front of the body without copying it", "[Message][tools]" )
+{
+	GIVEN( "A body that's too big to fit in the string's own storage" )
+	{
+		const std::string expectedBody( 4096, 'x' );
+
+		WHEN( "I build the body in a MessageBuffer and move it in" )
+		{
+			communique::MessageBuffer body( expectedBody.size() );
+			body.append( expectedBody );
+			const char* pBodyData=body.data();
+			communique::impl::Message message( std::move(body), communique::impl::Message::REQUEST, 1234 );
+
+			THEN( "The header goes in the headroom and the body stays where it was" )
+			{
+				CHECK( message.messageBodyView().data()==pBodyData );
+				CHECK( pBodyData==message.fullMessage().data()+communique::MessageBuffer::HEADROOM );
+				CHECK( message.type()==communique::impl::Message::REQUEST );
+				CHECK( message.userReference()==1234 );
+				CHECK( message.messageBodyView()==expectedBody );
+				CHECK( body.empty() );
+			}
+		}
+		WHEN( "I move a MessageBuffer somewhere else" )
+		{
+			communique::MessageBuffer body( expectedBody );
+			communique::MessageBuffer otherBody( std::move(body) );
+			CHECK( body.empty() );
+			body.append( "Still usable", 12 );
+			CHECK( std::string( body.data(), body.size() )=="Still usable" );
+			CHECK( std::string( otherBody.data(), otherBody.size() )==expectedBody );
+		}
+		WHEN( "I move in a std::string with spare capacity for the header" )
+		{
+			std::string body;
+			body.reserve( expectedBody.size()+communique::MessageBuffer::HEADROOM );
+			body=expectedBody;
+			const char* pBufferData=body.data();
+			communique::impl::Message message( std::move(body), communique::impl::Message::INFO, 0 );
+
+			THEN( "The buffer is reused rather than reallocated" )
+			{
+				CHECK( message.fullMessage().data()==pBufferData );
+				CHECK( message.type()==communique::impl::Message::INFO );
+				CHECK( message.messageBodyView()==expectedBody );
+			}
+		}
+		WHEN( "I copy the body in" )
+		{
+			communique::impl::Message message( expectedBody, communique::impl::Message::RESPONSE, 99 );
+			CHECK( message.messageBodyView().data()!=expectedBody.data() );
+			CHECK( message.type()==communique::impl::Message::RESPONSE );
+			CHECK( message.userReference()==99 );
+			CHECK( message.messageBodyView()==expectedBody );
+		}
+	}
+}
@@ -0,0 +1,71 @@
+#include <communique/impl/ShardedUniqueTokenStorage.h>
+#include "../catch.hpp"
+
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <string>
+
+SCENARIO( "Test that ShardedUniqueTokenStorage behaves as expected", "[UniqueTokenStorage][tools]" )
+{
+	GIVEN( "A ShardedUniqueTokenStorage<std::string,uint32_t> instance" )
+	{
+		communique::impl::ShardedUniqueTokenStorage<std::string,uint32_t> myTokenStorage;
+
+		WHEN( "I try to retrieve from an empty container" )
+		{
+			CHECK_THROWS( myTokenStorage.pop(9) );
+			CHECK_THROWS( myTokenStorage.at(0) );
+			std::string result;
+			CHECK( myTokenStorage.pop(0,result)==false );
+		}
+		WHEN( "I push and pop from several threads at once" )
+		{
+			const size_t numberOfThreads=8;
+			const size_t itemsPerThread=10000;
+			std::atomic<size_t> failures(0);
+			std::vector<std::thread> threads;
+			for( size_t threadNumber=0; threadNumber<numberOfThreads; ++threadNumber )
+			{
+				threads.emplace_back( [&,threadNumber]()
+				{
+					std::vector< std::pair<uint32_t,std::string> > stored;
+					for( size_t index=0; index<itemsPerThread; ++index )
+					{
+						std::string value=std::to_string(threadNumber)+"-"+std::to_string(index);
+						stored.emplace_back( myTokenStorage.push(value), value );
+					}
+					for( const auto& tokenValuePair : stored )
+					{
+						std::string retrievedValue;
+						if( !myTokenStorage.pop( tokenValuePair.first, retrievedValue ) || retrievedValue!=tokenValuePair.second ) ++failures;
+					}
+				} );
+			}
+			for( auto& thread : threads ) thread.join();
+			CHECK( failures==0u );
+		}
+		WHEN( "I pop everything pushed from several threads" )
+		{
+			std::vector<std::thread> threads;
+			for( size_t threadNumber=0; threadNumber<4; ++threadNumber )
+			{
+				threads.emplace_back( [&](){ for( size_t index=0; index<100; ++index ) myTokenStorage.push( std::to_string(index) ); } );
+			}
+			for( auto& thread : threads ) thread.join();
+			CHECK( myTokenStorage.size()==400u );
+			CHECK( myTokenStorage.popAll().size()==400u );
+			CHECK( myTokenStorage.size()==0u );
+			CHECK( myTokenStorage.popAll().empty() );
+		}
+		WHEN( "I pop on a different thread to the one that pushed" )
+		{
+			uint32_t token=0;
+			std::thread pushThread( [&](){ token=myTokenStorage.push("pushed elsewhere"); } );
+			pushThread.join();
+			CHECK( myTokenStorage.at(token)=="pushed elsewhere" );
+			CHECK( myTokenStorage.pop(token)=="pushed elsewhere" );
+			CHECK_THROWS( myTokenStorage.pop(token) );
+		}
+	}
+}
@@ -0,0 +1,109 @@
+#include <communique/impl/SharedMemoryRing.h>
+#include "../catch.hpp"
+
+#include <thread>
+
+SCENARIO( "Test that SharedMemoryRing behaves as expected", "[SharedMemoryRing][tools]" )
+{
+	GIVEN( "A small ring and a second view of the same memory" )
+	{
+		const size_t capacity=256;
+		struct alignas(64) { char bytes[1024]; } memory;
+		REQUIRE( communique::impl::SharedMemoryRing::regionSize(capacity)<=sizeof(memory) );
+		communique::impl::SharedMemoryRing producer( &memory, capacity, true );
+		communique::impl::SharedMemoryRing consumer( &memory, capacity, false );
+
+		WHEN( "I write and read a few records" )
+		{
+			CHECK( consumer.empty() );
+			CHECK( producer.tryWrite( "Hello", 5, false ) );
+			CHECK( producer.tryWrite( "first part ", 11, true ) );
+			CHECK( producer.tryWrite( "second part", 11, false ) );
+			CHECK( !consumer.empty() );
+
+			std::string record;
+			bool moreFragments=true;
+			REQUIRE( consumer.tryRead( record, moreFragments ) );
+			CHECK( record=="Hello" );
+			CHECK( moreFragments==false );
+
+			record.clear();
+			REQUIRE( consumer.tryRead( record, moreFragments ) );
+			CHECK( moreFragments==true );
+			REQUIRE( consumer.tryRead( record, moreFragments ) );
+			CHECK( moreFragments==false );
+			CHECK( record=="first part second part" );
+
+			CHECK( consumer.tryRead( record, moreFragments )==false );
+			CHECK( consumer.empty() );
+		}
+		WHEN( "I fill the ring" )
+		{
+			const std::string data( producer.maximumRecordSize(), 'x' );
+			size_t written=0;
+			while( producer.tryWrite( data.data(), data.size(), false ) ) ++written;
+			CHECK( written==4 );
+			CHECK_THROWS( producer.tryWrite( data.data(), data.size()+1, false ) );
+
+			// Reading one should make room for exactly one more
+			std::string record;
+			bool moreFragments;
+			REQUIRE( consumer.tryRead( record, moreFragments ) );
+			CHECK( record==data );
+			CHECK( producer.tryWrite( data.data(), data.size(), false ) );
+			CHECK( producer.tryWrite( data.data(), data.size(), false )==false );
+		}
+		WHEN( "The consumer goes to sleep" )
+		{
+			CHECK( producer.consumerNeedsWaking()==false );
+			CHECK( consumer.prepareToWait() );
+			CHECK( producer.tryWrite( "wake up", 7, false ) );
+			CHECK( producer.consumerNeedsWaking() );
+			// Only the first write after going to sleep should wake it
+			CHECK( producer.tryWrite( "wake up", 7, false ) );
+			CHECK( producer.consumerNeedsWaking()==false );
+			// And it shouldn't go to sleep while there's something to read
+			CHECK( consumer.prepareToWait()==false );
+		}
+		WHEN( "The record header is corrupted" )
+		{
+			CHECK( producer.tryWrite( "Hello", 5, false ) );
+			// The first 8 bytes after the control block are the header of the first record
+			char* pHeader=memory.bytes+communique::impl::SharedMemoryRing::regionSize(capacity)-capacity;
+			pHeader[3]=static_cast<char>(0x7f);
+			std::string record;
+			bool moreFragments;
+			CHECK_THROWS( consumer.tryRead( record, moreFragments ) );
+		}
+		WHEN( "A producer and consumer run on different threads" )
+		{
+			const size_t numberOfRecords=100000;
+			std::thread producerThread( [&]()
+				{
+					for( size_t index=0; index<numberOfRecords; ++index )
+					{
+						const std::string record=std::to_string(index);
+						while( !producer.tryWrite( record.data(), record.size(), false ) ) std::this_thread::yield();
+					}
+				} );
+
+			size_t mismatches=0;
+			for( size_t index=0; index<numberOfRecords; ++index )
+			{
+				std::string record;
+				bool moreFragments;
+				while( !consumer.tryRead( record, moreFragments ) ) std::this_thread::yield();
+				if( record!=std::to_string(index) ) ++mismatches;
+			}
+			producerThread.join();
+			CHECK( mismatches==0 );
+			CHECK( consumer.empty() );
+		}
+	}
+	GIVEN( "An invalid capacity" )
+	{
+		struct alignas(64) { char bytes[1024]; } memory;
+		CHECK_THROWS( communique::impl::SharedMemoryRing( &memory, 100, true ) );
+		CHECK_THROWS( communique::impl::SharedMemoryRing( &memory, 32, true ) );
+	}
+}
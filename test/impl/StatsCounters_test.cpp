@@ -0,0 +1,135 @@
+#include <communique/impl/StatsCounters.h>
+#include "../catch.hpp"
+
+#include <thread>
+#include <vector>
+#include <atomic>
+
+SCENARIO( "Test that StatsCounters and the Stats snapshots behave as expected", "[StatsCounters][tools]" )
+{
+	GIVEN( "An empty LatencyHistogram" )
+	{
+		communique::LatencyHistogram histogram;
+		CHECK( histogram.count==0 );
+		CHECK( histogram.quantile(0.5).count()==0 );
+		CHECK( histogram.mean().count()==0 );
+
+		WHEN( "I fill in some buckets" )
+		{
+			histogram.buckets[0]=50; // under 1us
+			histogram.buckets[4]=40; // 8 to 16us
+			histogram.buckets[10]=10; // 512 to 1024us
+			histogram.count=100;
+			histogram.totalMicroseconds=100*20;
+
+			THEN( "The quantiles are the tops of the buckets they fall in" )
+			{
+				CHECK( communique::LatencyHistogram::bucketUpperBound(0).count()==1 );
+				CHECK( communique::LatencyHistogram::bucketUpperBound(4).count()==16 );
+				CHECK( communique::LatencyHistogram::bucketUpperBound(communique::LatencyHistogram::NUMBER_OF_BUCKETS-1)==std::chrono::microseconds::max() );
+				CHECK( histogram.quantile(0.5).count()==1 );
+				CHECK( histogram.quantile(0.51).count()==16 );
+				CHECK( histogram.quantile(0.9).count()==16 );
+				CHECK( histogram.quantile(0.99).count()==1024 );
+				CHECK( histogram.quantile(1).count()==1024 );
+				CHECK( histogram.mean().count()==20 );
+			}
+			THEN( "Adding histograms adds every bucket" )
+			{
+				communique::LatencyHistogram sum;
+				sum+=histogram;
+				sum+=histogram;
+				CHECK( sum.count==200 );
+				CHECK( sum.buckets[4]==80 );
+				CHECK( sum.quantile(0.99).count()==1024 );
+			}
+		}
+	}
+
+	GIVEN( "Some StatsCounters" )
+	{
+		communique::impl::StatsCounters counters;
+
+		WHEN( "I count messages from more threads at once than there are writer slots" )
+		{
+			// So that some of them have to share the counters with atomic increments
+			const size_t numberOfThreads=communique::impl::StatsCounters::NUMBER_OF_WRITERS+4;
+			const std::string request( communique::impl::Message( "Hello", communique::impl::Message::REQUEST, 1 ).fullMessage() );
+			const std::string info( communique::impl::Message( "Bye", communique::impl::Message::INFO, 0 ).fullMessage() );
+			std::atomic<size_t> threadsStarted(0);
+			std::vector<std::thread> threads;
+			for( size_t threadNumber=0; threadNumber<numberOfThreads; ++threadNumber )
+			{
+				threads.emplace_back( [&]()
+					{
+						// Make sure they're all running before any claim a slot, otherwise they could take turns with one
+						++threadsStarted;
+						while( threadsStarted<numberOfThreads ) std::this_thread::yield();
+						for( size_t index=0; index<1000; ++index )
+						{
+							counters.messageSent( request );
+							counters.messageSent( info );
+						}
+					} );
+			}
+			for( auto& thread : threads ) thread.join();
+			// Only ever one thread receives
+			for( size_t index=0; index<numberOfThreads*1000; ++index ) counters.messageReceived( communique::impl::Message::RESPONSE, 10 );
+
+			communique::Stats stats;
+			counters.addTo( stats );
+			if( communique::Stats::enabled() )
+			{
+				CHECK( stats.messagesSent.requests==numberOfThreads*1000 );
+				CHECK( stats.messagesSent.infos==numberOfThreads*1000 );
+				CHECK( stats.messagesSent.responses==0u );
+				CHECK( stats.messagesSent.total()==numberOfThreads*2000 );
+				CHECK( stats.bytesSent==numberOfThreads*1000*(request.size()+info.size()) );
+				CHECK( stats.messagesReceived.responses==numberOfThreads*1000 );
+				CHECK( stats.messagesReceived.total()==numberOfThreads*1000 );
+				CHECK( stats.bytesReceived==numberOfThreads*1000*10 );
+			}
+			else CHECK( stats.messagesSent.total()==0u );
+		}
+		WHEN( "I time some handlers" )
+		{
+			const auto now=communique::impl::StatsCounters::clock_type::now();
+			counters.requestHandled( now-std::chrono::milliseconds(3) );
+			counters.requestHandled( now-std::chrono::seconds(100) ); // Beyond the last bucket
+			counters.responseReceived( now+std::chrono::seconds(1) ); // In the future, as if the clock went backwards
+
+			communique::Stats stats;
+			counters.addTo( stats );
+			if( communique::Stats::enabled() )
+			{
+				CHECK( stats.requestHandlerTime.count==2 );
+				CHECK( stats.requestHandlerTime.buckets[12]==1 ); // 2048 to 4096us
+				CHECK( stats.requestHandlerTime.buckets[communique::LatencyHistogram::NUMBER_OF_BUCKETS-1]==1 );
+				CHECK( stats.infoHandlerTime.count==0 );
+				CHECK( stats.responseTime.count==1 );
+				CHECK( stats.responseTime.buckets[0]==1 );
+			}
+			else CHECK( stats.requestHandlerTime.count==0 );
+		}
+		WHEN( "I start lots of timers on a new thread" )
+		{
+			size_t samples=0;
+			std::thread( [&samples]()
+				{
+					for( size_t index=0; index<2*communique::impl::StatsCounters::TIMING_SAMPLE_INTERVAL; ++index )
+					{
+						const auto start=communique::impl::StatsCounters::startTimer();
+						if( start!=communique::impl::StatsCounters::clock_type::time_point() ) ++samples;
+					}
+				} ).join();
+			// Unsampled timings are ignored
+			counters.infoHandled( communique::impl::StatsCounters::clock_type::time_point() );
+
+			communique::Stats stats;
+			counters.addTo( stats );
+			CHECK( stats.infoHandlerTime.count==0 );
+			if( communique::Stats::enabled() ) CHECK( samples==2 );
+			else CHECK( samples==0 );
+		}
+	}
+}
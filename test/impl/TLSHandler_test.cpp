@@ -0,0 +1,48 @@
+#include <communique/impl/TLSHandler.h>
+#include "../catch.hpp"
+
+#include "../testinputs.h" // Constants like locations of the test inputs
+
+
+SCENARIO( "Test that TLSHandler shares one TLS context between connections", "[local][tools][TLSHandler]" )
+{
+	GIVEN( "A TLSHandler with a certificate and key set" )
+	{
+		websocketpp::config::asio::alog_type logger;
+		communique::impl::TLSHandler myHandler( logger );
+		REQUIRE_NOTHROW( myHandler.setCertificateChainFile( testinputs::testFileDirectory+"server_cert.pem" ) );
+		REQUIRE_NOTHROW( myHandler.setPrivateKeyFile( testinputs::testFileDirectory+"server_key.pem" ) );
+
+		WHEN( "I ask for a context for several connections" )
+		{
+			auto pFirstContext=myHandler.on_tls_init( websocketpp::connection_hdl() );
+			auto pSecondContext=myHandler.on_tls_init( websocketpp::connection_hdl() );
+			REQUIRE( pFirstContext!=nullptr );
+			CHECK( pFirstContext==pSecondContext );
+		}
+		WHEN( "I change a setting after the context was built" )
+		{
+			auto pFirstContext=myHandler.context();
+			REQUIRE_NOTHROW( myHandler.setVerifyFile( testinputs::testFileDirectory+"certificateAuthority_cert.pem" ) );
+			auto pSecondContext=myHandler.context();
+			CHECK( pFirstContext!=pSecondContext );
+			CHECK( pSecondContext==myHandler.on_tls_init( websocketpp::connection_hdl() ) );
+		}
+		WHEN( "I set a file that doesn't exist" )
+		{
+			REQUIRE_NOTHROW( myHandler.setVerifyFile( testinputs::testFileDirectory+"blahblahblah.pem" ) );
+			CHECK_THROWS( myHandler.context() );
+		}
+		WHEN( "I set the protocol versions and ciphers" )
+		{
+			CHECK_THROWS( myHandler.setProtocolVersions( communique::TLSVersion::TLSv1_3, communique::TLSVersion::TLSv1_2 ) );
+			REQUIRE_NOTHROW( myHandler.setProtocolVersions( communique::TLSVersion::TLSv1_2, communique::TLSVersion::TLSv1_3 ) );
+			REQUIRE_NOTHROW( myHandler.setCurves( "X25519:P-256" ) );
+			REQUIRE_NOTHROW( myHandler.setCipherList( "ECDHE-RSA-AES128-GCM-SHA256" ) );
+			CHECK_NOTHROW( myHandler.context() );
+
+			REQUIRE_NOTHROW( myHandler.setCipherList( "NotARealCipher" ) );
+			CHECK_THROWS( myHandler.context() );
+		}
+	}
+}
@@ -0,0 +1,77 @@
+#include <communique/impl/TimingWheel.h>
+#include "../catch.hpp"
+
+#include <atomic>
+#include <future>
+
+SCENARIO( "Test that TimingWheel behaves as expected", "[TimingWheel][tools]" )
+{
+	GIVEN( "A TimingWheel with 10ms ticks and only a few slots" )
+	{
+		// Use fewer slots than the longest timeout so that timers have to wait several rounds
+		communique::impl::TimingWheel myWheel( std::chrono::milliseconds(10), 4 );
+
+		WHEN( "I add some timers" )
+		{
+			std::atomic<int> shortFired(0);
+			std::atomic<int> longFired(0);
+			REQUIRE_NOTHROW( myWheel.add( std::chrono::milliseconds(20), [&]{ ++shortFired; } ) );
+			REQUIRE_NOTHROW( myWheel.add( std::chrono::milliseconds(150), [&]{ ++longFired; } ) );
+			CHECK( myWheel.size()==2 );
+
+			std::this_thread::sleep_for( std::chrono::milliseconds(80) );
+			CHECK( shortFired==1 );
+			CHECK( longFired==0 );
+			CHECK( myWheel.size()==1 );
+
+			std::this_thread::sleep_for( std::chrono::milliseconds(150) );
+			CHECK( shortFired==1 );
+			CHECK( longFired==1 );
+			CHECK( myWheel.size()==0 );
+		}
+		WHEN( "I cancel a timer" )
+		{
+			std::atomic<int> fired(0);
+			communique::impl::TimingWheel::TimerId id=myWheel.add( std::chrono::milliseconds(30), [&]{ ++fired; } );
+			CHECK( myWheel.cancel(id) );
+			CHECK( myWheel.cancel(id)==false );
+			std::this_thread::sleep_for( std::chrono::milliseconds(80) );
+			CHECK( fired==0 );
+		}
+		WHEN( "I add lots of timers" )
+		{
+			std::atomic<int> fired(0);
+			std::vector<communique::impl::TimingWheel::TimerId> ids;
+			for( size_t index=0; index<100000; ++index ) ids.push_back( myWheel.add( std::chrono::milliseconds(50), [&]{ ++fired; } ) );
+			// Cancel every other one. Adding the timers could take longer than the timeout on a slow
+			// machine, so keep count of how many were cancelled before they fired.
+			int cancelled=0;
+			for( size_t index=0; index<ids.size(); index+=2 )
+			{
+				if( myWheel.cancel( ids[index] ) ) ++cancelled;
+			}
+			CHECK( cancelled>0 );
+			std::this_thread::sleep_for( std::chrono::milliseconds(200) );
+			CHECK( fired==static_cast<int>(ids.size())-cancelled );
+			CHECK( myWheel.size()==0 );
+		}
+	}
+	GIVEN( "A TimingWheel that is only referenced by one of its own timers" )
+	{
+		auto pWheel=std::make_shared<communique::impl::TimingWheel>( std::chrono::milliseconds(10), 4 );
+
+		WHEN( "The timer destroys the wheel when it fires" )
+		{
+			std::promise<void> destroyed;
+			std::atomic<int> laterFired(0);
+			// Another timer due at the same time should simply be dropped
+			pWheel->add( std::chrono::milliseconds(20), [&pWheel,&destroyed]{ pWheel.reset(); destroyed.set_value(); } );
+			pWheel->add( std::chrono::milliseconds(20), [&laterFired]{ ++laterFired; } );
+
+			// Used to throw from join() in the destructor, which called std::terminate
+			REQUIRE( destroyed.get_future().wait_for( std::chrono::seconds(1) )==std::future_status::ready );
+			std::this_thread::sleep_for( std::chrono::milliseconds(50) );
+			CHECK( laterFired<=1 );
+		}
+	}
+}
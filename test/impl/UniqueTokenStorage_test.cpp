@@ -119,4 +119,65 @@ SCENARIO( "Test that UniqueTokenStorage behaves as expected", "[UniqueTokenStora
 			}
 		}
 	}
+	GIVEN( "A UniqueTokenStorage<std::string,uint32_t> instance" )
+	{
+		communique::impl::UniqueTokenStorage<std::string,uint32_t> myTokenStorage;
+
+		WHEN( "I reuse a slot after popping" )
+		{
+			uint32_t firstToken=myTokenStorage.push( "first" );
+			std::string retrievedValue;
+			REQUIRE( myTokenStorage.pop( firstToken, retrievedValue ) );
+			CHECK( retrievedValue=="first" );
+
+			// The new element reuses the slot, but the token should be different so that
+			// the old token can't be used to retrieve it.
+			uint32_t secondToken=myTokenStorage.push( "second" );
+			CHECK( secondToken!=firstToken );
+			CHECK( myTokenStorage.pop( firstToken, retrievedValue )==false );
+			CHECK_THROWS( myTokenStorage.at( firstToken ) );
+			REQUIRE_NOTHROW( myTokenStorage.at( secondToken ) );
+			CHECK( myTokenStorage.at( secondToken )=="second" );
+			CHECK( myTokenStorage.pop( secondToken )=="second" );
+		}
+		WHEN( "I conditionally pop an element" )
+		{
+			uint32_t token=myTokenStorage.push( "value" );
+			std::string retrievedValue;
+			CHECK( myTokenStorage.popIf( token, retrievedValue, [](const std::string& element){ return element=="other value"; } )==false );
+			REQUIRE_NOTHROW( myTokenStorage.at( token ) );
+			CHECK( myTokenStorage.popIf( token, retrievedValue, [](const std::string& element){ return element=="value"; } ) );
+			CHECK( retrievedValue=="value" );
+			CHECK_THROWS( myTokenStorage.at( token ) );
+		}
+		WHEN( "I pop everything at once" )
+		{
+			std::vector<uint32_t> tokens;
+			for( size_t index=0; index<10; ++index ) tokens.push_back( myTokenStorage.push( std::to_string(index) ) );
+			myTokenStorage.pop( tokens[4] );
+			CHECK( myTokenStorage.size()==9 );
+
+			std::vector<std::string> allElements=myTokenStorage.popAll();
+			CHECK( allElements.size()==9 );
+			CHECK( myTokenStorage.size()==0 );
+			for( const auto& token : tokens ) CHECK_THROWS( myTokenStorage.at( token ) );
+			// Make sure the container can still be used afterwards
+			uint32_t newToken=myTokenStorage.push( "new" );
+			CHECK( myTokenStorage.pop( newToken )=="new" );
+		}
+		WHEN( "I store lots of elements" )
+		{
+			// Make sure references from at() stay valid while the container grows
+			uint32_t firstToken=myTokenStorage.push( "first" );
+			std::string& firstElement=myTokenStorage.at( firstToken );
+			std::vector<uint32_t> tokens;
+			for( size_t index=0; index<100000; ++index ) tokens.push_back( myTokenStorage.push( std::to_string(index) ) );
+			CHECK( firstElement=="first" );
+
+			for( size_t index=0; index<tokens.size(); ++index )
+			{
+				REQUIRE( myTokenStorage.pop( tokens[index] )==std::to_string(index) );
+			}
+		}
+	}
 }